@@ -0,0 +1,256 @@
+#include "activity_chart.hpp"
+#include "iso_time.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <utility>
+
+namespace {
+
+constexpr const char* WEEKDAYS[7] = {"Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"};
+constexpr const char* MONTHS[12] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+// Shades from nothing up; a heatmap day is under 2, 4 or 6 hours, or more
+constexpr char SHADES[5] = {'.', '-', '+', '*', '#'};
+constexpr double DAY_STEPS[3] = {2.0, 4.0, 6.0};
+constexpr const char* SVG_COLORS[5] = {"#ebedf0", "#9be9a8", "#40c463", "#30a14e", "#216e39"};
+
+// Hour cells are shaded by their share of the busiest one, and the
+// per-hour bars drawn up to this wide
+constexpr size_t BAR_WIDTH = 40;
+
+constexpr int SVG_CELL = 11;
+constexpr int SVG_STEP = 13;
+constexpr int SVG_LEFT = 32;
+constexpr int SVG_TOP = 20;
+
+unsigned day_level(double hours) {
+    if (hours <= 0.0) return 0;
+    unsigned level = 1;
+    for (double step : DAY_STEPS) level += hours >= step;
+    return level;
+}
+
+unsigned hour_level(double hours, double busiest) {
+    if (hours <= 0.0 || busiest <= 0.0) return 0;
+    return std::min(4u, 1 + static_cast<unsigned>(hours / busiest * 4.0 - 1e-9));
+}
+
+std::string day_label(int64_t day) {
+    iso_time::CivilDate date = iso_time::civil_from_days(day);
+    char label[32];
+    std::snprintf(label, sizeof(label), "%04d-%02u-%02u", date.year, date.month, date.day);
+    return label;
+}
+
+std::string hours_text(double hours) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.2f", hours);
+    return text;
+}
+
+// (week column, month) where a month's name goes over the weeks starting
+// at first_monday: the week it begins in, if that leaves room after the
+// previous name
+std::vector<std::pair<size_t, unsigned>> month_labels(int64_t first_monday, size_t weeks, int64_t from_day) {
+    std::vector<std::pair<size_t, unsigned>> labels;
+    for (size_t week = 0; week < weeks; ++week) {
+        int64_t monday = first_monday + static_cast<int64_t>(week) * 7;
+        unsigned month = iso_time::civil_from_days(week == 0 ? from_day : monday + 6).month;
+        if (week > 0 && month == iso_time::civil_from_days(monday - 1).month) continue;
+        if (!labels.empty() && week < labels.back().first + 4) continue;
+        labels.emplace_back(week, month);
+    }
+    return labels;
+}
+
+void heatmap_svg(std::ostream& out, int64_t from_day, const std::vector<double>& hours) {
+    int64_t to_day = from_day + static_cast<int64_t>(hours.size()) - 1;
+    int64_t first_monday = from_day - iso_time::weekday(from_day);
+    size_t weeks = static_cast<size_t>((to_day - first_monday) / 7 + 1);
+    int width = SVG_LEFT + static_cast<int>(weeks) * SVG_STEP + 2;
+    int height = SVG_TOP + 7 * SVG_STEP + 24;
+
+    out << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << width << "\" height=\"" << height
+        << "\" font-family=\"sans-serif\" font-size=\"9\" fill=\"#57606a\">\n";
+    for (const auto& [week, month] : month_labels(first_monday, weeks, from_day)) {
+        out << "<text x=\"" << SVG_LEFT + static_cast<int>(week) * SVG_STEP << "\" y=\"" << SVG_TOP - 6 << "\">"
+            << MONTHS[month - 1] << "</text>\n";
+    }
+    for (unsigned weekday : {0u, 2u, 4u, 6u}) {
+        out << "<text x=\"0\" y=\"" << SVG_TOP + static_cast<int>(weekday) * SVG_STEP + SVG_CELL - 2 << "\">"
+            << WEEKDAYS[weekday] << "</text>\n";
+    }
+    for (int64_t day = from_day; day <= to_day; ++day) {
+        int64_t week = (day - first_monday) / 7;
+        double worked = hours[static_cast<size_t>(day - from_day)];
+        out << "<rect x=\"" << SVG_LEFT + week * SVG_STEP << "\" y=\""
+            << SVG_TOP + static_cast<int>(iso_time::weekday(day)) * SVG_STEP << "\" width=\"" << SVG_CELL
+            << "\" height=\"" << SVG_CELL << "\" rx=\"2\" fill=\"" << SVG_COLORS[day_level(worked)] << "\"><title>"
+            << day_label(day) << ": " << hours_text(worked) << " h</title></rect>\n";
+    }
+    int legend = SVG_TOP + 7 * SVG_STEP + 10;
+    out << "<text x=\"" << SVG_LEFT << "\" y=\"" << legend + 9 << "\">Less</text>\n";
+    for (int level = 0; level < 5; ++level) {
+        out << "<rect x=\"" << SVG_LEFT + 26 + level * SVG_STEP << "\" y=\"" << legend << "\" width=\"" << SVG_CELL
+            << "\" height=\"" << SVG_CELL << "\" rx=\"2\" fill=\"" << SVG_COLORS[level] << "\"/>\n";
+    }
+    out << "<text x=\"" << SVG_LEFT + 30 + 5 * SVG_STEP << "\" y=\"" << legend + 9 << "\">More</text>\n";
+    out << "</svg>\n";
+}
+
+// The empty cell colour blended towards the darkest by hours / busiest
+std::string shade(double hours, double busiest) {
+    constexpr unsigned EMPTY[3] = {0xeb, 0xed, 0xf0};
+    constexpr unsigned FULL[3] = {0x21, 0x6e, 0x39};
+    double share = busiest > 0.0 ? std::min(1.0, hours / busiest) : 0.0;
+    char color[8];
+    unsigned rgb[3];
+    for (int i = 0; i < 3; ++i) rgb[i] = static_cast<unsigned>(EMPTY[i] + (static_cast<double>(FULL[i]) - EMPTY[i]) * share + 0.5);
+    std::snprintf(color, sizeof(color), "#%02x%02x%02x", rgb[0], rgb[1], rgb[2]);
+    return color;
+}
+
+void by_hour_svg(std::ostream& out, const std::array<std::array<double, 24>, 7>& hours, double busiest) {
+    const int cell = 18;
+    const int step = 20;
+    out << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << SVG_LEFT + 24 * step + 2 << "\" height=\""
+        << SVG_TOP + 7 * step + 2 << "\" font-family=\"sans-serif\" font-size=\"9\" fill=\"#57606a\">\n";
+    for (int hour = 0; hour < 24; hour += 3) {
+        char label[8];
+        std::snprintf(label, sizeof(label), "%02d", hour);
+        out << "<text x=\"" << SVG_LEFT + hour * step << "\" y=\"" << SVG_TOP - 6 << "\">" << label << "</text>\n";
+    }
+    for (int weekday = 0; weekday < 7; ++weekday) {
+        out << "<text x=\"0\" y=\"" << SVG_TOP + weekday * step + cell - 5 << "\">" << WEEKDAYS[weekday]
+            << "</text>\n";
+        for (int hour = 0; hour < 24; ++hour) {
+            double worked = hours[weekday][hour];
+            char title[16];
+            std::snprintf(title, sizeof(title), " %02d:00: ", hour);
+            out << "<rect x=\"" << SVG_LEFT + hour * step << "\" y=\"" << SVG_TOP + weekday * step << "\" width=\""
+                << cell << "\" height=\"" << cell << "\" rx=\"2\" fill=\"" << shade(worked, busiest) << "\"><title>"
+                << WEEKDAYS[weekday] << title << hours_text(worked) << " h</title></rect>\n";
+        }
+    }
+    out << "</svg>\n";
+}
+
+} // namespace
+
+bool parse_chart_format(std::string_view text, ChartFormat& format) {
+    if (text == "text") format = ChartFormat::Text;
+    else if (text == "csv") format = ChartFormat::Csv;
+    else if (text == "svg") format = ChartFormat::Svg;
+    else return false;
+    return true;
+}
+
+void render_heatmap(std::ostream& out, int64_t from_day, const std::vector<double>& hours, ChartFormat format) {
+    if (hours.empty()) return;
+    int64_t to_day = from_day + static_cast<int64_t>(hours.size()) - 1;
+    if (format == ChartFormat::Csv) {
+        out << "date,weekday,hours\n";
+        for (int64_t day = from_day; day <= to_day; ++day) {
+            out << day_label(day) << "," << WEEKDAYS[iso_time::weekday(day)] << ","
+                << hours_text(hours[static_cast<size_t>(day - from_day)]) << "\n";
+        }
+        return;
+    }
+    if (format == ChartFormat::Svg) {
+        heatmap_svg(out, from_day, hours);
+        return;
+    }
+
+    double total = 0.0;
+    size_t worked = 0;
+    for (double day : hours) {
+        total += day;
+        worked += day > 0.0;
+    }
+    out << "\n=== Heatmap for " << day_label(from_day) << " to " << day_label(to_day) << " ===\n";
+    out << "Total Hours: " << hours_text(total) << "\n";
+    out << "Days Worked: " << worked;
+    if (worked > 0) out << " (" << hours_text(total / static_cast<double>(worked)) << " hours a day)";
+    out << "\n\n";
+
+    // A column per week, Monday first; days outside the range stay blank
+    int64_t first_monday = from_day - iso_time::weekday(from_day);
+    size_t weeks = static_cast<size_t>((to_day - first_monday) / 7 + 1);
+    std::string months(weeks + 3, ' ');
+    for (const auto& [week, month] : month_labels(first_monday, weeks, from_day)) months.replace(week, 3, MONTHS[month - 1]);
+    months.erase(months.find_last_not_of(' ') + 1);
+    out << "     " << months << "\n";
+    for (unsigned weekday = 0; weekday < 7; ++weekday) {
+        std::string row;
+        for (size_t week = 0; week < weeks; ++week) {
+            int64_t day = first_monday + static_cast<int64_t>(week) * 7 + weekday;
+            row += day < from_day || day > to_day ? ' ' : SHADES[day_level(hours[static_cast<size_t>(day - from_day)])];
+        }
+        row.erase(row.find_last_not_of(' ') + 1);
+        out << WEEKDAYS[weekday] << "  " << row << "\n";
+    }
+    out << "\n     " << SHADES[0] << " none  " << SHADES[1] << " under 2h  " << SHADES[2] << " 2-4h  "
+        << SHADES[3] << " 4-6h  " << SHADES[4] << " 6h or more\n";
+}
+
+void render_by_hour(std::ostream& out, int64_t from_day, int64_t to_day,
+                    const std::array<std::array<double, 24>, 7>& hours, ChartFormat format) {
+    double busiest = 0.0;
+    double total = 0.0;
+    std::array<double, 7> per_weekday{};
+    std::array<double, 24> per_hour{};
+    for (size_t weekday = 0; weekday < 7; ++weekday) {
+        for (size_t hour = 0; hour < 24; ++hour) {
+            double worked = hours[weekday][hour];
+            busiest = std::max(busiest, worked);
+            total += worked;
+            per_weekday[weekday] += worked;
+            per_hour[hour] += worked;
+        }
+    }
+
+    if (format == ChartFormat::Csv) {
+        out << "weekday,hour,hours\n";
+        for (size_t weekday = 0; weekday < 7; ++weekday) {
+            for (size_t hour = 0; hour < 24; ++hour) {
+                out << WEEKDAYS[weekday] << "," << hour << "," << hours_text(hours[weekday][hour]) << "\n";
+            }
+        }
+        return;
+    }
+    if (format == ChartFormat::Svg) {
+        by_hour_svg(out, hours, busiest);
+        return;
+    }
+
+    out << "\n=== Hours by Weekday and Hour for " << day_label(from_day) << " to " << day_label(to_day) << " ===\n";
+    out << "Total Hours: " << hours_text(total) << "\n\n";
+    std::string header = "     ";
+    for (int hour = 0; hour < 24; hour += 3) {
+        char label[8];
+        std::snprintf(label, sizeof(label), "%02d    ", hour);
+        header += label;
+    }
+    out << header << "   hours\n";
+    for (size_t weekday = 0; weekday < 7; ++weekday) {
+        std::string row;
+        for (size_t hour = 0; hour < 24; ++hour) row.append(2, SHADES[hour_level(hours[weekday][hour], busiest)]);
+        char worked[32];
+        std::snprintf(worked, sizeof(worked), "%10.2f", per_weekday[weekday]);
+        out << WEEKDAYS[weekday] << "  " << row << worked << "\n";
+    }
+    out << "\n     Each cell is an hour of the day, shaded by its share of the busiest one\n";
+
+    double busiest_hour = *std::max_element(per_hour.begin(), per_hour.end());
+    out << "\nPer hour:\n";
+    for (size_t hour = 0; hour < 24; ++hour) {
+        if (per_hour[hour] <= 0.0) continue;
+        size_t bar = static_cast<size_t>(per_hour[hour] / busiest_hour * BAR_WIDTH + 0.5);
+        char line[48];
+        std::snprintf(line, sizeof(line), "%02zu:00 %10.2f  ", hour, per_hour[hour]);
+        out << line << std::string(std::max<size_t>(bar, 1), '#') << "\n";
+    }
+}
@@ -0,0 +1,34 @@
+/*
+ * Time Tracker - heatmap and weekday-by-hour charts
+ *
+ * `report --heatmap` draws hours per day as a calendar: a column per week
+ * (Monday on top), a cell per day, shaded by hours worked. `report
+ * --by-hour` draws hours per clock hour of each weekday, with totals per
+ * weekday and per hour. Both are drawn from the rollup cache's buckets
+ * (rollup_cache.hpp), never from the log, as text for the terminal, CSV
+ * or a standalone SVG image.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+enum class ChartFormat {
+    Text,
+    Csv,
+    Svg
+};
+
+// Parses "text", "csv" or "svg"
+bool parse_chart_format(std::string_view text, ChartFormat& format);
+
+// hours[i] is the hours logged on day from_day + i (days since 1970-01-01)
+void render_heatmap(std::ostream& out, int64_t from_day, const std::vector<double>& hours, ChartFormat format);
+
+// hours[weekday][hour], weekday 0 = Monday, over days from_day..to_day
+void render_by_hour(std::ostream& out, int64_t from_day, int64_t to_day,
+                    const std::array<std::array<double, 24>, 7>& hours, ChartFormat format);
@@ -0,0 +1,503 @@
+/*
+ * Time Tracker - benchmark suite
+ *
+ * Generates synthetic time_logs.csv files and times the hot paths against
+ * them: the daily report (cold, with the index build, and warm), the range
+ * report (scanned, and from the rollup cache), the year heatmap and the
+ * weekday-by-hour chart, the task tree, search, a
+ * compiled query against the same filter scanned by hand, a sync delta,
+ * read_session_data, cold status (plain and --fast), the stop/append
+ * path (and the append alone, committed and synced per row), bulk import, export in each format, the reminder timer wheel and
+ * notification dispatch.
+ * Each result is printed as one JSON object per line:
+ *
+ *   {"benchmark":"daily_report","rows":100000,"iterations":200,
+ *    "p50_us":12.1,"p99_us":40.3,"throughput":71234.5,"unit":"ops/s",
+ *    "peak_rss_kb":5120}
+ *
+ * Build and run with `make bench` (BENCH_ROWS="10000 100000000" to pick
+ * log sizes). The benchmark runs in a scratch HOME and never reaches the
+ * desktop: the session bus and notify-send are hidden from it.
+ *
+ * ./time_tracker_bench.exe [--output results.jsonl] [--iterations N] rows...
+ * ./time_tracker_bench.exe --generate rows path/to/time_logs.csv
+ */
+
+#define TIME_TRACKER_NO_MAIN
+#include "time_tracker.cpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+// Descriptions in the style of documentation/sample_time_logs.csv
+const char* const DESCRIPTIONS[] = {
+    "Sprint planning and team standup",
+    "Implementing user authentication API",
+    "Code review and bug fixes",
+    "Database optimization and testing",
+    "Writing documentation for the REST endpoints",
+    "Customer call, follow-up notes",
+    "Refactoring the \"legacy\" report module",
+    "Deploy",
+    "Investigating flaky integration tests on CI",
+    "1:1 with manager",
+};
+const char* const USERS[] = {"time_tracker", "alice", "bob", "carol"};
+
+// Swallows command output; stateless, so the notifier thread may write too
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+};
+
+struct Options {
+    std::vector<uint64_t> rows;
+    std::string output;
+    size_t iterations = 200;
+};
+
+long peak_rss_kb() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return static_cast<long>(counters.PeakWorkingSetSize / 1024);
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024; // bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+void set_env(const char* name, const std::string& value) {
+#ifdef _WIN32
+    _putenv_s(name, value.c_str());
+#else
+    setenv(name, value.c_str(), 1);
+#endif
+}
+
+// Writes a log of `rows` rows ending today, several sessions per day,
+// and returns the dates it covers (oldest first)
+std::vector<std::string> generate_log(const fs::path& path, uint64_t rows) {
+    std::FILE* file = std::fopen(path.string().c_str(), "wb");
+    if (!file) throw std::runtime_error("Could not create " + path.string());
+    std::vector<char> buffer(1 << 20);
+    std::setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+
+    // Keep dates within a few decades however large the log is
+    uint64_t per_day = std::max<uint64_t>(8, rows / 20000);
+    uint64_t days = (rows + per_day - 1) / per_day;
+    int64_t today = static_cast<int64_t>(std::time(nullptr) / 86400);
+
+    // Description fields, quoted once up front
+    std::vector<std::string> fields;
+    for (const char* description : DESCRIPTIONS) {
+        std::ostringstream field;
+        write_csv_field(field, description);
+        fields.push_back(field.str());
+    }
+
+    std::mt19937 random(42);
+    std::vector<std::string> dates;
+    std::fputs("name,date,start_time,end_time,duration_hours,description\n", file);
+    for (uint64_t row = 0; row < rows; ++row) {
+        if (row % per_day == 0) {
+            iso_time::CivilDate civil = iso_time::civil_from_days(today - static_cast<int64_t>(days - row / per_day));
+            char date[32];
+            std::snprintf(date, sizeof(date), "%04d-%02u-%02u", civil.year, civil.month, civil.day);
+            dates.push_back(date);
+        }
+        unsigned start = 8 * 3600 + static_cast<unsigned>(random() % (9 * 3600));
+        unsigned length = 300 + static_cast<unsigned>(random() % (3 * 3600));
+        unsigned end = std::min(start + length, 86399u);
+
+        char line[256];
+        int written = std::snprintf(line, sizeof(line), "%s,%s,%02u:%02u:%02u,%02u:%02u:%02u,%.2f,%s\n",
+                                    USERS[random() % std::size(USERS)], dates.back().c_str(),
+                                    start / 3600, start / 60 % 60, start % 60,
+                                    end / 3600, end / 60 % 60, end % 60, (end - start) / 3600.0,
+                                    fields[random() % fields.size()].c_str());
+        std::fwrite(line, 1, static_cast<size_t>(written), file);
+    }
+    std::fclose(file);
+    return dates;
+}
+
+class Results {
+public:
+    explicit Results(const std::string& path) {
+        if (!path.empty()) {
+            file_.open(path, std::ios::app);
+            if (!file_) throw std::runtime_error("Could not open " + path);
+        }
+    }
+
+    // samples are per-operation latencies in microseconds; throughput is
+    // operations per second unless bytes_per_op is given (then MB/s)
+    void record(const std::string& name, uint64_t rows, std::vector<double> samples,
+                double bytes_per_op = 0.0) {
+        if (samples.empty()) return;
+        std::sort(samples.begin(), samples.end());
+        double total = 0.0;
+        for (double sample : samples) total += sample;
+        auto percentile = [&samples](double p) {
+            return samples[std::min(samples.size() - 1, static_cast<size_t>(p * samples.size()))];
+        };
+        double ops_per_second = total > 0.0 ? samples.size() * 1e6 / total : 0.0;
+        double throughput = bytes_per_op > 0.0 ? ops_per_second * bytes_per_op / 1e6 : ops_per_second;
+
+        char line[512];
+        std::snprintf(line, sizeof(line),
+                      "{\"benchmark\":\"%s\",\"rows\":%llu,\"iterations\":%zu,\"p50_us\":%.2f,"
+                      "\"p99_us\":%.2f,\"throughput\":%.2f,\"unit\":\"%s\",\"peak_rss_kb\":%ld}\n",
+                      name.c_str(), static_cast<unsigned long long>(rows), samples.size(),
+                      percentile(0.50), percentile(0.99), throughput,
+                      bytes_per_op > 0.0 ? "MB/s" : "ops/s", peak_rss_kb());
+        std::fputs(line, stdout);
+        std::fflush(stdout);
+        if (file_.is_open()) file_ << line << std::flush;
+    }
+
+private:
+    std::ofstream file_;
+};
+
+template <typename F>
+double time_us(F&& operation) {
+    auto begin = std::chrono::steady_clock::now();
+    operation();
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count();
+}
+
+void run_suite(uint64_t rows, size_t iterations, Results& results) {
+    fs::path home = fs::temp_directory_path() / ("time_tracker_bench_" + std::to_string(rows));
+    fs::remove_all(home);
+    fs::create_directories(home / ".time_tracker");
+    set_env("HOME", home.string());
+    set_env("USERPROFILE", home.string());
+
+    TimeTracker tracker;
+    fs::path csv_file = home / ".time_tracker" / "time_logs.csv";
+    fs::path state_file = home / ".time_tracker" / "current_session.json";
+
+    std::vector<std::string> dates;
+    std::vector<double> samples = {time_us([&] { dates = generate_log(csv_file, rows); })};
+    double csv_bytes = static_cast<double>(fs::file_size(csv_file));
+    results.record("generate_log", rows, samples, csv_bytes);
+
+    std::mt19937 random(7);
+    auto random_date = [&] { return dates[random() % dates.size()]; };
+
+    // First report builds the date index over the whole log
+    samples = {time_us([&] { tracker.generate_daily_report(random_date()); })};
+    results.record("daily_report_cold", rows, samples, csv_bytes);
+
+    samples.clear();
+    for (size_t i = 0; i < iterations; ++i) {
+        std::string date = random_date();
+        samples.push_back(time_us([&] { tracker.generate_daily_report(date); }));
+    }
+    results.record("daily_report", rows, samples);
+
+    int64_t from_day = 0;
+    int64_t to_day = 0;
+    iso_time::parse_day(dates.front(), from_day);
+    iso_time::parse_day(dates.back(), to_day);
+    samples.clear();
+    for (size_t i = 0; i < std::max<size_t>(1, iterations / 20); ++i) {
+        samples.push_back(time_us([&] { aggregate_range(csv_file, from_day, to_day, GroupBy::Description); }));
+    }
+    results.record("range_report", rows, samples, csv_bytes);
+
+    // Built from the whole log once; later reports add up cached totals
+    fs::path rollup_file = csv_file;
+    rollup_file.replace_extension(".rollup");
+    RollupCache rollup(csv_file, csv_file.parent_path() / "segments", rollup_file);
+    samples = {time_us([&] { rollup.totals(from_day, to_day, GroupBy::Description); })};
+    results.record("range_report_rollup_cold", rows, samples, csv_bytes);
+
+    samples.clear();
+    for (size_t i = 0; i < iterations; ++i) {
+        samples.push_back(time_us([&] { rollup.totals(from_day, to_day, GroupBy::Description); }));
+    }
+    results.record("range_report_rollup", rows, samples);
+
+    // report --heatmap and --by-hour over the last 53 weeks, drawn as text
+    // from the warm rollup
+    std::ostringstream chart;
+    int64_t year_from = to_day - iso_time::weekday(to_day) - 52 * 7;
+    samples.clear();
+    for (size_t i = 0; i < iterations; ++i) {
+        chart.str("");
+        samples.push_back(time_us([&] {
+            render_heatmap(chart, year_from, rollup.daily_hours(year_from, to_day), ChartFormat::Text);
+        }));
+    }
+    results.record("heatmap", rows, samples);
+
+    samples.clear();
+    for (size_t i = 0; i < iterations; ++i) {
+        chart.str("");
+        samples.push_back(time_us([&] {
+            render_by_hour(chart, year_from, to_day, rollup.weekly_hours(year_from, to_day), ChartFormat::Text);
+        }));
+    }
+    results.record("by_hour", rows, samples);
+
+    // Up to 100k distinct "project: task" descriptions, the shape of
+    // report --tree over the rollup's totals
+    std::vector<std::string> tasks;
+    for (uint64_t i = 0; i < std::min<uint64_t>(rows, 100000); ++i) {
+        tasks.push_back("project" + std::to_string(i % 64) + ": " + DESCRIPTIONS[i % std::size(DESCRIPTIONS)] +
+                        ": step " + std::to_string(i));
+    }
+    samples.clear();
+    for (size_t i = 0; i < std::max<size_t>(1, iterations / 20); ++i) {
+        samples.push_back(time_us([&] {
+            TaskTree tree;
+            for (const auto& task : tasks) tree.add(task, 1.0);
+            tree.preorder();
+        }));
+    }
+    results.record("task_tree", rows, samples);
+
+    // The index is built on first use. One word is answered from its kept
+    // totals; two are intersected, so cost follows the rarer word.
+    fs::path search_file = csv_file;
+    search_file.replace_extension(".search");
+    SearchIndex search(csv_file, csv_file.parent_path() / "segments", search_file);
+    samples = {time_us([&] { search.search({"auth*"}, 20); })};
+    results.record("search_cold", rows, samples, csv_bytes);
+
+    samples.clear();
+    for (size_t i = 0; i < iterations; ++i) {
+        samples.push_back(time_us([&] { search.search({"auth*"}, 20); }));
+    }
+    results.record("search", rows, samples);
+
+    samples.clear();
+    for (size_t i = 0; i < iterations; ++i) {
+        samples.push_back(time_us([&] { search.search({"user", "auth*"}, 20); }));
+    }
+    results.record("search_two_terms", rows, samples);
+
+    // A compiled query over the whole log, and the same filter written by
+    // hand as a baseline for the kernel
+    LogQuery query("user=alice AND duration>2 AND desc~review");
+    fs::path index_file = csv_file.parent_path() / "time_logs.idx";
+    samples.clear();
+    for (size_t i = 0; i < std::max<size_t>(1, iterations / 20); ++i) {
+        samples.push_back(time_us([&] { query.run(csv_file, index_file, csv_file.parent_path() / "segments", 20); }));
+    }
+    results.record("query", rows, samples, csv_bytes);
+
+    samples.clear();
+    for (size_t i = 0; i < std::max<size_t>(1, iterations / 20); ++i) {
+        samples.push_back(time_us([&] {
+            MappedFile csv(csv_file);
+            CsvTokenizer tokens(csv.view(), csv_next_record(csv.view(), 0, false));
+            CsvRecord record;
+            LogRow row;
+            double hours = 0.0;
+            while (tokens.next(record)) {
+                if (!parse_log_row(record, row) || row.name != "alice" || !(row.hours > 2)) continue;
+                if (row.description.find("review") != std::string_view::npos) hours += row.hours;
+            }
+            return hours;
+        }));
+    }
+    results.record("query_hand_scan", rows, samples, csv_bytes);
+
+    // A sync delta of the log's last rows, there and back: read, packed,
+    // unpacked and applied, where every row is a duplicate, so the log is
+    // left as it was and the cost is reading the days they cover
+    LogSync sync(csv_file, csv_file.parent_path() / "time_logs.wal", index_file, csv_file.parent_path() / "segments");
+    uint64_t delta_from = sync.end().offset - std::min<uint64_t>(sync.end().offset, 100 * 80);
+    samples.clear();
+    for (size_t i = 0; i < iterations; ++i) {
+        samples.push_back(time_us([&] {
+            std::string delta;
+            decode_sync_batch(encode_sync_batch(sync.read(delta_from).rows, true), delta);
+            if (sync.apply(delta).rows != 0) throw std::runtime_error("Sync appended duplicate rows");
+        }));
+    }
+    results.record("sync_delta", rows, samples);
+
+    SessionData session;
+    session.name = "time_tracker";
+    session.start_time = "2025-10-03T14:30:00";
+    session.description = DESCRIPTIONS[0];
+    session.valid = true;
+    std::string json;
+    encode_session(session, json);
+    write_file_atomic(state_file, json);
+    samples.clear();
+    for (size_t i = 0; i < iterations * 10; ++i) {
+        samples.push_back(time_us([&] { tracker.read_session_data(state_file); }));
+    }
+    results.record("read_session_data", rows, samples);
+    fs::remove(state_file);
+
+    // A fresh tracker per call, as each CLI invocation pays it
+    for (const char* mode : {"", "--fast"}) {
+        std::vector<std::string> args = {"status"};
+        if (*mode) args.push_back(mode);
+        samples.clear();
+        for (size_t i = 0; i < iterations * 10; ++i) {
+            samples.push_back(time_us([&] {
+                TimeTracker cold;
+                run_command(cold, args);
+            }));
+        }
+        results.record(*mode ? "status_fast_cold" : "status_cold", rows, samples);
+    }
+
+    // Start is untimed; stop is the append path (journal, fsync, index, mirror)
+    samples.clear();
+    for (size_t i = 0; i < iterations; ++i) {
+        tracker.start_tracking(DESCRIPTIONS[i % std::size(DESCRIPTIONS)]);
+        samples.push_back(time_us([&] { tracker.stop_tracking(); }));
+    }
+    results.record("stop_append", rows, samples);
+
+    // The append alone: committed through one appender, as the daemon does,
+    // and opened and synced for every row, as it used to
+    {
+        fs::path append_dir = home / "append";
+        fs::create_directories(append_dir);
+        const fs::path append_csv = append_dir / "time_logs.csv";
+        const fs::path append_journal = append_dir / "time_logs.wal";
+        const std::string row = "time_tracker,2025-10-03,14:30:00,15:30:00,1.00,Deploy\n";
+        samples.clear();
+        {
+            DurableAppender csv(append_csv, append_journal);
+            for (size_t i = 0; i < iterations; ++i) {
+                samples.push_back(time_us([&] {
+                    csv.append(row);
+                    csv.commit();
+                }));
+            }
+        }
+        results.record("append_commit", rows, samples);
+        samples.clear();
+        for (size_t i = 0; i < iterations; ++i) {
+            samples.push_back(time_us([&] {
+                DurableAppender csv(append_csv, append_journal);
+                csv.append(row);
+                csv.sync();
+            }));
+        }
+        results.record("append_reopen_sync", rows, samples);
+    }
+
+    // The whole log through the import pipeline into an empty one
+    fs::path import_dir = home / "import";
+    fs::create_directories(import_dir);
+    std::FILE* input = std::fopen(csv_file.string().c_str(), "rb");
+    if (!input) throw std::runtime_error("Could not open " + csv_file.string());
+    samples = {time_us([&] {
+        LogImporter(import_dir / "time_logs.csv", import_dir / "time_logs.wal", "bench").run(input);
+    })};
+    std::fclose(input);
+    results.record("import", rows, samples, csv_bytes);
+
+    // The whole log in each export format, to a file (the date index is warm)
+    LogExporter exporter(csv_file, csv_file.parent_path() / "time_logs.idx", csv_file.parent_path() / "segments");
+    for (const char* name : {"json", "arrow", "parquet", "ics"}) {
+        ExportFormat format;
+        parse_export_format(name, format);
+        fs::path export_file = home / (std::string("export.") + name);
+        std::FILE* output = std::fopen(export_file.string().c_str(), "wb");
+        if (!output) throw std::runtime_error("Could not open " + export_file.string());
+        samples = {time_us([&] { exporter.run(format, dates.front(), dates.back(), output); })};
+        std::fclose(output);
+        results.record(std::string("export_") + name, rows, samples, csv_bytes);
+    }
+
+    // As many reminders as rows, due over a week: scheduling them, cancelling
+    // every other one, then running the clock through the week (timed per
+    // timer, so throughput is timers a second)
+    {
+        std::mt19937_64 random(rows);
+        TimerWheel<uint64_t> wheel(1759500000);
+        std::vector<TimerWheel<uint64_t>::Id> ids(rows);
+        samples = {time_us([&] {
+            for (uint64_t i = 0; i < rows; ++i) ids[i] = wheel.schedule(wheel.now() + 1 + random() % 604800, i);
+        }) / rows};
+        results.record("timer_schedule", rows, samples);
+        samples = {time_us([&] {
+            for (uint64_t i = 0; i < rows; i += 2) wheel.cancel(ids[i]);
+        }) / (rows / 2)};
+        results.record("timer_cancel", rows / 2, samples);
+        uint64_t fired = 0;
+        samples = {time_us([&] { wheel.advance(wheel.now() + 604800, [&](uint64_t) { ++fired; }); }) / (rows / 2)};
+        if (fired != rows / 2) throw std::runtime_error("Timer wheel fired " + std::to_string(fired) + " timers");
+        results.record("timer_advance", fired, samples);
+    }
+
+    Notifier::instance().flush(std::chrono::seconds(5));
+    samples.clear();
+    for (size_t i = 0; i < iterations; ++i) {
+        samples.push_back(time_us([&] { Notifier::instance().post("Time Tracker", "Benchmark reminder"); }));
+    }
+    results.record("notification_post", rows, samples);
+    samples = {time_us([&] { Notifier::instance().flush(std::chrono::seconds(30)); })};
+    results.record("notification_drain", rows, samples);
+
+    fs::remove_all(home);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--output" && i + 1 < argc) {
+                options.output = argv[++i];
+            } else if (arg == "--iterations" && i + 1 < argc) {
+                options.iterations = std::max(1ul, std::stoul(argv[++i]));
+            } else if (arg == "--generate" && i + 2 < argc) {
+                uint64_t rows = std::stoull(argv[i + 1]);
+                generate_log(argv[i + 2], rows);
+                return 0;
+            } else {
+                options.rows.push_back(std::stoull(arg));
+            }
+        }
+        if (options.rows.empty()) options.rows = {10000, 100000, 1000000};
+
+        // Reminders must not reach the desktop, so hide the bus and notify-send
+        set_env("DBUS_SESSION_BUS_ADDRESS", "unix:path=/nonexistent");
+        set_env("PATH", "");
+
+        // Command output would swamp the results; only JSON lines are printed
+        NullBuffer discarded;
+        std::streambuf* console = std::cout.rdbuf(&discarded);
+
+        Results results(options.output);
+        for (uint64_t rows : options.rows) {
+            run_suite(rows, options.iterations, results);
+        }
+        std::cout.rdbuf(console);
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,217 @@
+#include "binary_log.hpp"
+#include "csv_tokenizer.hpp"
+#include "iso_time.hpp"
+#include "mapped_file.hpp"
+
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+constexpr char RECORDS_MAGIC[4] = {'T', 'T', 'B', 'L'};
+constexpr uint32_t RECORDS_VERSION = 1;
+
+struct RecordsHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t reserved;
+};
+
+} // namespace
+
+BinaryLog::BinaryLog(fs::path records_file, fs::path strings_file)
+    : records_file_(std::move(records_file)), strings_file_(std::move(strings_file)) {}
+
+bool BinaryLog::enabled() const {
+    return fs::exists(records_file_);
+}
+
+void BinaryLog::reset() {
+    records_map_.close();
+    RecordsHeader header{};
+    std::memcpy(header.magic, RECORDS_MAGIC, sizeof(RECORDS_MAGIC));
+    header.version = RECORDS_VERSION;
+    header.record_size = sizeof(BinaryRecord);
+
+    std::ofstream records(records_file_, std::ios::binary | std::ios::trunc);
+    records.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    std::ofstream strings(strings_file_, std::ios::binary | std::ios::trunc);
+
+    strings_.clear();
+    string_ids_.clear();
+    pending_strings_.clear();
+    pending_records_.clear();
+    strings_loaded_ = true;
+}
+
+void BinaryLog::load_strings() {
+    if (strings_loaded_) return;
+    strings_loaded_ = true;
+
+    MappedFile table(strings_file_);
+    std::string_view data = table.view();
+    size_t pos = 0;
+    while (pos + sizeof(uint32_t) <= data.size()) {
+        uint32_t length;
+        std::memcpy(&length, data.data() + pos, sizeof(length));
+        pos += sizeof(length);
+        if (pos + length > data.size()) break; // torn trailing entry
+        strings_.emplace_back(data.substr(pos, length));
+        string_ids_.emplace(strings_.back(), static_cast<uint32_t>(strings_.size() - 1));
+        pos += length;
+    }
+}
+
+uint32_t BinaryLog::intern(std::string_view text) {
+    load_strings();
+    auto it = string_ids_.find(std::string(text));
+    if (it != string_ids_.end()) return it->second;
+
+    uint32_t length = static_cast<uint32_t>(text.size());
+    pending_strings_.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    pending_strings_.append(text);
+
+    uint32_t id = static_cast<uint32_t>(strings_.size());
+    strings_.emplace_back(text);
+    string_ids_.emplace(strings_.back(), id);
+    return id;
+}
+
+const std::string& BinaryLog::string_at(uint32_t id) {
+    static const std::string empty;
+    load_strings();
+    return id < strings_.size() ? strings_[id] : empty;
+}
+
+void BinaryLog::add(int64_t start_epoch, int64_t end_epoch, uint32_t duration_seconds,
+                    std::string_view name, std::string_view description) {
+    BinaryRecord record{};
+    record.start_epoch = start_epoch;
+    record.end_epoch = end_epoch;
+    record.duration_seconds = duration_seconds;
+    record.user_id = intern(name);
+    record.description_id = intern(description);
+    pending_records_.push_back(record);
+}
+
+void BinaryLog::flush() {
+    records_map_.close();
+
+    // Strings go first so every record on disk refers to IDs that exist
+    if (!pending_strings_.empty()) {
+        std::ofstream table(strings_file_, std::ios::binary | std::ios::app);
+        table.write(pending_strings_.data(), static_cast<std::streamsize>(pending_strings_.size()));
+        pending_strings_.clear();
+    }
+    if (!pending_records_.empty()) {
+        std::ofstream records(records_file_, std::ios::binary | std::ios::app);
+        records.write(reinterpret_cast<const char*>(pending_records_.data()),
+                      static_cast<std::streamsize>(pending_records_.size() * sizeof(BinaryRecord)));
+        pending_records_.clear();
+    }
+}
+
+void BinaryLog::append(int64_t start_epoch, int64_t end_epoch, uint32_t duration_seconds,
+                       std::string_view name, std::string_view description) {
+    if (!enabled()) reset();
+    add(start_epoch, end_epoch, duration_seconds, name, description);
+    flush();
+}
+
+int64_t BinaryLog::local_epoch(std::string_view date, std::string_view clock) {
+    int64_t local_seconds = 0;
+    if (date.size() != 10 || clock.size() != 8 ||
+        !iso_time::parse_local(date, clock, local_seconds)) {
+        return -1;
+    }
+    return local_seconds;
+}
+
+size_t BinaryLog::import_csv(const fs::path& csv_path) {
+    MappedFile csv;
+    if (!csv.open(csv_path)) throw std::runtime_error("Could not open " + csv_path.string());
+    return import_rows(csv.view(), true);
+}
+
+size_t BinaryLog::import_rows(std::string_view text, bool has_header) {
+    if (!enabled()) reset();
+    load_strings();
+
+    CsvTokenizer rows(text);
+    CsvRecord row;
+    size_t imported = 0;
+    if (has_header) rows.next(row);
+    while (rows.next(row)) {
+        // name,date,start_time,end_time,duration_hours,description
+        if (row.fields.size() < CSV_COLUMNS) continue;
+        std::string_view date = row.fields[CSV_DATE];
+        std::string_view duration = row.fields[CSV_DURATION];
+
+        int64_t end_epoch = local_epoch(date, row.fields[CSV_END_TIME]);
+        int64_t start_epoch = local_epoch(date, row.fields[CSV_START_TIME]);
+        double hours = 0.0;
+        auto parsed = std::from_chars(duration.data(), duration.data() + duration.size(), hours);
+        if (end_epoch < 0 || start_epoch < 0 || parsed.ec != std::errc() || hours < 0) continue;
+
+        // The date column is the end date; a later start time means it began the day before
+        if (start_epoch > end_epoch) start_epoch -= 86400;
+
+        add(start_epoch, end_epoch, static_cast<uint32_t>(std::lround(hours * 3600.0)),
+            row.fields[CSV_NAME], row.description());
+        ++imported;
+    }
+    flush();
+    return imported;
+}
+
+const BinaryRecord* BinaryLog::map_records(size_t& count) {
+    count = 0;
+    if (!records_map_.open(records_file_) || records_map_.size() < sizeof(RecordsHeader)) {
+        return nullptr;
+    }
+    RecordsHeader header;
+    std::memcpy(&header, records_map_.data(), sizeof(header));
+    if (std::memcmp(header.magic, RECORDS_MAGIC, sizeof(RECORDS_MAGIC)) != 0 ||
+        header.record_size != sizeof(BinaryRecord)) {
+        throw std::runtime_error("Unrecognized binary log format: " + records_file_.string());
+    }
+    // A torn trailing record is ignored rather than read
+    count = (records_map_.size() - sizeof(RecordsHeader)) / sizeof(BinaryRecord);
+    return reinterpret_cast<const BinaryRecord*>(records_map_.data() + sizeof(RecordsHeader));
+}
+
+void BinaryLog::export_csv(std::ostream& out) {
+    size_t count;
+    const BinaryRecord* records = map_records(count);
+
+    out << "name,date,start_time,end_time,duration_hours,description\n";
+    auto write_clock = [&out](int64_t epoch) {
+        int64_t seconds = iso_time::seconds_of_day(epoch);
+        out << std::setw(2) << seconds / 3600 << ':'
+            << std::setw(2) << (seconds / 60) % 60 << ':'
+            << std::setw(2) << seconds % 60;
+    };
+
+    out << std::setfill('0');
+    for (size_t i = 0; i < count; ++i) {
+        const BinaryRecord& record = records[i];
+        iso_time::CivilDate end_date = iso_time::civil_from_days(iso_time::day_of(record.end_epoch));
+
+        write_csv_field(out, string_at(record.user_id));
+        out << ',' << std::setw(4) << end_date.year << '-' << std::setw(2) << end_date.month
+            << '-' << std::setw(2) << end_date.day << ',';
+        write_clock(record.start_epoch);
+        out << ',';
+        write_clock(record.end_epoch);
+        out << ',' << std::fixed << std::setprecision(2) << record.duration_seconds / 3600.0 << ',';
+        write_csv_field(out, string_at(record.description_id));
+        out << '\n';
+    }
+    out << std::setfill(' ');
+}
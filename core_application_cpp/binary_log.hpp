@@ -0,0 +1,94 @@
+/*
+ * Time Tracker - compact binary session store
+ *
+ * An optional append-only companion to time_logs.csv. Each session is one
+ * fixed-width record of packed integers; user names and descriptions are
+ * interned into a separate string table and referenced by ID, so scans over
+ * the store never parse text.
+ *
+ *   time_logs.bin      header + BinaryRecord[]
+ *   time_logs.strings  [u32 length][bytes] per interned string, ID = ordinal
+ *
+ * Timestamps are local wall-clock seconds since 1970-01-01T00:00:00, i.e.
+ * the civil date/time written to the CSV, not UTC. That keeps export-csv
+ * byte-for-byte faithful to the text log regardless of the time zone.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "mapped_file.hpp"
+
+namespace fs = std::filesystem;
+
+struct BinaryRecord {
+    int64_t start_epoch;       // local seconds at session start
+    int64_t end_epoch;         // local seconds at session end
+    uint32_t duration_seconds;
+    uint32_t user_id;          // index into the string table
+    uint32_t description_id;   // index into the string table
+    uint32_t reserved;
+};
+static_assert(sizeof(BinaryRecord) == 32, "BinaryRecord must stay fixed-width");
+
+class BinaryLog {
+public:
+    BinaryLog(fs::path records_file, fs::path strings_file);
+
+    // The store is enabled once its records file exists (see import-csv)
+    bool enabled() const;
+
+    // Creates an empty store, discarding any existing records and strings
+    void reset();
+
+    // Appends one session, interning name/description as needed
+    void append(int64_t start_epoch, int64_t end_epoch, uint32_t duration_seconds,
+                std::string_view name, std::string_view description);
+
+    // "YYYY-MM-DD" + "HH:MM:SS" -> local seconds since epoch, or -1 if malformed
+    static int64_t local_epoch(std::string_view date, std::string_view clock);
+
+    // Appends every row of a CSV in the time_logs.csv schema.
+    // Returns the number of rows imported; malformed rows are skipped.
+    size_t import_csv(const fs::path& csv_path);
+
+    // Same, for CSV rows already in memory (a sealed segment has no header)
+    size_t import_rows(std::string_view text, bool has_header);
+
+    // Writes the store back out in the time_logs.csv schema
+    void export_csv(std::ostream& out);
+
+    // Read-only view of all records for sequential scans.
+    // Valid until the next call to map_records() or until the store changes.
+    const BinaryRecord* map_records(size_t& count);
+
+    // String for an interned ID (empty if unknown)
+    const std::string& string_at(uint32_t id);
+
+private:
+    void load_strings();
+    uint32_t intern(std::string_view text);
+
+    // Buffers a record; flush() writes pending strings and records in two writes
+    void add(int64_t start_epoch, int64_t end_epoch, uint32_t duration_seconds,
+             std::string_view name, std::string_view description);
+    void flush();
+
+    fs::path records_file_;
+    fs::path strings_file_;
+    MappedFile records_map_;
+
+    bool strings_loaded_ = false;
+    std::vector<std::string> strings_;
+    std::unordered_map<std::string, uint32_t> string_ids_;
+
+    std::string pending_strings_;
+    std::vector<BinaryRecord> pending_records_;
+};
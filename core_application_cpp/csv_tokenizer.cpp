@@ -0,0 +1,317 @@
+#include "csv_tokenizer.hpp"
+#include "iso_time.hpp"
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+inline unsigned count_trailing_zeros(uint64_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#endif
+}
+
+inline unsigned population_count(uint64_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    return static_cast<unsigned>(__popcnt64(mask));
+#else
+    return static_cast<unsigned>(__builtin_popcountll(mask));
+#endif
+}
+
+inline bool is_structural(char c) {
+    return c == ',' || c == '"' || c == '\n';
+}
+
+} // namespace
+
+const char* csv_find_structural(const char* p, const char* end) {
+#if defined(__AVX2__)
+    const __m256i comma32 = _mm256_set1_epi8(',');
+    const __m256i quote32 = _mm256_set1_epi8('"');
+    const __m256i newline32 = _mm256_set1_epi8('\n');
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, comma32),
+                                                       _mm256_cmpeq_epi8(v, quote32)),
+                                       _mm256_cmpeq_epi8(v, newline32));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+        if (mask) return p + count_trailing_zeros(mask);
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, comma), _mm_cmpeq_epi8(v, quote)),
+                                    _mm_cmpeq_epi8(v, newline));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hits));
+        if (mask) return p + count_trailing_zeros(mask);
+    }
+#elif defined(__ARM_NEON)
+    const uint8x16_t comma = vdupq_n_u8(',');
+    const uint8x16_t quote = vdupq_n_u8('"');
+    const uint8x16_t newline = vdupq_n_u8('\n');
+    for (; end - p >= 16; p += 16) {
+        uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+        uint8x16_t hits = vorrq_u8(vorrq_u8(vceqq_u8(v, comma), vceqq_u8(v, quote)), vceqq_u8(v, newline));
+        // Narrow each 0x00/0xff byte to a nibble: 4 mask bits per input byte
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(hits), 4)), 0);
+        if (mask) return p + count_trailing_zeros(mask) / 4;
+    }
+#endif
+    while (p < end && !is_structural(*p)) ++p;
+    return p;
+}
+
+size_t csv_count_quotes(const char* p, size_t size) {
+    const char* end = p + size;
+    size_t count = 0;
+#if defined(__AVX2__)
+    const __m256i quote32 = _mm256_set1_epi8('"');
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        count += population_count(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, quote32))));
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        count += population_count(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote))));
+    }
+#elif defined(__ARM_NEON)
+    const uint8x16_t quote = vdupq_n_u8('"');
+    for (; end - p >= 16; p += 16) {
+        uint8x16_t hits = vceqq_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(p)), quote);
+        count += vaddvq_u8(vshrq_n_u8(hits, 7));
+    }
+#endif
+    for (; p < end; ++p) count += *p == '"';
+    return count;
+}
+
+size_t csv_next_record(std::string_view data, size_t pos, bool in_quotes) {
+    const char* p = data.data() + std::min(pos, data.size());
+    const char* end = data.data() + data.size();
+    while (p < end) {
+        if (in_quotes) {
+            const void* quote = std::memchr(p, '"', static_cast<size_t>(end - p));
+            if (!quote) return data.size();
+            p = static_cast<const char*>(quote) + 1;
+            in_quotes = false;
+            continue;
+        }
+        p = csv_find_structural(p, end);
+        if (p == end) break;
+        if (*p == '\n') return static_cast<size_t>(p - data.data()) + 1;
+        if (*p == '"') in_quotes = true;
+        ++p;
+    }
+    return data.size();
+}
+
+std::string_view CsvRecord::description() const {
+    if (fields.size() <= CSV_COLUMNS) {
+        return fields.size() > CSV_DESCRIPTION ? fields[CSV_DESCRIPTION] : std::string_view();
+    }
+    // Legacy row with an unquoted comma: the description runs to the end of
+    // the line. An unescaped field lives in scratch, so start from its raw text.
+    const char* start = fields[CSV_DESCRIPTION].data();
+    for (const auto& entry : escaped) {
+        if (entry.field == CSV_DESCRIPTION) start = line.data() + (entry.raw - begin);
+    }
+    std::string_view tail(start, static_cast<size_t>(line.data() + line.size() - start));
+    if (!tail.empty() && tail.back() == '\r') tail.remove_suffix(1);
+    return tail;
+}
+
+namespace {
+
+bool parse_fields(const CsvRecord& record, LogRow& row) {
+    // name,date,start_time,end_time,duration_hours,description
+    if (record.fields.size() < CSV_COLUMNS) return false;
+    row.date = record.fields[CSV_DATE];
+    if (row.date.size() != 10 || !iso_time::parse_day(row.date, row.day)) return false;
+    std::string_view duration = record.fields[CSV_DURATION];
+    auto parsed = std::from_chars(duration.data(), duration.data() + duration.size(), row.hours);
+    if (parsed.ec != std::errc() || parsed.ptr != duration.data() + duration.size()) return false;
+    row.name = record.fields[CSV_NAME];
+    row.start_time = record.fields[CSV_START_TIME];
+    row.end_time = record.fields[CSV_END_TIME];
+    row.description = record.description();
+    return true;
+}
+
+} // namespace
+
+bool parse_log_row(const CsvRecord& record, LogRow& row) {
+#ifdef TIME_TRACKER_METRICS
+    thread_local unsigned calls = 0;
+    if (++calls % metrics::SAMPLE_EVERY == 0) {
+        auto start = std::chrono::steady_clock::now();
+        bool parsed = parse_fields(record, row);
+        METRIC_RECORD(PARSE_ROW, metrics::elapsed_ns(start));
+        return parsed;
+    }
+#endif
+    return parse_fields(record, row);
+}
+
+bool CsvRecord::unescaped(size_t i) const {
+    for (const auto& entry : escaped) {
+        if (entry.field == i) return true;
+    }
+    return false;
+}
+
+CsvTokenizer::CsvTokenizer(std::string_view data, size_t offset)
+    : data_(data), pos_(std::min(offset, data.size())), start_(pos_) {}
+
+CsvTokenizer::~CsvTokenizer() {
+    METRIC_ADD(ROWS_PARSED, records_);
+    METRIC_ADD(BYTES_READ, pos_ - start_);
+}
+
+bool CsvTokenizer::next(CsvRecord& record) {
+#ifdef TIME_TRACKER_METRICS
+    // One record in SAMPLE_EVERY is timed
+    bool sampled = records_ % metrics::SAMPLE_EVERY == metrics::SAMPLE_EVERY - 1;
+    auto start = sampled ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+    bool found = read(record);
+    if (sampled && found) METRIC_RECORD(TOKENIZE, metrics::elapsed_ns(start));
+    records_ += found;
+    return found;
+#else
+    return read(record);
+#endif
+}
+
+bool CsvTokenizer::read(CsvRecord& record) {
+    if (pos_ >= data_.size()) return false;
+
+    record.fields.clear();
+    record.scratch.clear();
+    record.escaped.clear();
+    record.begin = pos_;
+    record.terminated = false;
+
+    const char* base = data_.data();
+    const char* end = base + data_.size();
+    const char* p = base + pos_;
+    const char* line_end = end;
+
+    for (;;) {
+        std::string_view field;
+        const char* after; // the delimiter that ended the field, or end
+
+        if (p < end && *p == '"') {
+            // Quoted field: runs to the next quote that is not doubled
+            const char* segment = p + 1;
+            const char* q = segment;
+            bool has_escapes = false;
+            size_t scratch_start = record.scratch.size();
+            for (;;) {
+                const void* found = std::memchr(q, '"', static_cast<size_t>(end - q));
+                const char* quote = found ? static_cast<const char*>(found) : end;
+                if (quote + 1 < end && quote[1] == '"') {
+                    record.scratch.append(segment, static_cast<size_t>(quote + 1 - segment));
+                    has_escapes = true;
+                    segment = q = quote + 2;
+                    continue;
+                }
+                if (has_escapes) {
+                    record.scratch.append(segment, static_cast<size_t>(quote - segment));
+                    record.escaped.push_back(CsvRecord::Escaped{record.fields.size(), scratch_start,
+                                                                static_cast<size_t>(p + 1 - base)});
+                    field = std::string_view(nullptr, record.scratch.size() - scratch_start);
+                } else {
+                    field = std::string_view(p + 1, static_cast<size_t>(quote - p - 1));
+                }
+                q = quote < end ? quote + 1 : end;
+                break;
+            }
+            // Anything between the closing quote and the delimiter is ignored
+            after = q;
+            while (after < end && *after != ',' && *after != '\n') ++after;
+        } else {
+            // Unquoted field: a stray quote inside it is literal text
+            after = csv_find_structural(p, end);
+            while (after < end && *after == '"') after = csv_find_structural(after + 1, end);
+            field = std::string_view(p, static_cast<size_t>(after - p));
+            // End of record: drop the '\r' of a CRLF terminator
+            if (after < end && *after == '\n' && !field.empty() && field.back() == '\r') {
+                field.remove_suffix(1);
+            }
+        }
+
+        if (after < end && *after == ',') {
+            record.fields.push_back(field);
+            p = after + 1;
+            continue;
+        }
+
+        record.fields.push_back(field);
+        line_end = after;
+        if (after < end) {
+            record.terminated = true;
+            ++after;
+        }
+        pos_ = static_cast<size_t>(after - base);
+        break;
+    }
+
+    // Scratch may have grown while the record was read; bind views now
+    for (const auto& entry : record.escaped) {
+        record.fields[entry.field] =
+            std::string_view(record.scratch.data() + entry.scratch, record.fields[entry.field].size());
+    }
+
+    std::string_view line(base + record.begin, static_cast<size_t>(line_end - base) - record.begin);
+    if (record.terminated && !line.empty() && line.back() == '\r') line.remove_suffix(1);
+    record.line = line;
+    record.end = pos_;
+    return true;
+}
+
+void write_csv_field(std::ostream& out, std::string_view text) {
+    if (text.find_first_of(",\"\r\n") == std::string_view::npos) {
+        out << text;
+        return;
+    }
+    out << '"';
+    for (char c : text) {
+        if (c == '"') out << '"';
+        out << c;
+    }
+    out << '"';
+}
+
+void write_csv_field(std::string& out, std::string_view text) {
+    if (text.find_first_of(",\"\r\n") == std::string_view::npos) {
+        out.append(text);
+        return;
+    }
+    out += '"';
+    for (char c : text) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    out += '"';
+}
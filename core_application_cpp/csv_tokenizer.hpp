@@ -0,0 +1,111 @@
+/*
+ * Time Tracker - streaming RFC-4180 CSV tokenizer
+ *
+ * Splits CSV text into records and fields without copying: fields are
+ * string_views into the input, except quoted fields containing escaped
+ * quotes (""), which are unescaped into the record's scratch buffer.
+ * Quoted fields may contain commas and newlines.
+ *
+ * Delimiters, quotes and newlines are located a vector at a time (AVX2,
+ * SSE2 or NEON, whichever the build targets) with a scalar fallback.
+ * Every reader of time_logs.csv uses this tokenizer.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Column positions in time_logs.csv
+enum CsvColumn {
+    CSV_NAME = 0,
+    CSV_DATE = 1,
+    CSV_START_TIME = 2,
+    CSV_END_TIME = 3,
+    CSV_DURATION = 4,
+    CSV_DESCRIPTION = 5,
+    CSV_COLUMNS = 6
+};
+
+struct CsvRecord {
+    std::vector<std::string_view> fields;
+    std::string_view line;   // raw record text without its line terminator
+    size_t begin = 0;        // offset of the record in the input
+    size_t end = 0;          // offset just past the record's line terminator
+    bool terminated = false; // false for a trailing row with no newline yet
+
+    // Description column. Rows written before descriptions were quoted may
+    // hold unquoted commas; everything after the fifth comma is then used.
+    std::string_view description() const;
+
+    // True if fields[i] points into scratch rather than into the input
+    bool unescaped(size_t i) const;
+
+private:
+    friend class CsvTokenizer;
+    struct Escaped {
+        size_t field;   // index into fields
+        size_t scratch; // where the unescaped text starts in scratch
+        size_t raw;     // where the quoted text starts in the input
+    };
+    std::string scratch;
+    std::vector<Escaped> escaped;
+};
+
+// One time_logs.csv row as the reports see it. The text fields view the
+// tokenized input (or the record's scratch buffer), so a row is only
+// valid until the next call to next(); intern a field to keep it.
+struct LogRow {
+    std::string_view name;
+    std::string_view date;
+    std::string_view start_time;
+    std::string_view end_time;
+    std::string_view description;
+    int64_t day = 0; // days since 1970-01-01
+    double hours = 0.0;
+};
+
+// Fills row from a record; false if a column is missing or the date or
+// duration is malformed
+bool parse_log_row(const CsvRecord& record, LogRow& row);
+
+class CsvTokenizer {
+public:
+    // Tokenizes data starting at offset, which must be the start of a record
+    explicit CsvTokenizer(std::string_view data, size_t offset = 0);
+    ~CsvTokenizer(); // adds what was read to the metrics
+    CsvTokenizer(const CsvTokenizer&) = delete;
+    CsvTokenizer& operator=(const CsvTokenizer&) = delete;
+
+    // Reads the next record; returns false once the input is exhausted
+    bool next(CsvRecord& record);
+
+    size_t offset() const { return pos_; }
+
+private:
+    bool read(CsvRecord& record);
+
+    std::string_view data_;
+    size_t pos_;
+    size_t start_;
+    uint64_t records_ = 0;
+};
+
+// First ',', '"' or '\n' in [p, end), or end if there is none
+const char* csv_find_structural(const char* p, const char* end);
+
+// Number of '"' characters in [p, p + size)
+size_t csv_count_quotes(const char* p, size_t size);
+
+// Offset of the first record starting at or after pos, given whether pos
+// lies inside a quoted field. Used to cut a log into chunks on row boundaries.
+size_t csv_next_record(std::string_view data, size_t pos, bool in_quotes);
+
+// Writes text as one CSV field, quoting it only when RFC-4180 requires it
+void write_csv_field(std::ostream& out, std::string_view text);
+void write_csv_field(std::string& out, std::string_view text);
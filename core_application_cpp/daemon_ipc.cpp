@@ -0,0 +1,550 @@
+#include "daemon_ipc.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "ws2_32.lib")
+#endif
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Largest request or response accepted; reports are the only large payloads
+constexpr uint32_t MAX_MESSAGE_BYTES = 64u << 20;
+
+// A TCP peer that stops sending or reading for this long is dropped, so one
+// stalled client cannot hold up the team server
+constexpr int TCP_TIMEOUT_MS = 10000;
+
+std::string encode_args(const std::vector<std::string>& args) {
+    std::string payload;
+    for (const auto& arg : args) {
+        payload += arg;
+        payload += '\0';
+    }
+    return payload;
+}
+
+std::vector<std::string> decode_args(const std::string& payload) {
+    std::vector<std::string> args;
+    size_t pos = 0;
+    while (pos < payload.size()) {
+        size_t end = payload.find('\0', pos);
+        if (end == std::string::npos) end = payload.size();
+        args.emplace_back(payload, pos, end - pos);
+        pos = end + 1;
+    }
+    return args;
+}
+
+#ifdef _WIN32
+using Channel = HANDLE;
+
+bool write_all(Channel channel, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        DWORD written = 0;
+        if (!WriteFile(channel, p, static_cast<DWORD>(size), &written, NULL)) return false;
+        p += written;
+        size -= written;
+    }
+    return true;
+}
+
+bool read_all(Channel channel, void* data, size_t size) {
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+        DWORD got = 0;
+        if (!ReadFile(channel, p, static_cast<DWORD>(size), &got, NULL) || got == 0) return false;
+        p += got;
+        size -= got;
+    }
+    return true;
+}
+
+std::wstring wide(const std::string& text) {
+    return fs::path(text).wstring();
+}
+
+using Socket = SOCKET;
+const Socket NO_SOCKET = INVALID_SOCKET;
+
+bool write_all(Socket channel, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        int written = send(channel, p, static_cast<int>(size), 0);
+        if (written <= 0) return false;
+        p += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool read_all(Socket channel, void* data, size_t size) {
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+        int got = recv(channel, p, static_cast<int>(size), 0);
+        if (got <= 0) return false;
+        p += got;
+        size -= static_cast<size_t>(got);
+    }
+    return true;
+}
+
+void close_socket(Socket channel) {
+    closesocket(channel);
+}
+
+int socket_error() {
+    return WSAGetLastError();
+}
+
+// Winsock needs one WSAStartup per process before any socket call
+bool network_ready() {
+    static const bool ready = [] {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    return ready;
+}
+#else
+using Channel = int;
+
+bool write_all(Channel channel, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = send(channel, p, size, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        p += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool read_all(Channel channel, void* data, size_t size) {
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t got = recv(channel, p, size, 0);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        p += got;
+        size -= static_cast<size_t>(got);
+    }
+    return true;
+}
+
+bool make_address(const std::string& endpoint, sockaddr_un& address) {
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (endpoint.size() >= sizeof(address.sun_path)) return false;
+    std::memcpy(address.sun_path, endpoint.c_str(), endpoint.size() + 1);
+    return true;
+}
+
+using Socket = int;
+const Socket NO_SOCKET = -1;
+
+void close_socket(Socket channel) {
+    close(channel);
+}
+
+int socket_error() {
+    return errno;
+}
+
+bool network_ready() {
+    return true;
+}
+
+int connect_endpoint(const std::string& endpoint) {
+    sockaddr_un address;
+    if (!make_address(endpoint, address)) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+#endif
+
+// Splits "host:port"; an empty host (":7464") means every interface.
+// IPv6 hosts are written in brackets: "[::1]:7464".
+bool split_address(const std::string& address, std::string& host, std::string& port) {
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos || colon + 1 == address.size()) return false;
+    host = address.substr(0, colon);
+    port = address.substr(colon + 1);
+    if (host.size() >= 2 && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+    }
+    return true;
+}
+
+void configure_tcp(Socket channel) {
+    // Frames are written in pieces and answered at once; don't let Nagle
+    // hold the last piece back waiting for an ACK
+    int on = 1;
+    setsockopt(channel, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&on), sizeof(on));
+#ifdef _WIN32
+    DWORD timeout = TCP_TIMEOUT_MS;
+#else
+    timeval timeout{TCP_TIMEOUT_MS / 1000, 0};
+#endif
+    setsockopt(channel, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+    setsockopt(channel, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+}
+
+// Resolves address and returns a connected (client) or listening (server)
+// socket, trying each resolved address in turn
+Socket open_tcp(const std::string& address, bool listening) {
+    std::string host, port;
+    if (!network_ready() || !split_address(address, host, port)) return NO_SOCKET;
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = listening ? AI_PASSIVE : 0;
+    addrinfo* found = nullptr;
+    if (getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &found) != 0) {
+        return NO_SOCKET;
+    }
+
+    Socket channel = NO_SOCKET;
+    for (addrinfo* candidate = found; candidate && channel == NO_SOCKET; candidate = candidate->ai_next) {
+        int type = candidate->ai_socktype;
+#ifdef SOCK_CLOEXEC
+        type |= SOCK_CLOEXEC;
+#endif
+        channel = socket(candidate->ai_family, type, candidate->ai_protocol);
+        if (channel == NO_SOCKET) continue;
+        bool ok;
+        if (listening) {
+            int on = 1;
+            setsockopt(channel, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&on), sizeof(on));
+            ok = bind(channel, candidate->ai_addr, static_cast<int>(candidate->ai_addrlen)) == 0 &&
+                 listen(channel, SOMAXCONN) == 0;
+        } else {
+            ok = connect(channel, candidate->ai_addr, static_cast<int>(candidate->ai_addrlen)) == 0;
+        }
+        if (!ok) {
+            close_socket(channel);
+            channel = NO_SOCKET;
+        }
+    }
+    freeaddrinfo(found);
+    if (channel != NO_SOCKET && !listening) configure_tcp(channel);
+    return channel;
+}
+
+// Framing is shared by the local channel and TCP; on Windows those are
+// different handle types with their own write_all/read_all overloads
+template <typename Channel>
+bool write_frame(Channel channel, const std::string& payload) {
+    uint32_t length = static_cast<uint32_t>(payload.size());
+    return write_all(channel, &length, sizeof(length)) &&
+           write_all(channel, payload.data(), payload.size());
+}
+
+template <typename Channel>
+bool read_frame(Channel channel, std::string& payload) {
+    uint32_t length = 0;
+    if (!read_all(channel, &length, sizeof(length)) || length > MAX_MESSAGE_BYTES) return false;
+    payload.resize(length);
+    return read_all(channel, payload.data(), length);
+}
+
+template <typename Channel>
+bool exchange(Channel channel, const std::vector<std::string>& args,
+              std::string& output, int& exit_code) {
+    int32_t code = 1;
+    if (!write_frame(channel, encode_args(args)) ||
+        !read_all(channel, &code, sizeof(code)) ||
+        !read_frame(channel, output)) {
+        return false;
+    }
+    exit_code = code;
+    return true;
+}
+
+template <typename Channel>
+void respond(Channel channel, const ControlServer::Handler& handler) {
+    std::string payload;
+    if (!read_frame(channel, payload)) return;
+
+    std::string output;
+    int32_t code = 1;
+    try {
+        code = handler(decode_args(payload), output);
+    } catch (const std::exception& e) {
+        output += std::string("Error: ") + e.what() + "\n";
+    }
+    if (output.size() > MAX_MESSAGE_BYTES) {
+        output.resize(MAX_MESSAGE_BYTES);
+    }
+    if (write_all(channel, &code, sizeof(code))) {
+        write_frame(channel, output);
+    }
+}
+
+bool wait_for_endpoint(const std::string& endpoint) {
+    std::string output;
+    int exit_code = 0;
+    for (int attempt = 0; attempt < 200; ++attempt) {
+        if (control_call(endpoint, {"ping"}, output, exit_code)) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+} // namespace
+
+std::string control_endpoint(const fs::path& config_dir) {
+#ifdef _WIN32
+    // Pipe names live in their own namespace; derive one from the config path
+    std::string name = config_dir.string();
+    for (auto& c : name) {
+        if (c == '\\' || c == '/' || c == ':') c = '_';
+    }
+    return "\\\\.\\pipe\\time_tracker" + name;
+#else
+    return (config_dir / "daemon.sock").string();
+#endif
+}
+
+bool control_call(const std::string& endpoint, const std::vector<std::string>& args,
+                  std::string& output, int& exit_code) {
+#ifdef _WIN32
+    HANDLE pipe = CreateFileW(wide(endpoint).c_str(), GENERIC_READ | GENERIC_WRITE,
+                              0, NULL, OPEN_EXISTING, 0, NULL);
+    if (pipe == INVALID_HANDLE_VALUE && GetLastError() == ERROR_PIPE_BUSY &&
+        WaitNamedPipeW(wide(endpoint).c_str(), 2000)) {
+        pipe = CreateFileW(wide(endpoint).c_str(), GENERIC_READ | GENERIC_WRITE,
+                           0, NULL, OPEN_EXISTING, 0, NULL);
+    }
+    if (pipe == INVALID_HANDLE_VALUE) return false;
+    bool ok = exchange(pipe, args, output, exit_code);
+    CloseHandle(pipe);
+    return ok;
+#else
+    int fd = connect_endpoint(endpoint);
+    if (fd < 0) return false;
+    bool ok = exchange(fd, args, output, exit_code);
+    close(fd);
+    return ok;
+#endif
+}
+
+bool remote_call(const std::string& address, const std::vector<std::string>& args,
+                 std::string& output, int& exit_code) {
+    Socket channel = open_tcp(address, false);
+    if (channel == NO_SOCKET) return false;
+    bool ok = exchange(channel, args, output, exit_code);
+    close_socket(channel);
+    return ok;
+}
+
+bool loopback_address(const std::string& address) {
+    std::string host, port;
+    if (!network_ready() || !split_address(address, host, port) || host.empty()) return false;
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* found = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &found) != 0) return false;
+    bool loopback = found != nullptr;
+    for (addrinfo* candidate = found; candidate; candidate = candidate->ai_next) {
+        if (candidate->ai_family == AF_INET) {
+            const auto* ipv4 = reinterpret_cast<const sockaddr_in*>(candidate->ai_addr);
+            loopback &= (ntohl(ipv4->sin_addr.s_addr) >> 24) == 127;
+        } else if (candidate->ai_family == AF_INET6) {
+            const auto* ipv6 = reinterpret_cast<const sockaddr_in6*>(candidate->ai_addr);
+            loopback &= IN6_IS_ADDR_LOOPBACK(&ipv6->sin6_addr) != 0;
+        } else {
+            loopback = false;
+        }
+    }
+    freeaddrinfo(found);
+    return loopback;
+}
+
+bool tokens_match(const std::string& given, const std::string& expected) {
+    // Touch every byte whatever the contents, so the time taken says
+    // nothing about how much of a guess was right
+    unsigned char diff = given.size() == expected.size() ? 0 : 1;
+    for (size_t i = 0; i < given.size(); ++i) {
+        diff |= static_cast<unsigned char>(given[i] ^ (expected.empty() ? 0 : expected[i % expected.size()]));
+    }
+    return diff == 0;
+}
+
+bool spawn_daemon_process(const std::string& endpoint) {
+#ifdef _WIN32
+    wchar_t module[MAX_PATH];
+    if (GetModuleFileNameW(NULL, module, MAX_PATH) == 0) return false;
+    std::wstring command_line = L"\"" + std::wstring(module) + L"\" daemon";
+
+    STARTUPINFOW startup{};
+    startup.cb = sizeof(startup);
+    PROCESS_INFORMATION process{};
+    if (!CreateProcessW(module, command_line.data(), NULL, NULL, FALSE,
+                        DETACHED_PROCESS | CREATE_NEW_PROCESS_GROUP, NULL, NULL,
+                        &startup, &process)) {
+        return false;
+    }
+    CloseHandle(process.hThread);
+    CloseHandle(process.hProcess);
+#else
+    std::error_code ec;
+    fs::path program = fs::read_symlink("/proc/self/exe", ec);
+    if (ec) return false;
+
+    // Double fork so the daemon is reparented to init and outlives this command
+    pid_t child = fork();
+    if (child < 0) return false;
+    if (child == 0) {
+        setsid();
+        if (fork() != 0) _exit(0);
+        int null_fd = open("/dev/null", O_RDWR);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDIN_FILENO);
+            dup2(null_fd, STDOUT_FILENO);
+            dup2(null_fd, STDERR_FILENO);
+            if (null_fd > STDERR_FILENO) close(null_fd);
+        }
+        if (chdir("/") != 0) _exit(1);
+        execl(program.c_str(), program.c_str(), "daemon", static_cast<char*>(nullptr));
+        _exit(1);
+    }
+    waitpid(child, nullptr, 0);
+#endif
+    return wait_for_endpoint(endpoint);
+}
+
+ControlServer::ControlServer(std::string endpoint, Transport transport)
+    : endpoint_(std::move(endpoint)), transport_(transport) {
+    if (transport_ == Transport::Tcp) {
+        Socket channel = open_tcp(endpoint_, true);
+        if (channel == NO_SOCKET) {
+            throw std::runtime_error("Could not listen on " + endpoint_ + ": " +
+                                     std::strerror(socket_error()));
+        }
+#ifdef _WIN32
+        listen_socket_ = static_cast<uintptr_t>(channel);
+#else
+        listen_fd_ = channel;
+#endif
+        return;
+    }
+#ifdef _WIN32
+    std::string output;
+    int exit_code = 0;
+    if (control_call(endpoint_, {"ping"}, output, exit_code)) {
+        throw std::runtime_error("A daemon is already listening on " + endpoint_);
+    }
+#else
+    int existing = connect_endpoint(endpoint_);
+    if (existing >= 0) {
+        close(existing);
+        throw std::runtime_error("A daemon is already listening on " + endpoint_);
+    }
+
+    sockaddr_un address;
+    if (!make_address(endpoint_, address)) {
+        throw std::runtime_error("Control socket path too long: " + endpoint_);
+    }
+    unlink(endpoint_.c_str()); // stale socket from a daemon that did not exit cleanly
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0 ||
+        bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        chmod(endpoint_.c_str(), S_IRUSR | S_IWUSR) != 0 ||
+        listen(listen_fd_, 16) != 0) {
+        int error = errno;
+        if (listen_fd_ >= 0) close(listen_fd_);
+        throw std::runtime_error("Could not listen on " + endpoint_ + ": " + std::strerror(error));
+    }
+#endif
+}
+
+ControlServer::~ControlServer() {
+#ifdef _WIN32
+    if (listen_socket_ != ~uintptr_t(0)) close_socket(static_cast<Socket>(listen_socket_));
+#else
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+        if (transport_ == Transport::Local) unlink(endpoint_.c_str());
+    }
+#endif
+}
+
+void ControlServer::serve(const Handler& handler, const std::atomic<bool>& stop) {
+#ifdef _WIN32
+    if (transport_ == Transport::Tcp) {
+        Socket listener = static_cast<Socket>(listen_socket_);
+        while (!stop) {
+            Socket client = accept(listener, nullptr, nullptr);
+            if (client == INVALID_SOCKET) {
+                if (stop) break;
+                throw std::runtime_error("accept failed on " + endpoint_);
+            }
+            configure_tcp(client);
+            respond(client, handler);
+            shutdown(client, SD_SEND);
+            close_socket(client);
+        }
+        return;
+    }
+    std::wstring name = wide(endpoint_);
+    while (!stop) {
+        HANDLE pipe = CreateNamedPipeW(name.c_str(), PIPE_ACCESS_DUPLEX,
+                                       PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT |
+                                       PIPE_REJECT_REMOTE_CLIENTS,
+                                       1, 64 * 1024, 64 * 1024, 0, NULL);
+        if (pipe == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("Could not create pipe " + endpoint_);
+        }
+        if (ConnectNamedPipe(pipe, NULL) || GetLastError() == ERROR_PIPE_CONNECTED) {
+            respond(pipe, handler);
+            FlushFileBuffers(pipe);
+        }
+        DisconnectNamedPipe(pipe);
+        CloseHandle(pipe);
+    }
+#else
+    // accept() blocks with no timeout; a signal interrupts it to re-check stop
+    while (!stop) {
+        int client = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            throw std::runtime_error(std::string("accept failed: ") + std::strerror(errno));
+        }
+        if (transport_ == Transport::Tcp) configure_tcp(client);
+        respond(client, handler);
+        close(client);
+    }
+#endif
+}
@@ -0,0 +1,79 @@
+/*
+ * Time Tracker - daemon control channel
+ *
+ * The daemon serves CLI commands over a local endpoint: a Unix domain socket
+ * (~/.time_tracker/daemon.sock) on POSIX systems, a per-user named pipe on
+ * Windows. Each connection carries one request and one response:
+ *
+ *   request   u32 length, then the command arguments, each NUL-terminated
+ *   response  i32 exit code, u32 length, then the command's output text
+ *
+ * The team server speaks the same protocol over TCP.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// Endpoint name for the control channel of the given config directory
+std::string control_endpoint(const fs::path& config_dir);
+
+// Sends one command to a running daemon. Returns false if no daemon is
+// listening, in which case the caller should run the command itself.
+bool control_call(const std::string& endpoint, const std::vector<std::string>& args,
+                  std::string& output, int& exit_code);
+
+// Sends one command to a team server at "host:port" over TCP. Returns
+// false if the server cannot be reached or the connection drops.
+bool remote_call(const std::string& address, const std::vector<std::string>& args,
+                 std::string& output, int& exit_code);
+
+// True when "host:port" names only loopback addresses, so a server bound
+// to it is reachable from this machine alone. ":port" is never loopback.
+bool loopback_address(const std::string& address);
+
+// Compares a client's token with the server's in time that depends only
+// on the length of the client's
+bool tokens_match(const std::string& given, const std::string& expected);
+
+// Starts "<this executable> daemon" detached from the terminal and waits
+// until its control channel is accepting connections.
+bool spawn_daemon_process(const std::string& endpoint);
+
+class ControlServer {
+public:
+    using Handler = std::function<int(const std::vector<std::string>& args, std::string& output)>;
+
+    enum class Transport {
+        Local, // the per-user endpoint from control_endpoint()
+        Tcp    // "host:port", or ":port" for every interface
+    };
+
+    // Binds the endpoint, replacing a stale socket left by a crashed daemon.
+    // Throws std::runtime_error if another daemon already owns it, or if a
+    // TCP address cannot be bound.
+    explicit ControlServer(std::string endpoint, Transport transport = Transport::Local);
+    ~ControlServer();
+
+    ControlServer(const ControlServer&) = delete;
+    ControlServer& operator=(const ControlServer&) = delete;
+
+    // Serves requests one at a time until stop becomes true
+    void serve(const Handler& handler, const std::atomic<bool>& stop);
+
+private:
+    std::string endpoint_;
+    Transport transport_;
+#ifdef _WIN32
+    uintptr_t listen_socket_ = ~uintptr_t(0); // SOCKET of a TCP server
+#else
+    int listen_fd_ = -1;
+#endif
+};
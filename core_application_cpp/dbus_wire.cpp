@@ -0,0 +1,242 @@
+#include "dbus_wire.hpp"
+
+#ifndef _WIN32
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace dbus {
+
+void Writer::align(size_t n) {
+    while (data.size() % n) data += '\0';
+}
+
+void Writer::byte(uint8_t v) {
+    data += static_cast<char>(v);
+}
+
+void Writer::u32(uint32_t v) {
+    align(4);
+    char raw[4];
+    std::memcpy(raw, &v, sizeof(raw));
+    data.append(raw, sizeof(raw));
+}
+
+void Writer::str(const std::string& s) {
+    u32(static_cast<uint32_t>(s.size()));
+    data += s;
+    data += '\0';
+}
+
+void Writer::signature(const std::string& s) {
+    byte(static_cast<uint8_t>(s.size()));
+    data += s;
+    data += '\0';
+}
+
+void Writer::field(uint8_t code, char type, const std::string& value) {
+    align(8);
+    byte(code);
+    signature(std::string(1, type));
+    if (type == 'g') signature(value);
+    else str(value);
+}
+
+namespace {
+
+bool little_endian() {
+    const uint16_t probe = 1;
+    char first;
+    std::memcpy(&first, &probe, 1);
+    return first != 0;
+}
+
+// Largest reply read_reply accepts; ours are a few dozen bytes
+constexpr uint32_t MAX_MESSAGE_BYTES = 1 << 20;
+
+// Bus socket path from an address list; abstract sockets start with '\0'
+std::string socket_path(const char* address, const std::string& fallback) {
+    if (address) {
+        std::string list = address;
+        size_t start = 0;
+        while (start < list.size()) {
+            size_t end = list.find(';', start);
+            std::string entry = list.substr(start, end == std::string::npos ? std::string::npos : end - start);
+            start = end == std::string::npos ? list.size() : end + 1;
+            if (entry.rfind("unix:", 0) != 0) continue;
+            for (const char* key : {"path=", "abstract="}) {
+                size_t pos = entry.find(key);
+                if (pos == std::string::npos) continue;
+                pos += std::strlen(key);
+                std::string value = entry.substr(pos, entry.find(',', pos) - pos);
+                return key[0] == 'a' ? std::string(1, '\0') + value : value;
+            }
+        }
+    }
+    return fallback;
+}
+
+bool recv_exact(int fd, char* data, size_t size) {
+    size_t got = 0;
+    while (got < size) {
+        ssize_t n = recv(fd, data + got, size - got, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        got += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+uint32_t read_u32(const std::string& data, size_t pos, bool swap) {
+    uint32_t v;
+    std::memcpy(&v, data.data() + pos, sizeof(v));
+    if (swap) v = (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | (v << 24);
+    return v;
+}
+
+} // namespace
+
+std::string method_call(uint32_t serial, uint8_t flags, const std::string& destination,
+                        const std::string& path, const std::string& interface,
+                        const std::string& member, const std::string& body_signature,
+                        const std::string& body) {
+    // Fields start at offset 16, so alignment within this buffer matches the message
+    Writer fields;
+    fields.field(1, 'o', path);
+    fields.field(2, 's', interface);
+    fields.field(3, 's', member);
+    fields.field(6, 's', destination);
+    if (!body_signature.empty()) fields.field(8, 'g', body_signature);
+
+    Writer message;
+    message.byte(little_endian() ? 'l' : 'B');
+    message.byte(1); // METHOD_CALL
+    message.byte(flags);
+    message.byte(1); // protocol version
+    message.u32(static_cast<uint32_t>(body.size()));
+    message.u32(serial);
+    message.u32(static_cast<uint32_t>(fields.data.size()));
+    message.data += fields.data;
+    message.align(8);
+    message.data += body;
+    return message.data;
+}
+
+bool send_all(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+int connect(Bus bus) {
+    std::string path = bus == Bus::Session
+        ? socket_path(getenv("DBUS_SESSION_BUS_ADDRESS"), "/run/user/" + std::to_string(getuid()) + "/bus")
+        : socket_path(getenv("DBUS_SYSTEM_BUS_ADDRESS"), "/var/run/dbus/system_bus_socket");
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) return -1;
+    std::memcpy(address.sun_path, path.data(), path.size());
+    socklen_t length = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + path.size() +
+                                              (path[0] == '\0' ? 0 : 1));
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), length) != 0) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+
+    // A stuck bus must not stall the caller for long
+    timeval timeout{1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    // SASL EXTERNAL: the credential is our uid, hex-encoded as ASCII digits
+    std::string uid = std::to_string(getuid());
+    std::string hex;
+    for (char c : uid) {
+        const char* digits = "0123456789abcdef";
+        hex += digits[(c >> 4) & 0xf];
+        hex += digits[c & 0xf];
+    }
+    std::string auth = std::string(1, '\0') + "AUTH EXTERNAL " + hex + "\r\n";
+    char reply[256];
+    ssize_t got = send_all(fd, auth) ? recv(fd, reply, sizeof(reply) - 1, 0) : -1;
+    if (got < 2 || std::strncmp(reply, "OK", 2) != 0 || !send_all(fd, "BEGIN\r\n") ||
+        !send_all(fd, method_call(1, 0, "org.freedesktop.DBus", "/org/freedesktop/DBus",
+                                  "org.freedesktop.DBus", "Hello", "", ""))) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool read_reply(int fd, uint32_t serial, std::string& body, std::string& signature) {
+    for (;;) {
+        // Fixed header: endian, type, flags, version, body length, serial, field array length
+        std::string message(16, '\0');
+        if (!recv_exact(fd, &message[0], message.size())) return false;
+        if (message[0] != 'l' && message[0] != 'B') return false;
+        bool swap = (message[0] == 'l') != little_endian();
+        uint8_t type = static_cast<uint8_t>(message[1]);
+        uint32_t body_bytes = read_u32(message, 4, swap);
+        uint32_t field_bytes = read_u32(message, 12, swap);
+        if (body_bytes > MAX_MESSAGE_BYTES || field_bytes > MAX_MESSAGE_BYTES) return false;
+        size_t body_start = (16 + field_bytes + 7) / 8 * 8;
+        message.resize(body_start + body_bytes);
+        if (!recv_exact(fd, &message[16], message.size() - 16)) return false;
+
+        // Header fields: only the reply serial and the body signature matter here
+        bool is_reply = false;
+        std::string body_signature;
+        size_t pos = 16;
+        size_t end = 16 + field_bytes;
+        while (pos < end) {
+            pos = (pos + 7) / 8 * 8;
+            if (pos + 3 > end) return false;
+            uint8_t code = static_cast<uint8_t>(message[pos]);
+            uint8_t sig_length = static_cast<uint8_t>(message[pos + 1]);
+            if (sig_length != 1 || pos + 4 > end) return false;
+            char value_type = message[pos + 2];
+            pos += 4;
+            if (value_type == 's' || value_type == 'o') {
+                pos = (pos + 3) / 4 * 4;
+                if (pos + 4 > end) return false;
+                pos += 4 + read_u32(message, pos, swap) + 1;
+            } else if (value_type == 'g') {
+                if (pos >= end) return false;
+                size_t length = static_cast<uint8_t>(message[pos]);
+                if (code == 8 && pos + 1 + length <= end) body_signature = message.substr(pos + 1, length);
+                pos += 1 + length + 1;
+            } else if (value_type == 'u') {
+                pos = (pos + 3) / 4 * 4;
+                if (pos + 4 > end) return false;
+                if (code == 5) is_reply = read_u32(message, pos, swap) == serial;
+                pos += 4;
+            } else {
+                return false;
+            }
+        }
+        if (pos > end) return false;
+
+        // 2 = METHOD_RETURN, 3 = ERROR; anything else is a signal or someone else's reply
+        if (!is_reply || (type != 2 && type != 3)) continue;
+        if (type == 3 || swap) return false; // callers read bodies in host byte order
+        body = message.substr(body_start);
+        signature = body_signature;
+        return true;
+    }
+}
+
+} // namespace dbus
+
+#endif
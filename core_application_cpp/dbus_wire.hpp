@@ -0,0 +1,61 @@
+/*
+ * Time Tracker - minimal D-Bus client
+ *
+ * Just enough of the D-Bus wire protocol to talk to a bus socket without
+ * libdbus: SASL EXTERNAL authentication, method calls with string and
+ * integer arguments, and reading the reply to a call. The notifier uses
+ * the session bus; the idle monitor asks logind on the system bus.
+ *
+ * Not used on Windows.
+ */
+
+#pragma once
+
+#ifndef _WIN32
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace dbus {
+
+// Appends values in the D-Bus wire format, aligned as the spec requires.
+// Alignment is relative to the start of data, so a body must be built in
+// its own writer (bodies start 8-aligned).
+class Writer {
+public:
+    std::string data;
+
+    void align(size_t n);
+    void byte(uint8_t v);
+    void u32(uint32_t v);
+    void str(const std::string& s);
+    void signature(const std::string& s);
+    // One (code, variant) entry of the header field array
+    void field(uint8_t code, char type, const std::string& value);
+};
+
+enum class Bus { Session, System };
+
+// Flag for calls whose reply is not wanted
+constexpr uint8_t NO_REPLY_EXPECTED = 0x1;
+
+std::string method_call(uint32_t serial, uint8_t flags, const std::string& destination,
+                        const std::string& path, const std::string& interface,
+                        const std::string& member, const std::string& body_signature,
+                        const std::string& body);
+
+bool send_all(int fd, const std::string& data);
+
+// Connects to the bus, authenticates and sends Hello (serial 1). Returns
+// the socket, with one-second send and receive timeouts, or -1.
+int connect(Bus bus);
+
+// Reads messages until the reply to serial arrives, skipping signals and
+// other replies. body gets the reply's body and signature its type
+// signature. False on an error reply, a timeout or a broken connection.
+bool read_reply(int fd, uint32_t serial, std::string& body, std::string& signature);
+
+} // namespace dbus
+
+#endif
@@ -0,0 +1,445 @@
+#include "durable_log.hpp"
+#include "metrics.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <process.h>
+#include <sys/locking.h>
+#include <sys/stat.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr uint32_t RECORD_MAGIC = 0x4c415754; // "TWAL"
+constexpr uint32_t CUT_MAGIC = 0x54554354;    // "TCUT": undoes a bulk append; no payload
+
+struct RecordHeader {
+    uint32_t magic;
+    uint32_t length;
+    uint64_t offset; // where the payload belongs in the CSV
+    uint32_t crc;
+    uint32_t reserved;
+};
+static_assert(sizeof(RecordHeader) == 24, "journal record header must stay packed");
+
+constexpr std::array<uint32_t, 256> make_crc_table() {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        table[i] = c;
+    }
+    return table;
+}
+constexpr auto CRC_TABLE = make_crc_table();
+
+// Thin wrappers so the journal logic reads the same on both platforms
+#ifdef _WIN32
+int open_file(const fs::path& path) {
+    return _wopen(path.c_str(), _O_RDWR | _O_CREAT | _O_BINARY, _S_IREAD | _S_IWRITE);
+}
+void close_file(int fd) { _close(fd); }
+int process_id() { return _getpid(); }
+uint64_t file_size(int fd) { return static_cast<uint64_t>(_filelengthi64(fd)); }
+bool sync_file(int fd) { return _commit(fd) == 0; }
+bool truncate_file(int fd, uint64_t size) { return _chsize_s(fd, static_cast<__int64>(size)) == 0; }
+
+bool write_at(int fd, uint64_t offset, const char* data, size_t size) {
+    if (_lseeki64(fd, static_cast<__int64>(offset), SEEK_SET) < 0) return false;
+    while (size > 0) {
+        int n = _write(fd, data, static_cast<unsigned>(size));
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool read_at(int fd, uint64_t offset, char* data, size_t size) {
+    if (_lseeki64(fd, static_cast<__int64>(offset), SEEK_SET) < 0) return false;
+    while (size > 0) {
+        int n = _read(fd, data, static_cast<unsigned>(size));
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Serializes writers across processes on the journal's first byte
+void lock_file(int fd) {
+    _lseeki64(fd, 0, SEEK_SET);
+    if (_locking(fd, _LK_NBLCK, 1) == 0) return;
+    METRIC_ADD(LOCK_WAITS, 1);
+    METRIC_TIMER(LOCK_WAIT);
+    while (_locking(fd, _LK_LOCK, 1) != 0) {}
+}
+void unlock_file(int fd) {
+    _lseeki64(fd, 0, SEEK_SET);
+    _locking(fd, _LK_UNLCK, 1);
+}
+#else
+int open_file(const fs::path& path) {
+    return open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+}
+void close_file(int fd) { close(fd); }
+int process_id() { return static_cast<int>(getpid()); }
+
+uint64_t file_size(int fd) {
+    struct stat st;
+    return fstat(fd, &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+}
+
+bool sync_file(int fd) {
+#ifdef __APPLE__
+    return fsync(fd) == 0;
+#else
+    return fdatasync(fd) == 0;
+#endif
+}
+
+bool truncate_file(int fd, uint64_t size) { return ftruncate(fd, static_cast<off_t>(size)) == 0; }
+
+bool write_at(int fd, uint64_t offset, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = pwrite(fd, data, size, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        offset += static_cast<uint64_t>(n);
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool read_at(int fd, uint64_t offset, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = pread(fd, data, size, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        offset += static_cast<uint64_t>(n);
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Serializes writers across processes (daemon and in-process fallback).
+// Only a lock found taken is counted and timed.
+void lock_file(int fd) {
+    int taken;
+    while ((taken = flock(fd, LOCK_EX | LOCK_NB)) != 0 && errno == EINTR) {}
+    if (taken == 0) return;
+    METRIC_ADD(LOCK_WAITS, 1);
+    METRIC_TIMER(LOCK_WAIT);
+    while (flock(fd, LOCK_EX) != 0 && errno == EINTR) {}
+}
+void unlock_file(int fd) { flock(fd, LOCK_UN); }
+#endif
+
+class FileLock {
+public:
+    explicit FileLock(int fd) : fd_(fd) { lock_file(fd_); }
+    ~FileLock() { unlock_file(fd_); }
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+private:
+    int fd_;
+};
+
+} // namespace
+
+ProcessLock::ProcessLock(const fs::path& path) : fd_(open_file(path)) {
+    if (fd_ >= 0) lock_file(fd_);
+}
+
+ProcessLock::~ProcessLock() {
+    if (fd_ < 0) return;
+    unlock_file(fd_);
+    close_file(fd_);
+}
+
+fs::path derived_lock_file(const fs::path& csv_file) {
+    fs::path path = csv_file;
+    return path.replace_extension(".lock");
+}
+
+uint32_t crc32(const void* data, size_t size, uint32_t crc) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) crc = CRC_TABLE[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+void write_file_atomic(const fs::path& path, std::string_view contents) {
+    // A temporary file per writer: the daemon and a command, or two
+    // threads, may replace the same file at once
+    static std::atomic<uint64_t> serial{0};
+    fs::path temp = path;
+    temp += ".tmp." + std::to_string(process_id()) + "." + std::to_string(serial.fetch_add(1));
+
+    int fd = open_file(temp);
+    if (fd < 0) throw std::runtime_error("Could not create " + temp.string());
+    bool ok = truncate_file(fd, 0) && write_at(fd, 0, contents.data(), contents.size()) &&
+              sync_file(fd);
+    close_file(fd);
+    if (!ok) {
+        fs::remove(temp);
+        throw std::runtime_error("Could not write " + temp.string());
+    }
+    // rename(2) / MoveFileEx(REPLACE_EXISTING): readers see the old or the new file, never a mix
+    fs::rename(temp, path);
+}
+
+DurableAppender::DurableAppender(const fs::path& csv_file, const fs::path& journal_file)
+    : csv_file_(csv_file) {
+    csv_fd_ = open_file(csv_file);
+    journal_fd_ = open_file(journal_file);
+    if (csv_fd_ < 0 || journal_fd_ < 0) {
+        if (csv_fd_ >= 0) close_file(csv_fd_);
+        if (journal_fd_ >= 0) close_file(journal_fd_);
+        throw std::runtime_error("Could not open " + csv_file.string() + " for appending");
+    }
+    recover();
+}
+
+DurableAppender::~DurableAppender() {
+    try {
+        if (uncommitted_ > 0) sync();
+    } catch (...) {
+        // Destructors must not throw; the journal still covers the rows
+    }
+    close_file(csv_fd_);
+    close_file(journal_fd_);
+}
+
+void DurableAppender::recover() {
+    FileLock lock(journal_fd_);
+    uint64_t journal_size = file_size(journal_fd_);
+    if (journal_size == 0) return;
+
+    std::vector<char> journal(static_cast<size_t>(journal_size));
+    if (!read_at(journal_fd_, 0, journal.data(), journal.size())) {
+        throw std::runtime_error("Could not read the append journal");
+    }
+
+    bool repaired = false;
+    std::string existing;
+    size_t pos = 0;
+    while (pos + sizeof(RecordHeader) <= journal.size()) {
+        RecordHeader header;
+        std::memcpy(&header, journal.data() + pos, sizeof(header));
+        const char* payload = journal.data() + pos + sizeof(header);
+        if ((header.magic != RECORD_MAGIC && header.magic != CUT_MAGIC) ||
+            header.length > journal.size() - pos - sizeof(header) ||
+            crc32(payload, header.length) != header.crc) {
+            break; // torn journal tail: that row never got past the journal
+        }
+        pos += sizeof(header) + header.length;
+        uint64_t csv_size = file_size(csv_fd_);
+
+        if (header.magic == CUT_MAGIC) {
+            // A bulk append never finished: drop whatever part of it landed
+            if (csv_size > header.offset) {
+                if (!truncate_file(csv_fd_, header.offset)) {
+                    throw std::runtime_error("Could not roll back an interrupted bulk append");
+                }
+                repaired = true;
+            }
+            continue;
+        }
+
+        // Redo the row unless the CSV already holds exactly these bytes
+        if (header.offset > csv_size) continue; // CSV was cut short externally
+        existing.resize(header.length);
+        bool intact = header.offset + header.length <= csv_size &&
+                      read_at(csv_fd_, header.offset, existing.data(), existing.size()) &&
+                      std::memcmp(existing.data(), payload, header.length) == 0;
+        if (!intact) {
+            if (!truncate_file(csv_fd_, header.offset) ||
+                !write_at(csv_fd_, header.offset, payload, header.length)) {
+                throw std::runtime_error("Could not repair the CSV log from its journal");
+            }
+            repaired = true;
+        }
+    }
+
+    // Intact rows may have been committed through the journal alone, so the
+    // CSV is flushed before the journal vouching for them is dropped
+    if (!sync_file(csv_fd_)) {
+        throw std::runtime_error(repaired ? "Could not flush the repaired CSV log" : "Could not flush the CSV log");
+    }
+    sync_file(journal_fd_);
+    truncate_file(journal_fd_, 0);
+    sync_file(journal_fd_);
+}
+
+uint64_t DurableAppender::append(std::string_view row) {
+    if (row.empty() || row.back() != '\n') {
+        throw std::invalid_argument("appended rows must end with a newline");
+    }
+
+    uint64_t offset;
+    {
+        FileLock lock(journal_fd_);
+        reopen_if_replaced();
+        offset = file_size(csv_fd_);
+
+        // Never glue a row onto a partial line left by another writer
+        std::string payload;
+        char last = '\n';
+        if (offset > 0) read_at(csv_fd_, offset - 1, &last, 1);
+        if (last != '\n') payload += '\n';
+        payload.append(row);
+
+        RecordHeader header{RECORD_MAGIC, static_cast<uint32_t>(payload.size()), offset,
+                            crc32(payload.data(), payload.size()), 0};
+        std::string record(reinterpret_cast<const char*>(&header), sizeof(header));
+        record += payload;
+
+        if (!write_at(journal_fd_, file_size(journal_fd_), record.data(), record.size()) ||
+            !write_at(csv_fd_, offset, payload.data(), payload.size())) {
+            throw std::runtime_error("Could not append to the CSV log");
+        }
+        offset += payload.size() - row.size();
+        ++pending_;
+        ++uncommitted_;
+    }
+
+    if (pending_ >= SYNC_BATCH_ROWS) sync();
+    return offset;
+}
+
+void DurableAppender::sync() {
+    FileLock lock(journal_fd_);
+    // Journal first: if the CSV flush is interrupted, recovery can redo it
+    if (!sync_file(journal_fd_) || !sync_file(csv_fd_)) {
+        throw std::runtime_error("Could not flush the CSV log");
+    }
+    truncate_file(journal_fd_, 0);
+    sync_file(journal_fd_);
+    pending_ = 0;
+    uncommitted_ = 0;
+}
+
+void DurableAppender::commit() {
+    if (uncommitted_ == 0) return;
+    FileLock lock(journal_fd_);
+    if (!sync_file(journal_fd_)) {
+        throw std::runtime_error("Could not flush the append journal");
+    }
+    uncommitted_ = 0;
+}
+
+uint64_t DurableAppender::append_bulk(const std::function<void(const BulkWriter& write)>& fill) {
+    FileLock lock(journal_fd_);
+    reopen_if_replaced();
+    if (!sync_file(journal_fd_) || !sync_file(csv_fd_)) {
+        throw std::runtime_error("Could not flush the CSV log");
+    }
+    truncate_file(journal_fd_, 0);
+    pending_ = 0;
+    uncommitted_ = 0;
+
+    // The undo record must be on disk before any of the rows can be
+    uint64_t start = file_size(csv_fd_);
+    RecordHeader cut{CUT_MAGIC, 0, start, crc32(nullptr, 0), 0};
+    if (!write_at(journal_fd_, 0, reinterpret_cast<const char*>(&cut), sizeof(cut)) ||
+        !sync_file(journal_fd_)) {
+        throw std::runtime_error("Could not write the append journal");
+    }
+
+    uint64_t end = start;
+    try {
+        // Never glue a row onto a partial line left by another writer
+        char last = '\n';
+        if (start > 0) read_at(csv_fd_, start - 1, &last, 1);
+        uint64_t rows_start = last == '\n' ? start : start + 1;
+        end = rows_start;
+        fill([&](std::string_view block) {
+            if (block.empty()) return;
+            if (block.back() != '\n') throw std::invalid_argument("appended rows must end with a newline");
+            if (end == start + 1 && !write_at(csv_fd_, start, "\n", 1)) {
+                throw std::runtime_error("Could not append to the CSV log");
+            }
+            if (!write_at(csv_fd_, end, block.data(), block.size())) {
+                throw std::runtime_error("Could not append to the CSV log");
+            }
+            end += block.size();
+        });
+        if (end > rows_start && !sync_file(csv_fd_)) {
+            throw std::runtime_error("Could not flush the CSV log");
+        }
+        start = rows_start;
+    } catch (...) {
+        // Roll back now rather than at the next open
+        truncate_file(csv_fd_, start);
+        sync_file(csv_fd_);
+        truncate_file(journal_fd_, 0);
+        sync_file(journal_fd_);
+        throw;
+    }
+    truncate_file(journal_fd_, 0);
+    sync_file(journal_fd_);
+    return start;
+}
+
+void DurableAppender::rewrite(const std::function<bool(std::string_view, std::string&)>& edit) {
+    FileLock lock(journal_fd_);
+    reopen_if_replaced();
+    if (!sync_file(journal_fd_) || !sync_file(csv_fd_)) {
+        throw std::runtime_error("Could not flush the CSV log");
+    }
+    truncate_file(journal_fd_, 0);
+    sync_file(journal_fd_);
+    pending_ = 0;
+    uncommitted_ = 0;
+
+    std::string current(static_cast<size_t>(file_size(csv_fd_)), '\0');
+    if (!read_at(csv_fd_, 0, current.data(), current.size())) {
+        throw std::runtime_error("Could not read the CSV log");
+    }
+    std::string replacement;
+    if (!edit(current, replacement)) return;
+
+    // Windows cannot rename over a file that is still open
+    close_file(csv_fd_);
+    csv_fd_ = -1;
+    write_file_atomic(csv_file_, replacement);
+    csv_fd_ = open_file(csv_file_);
+    if (csv_fd_ < 0) throw std::runtime_error("Could not reopen " + csv_file_.string());
+}
+
+// Called with the lock held: a rewrite may have renamed a new CSV into
+// place since this appender opened the old one
+void DurableAppender::reopen_if_replaced() {
+#ifndef _WIN32
+    struct stat opened;
+    struct stat current;
+    if (fstat(csv_fd_, &opened) != 0) return;
+    // A CSV removed since is created again, as opening the appender would
+    if (stat(csv_file_.c_str(), &current) == 0 && opened.st_ino == current.st_ino &&
+        opened.st_dev == current.st_dev) {
+        return;
+    }
+    int fd = open_file(csv_file_);
+    if (fd < 0) throw std::runtime_error("Could not reopen " + csv_file_.string());
+    close_file(csv_fd_);
+    csv_fd_ = fd;
+#endif
+}
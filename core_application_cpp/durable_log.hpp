@@ -0,0 +1,120 @@
+/*
+ * Time Tracker - crash-safe appends and atomic file replacement
+ *
+ * DurableAppender appends rows to time_logs.csv through a small redo
+ * journal (time_logs.wal). Each row is first written to the journal as
+ *
+ *   u32 magic | u32 length | u64 csv offset | u32 crc32 | u32 reserved | payload
+ *
+ * and then to the CSV. sync() makes the journal and the CSV durable and
+ * empties the journal. commit() makes rows durable with one flush of the
+ * journal alone, which recovery can redo them from; the CSV is flushed and
+ * the journal emptied once a batch of rows is pending.
+ * When the appender is opened after a crash, every journal record with a
+ * valid checksum is checked against the CSV and rewritten if the row is
+ * missing or torn, so the CSV never keeps a half-written row.
+ *
+ * append_bulk() streams a large batch of rows straight into the CSV, with
+ * only an undo record in the journal, and makes them durable with one
+ * flush at the end. Recovery cuts the CSV back to where an unfinished
+ * batch began, so a batch lands whole or not at all.
+ *
+ * rewrite() replaces the whole CSV (see `compact`) under the same writer
+ * lock. An appender that finds the CSV replaced or removed reopens it
+ * before writing.
+ *
+ * write_file_atomic replaces a small file (the session state) by writing a
+ * temporary file and renaming it over the original.
+ *
+ * ProcessLock serializes the files derived from the log (the date index,
+ * the rollup cache and the search index), which every process brings up
+ * to date in place, on time_logs.lock. Appends never wait on it; a holder
+ * of the journal lock may take it, never the other way round.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace fs = std::filesystem;
+
+// CRC-32 (IEEE 802.3), as used by zlib and PNG
+uint32_t crc32(const void* data, size_t size, uint32_t crc = 0);
+
+// Writes contents to path.tmp, flushes it to disk and renames it over path
+void write_file_atomic(const fs::path& path, std::string_view contents);
+
+// An exclusive lock across processes and threads on lock_file, created if
+// missing, held for the object's lifetime. If the file cannot be opened
+// nothing is locked: the files it guards are rebuilt from the log anyway.
+class ProcessLock {
+public:
+    explicit ProcessLock(const fs::path& lock_file);
+    ~ProcessLock();
+
+    ProcessLock(const ProcessLock&) = delete;
+    ProcessLock& operator=(const ProcessLock&) = delete;
+
+private:
+    int fd_ = -1;
+};
+
+// The lock file the derived files of csv_file are updated under
+fs::path derived_lock_file(const fs::path& csv_file);
+
+class DurableAppender {
+public:
+    // Rows appended or committed since the last sync() are synced once this
+    // many are pending
+    static constexpr size_t SYNC_BATCH_ROWS = 64;
+
+    // Opens both files and repairs the CSV from the journal if needed
+    DurableAppender(const fs::path& csv_file, const fs::path& journal_file);
+    ~DurableAppender();
+
+    DurableAppender(const DurableAppender&) = delete;
+    DurableAppender& operator=(const DurableAppender&) = delete;
+
+    // Appends one complete row (including its trailing newline).
+    // Returns the CSV offset the row was written at.
+    uint64_t append(std::string_view row);
+
+    // Makes every appended row durable and checkpoints the journal
+    void sync();
+
+    // Makes every appended row durable by flushing the journal alone. The
+    // rows stay in it until a sync(), which append() runs once
+    // SYNC_BATCH_ROWS are pending, or recovery.
+    void commit();
+
+    using BulkWriter = std::function<void(std::string_view rows)>;
+
+    // Calls fill, which hands blocks of complete rows to write, with
+    // appends from every process held off, then flushes the CSV once. If
+    // fill throws, nothing it wrote is kept. Returns the CSV offset of the
+    // first row.
+    uint64_t append_bulk(const std::function<void(const BulkWriter& write)>& fill);
+
+    // Hands the current CSV to edit with appends from every process held
+    // off. If edit returns true, the CSV is atomically replaced by the text
+    // it stored in replacement. The journal is checkpointed first, so it
+    // never refers to offsets in the old file.
+    void rewrite(const std::function<bool(std::string_view csv, std::string& replacement)>& edit);
+
+    size_t pending() const { return pending_; }
+
+private:
+    void recover();
+    void reopen_if_replaced();
+
+    fs::path csv_file_;
+    int csv_fd_ = -1;
+    int journal_fd_ = -1;
+    size_t pending_ = 0;     // rows in the journal
+    size_t uncommitted_ = 0; // rows in the journal that it has not flushed
+};
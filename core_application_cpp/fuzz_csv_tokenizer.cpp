@@ -0,0 +1,126 @@
+/*
+ * Time Tracker - CSV tokenizer fuzz target
+ *
+ * Any input must tokenize without reading outside it: the records tile
+ * the input (each begins where the last ended, the last ends at its end),
+ * every field lies inside its record unless it was unescaped, a legacy
+ * description (one with an unquoted comma) lies inside its line, and the
+ * vector kernels agree with a byte-at-a-time scan. fuzz_seeds/ holds the
+ * inputs that once broke these.
+ *
+ * The input is also read as fields, split into records at 0x1e and into
+ * fields at 0x1f, written out with write_csv_field and tokenized again:
+ * the same fields must come back, and csv_next_record must find the same
+ * record boundaries the tokenizer does.
+ *
+ * Build with `make fuzz` (see fuzz_driver.cpp).
+ */
+
+#include "csv_tokenizer.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+constexpr char RECORD_SEPARATOR = '\x1e';
+constexpr char FIELD_SEPARATOR = '\x1f';
+constexpr size_t KERNEL_OFFSETS = 64; // start offsets the kernels are checked from
+
+void require(bool condition, const char* what) {
+    if (condition) return;
+    std::fprintf(stderr, "fuzz_csv_tokenizer: %s\n", what);
+    std::abort();
+}
+
+void check_kernels(std::string_view data) {
+    const char* end = data.data() + data.size();
+    for (size_t offset = 0; offset < std::min(data.size(), KERNEL_OFFSETS); ++offset) {
+        const char* p = data.data() + offset;
+        const char* expected = p;
+        while (expected < end && *expected != ',' && *expected != '"' && *expected != '\n') ++expected;
+        require(csv_find_structural(p, end) == expected, "csv_find_structural disagrees with a scan");
+        require(csv_count_quotes(p, data.size() - offset) == static_cast<size_t>(std::count(p, end, '"')),
+                "csv_count_quotes disagrees with a scan");
+    }
+}
+
+void check_tokenizer(std::string_view data) {
+    CsvTokenizer tokens(data);
+    CsvRecord record;
+    size_t expected_begin = 0;
+    while (tokens.next(record)) {
+        require(record.begin == expected_begin, "records do not tile the input");
+        require(record.end > record.begin && record.end <= data.size(), "record end out of range");
+        // An unclosed quote runs to the end of the input, newlines and all
+        require(!record.terminated || data[record.end - 1] == '\n', "terminated record without a newline");
+        require(record.terminated || record.end == data.size(), "unterminated record before the end");
+        require(!record.fields.empty(), "record without fields");
+        require(record.line.data() == data.data() + record.begin &&
+                record.line.size() <= record.end - record.begin, "line outside its record");
+        for (size_t i = 0; i < record.fields.size(); ++i) {
+            if (record.unescaped(i)) continue;
+            std::string_view field = record.fields[i];
+            require(field.empty() || (field.data() >= data.data() + record.begin &&
+                                      field.data() + field.size() <= data.data() + record.end),
+                    "field outside its record");
+        }
+        if (record.fields.size() > CSV_COLUMNS) {
+            std::string_view description = record.description();
+            require(description.data() >= record.line.data() &&
+                    description.data() + description.size() <= record.line.data() + record.line.size(),
+                    "legacy description outside its line");
+        }
+        expected_begin = record.end;
+    }
+    require(expected_begin == data.size(), "input left untokenized");
+}
+
+void check_round_trip(std::string_view data) {
+    std::vector<std::vector<std::string_view>> records(1);
+    size_t start = 0;
+    for (size_t i = 0; i <= data.size(); ++i) {
+        if (i < data.size() && data[i] != RECORD_SEPARATOR && data[i] != FIELD_SEPARATOR) continue;
+        records.back().push_back(data.substr(start, i - start));
+        if (i < data.size() && data[i] == RECORD_SEPARATOR) records.emplace_back();
+        start = i + 1;
+    }
+
+    std::string text;
+    for (const auto& fields : records) {
+        for (size_t i = 0; i < fields.size(); ++i) {
+            if (i > 0) text += ',';
+            write_csv_field(text, fields[i]);
+        }
+        text += '\n';
+    }
+
+    CsvTokenizer tokens(text);
+    CsvRecord record;
+    for (const auto& fields : records) {
+        require(tokens.next(record), "written record not read back");
+        require(record.terminated, "written record not terminated");
+        require(record.fields.size() == fields.size(), "written record read back with other fields");
+        for (size_t i = 0; i < fields.size(); ++i) {
+            require(record.fields[i] == fields[i], "written field read back changed");
+        }
+        require(csv_next_record(text, record.begin, false) == record.end,
+                "csv_next_record disagrees with the tokenizer");
+    }
+    require(!tokens.next(record), "written records read back with extra records");
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    std::string_view input(reinterpret_cast<const char*>(data), size);
+    check_kernels(input);
+    check_tokenizer(input);
+    check_round_trip(input);
+    return 0;
+}
@@ -0,0 +1,166 @@
+/*
+ * Time Tracker - standalone fuzz driver
+ *
+ * Stands in for libFuzzer where it is not available (g++ has none): each
+ * file given, and each file in a directory given, is run once as is, then
+ * mutated copies of them (or of an empty input) are fed to the target's
+ * LLVMFuzzerTestOneInput. There is no coverage feedback, so mutations
+ * lean on the bytes the parsers care about. It takes libFuzzer's -runs=N,
+ * -seed=N and -max_len=N options.
+ *
+ * When the target or a sanitizer aborts, the input that was running is
+ * written to crash-input first; pass that file back to replay it.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__has_include)
+#if __has_include(<sanitizer/common_interface_defs.h>)
+#include <sanitizer/common_interface_defs.h>
+#define FUZZ_DEATH_CALLBACK 1
+#endif
+#endif
+
+namespace fs = std::filesystem;
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+namespace {
+
+// Delimiters, quotes, escapes and separators the CSV and JSON parsers branch on
+const char INTERESTING[] = {',', '"', '\n', '\r', '\\', 'u', '{', '}', ':', '[', ']', ' ',
+                            '\0', '\x1e', '\x1f', '\x7f', '\xc3', '\xff'};
+
+const std::string* running = nullptr;
+
+void save_running() {
+    if (!running) return;
+    if (std::FILE* file = std::fopen("crash-input", "wb")) {
+        std::fwrite(running->data(), 1, running->size(), file);
+        std::fclose(file);
+    }
+    std::fprintf(stderr, "fuzz_driver: input written to crash-input (%zu bytes)\n", running->size());
+    running = nullptr;
+}
+
+void on_abort(int) {
+    save_running();
+    std::signal(SIGABRT, SIG_DFL);
+    std::raise(SIGABRT);
+}
+
+void run(const std::string& input) {
+    running = &input;
+    LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+    running = nullptr;
+}
+
+void add_seed(const fs::path& path, std::vector<std::string>& seeds) {
+    std::ifstream file(path, std::ios::binary);
+    seeds.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void mutate(std::string& input, const std::vector<std::string>& seeds, size_t max_length, std::mt19937_64& random) {
+    auto below = [&random](size_t n) { return n ? static_cast<size_t>(random() % n) : 0; };
+    for (size_t count = 1 + below(4); count > 0; --count) {
+        switch (below(7)) {
+        case 0: // flip a bit
+            if (!input.empty()) input[below(input.size())] ^= static_cast<char>(1 << below(8));
+            break;
+        case 1: // overwrite a byte
+            if (!input.empty()) input[below(input.size())] = static_cast<char>(below(256));
+            break;
+        case 2: // insert one the parsers care about
+            input.insert(input.begin() + static_cast<std::ptrdiff_t>(below(input.size() + 1)),
+                         INTERESTING[below(sizeof(INTERESTING))]);
+            break;
+        case 3: // overwrite with one
+            if (!input.empty()) input[below(input.size())] = INTERESTING[below(sizeof(INTERESTING))];
+            break;
+        case 4: { // erase a run
+            size_t at = below(input.size());
+            input.erase(at, 1 + below(std::min<size_t>(16, input.size() - at)));
+            break;
+        }
+        case 5: { // repeat a run
+            size_t at = below(input.size());
+            input.insert(below(input.size() + 1), input.substr(at, 1 + below(16)));
+            break;
+        }
+        default: { // splice in part of another seed
+            const std::string& other = seeds[below(seeds.size())];
+            size_t at = below(other.size());
+            input.insert(below(input.size() + 1), other.substr(at, 1 + below(64)));
+            break;
+        }
+        }
+    }
+    if (input.size() > max_length) input.resize(max_length);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    uint64_t runs = 100000;
+    uint64_t seed = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    size_t max_length = 4096;
+    std::vector<std::string> seeds;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("-runs=", 0) == 0) {
+            runs = std::stoull(arg.substr(6));
+        } else if (arg.rfind("-seed=", 0) == 0) {
+            seed = std::stoull(arg.substr(6));
+        } else if (arg.rfind("-max_len=", 0) == 0) {
+            max_length = std::max<size_t>(1, std::stoul(arg.substr(9)));
+        } else if (fs::is_directory(arg)) {
+            for (const auto& entry : fs::directory_iterator(arg)) {
+                if (entry.is_regular_file()) add_seed(entry.path(), seeds);
+            }
+        } else if (fs::is_regular_file(arg)) {
+            add_seed(arg, seeds);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [-runs=N] [-seed=N] [-max_len=N] [file|directory]...\n";
+            return 1;
+        }
+    }
+
+    std::signal(SIGABRT, on_abort);
+#ifdef FUZZ_DEATH_CALLBACK
+    __sanitizer_set_death_callback(save_running);
+#endif
+
+    for (const auto& input : seeds) run(input);
+    if (seeds.empty()) seeds.emplace_back();
+
+    // Mutations stack up for a while before starting again from a seed
+    std::mt19937_64 random(seed);
+    std::string input;
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < runs; ++i) {
+        if (i % 16 == 0) {
+            // A window of a seed longer than max_length
+            const std::string& from = seeds[random() % seeds.size()];
+            size_t length = std::min(from.size(), max_length);
+            input = from.substr(random() % (from.size() - length + 1), length);
+        }
+        mutate(input, seeds, max_length, random);
+        run(input);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("Done %llu runs in %.1f s (%.0f exec/s), seed %llu\n", static_cast<unsigned long long>(runs),
+                seconds, seconds > 0.0 ? runs / seconds : 0.0, static_cast<unsigned long long>(seed));
+    return 0;
+}
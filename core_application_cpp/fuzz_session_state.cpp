@@ -0,0 +1,77 @@
+/*
+ * Time Tracker - session codec fuzz target
+ *
+ * Any input must decode without reading outside it, and a document that
+ * decodes must encode and decode again to the same session.
+ *
+ * The input is also read as the five session fields, split at 0x1f:
+ * encoded, they must decode back byte for byte (control characters, NULs
+ * and invalid UTF-8 included), and the encoding cut short must be
+ * rejected, as a half-written state file would be.
+ *
+ * Build with `make fuzz` (see fuzz_driver.cpp).
+ */
+
+#include "session_state.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+namespace {
+
+constexpr char FIELD_SEPARATOR = '\x1f';
+
+void require(bool condition, const char* what) {
+    if (condition) return;
+    std::fprintf(stderr, "fuzz_session_state: %s\n", what);
+    std::abort();
+}
+
+bool same_fields(const SessionData& a, const SessionData& b) {
+    return a.name == b.name && a.start_time == b.start_time && a.description == b.description &&
+           a.last_notification == b.last_notification && a.session == b.session && a.valid == b.valid;
+}
+
+void check_decode(std::string_view input) {
+    SessionData decoded;
+    if (!decode_session(input, decoded)) return;
+    std::string json;
+    encode_session(decoded, json);
+    SessionData again;
+    require(decode_session(json, again), "re-encoded session does not decode");
+    require(same_fields(decoded, again), "re-encoded session decodes differently");
+}
+
+void check_round_trip(std::string_view input) {
+    SessionData session;
+    std::string* fields[] = {&session.name, &session.start_time, &session.description,
+                             &session.last_notification, &session.session};
+    size_t field = 0;
+    for (char c : input) {
+        if (c == FIELD_SEPARATOR && field + 1 < std::size(fields)) ++field;
+        else *fields[field] += c;
+    }
+    session.valid = !session.start_time.empty() && !session.description.empty();
+
+    std::string json;
+    encode_session(session, json);
+    SessionData decoded;
+    require(decode_session(json, decoded), "encoded session does not decode");
+    require(same_fields(session, decoded), "encoded session decodes differently");
+
+    // Cut before its closing brace, a document is never complete
+    size_t cut = input.size() % (json.rfind('}') + 1);
+    require(!decode_session(std::string_view(json).substr(0, cut), decoded), "truncated session decodes");
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    std::string_view input(reinterpret_cast<const char*>(data), size);
+    check_decode(input);
+    check_round_trip(input);
+    return 0;
+}
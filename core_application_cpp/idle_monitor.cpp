@@ -0,0 +1,215 @@
+#include "idle_monitor.hpp"
+
+#include <chrono>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include "dbus_wire.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <string>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+struct IdleMonitor::Backend {};
+
+IdleMonitor::IdleMonitor() = default;
+IdleMonitor::~IdleMonitor() = default;
+
+bool IdleMonitor::idle_seconds(int64_t& seconds) {
+    LASTINPUTINFO input{};
+    input.cbSize = sizeof(input);
+    if (!GetLastInputInfo(&input)) return false;
+    // Tick counts wrap after 49 days; the unsigned difference does not care
+    DWORD elapsed = GetTickCount() - input.dwTime;
+    seconds = static_cast<int64_t>(elapsed / 1000);
+    return true;
+}
+
+const char* IdleMonitor::source() const {
+    return "GetLastInputInfo";
+}
+
+#else
+
+namespace {
+
+// The parts of Xlib and XScreenSaver used here, declared locally so that
+// neither header is needed to build. Layouts match Xlib's ABI.
+struct Display;
+using Window = unsigned long;
+struct XScreenSaverInfo {
+    Window window;
+    int state;
+    int kind;
+    unsigned long til_or_since;
+    unsigned long idle; // milliseconds since the last input
+    unsigned long event_mask;
+};
+
+} // namespace
+
+struct IdleMonitor::Backend {
+    // XScreenSaver
+    void* libx11 = nullptr;
+    void* libxss = nullptr;
+    Display* display = nullptr;
+    XScreenSaverInfo* info = nullptr;
+    int (*close_display)(Display*) = nullptr;
+    Window (*root_window)(Display*) = nullptr;
+    int (*query_info)(Display*, Window, XScreenSaverInfo*) = nullptr;
+    int (*x_free)(void*) = nullptr;
+
+    // logind
+    int bus_fd = -1;
+    uint32_t bus_serial = 1; // Hello
+    bool bus_failed = false;
+
+    const char* source = "none";
+
+    bool open_x11();
+    void close_x11();
+    bool query_x11(int64_t& seconds);
+    bool read_property(const char* name, char type, uint64_t& value);
+    bool query_logind(int64_t& seconds);
+
+    ~Backend() {
+        close_x11();
+        if (bus_fd >= 0) close(bus_fd);
+    }
+};
+
+bool IdleMonitor::Backend::open_x11() {
+    const char* name = getenv("DISPLAY");
+    if (!name || !*name) return false;
+    libx11 = dlopen("libX11.so.6", RTLD_LAZY | RTLD_LOCAL);
+    libxss = libx11 ? dlopen("libXss.so.1", RTLD_LAZY | RTLD_LOCAL) : nullptr;
+    if (!libxss) {
+        close_x11();
+        return false;
+    }
+    auto open_display = reinterpret_cast<Display* (*)(const char*)>(dlsym(libx11, "XOpenDisplay"));
+    close_display = reinterpret_cast<int (*)(Display*)>(dlsym(libx11, "XCloseDisplay"));
+    root_window = reinterpret_cast<Window (*)(Display*)>(dlsym(libx11, "XDefaultRootWindow"));
+    x_free = reinterpret_cast<int (*)(void*)>(dlsym(libx11, "XFree"));
+    auto query_extension = reinterpret_cast<int (*)(Display*, int*, int*)>(
+        dlsym(libxss, "XScreenSaverQueryExtension"));
+    auto alloc_info = reinterpret_cast<XScreenSaverInfo* (*)()>(dlsym(libxss, "XScreenSaverAllocInfo"));
+    query_info = reinterpret_cast<int (*)(Display*, Window, XScreenSaverInfo*)>(
+        dlsym(libxss, "XScreenSaverQueryInfo"));
+    if (!open_display || !close_display || !root_window || !x_free || !query_extension ||
+        !alloc_info || !query_info) {
+        close_x11();
+        return false;
+    }
+
+    display = open_display(nullptr);
+    int event_base = 0, error_base = 0;
+    if (!display || !query_extension(display, &event_base, &error_base) || !(info = alloc_info())) {
+        close_x11();
+        return false;
+    }
+    return true;
+}
+
+void IdleMonitor::Backend::close_x11() {
+    if (info) x_free(info);
+    if (display) close_display(display);
+    if (libxss) dlclose(libxss);
+    if (libx11) dlclose(libx11);
+    info = nullptr;
+    display = nullptr;
+    libxss = nullptr;
+    libx11 = nullptr;
+}
+
+bool IdleMonitor::Backend::query_x11(int64_t& seconds) {
+    if (!display || !query_info(display, root_window(display), info)) return false;
+    seconds = static_cast<int64_t>(info->idle / 1000);
+    return true;
+}
+
+// Reads a boolean ('b') or uint64 ('t') property of logind's Manager
+bool IdleMonitor::Backend::read_property(const char* name, char type, uint64_t& value) {
+    dbus::Writer args;
+    args.str("org.freedesktop.login1.Manager");
+    args.str(name);
+    uint32_t serial = ++bus_serial;
+    std::string call = dbus::method_call(serial, 0, "org.freedesktop.login1", "/org/freedesktop/login1",
+                                         "org.freedesktop.DBus.Properties", "Get", "ss", args.data);
+    std::string body, signature;
+    if (!dbus::send_all(bus_fd, call) || !dbus::read_reply(bus_fd, serial, body, signature)) return false;
+
+    // A variant: its signature, then the value at its natural alignment
+    if (signature != "v" || body.size() < 3 || body[0] != 1 || body[1] != type) return false;
+    if (type == 'b') {
+        uint32_t flag;
+        if (body.size() < 8) return false;
+        std::memcpy(&flag, body.data() + 4, sizeof(flag));
+        value = flag;
+    } else {
+        if (body.size() < 16) return false;
+        std::memcpy(&value, body.data() + 8, sizeof(value));
+    }
+    return true;
+}
+
+bool IdleMonitor::Backend::query_logind(int64_t& seconds) {
+    for (int attempt = 0; attempt < 2 && !bus_failed; ++attempt) {
+        if (bus_fd < 0) {
+            bus_fd = dbus::connect(dbus::Bus::System);
+            bus_serial = 1;
+            if (bus_fd < 0) {
+                bus_failed = true; // no system bus: not worth retrying
+                return false;
+            }
+        }
+        uint64_t idle = 0, since = 0;
+        if (read_property("IdleHint", 'b', idle) && read_property("IdleSinceHint", 't', since)) {
+            // IdleSinceHint is when the hint last changed, in microseconds of
+            // wall-clock time. Until it says idle, the user counts as active.
+            int64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            int64_t idle_for = idle ? (now - static_cast<int64_t>(since)) / 1000000 : 0;
+            seconds = idle_for > 0 ? idle_for : 0;
+            return true;
+        }
+        close(bus_fd); // logind restarted or the reply was lost: reconnect once
+        bus_fd = -1;
+    }
+    return false;
+}
+
+IdleMonitor::IdleMonitor() : backend_(std::make_unique<Backend>()) {
+    backend_->open_x11();
+}
+
+IdleMonitor::~IdleMonitor() = default;
+
+bool IdleMonitor::idle_seconds(int64_t& seconds) {
+    Backend& backend = *backend_;
+    if (backend.display) {
+        if (backend.query_x11(seconds)) {
+            backend.source = "XScreenSaver";
+            return true;
+        }
+        backend.close_x11(); // the X server went away
+    }
+    if (backend.query_logind(seconds)) {
+        backend.source = "logind";
+        return true;
+    }
+    backend.source = "none";
+    return false;
+}
+
+const char* IdleMonitor::source() const {
+    return backend_->source;
+}
+
+#endif
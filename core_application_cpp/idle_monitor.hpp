@@ -0,0 +1,40 @@
+/*
+ * Time Tracker - user idle detection
+ *
+ * Tells the daemon how long it has been since the last keyboard or mouse
+ * input, asking the system for the counter it already keeps instead of
+ * watching input itself:
+ *
+ *   Linux    the XScreenSaver extension on $DISPLAY (libX11 and libXss are
+ *            loaded at run time, so neither is a build dependency), else
+ *            logind's IdleHint/IdleSinceHint over the system bus, which
+ *            desktops such as GNOME set after their own idle delay.
+ *   Windows  GetLastInputInfo.
+ *
+ * One query is a single round trip, so the daemon can afford to ask only
+ * when the answer could have changed (see notification_loop).
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+class IdleMonitor {
+public:
+    IdleMonitor();
+    ~IdleMonitor();
+    IdleMonitor(const IdleMonitor&) = delete;
+    IdleMonitor& operator=(const IdleMonitor&) = delete;
+
+    // Seconds since the last user input. False if no source can tell.
+    bool idle_seconds(int64_t& seconds);
+
+    // The source that answered last: "XScreenSaver", "logind",
+    // "GetLastInputInfo" or "none"
+    const char* source() const;
+
+private:
+    struct Backend; // per platform, in idle_monitor.cpp
+    std::unique_ptr<Backend> backend_;
+};
@@ -0,0 +1,205 @@
+/*
+ * Time Tracker - allocation-free date/time parsing
+ *
+ * Parses the fixed layouts this tool writes ("YYYY-MM-DD", "HH:MM:SS" and
+ * "YYYY-MM-DDTHH:MM:SS", see local_clock.hpp) straight from a string_view
+ * into integers, and formats the last one back. Digits are validated
+ * together rather than one branch per character, and everything except
+ * local_to_utc is constexpr.
+ *
+ * "Local seconds" are wall-clock seconds since 1970-01-01T00:00:00 with no
+ * time zone applied. Durations must be taken between UTC instants (see
+ * local_to_utc), otherwise a DST change inside a session is miscounted.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string_view>
+
+namespace iso_time {
+
+struct CivilDate {
+    int year;
+    unsigned month;
+    unsigned day;
+};
+
+// Days since 1970-01-01 for a proleptic Gregorian date
+constexpr int64_t days_from_civil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+constexpr CivilDate civil_from_days(int64_t z) {
+    z += 719468;
+    const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    const unsigned d = doy - (153 * mp + 2) / 5 + 1;
+    const unsigned m = mp < 10 ? mp + 3 : mp - 9;
+    return CivilDate{static_cast<int>(yoe + era * 400 + (m <= 2)), m, d};
+}
+
+constexpr bool leap_year(int64_t y) {
+    return y % 4 == 0 && (y % 100 != 0 || y % 400 == 0);
+}
+
+// Days in month m (1-12) of year y
+constexpr unsigned days_in_month(int64_t y, unsigned m) {
+    return m == 2 ? 28 + leap_year(y) : 30 + ((m + (m > 7)) & 1);
+}
+
+// Floor division for local seconds before 1970
+constexpr int64_t day_of(int64_t local_seconds) {
+    return (local_seconds >= 0 ? local_seconds : local_seconds - 86399) / 86400;
+}
+
+constexpr int64_t seconds_of_day(int64_t local_seconds) {
+    return local_seconds - day_of(local_seconds) * 86400;
+}
+
+// 0 = Monday ... 6 = Sunday
+constexpr unsigned weekday(int64_t days) {
+    return static_cast<unsigned>(((days + 3) % 7 + 7) % 7);
+}
+
+struct IsoWeek {
+    int year;
+    unsigned week;
+};
+
+// ISO-8601 week: weeks start on Monday and belong to the year of their Thursday
+constexpr IsoWeek iso_week(int64_t days) {
+    const int64_t thursday = days - weekday(days) + 3;
+    const int year = civil_from_days(thursday).year;
+    const int64_t first = days_from_civil(year, 1, 1);
+    return IsoWeek{year, static_cast<unsigned>((thursday - first) / 7 + 1)};
+}
+
+namespace detail {
+
+// Value of the two digits at text[pos], accumulating non-digits into bad
+constexpr unsigned two_digits(std::string_view text, size_t pos, unsigned& bad) {
+    unsigned hi = static_cast<unsigned char>(text[pos]) - '0';
+    unsigned lo = static_cast<unsigned char>(text[pos + 1]) - '0';
+    bad |= (hi > 9) | (lo > 9);
+    return hi * 10 + lo;
+}
+
+} // namespace detail
+
+// "YYYY-MM-DD" -> civil date
+constexpr bool parse_date(std::string_view text, CivilDate& date) {
+    if (text.size() < 10) return false;
+    unsigned bad = (text[4] != '-') | (text[7] != '-');
+    unsigned century = detail::two_digits(text, 0, bad);
+    unsigned year = detail::two_digits(text, 2, bad);
+    unsigned month = detail::two_digits(text, 5, bad);
+    unsigned day = detail::two_digits(text, 8, bad);
+    date = CivilDate{static_cast<int>(century * 100 + year), month, day};
+    bad |= (month - 1 > 11) | (day - 1 >= days_in_month(date.year, month));
+    return bad == 0;
+}
+
+// "HH:MM:SS" -> seconds since midnight (a leap second 60 is accepted)
+constexpr bool parse_clock(std::string_view text, int64_t& seconds) {
+    if (text.size() < 8) return false;
+    unsigned bad = (text[2] != ':') | (text[5] != ':');
+    unsigned h = detail::two_digits(text, 0, bad);
+    unsigned m = detail::two_digits(text, 3, bad);
+    unsigned s = detail::two_digits(text, 6, bad);
+    bad |= (h > 23) | (m > 59) | (s > 60);
+    seconds = static_cast<int64_t>(h * 3600 + m * 60 + s);
+    return bad == 0;
+}
+
+// "YYYY-MM-DD" -> days since 1970-01-01
+constexpr bool parse_day(std::string_view text, int64_t& days) {
+    CivilDate date{};
+    if (!parse_date(text, date)) return false;
+    days = days_from_civil(date.year, date.month, date.day);
+    return true;
+}
+
+// "YYYY-MM-DD" + "HH:MM:SS" -> local seconds
+constexpr bool parse_local(std::string_view date, std::string_view clock, int64_t& local_seconds) {
+    int64_t days = 0;
+    int64_t seconds = 0;
+    if (!parse_day(date, days) || !parse_clock(clock, seconds)) return false;
+    local_seconds = days * 86400 + seconds;
+    return true;
+}
+
+// "YYYY-MM-DDTHH:MM:SS" (or with a space separator) -> local seconds
+constexpr bool parse_iso(std::string_view text, int64_t& local_seconds) {
+    if (text.size() < 19 || (text[10] != 'T' && text[10] != ' ')) return false;
+    return parse_local(text.substr(0, 10), text.substr(11, 8), local_seconds);
+}
+
+// Length of "YYYY-MM-DDTHH:MM:SS"
+constexpr size_t ISO_LENGTH = 19;
+
+// Local seconds -> "YYYY-MM-DDTHH:MM:SS" (years 0 to 9999), without a terminator
+constexpr void format_iso(int64_t local_seconds, char (&text)[ISO_LENGTH]) {
+    CivilDate date = civil_from_days(day_of(local_seconds));
+    int64_t seconds = seconds_of_day(local_seconds);
+    unsigned year = static_cast<unsigned>(date.year);
+    unsigned fields[] = {year / 100, year % 100, date.month, date.day,
+                         static_cast<unsigned>(seconds / 3600), static_cast<unsigned>(seconds / 60 % 60),
+                         static_cast<unsigned>(seconds % 60)};
+    size_t positions[] = {0, 2, 5, 8, 11, 14, 17};
+    for (size_t i = 0; i < 7; ++i) {
+        text[positions[i]] = static_cast<char>('0' + fields[i] / 10 % 10);
+        text[positions[i] + 1] = static_cast<char>('0' + fields[i] % 10);
+    }
+    text[4] = text[7] = '-';
+    text[10] = 'T';
+    text[13] = text[16] = ':';
+}
+
+static_assert(days_from_civil(1970, 1, 1) == 0, "epoch");
+static_assert(days_from_civil(2000, 3, 1) == 11017, "leap century");
+static_assert(civil_from_days(20367).month == 10, "round trip");
+static_assert(weekday(0) == 3, "1970-01-01 was a Thursday");
+static_assert(days_in_month(1900, 2) == 28 && days_in_month(2000, 2) == 29 && days_in_month(2024, 7) == 31 &&
+              days_in_month(2024, 8) == 31 && days_in_month(2024, 9) == 30, "month lengths");
+static_assert([] {
+    CivilDate date{};
+    return !parse_date("2023-02-29", date) && parse_date("2024-02-29", date) && !parse_date("2023-04-31", date) &&
+           parse_date("2023-12-31", date) && !parse_date("2024-02-31", date);
+}(), "parse_date checks the month's length");
+static_assert(iso_week(days_from_civil(2021, 1, 3)).week == 53, "ISO week of early January");
+static_assert([] {
+    char text[ISO_LENGTH] = {};
+    int64_t local = 20367 * 86400 + 14 * 3600 + 30 * 60 + 5;
+    format_iso(local, text);
+    int64_t parsed = 0;
+    return parse_iso(std::string_view(text, ISO_LENGTH), parsed) && parsed == local && text[11] == '1';
+}(), "format_iso round trip");
+
+// Converts local seconds to a UTC time_t using the system time zone rules.
+// Ambiguous times in a DST fall-back hour resolve to the system's choice.
+inline std::time_t local_to_utc(int64_t local_seconds) {
+    CivilDate date = civil_from_days(day_of(local_seconds));
+    int64_t seconds = seconds_of_day(local_seconds);
+    std::tm tm{};
+    tm.tm_year = date.year - 1900;
+    tm.tm_mon = static_cast<int>(date.month) - 1;
+    tm.tm_mday = static_cast<int>(date.day);
+    tm.tm_hour = static_cast<int>(seconds / 3600);
+    tm.tm_min = static_cast<int>(seconds / 60 % 60);
+    tm.tm_sec = static_cast<int>(seconds % 60);
+    tm.tm_isdst = -1;
+    return std::mktime(&tm);
+}
+
+} // namespace iso_time
@@ -0,0 +1,51 @@
+#include "local_clock.hpp"
+
+#include <chrono>
+#include <climits>
+
+namespace {
+
+// Offsets are cached for this long, aligned to its multiples
+constexpr int64_t OFFSET_WINDOW_SECONDS = 15 * 60;
+
+constexpr int64_t floor_div(int64_t a, int64_t b) {
+    return (a >= 0 ? a : a - (b - 1)) / b;
+}
+
+// Seconds the local clock is ahead of UTC at the instant, from the C library
+int64_t utc_offset(std::time_t utc) {
+    std::tm tm{};
+#ifdef _WIN32
+    if (localtime_s(&tm, &utc) != 0) return 0;
+#else
+    if (!localtime_r(&utc, &tm)) return 0;
+#endif
+    int64_t local = iso_time::days_from_civil(tm.tm_year + 1900, static_cast<unsigned>(tm.tm_mon + 1),
+                                              static_cast<unsigned>(tm.tm_mday)) * 86400 +
+                    tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec;
+    return local - static_cast<int64_t>(utc);
+}
+
+} // namespace
+
+int64_t local_seconds(std::time_t utc) {
+    struct Cache {
+        int64_t window = INT64_MIN;
+        int64_t offset = 0;
+    };
+    thread_local Cache cache;
+    int64_t window = floor_div(static_cast<int64_t>(utc), OFFSET_WINDOW_SECONDS);
+    if (window != cache.window) {
+        cache.offset = utc_offset(utc);
+        cache.window = window;
+    }
+    return static_cast<int64_t>(utc) + cache.offset;
+}
+
+ClockSnapshot ClockSnapshot::now() {
+    return ClockSnapshot(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
+}
+
+ClockSnapshot::ClockSnapshot(std::time_t utc) : utc_(utc), local_(local_seconds(utc)) {
+    iso_time::format_iso(local_, text_);
+}
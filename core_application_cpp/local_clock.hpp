@@ -0,0 +1,46 @@
+/*
+ * Time Tracker - thread-safe local wall clock
+ *
+ * A ClockSnapshot is one reading of the clock, with its local date and
+ * time formatted once into a fixed buffer. A logged row takes its date,
+ * end time and duration from the same snapshot, so they cannot straddle
+ * a second or midnight.
+ *
+ * std::localtime shares one static result between threads and rereads
+ * the time zone on every call. Here the UTC offset comes from
+ * localtime_r (localtime_s on Windows) and each thread caches it for the
+ * quarter hour it was computed in. Zone offsets only change on
+ * quarter-hour boundaries, so formatting usually costs no library call
+ * at all.
+ */
+
+#pragma once
+
+#include "iso_time.hpp"
+
+#include <cstdint>
+#include <ctime>
+#include <string_view>
+
+class ClockSnapshot {
+public:
+    static ClockSnapshot now();
+
+    // The local time of a given instant
+    explicit ClockSnapshot(std::time_t utc);
+
+    std::time_t utc() const { return utc_; }
+    int64_t local() const { return local_; } // local seconds, see iso_time.hpp
+
+    std::string_view iso() const { return std::string_view(text_, iso_time::ISO_LENGTH); } // YYYY-MM-DDTHH:MM:SS
+    std::string_view date() const { return iso().substr(0, 10); }                          // YYYY-MM-DD
+    std::string_view clock() const { return iso().substr(11, 8); }                         // HH:MM:SS
+
+private:
+    std::time_t utc_;
+    int64_t local_;
+    char text_[iso_time::ISO_LENGTH];
+};
+
+// Local seconds of a UTC instant under the system time zone
+int64_t local_seconds(std::time_t utc);
@@ -0,0 +1,1127 @@
+#include "log_export.hpp"
+
+#include "channel.hpp"
+#include "csv_tokenizer.hpp"
+#include "iso_time.hpp"
+#include "log_index.hpp"
+#include "mapped_file.hpp"
+#include "segment_store.hpp"
+#include "session_state.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <climits>
+#include <condition_variable>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef TIME_TRACKER_ZLIB
+#include <zlib.h>
+#endif
+
+// Arrow and Parquet store numbers little-endian. Columns are copied out in
+// host order, which is little-endian on every platform this tool targets.
+
+namespace {
+
+// One column's strings as Arrow lays them out: value i is
+// bytes[offsets[i], offsets[i + 1])
+struct TextColumn {
+    std::string bytes;
+    std::vector<int32_t> offsets{0};
+
+    void add(std::string_view text) {
+        bytes.append(text);
+        offsets.push_back(static_cast<int32_t>(bytes.size()));
+    }
+
+    std::string_view operator[](size_t i) const {
+        return std::string_view(bytes).substr(offsets[i], offsets[i + 1] - offsets[i]);
+    }
+};
+
+struct Batch {
+    size_t sequence = 0;
+    TextColumn names;
+    std::vector<int32_t> days;       // since 1970-01-01
+    std::vector<int64_t> starts;     // local seconds
+    std::vector<int64_t> ends;
+    std::vector<double> hours;
+    TextColumn descriptions;
+    std::vector<uint64_t> positions; // logical log offset of each row, for calendar UIDs
+
+    size_t rows() const { return days.size(); }
+
+    bool full() const {
+        return rows() >= LogExporter::BATCH_ROWS ||
+               names.bytes.size() + descriptions.bytes.size() >= LogExporter::BATCH_TEXT_BYTES;
+    }
+};
+
+// Where a Parquet column chunk lies within its row group
+struct ChunkInfo {
+    uint64_t offset = 0;       // from the start of the row group
+    uint64_t raw_bytes = 0;    // page header and plain values
+    uint64_t stored_bytes = 0; // page header and values as written
+    std::string min;           // plain-encoded statistics; empty for strings and doubles
+    std::string max;
+};
+
+struct Encoded {
+    size_t sequence = 0;
+    size_t rows = 0;
+    std::string bytes;
+    size_t metadata_bytes = 0;     // Arrow: the message in front of the body
+    std::vector<ChunkInfo> chunks; // Parquet: one per column
+};
+
+// An encoded batch once written, as the file footers need it
+struct Placed {
+    uint64_t offset = 0;
+    uint64_t bytes = 0;
+    size_t rows = 0;
+    size_t metadata_bytes = 0;
+    std::vector<ChunkInfo> chunks;
+};
+
+// Encoders finish batches out of order; the writer takes them back in
+// sequence. Batches more than `window` past the next one wait, so a slow
+// output stalls the encoders instead of filling memory.
+class Reorder {
+public:
+    explicit Reorder(size_t window) : window_(window) {}
+
+    bool put(Encoded encoded) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        size_t sequence = encoded.sequence;
+        room_.wait(lock, [&] { return closed_ || sequence < next_ + window_; });
+        if (closed_) return false;
+        done_.emplace(sequence, std::move(encoded));
+        ready_.notify_all();
+        return true;
+    }
+
+    // The next batch in sequence; false after the last one or after close()
+    bool take(Encoded& encoded) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_.wait(lock, [&] { return closed_ || done_.count(next_) || (finished_ && next_ == total_); });
+        auto found = done_.find(next_);
+        if (closed_ || found == done_.end()) return false;
+        encoded = std::move(found->second);
+        done_.erase(found);
+        ++next_;
+        room_.notify_all();
+        return true;
+    }
+
+    // Every one of total batches has been put
+    void finish(size_t total) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        finished_ = true;
+        total_ = total;
+        ready_.notify_all();
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        room_.notify_all();
+        ready_.notify_all();
+    }
+
+private:
+    size_t window_;
+    std::mutex mutex_;
+    std::condition_variable room_;
+    std::condition_variable ready_;
+    std::map<size_t, Encoded> done_;
+    size_t next_ = 0;
+    size_t total_ = 0;
+    bool finished_ = false;
+    bool closed_ = false;
+};
+
+void put_le(std::string& out, uint64_t value, size_t size) {
+    for (size_t i = 0; i < size; ++i) out += static_cast<char>(value >> (8 * i));
+}
+
+void pad(std::string& out, size_t alignment) {
+    out.append((alignment - out.size() % alignment) % alignment, '\0');
+}
+
+template <typename T>
+void append_values(std::string& out, const std::vector<T>& values) {
+    if (!values.empty()) out.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+// Start and end as local seconds. The date is the day a session ended, so
+// a start later than the end, or hours beyond the clock span, means the
+// session began on an earlier day.
+bool session_times(const LogRow& row, int64_t& start, int64_t& end) {
+    int64_t start_clock = 0;
+    int64_t end_clock = 0;
+    if (!iso_time::parse_clock(row.start_time, start_clock) || !iso_time::parse_clock(row.end_time, end_clock)) {
+        return false;
+    }
+    end = row.day * 86400 + end_clock;
+    start = row.day * 86400 + start_clock;
+    if (start > end) start -= 86400;
+    double missing = row.hours * 3600 - static_cast<double>(end - start);
+    if (missing > 43200) start -= static_cast<int64_t>((missing + 43200) / 86400) * 86400;
+    return true;
+}
+
+// --- JSON ------------------------------------------------------------------
+
+void append_json_time(std::string& out, int64_t local_seconds, size_t length) {
+    char text[iso_time::ISO_LENGTH];
+    iso_time::format_iso(local_seconds, text);
+    out += '"';
+    out.append(text, length);
+    out += '"';
+}
+
+Encoded encode_json(const Batch& batch) {
+    Encoded encoded;
+    std::string& out = encoded.bytes;
+    out.reserve(batch.names.bytes.size() + batch.descriptions.bytes.size() + batch.rows() * 128);
+    for (size_t i = 0; i < batch.rows(); ++i) {
+        if (batch.sequence > 0 || i > 0) out += ",\n";
+        out += "{\"name\":";
+        encode_json_string(batch.names[i], out);
+        out += ",\"date\":";
+        append_json_time(out, int64_t{batch.days[i]} * 86400, 10);
+        out += ",\"start\":";
+        append_json_time(out, batch.starts[i], iso_time::ISO_LENGTH);
+        out += ",\"end\":";
+        append_json_time(out, batch.ends[i], iso_time::ISO_LENGTH);
+        out += ",\"hours\":";
+        char number[32];
+        auto written = std::to_chars(number, number + sizeof(number), batch.hours[i]);
+        out.append(number, written.ptr);
+        out += ",\"description\":";
+        encode_json_string(batch.descriptions[i], out);
+        out += '}';
+    }
+    return encoded;
+}
+
+// --- iCalendar -------------------------------------------------------------
+
+// "YYYYMMDDTHHMMSS", a floating (local) DATE-TIME
+void append_ics_time(std::string& out, int64_t local_seconds) {
+    char text[iso_time::ISO_LENGTH];
+    iso_time::format_iso(local_seconds, text);
+    for (char c : text) {
+        if (c != '-' && c != ':') out += c;
+    }
+}
+
+// Ends the content line that begins at line_start, folded so no line
+// exceeds 75 octets (a continuation's leading space included) and no
+// UTF-8 sequence is split
+void end_ics_line(std::string& out, size_t line_start) {
+    constexpr size_t LINE_OCTETS = 75;
+    while (out.size() - line_start > LINE_OCTETS) {
+        size_t cut = line_start + LINE_OCTETS;
+        while (cut > line_start + 1 && (static_cast<unsigned char>(out[cut]) & 0xc0) == 0x80) --cut;
+        out.insert(cut, "\r\n ");
+        line_start = cut + 2;
+    }
+    out += "\r\n";
+}
+
+// Appends text escaped as an iCalendar TEXT value, copying the runs that
+// need no escaping whole
+void append_ics_escaped(std::string& out, std::string_view text) {
+    size_t run = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        bool plain = c != '\\' && c != ';' && c != ',' && (static_cast<unsigned char>(c) >= 0x20 || c == '\t');
+        if (plain) continue;
+        out.append(text, run, i - run);
+        run = i + 1;
+        if (c == '\n') {
+            out += "\\n";
+        } else if (static_cast<unsigned char>(c) >= 0x20) {
+            out += '\\';
+            out += c;
+        } // other controls are not TEXT and are dropped
+    }
+    out.append(text, run, std::string_view::npos);
+}
+
+// "NAME:value" with value escaped as TEXT
+void append_ics_text(std::string& out, std::string_view name, std::string_view text) {
+    size_t line_start = out.size();
+    out += name;
+    out += ':';
+    append_ics_escaped(out, text);
+    end_ics_line(out, line_start);
+}
+
+Encoded encode_ics(const Batch& batch, const std::string& stamp) {
+    Encoded encoded;
+    std::string& out = encoded.bytes;
+    out.reserve(batch.names.bytes.size() * 2 + batch.descriptions.bytes.size() + batch.rows() * 192);
+    for (size_t i = 0; i < batch.rows(); ++i) {
+        out += "BEGIN:VEVENT\r\n";
+        // The logical offset never changes, so a re-export updates the same events
+        size_t line_start = out.size();
+        char position[24];
+        auto written = std::to_chars(position, position + sizeof(position), batch.positions[i]);
+        out += "UID:";
+        out.append(position, written.ptr);
+        out += '-';
+        append_ics_escaped(out, batch.names[i]);
+        out += "@time-tracker";
+        end_ics_line(out, line_start);
+        out += "DTSTAMP:";
+        out += stamp;
+        out += "\r\nDTSTART:";
+        append_ics_time(out, batch.starts[i]);
+        out += "\r\nDTEND:";
+        append_ics_time(out, batch.ends[i]);
+        out += "\r\n";
+        std::string_view summary = batch.descriptions[i];
+        append_ics_text(out, "SUMMARY", summary.empty() ? batch.names[i] : summary);
+        append_ics_text(out, "CATEGORIES", batch.names[i]);
+        out += "END:VEVENT\r\n";
+    }
+    return encoded;
+}
+
+// --- Arrow and Parquet columns ----------------------------------------------
+
+enum class ColumnType {
+    Text,
+    Date,
+    Timestamp,
+    Double
+};
+
+struct Column {
+    const char* name;
+    ColumnType type;
+};
+
+constexpr Column COLUMNS[] = {
+    {"name", ColumnType::Text},
+    {"date", ColumnType::Date},
+    {"start", ColumnType::Timestamp},
+    {"end", ColumnType::Timestamp},
+    {"hours", ColumnType::Double},
+    {"description", ColumnType::Text},
+};
+constexpr size_t COLUMN_COUNT = sizeof(COLUMNS) / sizeof(COLUMNS[0]);
+
+const TextColumn& text_column(const Batch& batch, size_t column) {
+    return column == 0 ? batch.names : batch.descriptions;
+}
+
+const std::vector<int64_t>& time_column(const Batch& batch, size_t column) {
+    return column == 2 ? batch.starts : batch.ends;
+}
+
+// --- Arrow -----------------------------------------------------------------
+
+// A flatbuffer object, enough of the format for Arrow's metadata. Objects
+// are laid out front to back, each after the table that refers to it, so
+// every offset points forward as flatbuffers require.
+struct FlatObject {
+    enum class Kind {
+        Table,
+        String,
+        Structs, // a vector of inline structs
+        Tables   // a vector of tables
+    };
+
+    struct Scalar {
+        uint16_t id;
+        uint64_t bits;
+        uint8_t size;
+    };
+
+    Kind kind = Kind::Table;
+    std::vector<Scalar> scalars;
+    std::vector<uint16_t> child_ids;   // Table: the fields that refer to children
+    std::vector<FlatObject> children;  // Table: by child_ids; Tables: the elements
+    std::string bytes;                 // String: the text; Structs: the elements
+    uint32_t count = 0;                // Structs
+    size_t align = 4;                  // Structs: alignment of the elements
+
+    FlatObject& scalar(uint16_t id, uint64_t bits, uint8_t size) {
+        scalars.push_back(Scalar{id, bits, size});
+        return *this;
+    }
+
+    FlatObject& child(uint16_t id, FlatObject object) {
+        child_ids.push_back(id);
+        children.push_back(std::move(object));
+        return *this;
+    }
+
+    static FlatObject string(std::string_view text) {
+        FlatObject object;
+        object.kind = Kind::String;
+        object.bytes = std::string(text);
+        return object;
+    }
+
+    static FlatObject structs(std::string bytes, uint32_t count, size_t align) {
+        FlatObject object;
+        object.kind = Kind::Structs;
+        object.bytes = std::move(bytes);
+        object.count = count;
+        object.align = align;
+        return object;
+    }
+
+    static FlatObject tables(std::vector<FlatObject> items) {
+        FlatObject object;
+        object.kind = Kind::Tables;
+        object.children = std::move(items);
+        return object;
+    }
+};
+
+void patch_offset(std::string& out, size_t at, size_t target) {
+    uint32_t offset = static_cast<uint32_t>(target - at);
+    std::memcpy(&out[at], &offset, sizeof(offset));
+}
+
+// Appends object; returns the position offsets to it must point at
+size_t write_flat(std::string& out, const FlatObject& object) {
+    switch (object.kind) {
+    case FlatObject::Kind::String: {
+        pad(out, 4);
+        size_t at = out.size();
+        put_le(out, object.bytes.size(), 4);
+        out += object.bytes;
+        out += '\0';
+        return at;
+    }
+    case FlatObject::Kind::Structs: {
+        while (out.size() % 4 != 0 || (out.size() + 4) % object.align != 0) out += '\0';
+        size_t at = out.size();
+        put_le(out, object.count, 4);
+        out += object.bytes;
+        return at;
+    }
+    case FlatObject::Kind::Tables: {
+        pad(out, 4);
+        size_t at = out.size();
+        put_le(out, object.children.size(), 4);
+        size_t slots = out.size();
+        out.append(object.children.size() * 4, '\0');
+        for (size_t i = 0; i < object.children.size(); ++i) {
+            patch_offset(out, slots + i * 4, write_flat(out, object.children[i]));
+        }
+        return at;
+    }
+    case FlatObject::Kind::Table:
+        break;
+    }
+
+    // The vtable goes first, then the table it describes
+    size_t fields = 0;
+    for (const auto& scalar : object.scalars) fields = std::max<size_t>(fields, scalar.id + 1u);
+    for (uint16_t id : object.child_ids) fields = std::max<size_t>(fields, id + 1u);
+    pad(out, 2);
+    size_t vtable = out.size();
+    out.append(4 + 2 * fields, '\0');
+    pad(out, 4);
+    size_t table = out.size();
+    put_le(out, table - vtable, 4);
+
+    std::vector<uint16_t> slots(fields, 0);
+    std::vector<FlatObject::Scalar> scalars = object.scalars;
+    std::stable_sort(scalars.begin(), scalars.end(),
+                     [](const FlatObject::Scalar& a, const FlatObject::Scalar& b) { return a.size > b.size; });
+    for (const auto& scalar : scalars) {
+        pad(out, scalar.size);
+        slots[scalar.id] = static_cast<uint16_t>(out.size() - table);
+        put_le(out, scalar.bits, scalar.size);
+    }
+    std::vector<size_t> references;
+    for (uint16_t id : object.child_ids) {
+        pad(out, 4);
+        slots[id] = static_cast<uint16_t>(out.size() - table);
+        references.push_back(out.size());
+        out.append(4, '\0');
+    }
+
+    std::string entries;
+    put_le(entries, 4 + 2 * fields, 2);
+    put_le(entries, out.size() - table, 2);
+    for (uint16_t slot : slots) put_le(entries, slot, 2);
+    out.replace(vtable, entries.size(), entries);
+
+    for (size_t i = 0; i < object.children.size(); ++i) {
+        patch_offset(out, references[i], write_flat(out, object.children[i]));
+    }
+    return table;
+}
+
+// A finished flatbuffer: the root offset, then the objects
+std::string flat_buffer(const FlatObject& root) {
+    std::string out(4, '\0');
+    patch_offset(out, 0, write_flat(out, root));
+    return out;
+}
+
+constexpr uint16_t ARROW_VERSION = 4;    // MetadataVersion V5
+constexpr uint8_t ARROW_SCHEMA = 1;      // MessageHeader
+constexpr uint8_t ARROW_RECORD_BATCH = 3;
+constexpr char ARROW_MAGIC[] = "ARROW1";
+
+FlatObject arrow_schema() {
+    std::vector<FlatObject> fields;
+    for (const Column& column : COLUMNS) {
+        FlatObject type;
+        uint8_t type_id = 0;
+        switch (column.type) {
+        case ColumnType::Text:      type_id = 5; break;                          // Utf8
+        case ColumnType::Date:      type_id = 8; type.scalar(0, 0, 2); break;    // Date, DAY
+        case ColumnType::Timestamp: type_id = 10; type.scalar(0, 0, 2); break;   // Timestamp, SECOND
+        case ColumnType::Double:    type_id = 3; type.scalar(0, 2, 2); break;    // FloatingPoint, DOUBLE
+        }
+        FlatObject field;
+        field.child(0, FlatObject::string(column.name))
+            .scalar(1, 0, 1) // not nullable
+            .scalar(2, type_id, 1)
+            .child(3, std::move(type))
+            .child(5, FlatObject::tables({})); // readers want an empty children list
+        fields.push_back(std::move(field));
+    }
+    FlatObject schema;
+    schema.scalar(0, 0, 2).child(1, FlatObject::tables(std::move(fields))); // little-endian
+    return schema;
+}
+
+// Continuation marker, metadata length and the Message flatbuffer, padded
+// so the body after it starts 8-byte aligned
+std::string arrow_message(uint8_t header_type, FlatObject header, uint64_t body_bytes) {
+    FlatObject message;
+    message.scalar(0, ARROW_VERSION, 2)
+        .scalar(1, header_type, 1)
+        .child(2, std::move(header))
+        .scalar(3, body_bytes, 8);
+    std::string metadata = flat_buffer(message);
+    pad(metadata, 8);
+    std::string out;
+    put_le(out, 0xFFFFFFFFu, 4);
+    put_le(out, metadata.size(), 4);
+    return out + metadata;
+}
+
+Encoded encode_arrow(const Batch& batch) {
+    // Each column: a validity buffer (empty, as nothing is null) and its
+    // data, every buffer starting 8-byte aligned in the body
+    std::vector<std::pair<const void*, size_t>> buffers;
+    for (size_t c = 0; c < COLUMN_COUNT; ++c) {
+        buffers.emplace_back(nullptr, 0);
+        switch (COLUMNS[c].type) {
+        case ColumnType::Text: {
+            const TextColumn& text = text_column(batch, c);
+            buffers.emplace_back(text.offsets.data(), text.offsets.size() * sizeof(int32_t));
+            buffers.emplace_back(text.bytes.data(), text.bytes.size());
+            break;
+        }
+        case ColumnType::Date:
+            buffers.emplace_back(batch.days.data(), batch.rows() * sizeof(int32_t));
+            break;
+        case ColumnType::Timestamp:
+            buffers.emplace_back(time_column(batch, c).data(), batch.rows() * sizeof(int64_t));
+            break;
+        case ColumnType::Double:
+            buffers.emplace_back(batch.hours.data(), batch.rows() * sizeof(double));
+            break;
+        }
+    }
+
+    std::string nodes;
+    for (size_t c = 0; c < COLUMN_COUNT; ++c) {
+        put_le(nodes, batch.rows(), 8);
+        put_le(nodes, 0, 8); // null count
+    }
+    std::string layout;
+    uint64_t body_bytes = 0;
+    for (const auto& buffer : buffers) {
+        put_le(layout, body_bytes, 8);
+        put_le(layout, buffer.second, 8);
+        body_bytes += (buffer.second + 7) / 8 * 8;
+    }
+    FlatObject record_batch;
+    record_batch.scalar(0, batch.rows(), 8)
+        .child(1, FlatObject::structs(std::move(nodes), COLUMN_COUNT, 8))
+        .child(2, FlatObject::structs(std::move(layout), static_cast<uint32_t>(buffers.size()), 8));
+
+    Encoded encoded;
+    encoded.bytes = arrow_message(ARROW_RECORD_BATCH, std::move(record_batch), body_bytes);
+    encoded.metadata_bytes = encoded.bytes.size();
+    encoded.bytes.reserve(encoded.bytes.size() + body_bytes);
+    for (const auto& buffer : buffers) {
+        if (buffer.second > 0) encoded.bytes.append(static_cast<const char*>(buffer.first), buffer.second);
+        pad(encoded.bytes, 8);
+    }
+    return encoded;
+}
+
+std::string arrow_preamble() {
+    std::string out(ARROW_MAGIC, 6);
+    out.append(2, '\0');
+    return out + arrow_message(ARROW_SCHEMA, arrow_schema(), 0);
+}
+
+std::string arrow_trailer(const std::vector<Placed>& placed) {
+    std::string out;
+    put_le(out, 0xFFFFFFFFu, 4); // end of stream
+    put_le(out, 0, 4);
+
+    std::string blocks;
+    for (const Placed& batch : placed) {
+        put_le(blocks, batch.offset, 8);
+        put_le(blocks, batch.metadata_bytes, 4);
+        put_le(blocks, 0, 4);
+        put_le(blocks, batch.bytes - batch.metadata_bytes, 8);
+    }
+    FlatObject footer;
+    footer.scalar(0, ARROW_VERSION, 2)
+        .child(1, arrow_schema())
+        .child(2, FlatObject::structs("", 0, 8)) // no dictionaries
+        .child(3, FlatObject::structs(std::move(blocks), static_cast<uint32_t>(placed.size()), 8));
+    std::string metadata = flat_buffer(footer);
+    out += metadata;
+    put_le(out, metadata.size(), 4);
+    return out + ARROW_MAGIC;
+}
+
+// --- Parquet ---------------------------------------------------------------
+
+// Thrift's compact protocol, the encoding of Parquet's metadata
+class CompactWriter {
+public:
+    enum Type : uint8_t {
+        BOOL_TRUE = 1,
+        BOOL_FALSE = 2,
+        I32 = 5,
+        I64 = 6,
+        BINARY = 8,
+        LIST = 9,
+        STRUCT = 12
+    };
+
+    explicit CompactWriter(std::string& out) : out_(out) {}
+
+    void field_i32(int16_t id, int32_t value) {
+        field(id, I32);
+        varint(zigzag(value));
+    }
+
+    void field_i64(int16_t id, int64_t value) {
+        field(id, I64);
+        varint(zigzag(value));
+    }
+
+    void field_binary(int16_t id, std::string_view value) {
+        field(id, BINARY);
+        binary(value);
+    }
+
+    void field_bool(int16_t id, bool value) { field(id, value ? BOOL_TRUE : BOOL_FALSE); }
+
+    // Opens a struct field; close it with end()
+    void field_struct(int16_t id) {
+        field(id, STRUCT);
+        begin();
+    }
+
+    // The elements follow: begin()/end() for structs, i32() or binary() otherwise
+    void field_list(int16_t id, Type element, size_t size) {
+        field(id, LIST);
+        if (size < 15) {
+            out_ += static_cast<char>(size << 4 | element);
+        } else {
+            out_ += static_cast<char>(0xF0 | element);
+            varint(size);
+        }
+    }
+
+    void begin() {
+        last_ids_.push_back(last_id_);
+        last_id_ = 0;
+    }
+
+    void end() {
+        out_ += '\0';
+        last_id_ = last_ids_.back();
+        last_ids_.pop_back();
+    }
+
+    void i32(int32_t value) { varint(zigzag(value)); }
+
+    void binary(std::string_view value) {
+        varint(value.size());
+        out_ += value;
+    }
+
+private:
+    static uint64_t zigzag(int64_t value) {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    void varint(uint64_t value) {
+        while (value >= 0x80) {
+            out_ += static_cast<char>(value | 0x80);
+            value >>= 7;
+        }
+        out_ += static_cast<char>(value);
+    }
+
+    void field(int16_t id, Type type) {
+        if (id > last_id_ && id - last_id_ <= 15) {
+            out_ += static_cast<char>((id - last_id_) << 4 | type);
+        } else {
+            out_ += static_cast<char>(type);
+            varint(zigzag(id));
+        }
+        last_id_ = id;
+    }
+
+    std::string& out_;
+    int16_t last_id_ = 0;
+    std::vector<int16_t> last_ids_;
+};
+
+constexpr char PARQUET_MAGIC[] = "PAR1";
+
+// Physical types, converted types and encodings from parquet.thrift
+constexpr int32_t PARQUET_INT32 = 1;
+constexpr int32_t PARQUET_INT64 = 2;
+constexpr int32_t PARQUET_DOUBLE = 5;
+constexpr int32_t PARQUET_BYTE_ARRAY = 6;
+constexpr int32_t PARQUET_UTF8 = 0;
+constexpr int32_t PARQUET_DATE = 6;
+constexpr int32_t PARQUET_PLAIN = 0;
+constexpr int32_t PARQUET_RLE = 3;
+
+#ifdef TIME_TRACKER_ZLIB
+constexpr int32_t PARQUET_CODEC = 2; // GZIP
+
+// Parquet's GZIP is RFC 1952 gzip. The fastest level keeps an export
+// bound by the output rather than by deflate.
+std::string compress_page(const std::string& raw) {
+    if (raw.size() > UINT_MAX) throw std::runtime_error("Parquet page too large to compress");
+    z_stream stream{};
+    if (deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw std::runtime_error("Could not start compression");
+    }
+    std::string out(deflateBound(&stream, static_cast<uLong>(raw.size())) + 32, '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(raw.data()));
+    stream.avail_in = static_cast<uInt>(raw.size());
+    stream.next_out = reinterpret_cast<Bytef*>(out.data());
+    stream.avail_out = static_cast<uInt>(out.size());
+    int status = deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    if (status != Z_STREAM_END) throw std::runtime_error("Could not compress Parquet page");
+    return out;
+}
+#else
+constexpr int32_t PARQUET_CODEC = 0; // UNCOMPRESSED
+#endif
+
+int32_t parquet_type(ColumnType type) {
+    switch (type) {
+    case ColumnType::Text:      return PARQUET_BYTE_ARRAY;
+    case ColumnType::Date:      return PARQUET_INT32;
+    case ColumnType::Timestamp: return PARQUET_INT64;
+    case ColumnType::Double:    break;
+    }
+    return PARQUET_DOUBLE;
+}
+
+template <typename T>
+void set_statistics(ChunkInfo& chunk, const std::vector<T>& values, T scale = 1) {
+    if (values.empty()) return;
+    auto [min, max] = std::minmax_element(values.begin(), values.end());
+    put_le(chunk.min, static_cast<uint64_t>(*min * scale), sizeof(T));
+    put_le(chunk.max, static_cast<uint64_t>(*max * scale), sizeof(T));
+}
+
+// One row group: per column, a single data page of PLAIN values. The
+// columns are REQUIRED, so the pages hold no definition levels.
+Encoded encode_parquet(const Batch& batch) {
+    Encoded encoded;
+    std::string values;
+    for (size_t c = 0; c < COLUMN_COUNT; ++c) {
+        ChunkInfo chunk;
+        chunk.offset = encoded.bytes.size();
+        values.clear();
+        switch (COLUMNS[c].type) {
+        case ColumnType::Text: {
+            const TextColumn& text = text_column(batch, c);
+            values.reserve(text.bytes.size() + batch.rows() * 4);
+            for (size_t i = 0; i < batch.rows(); ++i) {
+                std::string_view value = text[i];
+                put_le(values, value.size(), 4);
+                values += value;
+            }
+            break;
+        }
+        case ColumnType::Date:
+            append_values(values, batch.days);
+            set_statistics(chunk, batch.days);
+            break;
+        case ColumnType::Timestamp: {
+            const std::vector<int64_t>& seconds = time_column(batch, c);
+            values.reserve(seconds.size() * 8);
+            for (int64_t value : seconds) put_le(values, static_cast<uint64_t>(value * 1000), 8);
+            set_statistics<int64_t>(chunk, seconds, 1000);
+            break;
+        }
+        case ColumnType::Double:
+            append_values(values, batch.hours);
+            break;
+        }
+        if (values.size() > INT32_MAX) throw std::runtime_error("Parquet page too large");
+
+#ifdef TIME_TRACKER_ZLIB
+        std::string compressed = compress_page(values);
+        const std::string& page = compressed;
+#else
+        const std::string& page = values;
+#endif
+        std::string header;
+        CompactWriter meta(header);
+        meta.begin();
+        meta.field_i32(1, 0); // DATA_PAGE
+        meta.field_i32(2, static_cast<int32_t>(values.size()));
+        meta.field_i32(3, static_cast<int32_t>(page.size()));
+        meta.field_struct(5);
+        meta.field_i32(1, static_cast<int32_t>(batch.rows()));
+        meta.field_i32(2, PARQUET_PLAIN);
+        meta.field_i32(3, PARQUET_RLE); // definition levels
+        meta.field_i32(4, PARQUET_RLE); // repetition levels
+        meta.end();
+        meta.end();
+
+        chunk.raw_bytes = header.size() + values.size();
+        chunk.stored_bytes = header.size() + page.size();
+        encoded.bytes += header;
+        encoded.bytes += page;
+        encoded.chunks.push_back(std::move(chunk));
+    }
+    return encoded;
+}
+
+std::string parquet_trailer(const std::vector<Placed>& placed) {
+    uint64_t rows = 0;
+    for (const Placed& group : placed) rows += group.rows;
+
+    std::string metadata;
+    CompactWriter meta(metadata);
+    meta.begin();
+    meta.field_i32(1, 1); // version
+
+    meta.field_list(2, CompactWriter::STRUCT, COLUMN_COUNT + 1);
+    meta.begin();
+    meta.field_binary(4, "schema");
+    meta.field_i32(5, static_cast<int32_t>(COLUMN_COUNT));
+    meta.end();
+    for (const Column& column : COLUMNS) {
+        meta.begin();
+        meta.field_i32(1, parquet_type(column.type));
+        meta.field_i32(3, 0); // REQUIRED
+        meta.field_binary(4, column.name);
+        if (column.type == ColumnType::Text) meta.field_i32(6, PARQUET_UTF8);
+        if (column.type == ColumnType::Date) meta.field_i32(6, PARQUET_DATE);
+        if (column.type != ColumnType::Double) {
+            meta.field_struct(10); // LogicalType
+            switch (column.type) {
+            case ColumnType::Text:
+                meta.field_struct(1); // STRING
+                meta.end();
+                break;
+            case ColumnType::Date:
+                meta.field_struct(6); // DATE
+                meta.end();
+                break;
+            case ColumnType::Timestamp:
+                meta.field_struct(8); // TIMESTAMP
+                meta.field_bool(1, false); // wall-clock time, not adjusted to UTC
+                meta.field_struct(2);      // unit
+                meta.field_struct(1);      // MILLIS
+                meta.end();
+                meta.end();
+                meta.end();
+                break;
+            case ColumnType::Double:
+                break;
+            }
+            meta.end();
+        }
+        meta.end();
+    }
+
+    meta.field_i64(3, static_cast<int64_t>(rows));
+    meta.field_list(4, CompactWriter::STRUCT, placed.size());
+    for (const Placed& group : placed) {
+        uint64_t raw_bytes = 0;
+        uint64_t stored_bytes = 0;
+        meta.begin();
+        meta.field_list(1, CompactWriter::STRUCT, COLUMN_COUNT);
+        for (size_t c = 0; c < COLUMN_COUNT; ++c) {
+            const ChunkInfo& chunk = group.chunks[c];
+            int64_t offset = static_cast<int64_t>(group.offset + chunk.offset);
+            raw_bytes += chunk.raw_bytes;
+            stored_bytes += chunk.stored_bytes;
+            meta.begin();
+            meta.field_i64(2, offset);
+            meta.field_struct(3); // ColumnMetaData
+            meta.field_i32(1, parquet_type(COLUMNS[c].type));
+            meta.field_list(2, CompactWriter::I32, 1);
+            meta.i32(PARQUET_PLAIN);
+            meta.field_list(3, CompactWriter::BINARY, 1);
+            meta.binary(COLUMNS[c].name);
+            meta.field_i32(4, PARQUET_CODEC);
+            meta.field_i64(5, static_cast<int64_t>(group.rows));
+            meta.field_i64(6, static_cast<int64_t>(chunk.raw_bytes));
+            meta.field_i64(7, static_cast<int64_t>(chunk.stored_bytes));
+            meta.field_i64(9, offset);
+            if (!chunk.min.empty()) {
+                meta.field_struct(12); // Statistics
+                meta.field_i64(3, 0);  // null count
+                meta.field_binary(5, chunk.max);
+                meta.field_binary(6, chunk.min);
+                meta.end();
+            }
+            meta.end();
+            meta.end();
+        }
+        meta.field_i64(2, static_cast<int64_t>(raw_bytes));
+        meta.field_i64(3, static_cast<int64_t>(group.rows));
+        meta.field_i64(5, static_cast<int64_t>(group.offset));
+        meta.field_i64(6, static_cast<int64_t>(stored_bytes));
+        meta.end();
+    }
+    meta.field_binary(6, "time_tracker");
+    meta.end();
+
+    std::string out = metadata;
+    put_le(out, metadata.size(), 4);
+    return out + PARQUET_MAGIC;
+}
+
+// --- Formats ---------------------------------------------------------------
+
+std::string preamble(ExportFormat format) {
+    switch (format) {
+    case ExportFormat::Json:    return "[\n";
+    case ExportFormat::Arrow:   return arrow_preamble();
+    case ExportFormat::Parquet: return PARQUET_MAGIC;
+    case ExportFormat::Ics:     break;
+    }
+    return "BEGIN:VCALENDAR\r\nVERSION:2.0\r\nPRODID:-//Time Tracker//Export//EN\r\nCALSCALE:GREGORIAN\r\n";
+}
+
+Encoded encode(ExportFormat format, const Batch& batch, const std::string& stamp) {
+    Encoded encoded;
+    switch (format) {
+    case ExportFormat::Json:    encoded = encode_json(batch); break;
+    case ExportFormat::Arrow:   encoded = encode_arrow(batch); break;
+    case ExportFormat::Parquet: encoded = encode_parquet(batch); break;
+    case ExportFormat::Ics:     encoded = encode_ics(batch, stamp); break;
+    }
+    encoded.sequence = batch.sequence;
+    encoded.rows = batch.rows();
+    return encoded;
+}
+
+std::string trailer(ExportFormat format, const std::vector<Placed>& placed) {
+    switch (format) {
+    case ExportFormat::Json:    return placed.empty() ? "]\n" : "\n]\n";
+    case ExportFormat::Arrow:   return arrow_trailer(placed);
+    case ExportFormat::Parquet: return parquet_trailer(placed);
+    case ExportFormat::Ics:     break;
+    }
+    return "END:VCALENDAR\r\n";
+}
+
+void write_out(std::FILE* output, std::string_view bytes, ExportResult& result) {
+    if (std::fwrite(bytes.data(), 1, bytes.size(), output) != bytes.size()) {
+        throw std::runtime_error("Could not write the export");
+    }
+    result.bytes += bytes.size();
+}
+
+} // namespace
+
+bool parse_export_format(std::string_view text, ExportFormat& format) {
+    if (text == "json") format = ExportFormat::Json;
+    else if (text == "arrow") format = ExportFormat::Arrow;
+    else if (text == "parquet") format = ExportFormat::Parquet;
+    else if (text == "ics") format = ExportFormat::Ics;
+    else return false;
+    return true;
+}
+
+LogExporter::LogExporter(fs::path csv_file, fs::path index_file, fs::path segment_dir)
+    : csv_file_(std::move(csv_file)), index_file_(std::move(index_file)), segment_dir_(std::move(segment_dir)) {}
+
+ExportResult LogExporter::run(ExportFormat format, std::string_view from, std::string_view to,
+                              std::FILE* output, unsigned threads) {
+    int64_t from_day = 0;
+    int64_t to_day = 0;
+    if (from.size() != 10 || !iso_time::parse_day(from, from_day)) {
+        throw std::runtime_error("Invalid --from date: " + std::string(from));
+    }
+    if (to.size() != 10 || !iso_time::parse_day(to, to_day)) {
+        throw std::runtime_error("Invalid --to date: " + std::string(to));
+    }
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    // DTSTAMP: when the calendar was written, in UTC
+    std::string stamp;
+    if (format == ExportFormat::Ics) {
+        std::time_t now = std::time(nullptr);
+        std::tm utc{};
+#ifdef _WIN32
+        gmtime_s(&utc, &now);
+#else
+        gmtime_r(&now, &utc);
+#endif
+        char text[32];
+        std::strftime(text, sizeof(text), "%Y%m%dT%H%M%SZ", &utc);
+        stamp = text;
+    }
+
+    ExportResult result;
+    Channel<Batch> batches(QUEUE_DEPTH);
+    Reorder encoded(threads + QUEUE_DEPTH);
+    std::atomic<size_t> cut{0};
+    std::atomic<unsigned> encoding{threads};
+    std::exception_ptr select_failure;
+    std::vector<std::exception_ptr> encode_failures(threads);
+
+    auto select_stage = [&] {
+        try {
+            Batch batch;
+            auto send = [&] {
+                if (batch.rows() == 0) return true;
+                batch.sequence = cut++;
+                bool sent = batches.push(std::move(batch));
+                batch = Batch();
+                return sent;
+            };
+            // Copies the rows of text from begin that fall in the range;
+            // shift maps offsets in text to logical log offsets
+            auto collect = [&](std::string_view text, size_t begin, uint64_t shift) {
+                CsvTokenizer rows(text, begin);
+                CsvRecord record;
+                LogRow row;
+                while (rows.next(record)) {
+                    if (!parse_log_row(record, row) || row.day < from_day || row.day > to_day) continue;
+                    int64_t start = 0;
+                    int64_t end = 0;
+                    if (!session_times(row, start, end)) {
+                        ++result.skipped;
+                        continue;
+                    }
+                    batch.names.add(row.name);
+                    batch.days.push_back(static_cast<int32_t>(row.day));
+                    batch.starts.push_back(start);
+                    batch.ends.push_back(end);
+                    batch.hours.push_back(row.hours);
+                    batch.descriptions.add(row.description);
+                    batch.positions.push_back(record.begin + shift);
+                    if (batch.full() && !send()) return false;
+                }
+                return true;
+            };
+
+            // Sealed rows come first; only segments whose dates can match are read
+            SegmentStore segments(csv_file_, segment_dir_);
+            bool open = true;
+            for (const Segment& segment : segments.overlapping(from_day, to_day)) {
+                if (!(open = collect(segments.read(segment), 0, segment.offset))) break;
+            }
+
+            std::vector<DayRange> ranges = LogIndex(csv_file_, index_file_).find(from, to);
+            MappedFile csv(csv_file_);
+            std::string_view text = csv.view();
+            uint64_t head_start = segments.head_start(text);
+            uint64_t shift = segments.logical_offset(text, head_start) - head_start;
+            for (const auto& range : ranges) {
+                if (!open) break;
+                if (range.end > text.size()) continue; // log changed under us
+                if (range.end <= head_start) continue; // sealed; a compaction was interrupted
+                open = collect(text.substr(0, range.end), static_cast<size_t>(std::max(range.begin, head_start)),
+                               shift);
+            }
+            if (open) send();
+        } catch (...) {
+            select_failure = std::current_exception();
+            encoded.close();
+        }
+        batches.close();
+    };
+
+    auto encode_stage = [&](unsigned worker) {
+        try {
+            Batch batch;
+            while (batches.pop(batch)) {
+                if (!encoded.put(encode(format, batch, stamp))) break;
+            }
+        } catch (...) {
+            encode_failures[worker] = std::current_exception();
+            batches.close();
+            encoded.close();
+        }
+        if (--encoding == 0) encoded.finish(cut);
+    };
+
+    std::thread selector(select_stage);
+    std::vector<std::thread> encoders;
+    for (unsigned i = 0; i < threads; ++i) encoders.emplace_back(encode_stage, i);
+
+    // Each batch goes out in one write, straight from the encoder's buffer
+    std::vector<Placed> placed;
+    std::exception_ptr write_failure;
+    try {
+        write_out(output, preamble(format), result);
+        Encoded batch;
+        while (encoded.take(batch)) {
+            placed.push_back(Placed{result.bytes, batch.bytes.size(), batch.rows, batch.metadata_bytes,
+                                    std::move(batch.chunks)});
+            write_out(output, batch.bytes, result);
+            result.rows += batch.rows;
+        }
+    } catch (...) {
+        write_failure = std::current_exception();
+        batches.close();
+        encoded.close();
+    }
+    selector.join();
+    for (auto& encoder : encoders) encoder.join();
+
+    if (select_failure) std::rethrow_exception(select_failure);
+    for (const auto& failure : encode_failures) {
+        if (failure) std::rethrow_exception(failure);
+    }
+    if (write_failure) std::rethrow_exception(write_failure);
+
+    write_out(output, trailer(format, placed), result);
+    if (std::fflush(output) != 0) throw std::runtime_error("Could not write the export");
+    return result;
+}
@@ -0,0 +1,73 @@
+/*
+ * Time Tracker - export of the log for other tools
+ *
+ * Writes the sessions dated in a range of days in a format BI tools and
+ * calendars read directly. Only the matching rows are read: the date
+ * index points at them in the CSV, and sealed segments are opened only
+ * if their dates can match. Three stages joined by bounded queues keep
+ * the CPU work off the output's path:
+ *
+ *   select  tokenizes the matching rows into column batches
+ *   encode  one thread per core turns each batch into the output format,
+ *           gzip included for Parquet pages when built with zlib
+ *   write   puts the encoded batches out in order, one write per batch
+ *
+ * Every format has the columns name, date, start, end, hours and
+ * description, in log order. start and end are local wall-clock times
+ * with no time zone, as the log records them; date is the day a session
+ * ended.
+ *
+ *   json     one array, one object per line
+ *   arrow    Arrow IPC file (Feather v2), one record batch per batch:
+ *            utf8, date32[day], timestamp[s] and float64 columns
+ *   parquet  one row group per batch, PLAIN pages, DATE and
+ *            TIMESTAMP(MILLIS, not adjusted to UTC) logical types
+ *   ics      iCalendar, one VEVENT per session with floating times
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string_view>
+
+namespace fs = std::filesystem;
+
+enum class ExportFormat {
+    Json,
+    Arrow,
+    Parquet,
+    Ics
+};
+
+// Parses "json", "arrow", "parquet" or "ics"
+bool parse_export_format(std::string_view text, ExportFormat& format);
+
+struct ExportResult {
+    uint64_t rows = 0;    // sessions written
+    uint64_t skipped = 0; // dated in range, but with start or end times that do not parse
+    uint64_t bytes = 0;   // written to the output
+};
+
+class LogExporter {
+public:
+    static constexpr size_t BATCH_ROWS = 64 * 1024;
+    static constexpr size_t BATCH_TEXT_BYTES = 16 << 20; // a batch also ends once its strings fill this
+    static constexpr size_t QUEUE_DEPTH = 4;             // batches waiting per stage, beyond one per encoder
+
+    LogExporter(fs::path csv_file, fs::path index_file, fs::path segment_dir);
+
+    // Writes the rows dated from..to ("YYYY-MM-DD") to output. threads = 0
+    // picks one encoder per hardware thread. Throws std::runtime_error on an
+    // invalid date, an unreadable segment or a write failure; output is
+    // then incomplete.
+    ExportResult run(ExportFormat format, std::string_view from, std::string_view to,
+                     std::FILE* output, unsigned threads = 0);
+
+private:
+    fs::path csv_file_;
+    fs::path index_file_;
+    fs::path segment_dir_;
+};
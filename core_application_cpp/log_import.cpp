@@ -0,0 +1,342 @@
+#include "log_import.hpp"
+
+#include "channel.hpp"
+#include "csv_tokenizer.hpp"
+#include "durable_log.hpp"
+#include "iso_time.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <exception>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+namespace {
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) text.remove_suffix(1);
+    return text;
+}
+
+// "YYYY-MM-DD" (or with '/') naming a real calendar day
+bool parse_import_day(std::string_view text, int64_t& day) {
+    if (text.size() != 10) return false;
+    char normalized[10];
+    for (size_t i = 0; i < 10; ++i) normalized[i] = text[i] == '/' ? '-' : text[i];
+    std::string_view date(normalized, 10);
+    iso_time::CivilDate civil{};
+    if (!iso_time::parse_date(date, civil) || !iso_time::parse_day(date, day)) return false;
+    iso_time::CivilDate back = iso_time::civil_from_days(day);
+    return back.month == civil.month && back.day == civil.day; // rejects 2025-02-30
+}
+
+// "H:MM", "HH:MM" or "H:MM:SS" with at most max_hours hours -> seconds
+bool parse_hms(std::string_view text, int64_t max_hours, int64_t& seconds) {
+    int64_t parts[3] = {0, 0, 0};
+    size_t count = 0;
+    size_t digits = 0;
+    for (char c : text) {
+        if (c == ':') {
+            if (digits == 0 || (count > 0 && digits != 2) || ++count > 2) return false;
+            digits = 0;
+            continue;
+        }
+        if (c < '0' || c > '9' || ++digits > 7) return false;
+        parts[count] = parts[count] * 10 + (c - '0');
+    }
+    if (count == 0 || digits != 2) return false;
+    if (parts[0] > max_hours || parts[1] > 59 || parts[2] > 59) return false;
+    seconds = parts[0] * 3600 + parts[1] * 60 + parts[2];
+    return true;
+}
+
+// A start or end: a time of day, or a date and time ("T" or " " between)
+struct Moment {
+    bool dated = false;
+    int64_t day = 0;
+    int64_t seconds = 0; // of the day
+};
+
+bool parse_moment(std::string_view text, Moment& moment) {
+    if (text.size() > 11 && (text[10] == 'T' || text[10] == ' ')) {
+        moment.dated = true;
+        return parse_import_day(text.substr(0, 10), moment.day) &&
+               parse_hms(trim(text.substr(11)), 23, moment.seconds);
+    }
+    return parse_hms(text, 23, moment.seconds);
+}
+
+// Decimal hours ("1.5") or a clock-style length ("1:30", "01:30:00")
+bool parse_duration(std::string_view text, int64_t& seconds) {
+    if (text.find(':') != std::string_view::npos) return parse_hms(text, 1000000, seconds);
+    double hours = 0.0;
+    auto parsed = std::from_chars(text.data(), text.data() + text.size(), hours);
+    if (parsed.ec != std::errc() || parsed.ptr != text.data() + text.size() || !(hours >= 0.0) ||
+        hours > 1000000.0) {
+        return false;
+    }
+    seconds = std::llround(hours * 3600.0);
+    return true;
+}
+
+// Hours with two decimals, rounded half up. Integer arithmetic: printf
+// would cost more than the rest of the row together.
+void append_hours(std::string& out, int64_t seconds) {
+    int64_t hundredths = (seconds * 100 + 1800) / 3600;
+    char text[24];
+    char* end = std::to_chars(text, text + sizeof(text), hundredths / 100).ptr;
+    *end++ = '.';
+    *end++ = static_cast<char>('0' + hundredths / 10 % 10);
+    *end++ = static_cast<char>('0' + hundredths % 10);
+    out.append(text, static_cast<size_t>(end - text));
+}
+
+// Turns input records into rows in the log's own layout
+class Normalizer {
+public:
+    enum class Outcome { Row, Header, Blank, Rejected };
+
+    explicit Normalizer(const std::string& default_name) : default_name_(default_name) {
+        for (int i = 0; i < CSV_COLUMNS; ++i) columns_[i] = i;
+    }
+
+    Outcome add(const CsvRecord& record, std::string& out, std::string& reason) {
+        if (trim(record.line).empty()) return Outcome::Blank;
+        if (first_) {
+            first_ = false;
+            if (read_header(record)) return Outcome::Header;
+        }
+
+        std::string_view name = field(record, CSV_NAME);
+        std::string_view date = field(record, CSV_DATE);
+        std::string_view start_text = field(record, CSV_START_TIME);
+        std::string_view end_text = field(record, CSV_END_TIME);
+        std::string_view duration_text = field(record, CSV_DURATION);
+        std::string_view description = layout_ ? record.description() : field(record, CSV_DESCRIPTION);
+
+        Moment start;
+        Moment end;
+        int64_t day = 0;
+        int64_t duration = 0;
+        if (!start_text.empty() && !parse_moment(start_text, start)) return reject(reason, "bad start time", start_text);
+        if (!end_text.empty() && !parse_moment(end_text, end)) return reject(reason, "bad end time", end_text);
+        if (!duration_text.empty() && !parse_duration(duration_text, duration)) {
+            return reject(reason, "bad duration", duration_text);
+        }
+        if (!date.empty() && !parse_import_day(date, day)) return reject(reason, "bad date", date);
+        bool has_start = !start_text.empty();
+        bool has_end = !end_text.empty();
+        bool has_duration = !duration_text.empty();
+        if (has_start + has_end + has_duration < 2) {
+            return reject(reason, "needs two of start, end and duration", record.line);
+        }
+
+        // As in the log, the date is the day the session ended (or, with
+        // no end given, the day it started)
+        if (date.empty()) {
+            if (has_end && end.dated) day = end.day;
+            else if (has_start && start.dated) day = start.day;
+            else return reject(reason, "no date", record.line);
+        }
+        int64_t start_local = 0;
+        int64_t end_local = 0;
+        if (has_end) end_local = (end.dated ? end.day : day) * 86400 + end.seconds;
+        if (has_start) {
+            start_local = (start.dated ? start.day : day) * 86400 + start.seconds;
+            // An undated start later than the end began the day before
+            if (has_end && !start.dated && start_local > end_local) start_local -= 86400;
+        }
+        if (!has_end) end_local = start_local + duration;
+        if (!has_start) start_local = end_local - duration;
+        // Wall-clock difference: a session across a DST change is off by the shift
+        if (!has_duration) duration = end_local - start_local;
+        if (end_local < start_local) return reject(reason, "ends before it starts", record.line);
+
+        char end_iso[iso_time::ISO_LENGTH];
+        char start_iso[iso_time::ISO_LENGTH];
+        iso_time::format_iso(end_local, end_iso);
+        iso_time::format_iso(start_local, start_iso);
+        write_csv_field(out, name.empty() ? std::string_view(default_name_) : name);
+        out += ',';
+        out.append(end_iso, 10);
+        out += ',';
+        out.append(start_iso + 11, 8);
+        out += ',';
+        out.append(end_iso + 11, 8);
+        out += ',';
+        append_hours(out, duration);
+        out += ',';
+        write_csv_field(out, description);
+        out += '\n';
+        return Outcome::Row;
+    }
+
+private:
+    std::string_view field(const CsvRecord& record, int column) const {
+        int index = columns_[column];
+        if (index < 0 || static_cast<size_t>(index) >= record.fields.size()) return std::string_view();
+        return trim(record.fields[static_cast<size_t>(index)]);
+    }
+
+    // A first row naming at least two known columns is a header
+    bool read_header(const CsvRecord& record) {
+        static const std::pair<const char*, int> NAMES[] = {
+            {"name", CSV_NAME}, {"user", CSV_NAME}, {"date", CSV_DATE},
+            {"start_time", CSV_START_TIME}, {"start", CSV_START_TIME},
+            {"end_time", CSV_END_TIME}, {"end", CSV_END_TIME},
+            {"duration_hours", CSV_DURATION}, {"duration", CSV_DURATION}, {"hours", CSV_DURATION},
+            {"description", CSV_DESCRIPTION}, {"task", CSV_DESCRIPTION}};
+        int mapped[CSV_COLUMNS];
+        std::fill(std::begin(mapped), std::end(mapped), -1);
+        int known = 0;
+        for (size_t i = 0; i < record.fields.size(); ++i) {
+            std::string label(trim(record.fields[i]));
+            std::transform(label.begin(), label.end(), label.begin(),
+                           [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            for (const auto& [text, column] : NAMES) {
+                if (label == text && mapped[column] < 0) {
+                    mapped[column] = static_cast<int>(i);
+                    ++known;
+                }
+            }
+        }
+        if (known < 2) return false;
+        if (mapped[CSV_START_TIME] < 0 && mapped[CSV_END_TIME] < 0) {
+            throw std::runtime_error("import header names neither a start nor an end column");
+        }
+        // The log's own header keeps legacy descriptions readable
+        layout_ = std::equal(std::begin(mapped), std::end(mapped), std::begin(columns_));
+        std::copy(std::begin(mapped), std::end(mapped), columns_);
+        return true;
+    }
+
+    Outcome reject(std::string& reason, const char* what, std::string_view value) {
+        reason = what;
+        reason += ": ";
+        reason.append(value.substr(0, 80));
+        return Outcome::Rejected;
+    }
+
+    std::string default_name_;
+    int columns_[CSV_COLUMNS];
+    bool layout_ = true; // the log's own column order, legacy descriptions included
+    bool first_ = true;
+};
+
+} // namespace
+
+LogImporter::LogImporter(fs::path csv_file, fs::path journal_file, std::string default_name)
+    : csv_file_(std::move(csv_file)), journal_file_(std::move(journal_file)),
+      default_name_(std::move(default_name)) {}
+
+ImportResult LogImporter::run(std::FILE* input) {
+    ImportResult result;
+    Channel<std::string> chunks(QUEUE_DEPTH);
+    Channel<std::string> blocks(QUEUE_DEPTH);
+    std::exception_ptr read_failure;
+    std::exception_ptr normalize_failure;
+
+    auto read_stage = [&] {
+        try {
+            for (;;) {
+                std::string chunk(CHUNK_BYTES, '\0');
+                size_t size = std::fread(chunk.data(), 1, chunk.size(), input);
+                if (size == 0) break;
+                chunk.resize(size);
+                if (!chunks.push(std::move(chunk))) break;
+            }
+            if (std::ferror(input)) throw std::runtime_error("Could not read the import input");
+        } catch (...) {
+            read_failure = std::current_exception();
+            blocks.close(); // stops the writer without a partial import
+        }
+        chunks.close();
+    };
+
+    auto normalize_stage = [&] {
+        try {
+            Normalizer normalizer(default_name_);
+            std::string block;
+            std::string reason;
+            uint64_t row_number = 0;
+            // Tokenizes text and returns how much of it was consumed; a record
+            // the chunk cuts short is left for the next one unless text is final
+            auto consume = [&](std::string_view text, bool final) {
+                CsvTokenizer tokenizer(text);
+                CsvRecord record;
+                size_t consumed = 0;
+                while (tokenizer.next(record)) {
+                    if (!record.terminated && !final) break;
+                    consumed = record.end;
+                    ++row_number;
+                    switch (normalizer.add(record, block, reason)) {
+                    case Normalizer::Outcome::Row:
+                        ++result.rows;
+                        break;
+                    case Normalizer::Outcome::Rejected:
+                        ++result.skipped;
+                        if (result.errors.size() < MAX_ERRORS) {
+                            result.errors.push_back("row " + std::to_string(row_number) + ": " + reason);
+                        }
+                        break;
+                    case Normalizer::Outcome::Header:
+                    case Normalizer::Outcome::Blank:
+                        break;
+                    }
+                    if (block.size() >= CHUNK_BYTES) {
+                        result.bytes += block.size();
+                        if (!blocks.push(std::move(block))) return consumed;
+                        block = std::string();
+                        block.reserve(CHUNK_BYTES + CHUNK_BYTES / 8);
+                    }
+                }
+                return final ? text.size() : consumed;
+            };
+
+            std::string carry; // a record cut by the end of the previous chunk
+            std::string chunk;
+            bool first = true;
+            while (chunks.pop(chunk)) {
+                if (first && chunk.rfind("\xEF\xBB\xBF", 0) == 0) chunk.erase(0, 3); // UTF-8 BOM
+                first = false;
+                if (!carry.empty()) chunk.insert(0, carry);
+                carry.assign(chunk, consume(chunk, false), std::string::npos);
+            }
+            consume(carry, true);
+            if (!block.empty()) {
+                result.bytes += block.size();
+                blocks.push(std::move(block));
+            }
+        } catch (...) {
+            normalize_failure = std::current_exception();
+            chunks.close();
+        }
+        blocks.close();
+    };
+
+    DurableAppender csv(csv_file_, journal_file_);
+    result.offset = csv.append_bulk([&](const DurableAppender::BulkWriter& write) {
+        std::thread reader(read_stage);
+        std::thread normalizer(normalize_stage);
+        try {
+            std::string block;
+            while (blocks.pop(block)) write(block);
+        } catch (...) {
+            chunks.close();
+            blocks.close();
+            reader.join();
+            normalizer.join();
+            throw;
+        }
+        reader.join();
+        normalizer.join();
+        if (read_failure) std::rethrow_exception(read_failure);
+        if (normalize_failure) std::rethrow_exception(normalize_failure);
+    });
+    return result;
+}
@@ -0,0 +1,62 @@
+/*
+ * Time Tracker - bulk import of historical sessions
+ *
+ * Appends sessions exported by other tools (or an old time_logs.csv) to
+ * the log in one pass. Three threads form a pipeline joined by bounded
+ * queues, so reading, parsing and writing overlap:
+ *
+ *   read       fills CHUNK_BYTES buffers from the input
+ *   normalize  tokenizes the chunks, checks each row and re-formats it in
+ *              the log's own layout into output blocks
+ *   write      streams the blocks into the CSV through
+ *              DurableAppender::append_bulk: one flush for the whole
+ *              import, which lands whole or not at all
+ *
+ * Input is CSV. A header row may name the columns in any order (name or
+ * user, date, start_time or start, end_time or end, duration_hours,
+ * duration or hours, description or task); without one the log's own
+ * column order is assumed. Times may be H:MM, HH:MM or HH:MM:SS, or a
+ * full "YYYY-MM-DD HH:MM[:SS]" (or with a T), in which case the date
+ * column may be left out. As in the log, the date is the day a session
+ * ended. Any two of start, end and duration are enough.
+ * Rows that still do not make sense are skipped and reported by row
+ * number.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct ImportResult {
+    uint64_t rows = 0;               // appended to the log
+    uint64_t skipped = 0;            // rejected, including the ones in errors
+    uint64_t bytes = 0;              // of normalized CSV appended
+    uint64_t offset = 0;             // where the first appended row begins in the CSV
+    std::vector<std::string> errors; // the first MAX_ERRORS rejections, "row N: reason"
+};
+
+class LogImporter {
+public:
+    static constexpr size_t CHUNK_BYTES = 4 << 20;
+    static constexpr size_t QUEUE_DEPTH = 4; // chunks in flight between two stages
+    static constexpr size_t MAX_ERRORS = 10;
+
+    // Rows with no name are logged under default_name
+    LogImporter(fs::path csv_file, fs::path journal_file, std::string default_name);
+
+    // Reads input to the end and appends every valid row. Throws
+    // std::runtime_error on a read or write failure, with nothing appended.
+    ImportResult run(std::FILE* input);
+
+private:
+    fs::path csv_file_;
+    fs::path journal_file_;
+    std::string default_name_;
+};
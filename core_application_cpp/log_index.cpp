@@ -0,0 +1,209 @@
+#include "log_index.hpp"
+#include "csv_tokenizer.hpp"
+#include "durable_log.hpp"
+#include "iso_time.hpp"
+#include "mapped_file.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+#include <utility>
+
+namespace {
+
+constexpr char INDEX_MAGIC[4] = {'T', 'T', 'I', 'X'};
+constexpr uint32_t INDEX_VERSION = 1;
+constexpr uint64_t TAIL_HASH_BYTES = 64;
+
+// FNV-1a, used only to notice that the indexed part of the CSV was edited
+uint64_t fnv1a(const char* data, size_t size) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+} // namespace
+
+LogIndex::LogIndex(fs::path csv_file, fs::path index_file)
+    : csv_file_(std::move(csv_file)), index_file_(std::move(index_file)) {}
+
+uint32_t LogIndex::date_key(std::string_view date) {
+    iso_time::CivilDate civil{};
+    if (date.size() != 10 || !iso_time::parse_date(date, civil)) return 0;
+    return static_cast<uint32_t>(civil.year) * 10000 + civil.month * 100 + civil.day;
+}
+
+bool LogIndex::read_header(Header& header) const {
+    std::ifstream in(index_file_, std::ios::binary);
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+    return std::memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0 &&
+           header.version == INDEX_VERSION;
+}
+
+uint64_t LogIndex::csv_tail_hash(uint64_t end) const {
+    uint64_t count = std::min(end, TAIL_HASH_BYTES);
+    char buffer[TAIL_HASH_BYTES];
+    std::ifstream in(csv_file_, std::ios::binary);
+    in.seekg(static_cast<std::streamoff>(end - count));
+    if (!in.read(buffer, static_cast<std::streamsize>(count))) return 0;
+    return fnv1a(buffer, static_cast<size_t>(count));
+}
+
+void LogIndex::rebuild() {
+    Header header{};
+    std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version = INDEX_VERSION;
+    header.sorted = 1;
+
+    std::ofstream out(index_file_, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+void LogIndex::sync() {
+    ProcessLock lock(derived_lock_file(csv_file_));
+    update();
+}
+
+void LogIndex::update() {
+    std::error_code ec;
+    uint64_t csv_size = fs::file_size(csv_file_, ec);
+    if (ec) return;
+
+    Header header{};
+    if (!read_header(header) ||
+        csv_size < header.indexed_bytes ||
+        (header.indexed_bytes > 0 && csv_tail_hash(header.indexed_bytes) != header.tail_hash)) {
+        rebuild();
+        read_header(header);
+    }
+    if (csv_size == header.indexed_bytes) return;
+
+    MappedFile csv(csv_file_);
+    std::string_view text = csv.view();
+    if (text.size() < header.indexed_bytes) return; // truncated between stat and map
+
+    Run last{};
+    bool have_last = header.run_count > 0;
+    if (have_last) {
+        std::ifstream in(index_file_, std::ios::binary);
+        in.seekg(static_cast<std::streamoff>(sizeof(Header) + (header.run_count - 1) * sizeof(Run)));
+        in.read(reinterpret_cast<char*>(&last), sizeof(last));
+    }
+
+    std::vector<Run> runs;
+    CsvTokenizer rows(text, static_cast<size_t>(header.indexed_bytes));
+    CsvRecord row;
+    if (header.indexed_bytes == 0) {
+        // Skip the column header row
+        if (!rows.next(row) || !row.terminated) return;
+    }
+
+    size_t pos = rows.offset();
+    while (rows.next(row) && row.terminated) { // a partial row is still being written
+        uint32_t day = row.fields.size() > CSV_DATE ? date_key(row.fields[CSV_DATE]) : 0;
+        if (day != 0) {
+            Run* tail = !runs.empty() ? &runs.back() : (have_last ? &last : nullptr);
+            if (tail && tail->day == day && tail->end == row.begin) {
+                tail->end = row.end;
+            } else {
+                if (tail && day < tail->day) header.sorted = 0;
+                runs.push_back(Run{day, 0, row.begin, row.end});
+            }
+        }
+        pos = row.end;
+    }
+
+    std::fstream out(index_file_, std::ios::binary | std::ios::in | std::ios::out);
+    if (have_last) {
+        out.seekp(static_cast<std::streamoff>(sizeof(Header) + (header.run_count - 1) * sizeof(Run)));
+        out.write(reinterpret_cast<const char*>(&last), sizeof(last));
+    } else {
+        out.seekp(static_cast<std::streamoff>(sizeof(Header)));
+    }
+    out.write(reinterpret_cast<const char*>(runs.data()),
+              static_cast<std::streamsize>(runs.size() * sizeof(Run)));
+
+    header.run_count += runs.size();
+    header.indexed_bytes = pos;
+    header.tail_hash = fnv1a(text.data() + pos - std::min<uint64_t>(pos, TAIL_HASH_BYTES),
+                             static_cast<size_t>(std::min<uint64_t>(pos, TAIL_HASH_BYTES)));
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+std::vector<DayRange> LogIndex::find(std::string_view date) {
+    std::vector<DayRange> ranges;
+    uint32_t day = date_key(date);
+    if (day == 0) return ranges;
+
+    // Held while the runs are read too: a rebuild truncates the file
+    ProcessLock lock(derived_lock_file(csv_file_));
+    update();
+
+    MappedFile index(index_file_);
+    if (index.size() < sizeof(Header)) return ranges;
+
+    Header header;
+    std::memcpy(&header, index.data(), sizeof(header));
+    uint64_t available = (index.size() - sizeof(Header)) / sizeof(Run);
+    size_t count = static_cast<size_t>(std::min(header.run_count, available));
+
+    // The mapping is page aligned, so the 8-byte aligned run table can be read in place
+    const Run* runs = reinterpret_cast<const Run*>(index.data() + sizeof(Header));
+    auto by_day = [](const Run& run, uint32_t d) { return run.day < d; };
+
+    if (header.sorted) {
+        for (const Run* it = std::lower_bound(runs, runs + count, day, by_day);
+             it != runs + count && it->day == day; ++it) {
+            ranges.push_back(DayRange{it->begin, it->end});
+        }
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            if (runs[i].day == day) ranges.push_back(DayRange{runs[i].begin, runs[i].end});
+        }
+    }
+    return ranges;
+}
+
+std::vector<DayRange> LogIndex::find(std::string_view from, std::string_view to) {
+    std::vector<DayRange> ranges;
+    uint32_t first = date_key(from);
+    uint32_t last = date_key(to);
+    if (first == 0 || last == 0 || first > last) return ranges;
+
+    ProcessLock lock(derived_lock_file(csv_file_));
+    update();
+
+    MappedFile index(index_file_);
+    if (index.size() < sizeof(Header)) return ranges;
+
+    Header header;
+    std::memcpy(&header, index.data(), sizeof(header));
+    uint64_t available = (index.size() - sizeof(Header)) / sizeof(Run);
+    size_t count = static_cast<size_t>(std::min(header.run_count, available));
+    const Run* runs = reinterpret_cast<const Run*>(index.data() + sizeof(Header));
+
+    // Runs are stored in log order, so a sorted index yields ranges in order
+    const Run* begin = runs;
+    const Run* end = runs + count;
+    if (header.sorted) {
+        auto by_day = [](const Run& run, uint32_t d) { return run.day < d; };
+        begin = std::lower_bound(runs, end, first, by_day);
+    }
+    for (const Run* it = begin; it != end; ++it) {
+        if (it->day < first || it->day > last) {
+            if (header.sorted) break;
+            continue;
+        }
+        if (!ranges.empty() && ranges.back().end == it->begin) {
+            ranges.back().end = it->end;
+        } else {
+            ranges.push_back(DayRange{it->begin, it->end});
+        }
+    }
+    return ranges;
+}
@@ -0,0 +1,73 @@
+/*
+ * Time Tracker - sidecar date index for time_logs.csv
+ *
+ * The index maps each day to the byte ranges of its rows in the CSV, so a
+ * daily report only touches the rows for that day. It is stored next to the
+ * log as a small binary file of "runs" (consecutive rows sharing a date) and
+ * is brought up to date incrementally: only bytes appended since the last
+ * sync are scanned. If the CSV shrank or its indexed tail changed, the index
+ * is rebuilt from scratch. Every process updates the file in place, so
+ * syncs and lookups hold the derived files' lock (see durable_log.hpp).
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// Byte range [begin, end) of whole CSV rows, including their trailing newline
+struct DayRange {
+    uint64_t begin;
+    uint64_t end;
+};
+
+class LogIndex {
+public:
+    LogIndex(fs::path csv_file, fs::path index_file);
+
+    // Indexes rows appended since the last sync, or rebuilds the index
+    // if the CSV no longer matches what was indexed.
+    void sync();
+
+    // Returns the byte ranges holding rows whose date column equals date.
+    // Syncs first, so rows appended by other processes are included.
+    std::vector<DayRange> find(std::string_view date);
+
+    // Byte ranges holding rows dated from..to inclusive, in log order with
+    // adjacent ranges joined. Syncs first, like find(date).
+    std::vector<DayRange> find(std::string_view from, std::string_view to);
+
+    // "YYYY-MM-DD" -> yyyymmdd, or 0 if the text is not a date
+    static uint32_t date_key(std::string_view date);
+
+private:
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t indexed_bytes; // CSV bytes covered by the index
+        uint64_t run_count;
+        uint64_t tail_hash;     // hash of the last bytes before indexed_bytes
+        uint32_t sorted;        // 1 while run dates are non-decreasing
+        uint32_t reserved;
+    };
+
+    struct Run {
+        uint32_t day;
+        uint32_t reserved;
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    bool read_header(Header& header) const;
+    uint64_t csv_tail_hash(uint64_t end) const;
+    void rebuild();
+    // sync() for a caller holding the lock
+    void update();
+
+    fs::path csv_file_;
+    fs::path index_file_;
+};
@@ -0,0 +1,746 @@
+#include "log_query.hpp"
+
+#include "csv_tokenizer.hpp"
+#include "iso_time.hpp"
+#include "log_index.hpp"
+#include "mapped_file.hpp"
+#include "segment_store.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+static_assert(QueryBranch::FIRST_DAY == iso_time::days_from_civil(1, 1, 1), "first day");
+static_assert(QueryBranch::LAST_DAY == iso_time::days_from_civil(9999, 12, 31), "last day");
+
+namespace {
+
+constexpr double INF = std::numeric_limits<double>::infinity();
+
+// ASCII lowercase without a branch
+inline unsigned char fold(char c) {
+    unsigned char u = static_cast<unsigned char>(c);
+    return static_cast<unsigned char>(u + ((static_cast<unsigned>(u - 'A') < 26u) << 5));
+}
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool is_operator_char(char c) {
+    return c == '=' || c == '!' || c == '<' || c == '>' || c == '~';
+}
+
+std::string lowercase(std::string_view text) {
+    std::string lowered(text);
+    for (char& c : lowered) c = static_cast<char>(fold(c));
+    return lowered;
+}
+
+std::string date_text(int64_t day) {
+    iso_time::CivilDate date = iso_time::civil_from_days(day);
+    char text[32];
+    std::snprintf(text, sizeof(text), "%04d-%02u-%02u", date.year, date.month, date.day);
+    return text;
+}
+
+std::string clock_text(int64_t seconds) {
+    char text[16];
+    std::snprintf(text, sizeof(text), "%02d:%02d:%02d", static_cast<int>(seconds / 3600),
+                  static_cast<int>(seconds / 60 % 60), static_cast<int>(seconds % 60));
+    return text;
+}
+
+// Shortest text that reads back as value
+std::string number_text(double value) {
+    char text[32];
+    auto written = std::to_chars(text, text + sizeof(text), value);
+    return std::string(text, written.ptr);
+}
+
+// The neighbouring values of a range bound, for the strict comparisons
+int64_t before(int64_t value) { return value - 1; }
+int64_t after(int64_t value) { return value + 1; }
+double before(double value) { return std::nextafter(value, -INF); }
+double after(double value) { return std::nextafter(value, INF); }
+
+enum class Field { Name, Description, Date, Start, End, Hours };
+
+enum class Op { Equal, NotEqual, Less, LessEqual, Greater, GreaterEqual, Contains, Lacks };
+
+Op negated(Op op) {
+    switch (op) {
+    case Op::Equal: return Op::NotEqual;
+    case Op::NotEqual: return Op::Equal;
+    case Op::Less: return Op::GreaterEqual;
+    case Op::LessEqual: return Op::Greater;
+    case Op::Greater: return Op::LessEqual;
+    case Op::GreaterEqual: return Op::Less;
+    case Op::Contains: return Op::Lacks;
+    case Op::Lacks: return Op::Contains;
+    }
+    return op;
+}
+
+struct Token {
+    enum Kind { WORD, STRING, OP, OPEN, CLOSE, END };
+    Kind kind = END;
+    std::string text;
+    size_t column = 0; // 1-based
+};
+
+// Recursive descent straight to branches: negation is carried down as a
+// flag (De Morgan), so only comparisons are ever negated
+class Parser {
+public:
+    using Branches = std::vector<QueryBranch>;
+
+    explicit Parser(std::string_view text) : text_(text) { advance(); }
+
+    Branches parse() {
+        Branches branches = parse_or(false);
+        if (token_.kind != Token::END) fail("unexpected " + shown(token_), token_.column);
+        return branches;
+    }
+
+private:
+    [[noreturn]] void fail(const std::string& message, size_t column) const {
+        throw std::runtime_error("Invalid query at column " + std::to_string(column) + ": " + message);
+    }
+
+    static std::string shown(const Token& token) {
+        if (token.kind == Token::END) return "end of query";
+        if (token.kind == Token::OPEN) return "'('";
+        if (token.kind == Token::CLOSE) return "')'";
+        return "'" + token.text + "'";
+    }
+
+    void advance() {
+        while (pos_ < text_.size() && is_space(text_[pos_])) ++pos_;
+        token_ = Token();
+        token_.column = pos_ + 1;
+        if (pos_ == text_.size()) return;
+
+        char c = text_[pos_];
+        if (c == '(' || c == ')') {
+            token_.kind = c == '(' ? Token::OPEN : Token::CLOSE;
+            ++pos_;
+        } else if (c == '"') {
+            token_.kind = Token::STRING;
+            for (++pos_; pos_ < text_.size() && text_[pos_] != '"'; ++pos_) {
+                if (text_[pos_] == '\\' && pos_ + 1 < text_.size()) ++pos_;
+                token_.text += text_[pos_];
+            }
+            if (pos_ == text_.size()) fail("unterminated string", token_.column);
+            ++pos_;
+        } else if (is_operator_char(c)) {
+            token_.kind = Token::OP;
+            token_.text = c;
+            char next = pos_ + 1 < text_.size() ? text_[pos_ + 1] : '\0';
+            if ((next == '=' && c != '~') || (c == '!' && next == '~')) token_.text += next;
+            if (token_.text == "!") fail("'!' must be followed by = or ~", token_.column);
+            pos_ += token_.text.size();
+        } else {
+            token_.kind = Token::WORD;
+            while (pos_ < text_.size() && !is_space(text_[pos_]) && !is_operator_char(text_[pos_]) &&
+                   text_[pos_] != '(' && text_[pos_] != ')' && text_[pos_] != '"') {
+                token_.text += text_[pos_++];
+            }
+        }
+    }
+
+    bool keyword(const char* word) const {
+        return token_.kind == Token::WORD && lowercase(token_.text) == word;
+    }
+
+    Branches either(Branches left, const Branches& right) const {
+        left.insert(left.end(), right.begin(), right.end());
+        if (left.size() > LogQuery::MAX_BRANCHES) too_many();
+        return left;
+    }
+
+    Branches both(const Branches& left, const Branches& right) const {
+        Branches branches;
+        for (const auto& a : left) {
+            for (const auto& b : right) {
+                QueryBranch branch = a;
+                if (!branch.intersect(b)) continue;
+                branches.push_back(std::move(branch));
+                if (branches.size() > LogQuery::MAX_BRANCHES) too_many();
+            }
+        }
+        return branches;
+    }
+
+    [[noreturn]] void too_many() const {
+        fail("expands to more than " + std::to_string(LogQuery::MAX_BRANCHES) +
+             " AND-branches; simplify the ORs", token_.column);
+    }
+
+    Branches parse_or(bool negate) {
+        Branches branches = parse_and(negate);
+        while (keyword("or")) {
+            advance();
+            Branches right = parse_and(negate);
+            branches = negate ? both(branches, right) : either(std::move(branches), right);
+        }
+        return branches;
+    }
+
+    // AND may be left out: "user=alice date=2025-10" is both
+    Branches parse_and(bool negate) {
+        Branches branches = parse_unary(negate);
+        while (true) {
+            if (keyword("and")) advance();
+            else if (!(token_.kind == Token::OPEN || (token_.kind == Token::WORD && !keyword("or")))) break;
+            Branches right = parse_unary(negate);
+            branches = negate ? either(std::move(branches), right) : both(branches, right);
+        }
+        return branches;
+    }
+
+    Branches parse_unary(bool negate) {
+        if (keyword("not")) {
+            advance();
+            return parse_unary(!negate);
+        }
+        if (token_.kind == Token::OPEN) {
+            size_t column = token_.column;
+            advance();
+            Branches branches = parse_or(negate);
+            if (token_.kind != Token::CLOSE) fail("'(' at column " + std::to_string(column) + " is not closed",
+                                                  token_.column);
+            advance();
+            return branches;
+        }
+        return parse_comparison(negate);
+    }
+
+    Branches parse_comparison(bool negate) {
+        if (token_.kind != Token::WORD) fail("expected a field, found " + shown(token_), token_.column);
+        std::string name = lowercase(token_.text);
+        size_t field_column = token_.column;
+        Field field = Field::Name;
+        if (name == "user" || name == "name") field = Field::Name;
+        else if (name == "desc" || name == "description") field = Field::Description;
+        else if (name == "date") field = Field::Date;
+        else if (name == "start") field = Field::Start;
+        else if (name == "end") field = Field::End;
+        else if (name == "duration" || name == "hours") field = Field::Hours;
+        else fail("unknown field '" + token_.text + "' (user, desc, date, start, end or duration)", field_column);
+        advance();
+
+        if (token_.kind != Token::OP) fail("expected an operator after " + name + ", found " + shown(token_),
+                                           token_.column);
+        const std::string& text = token_.text;
+        Op op = text == "=" || text == "==" ? Op::Equal
+              : text == "!=" ? Op::NotEqual
+              : text == "<" ? Op::Less
+              : text == "<=" ? Op::LessEqual
+              : text == ">" ? Op::Greater
+              : text == ">=" ? Op::GreaterEqual
+              : text == "~" ? Op::Contains : Op::Lacks;
+        bool text_field = field == Field::Name || field == Field::Description;
+        bool text_op = op == Op::Equal || op == Op::NotEqual || op == Op::Contains || op == Op::Lacks;
+        bool range_op = op != Op::Contains && op != Op::Lacks;
+        if (text_field ? !text_op : !range_op) {
+            fail(name + (text_field ? " takes = != ~ or !~" : " takes = != < <= > or >="), token_.column);
+        }
+        advance();
+
+        if (token_.kind != Token::WORD && token_.kind != Token::STRING) {
+            fail("expected a value after " + text + ", found " + shown(token_), token_.column);
+        }
+        std::string value = token_.text;
+        size_t value_column = token_.column;
+        advance();
+        if (negate) op = negated(op);
+
+        switch (field) {
+        case Field::Name:
+        case Field::Description: return text_test(field, op, value);
+        case Field::Date: {
+            int64_t first = 0;
+            int64_t last = 0;
+            if (!parse_days(value, first, last)) fail("invalid date '" + value + "' (YYYY-MM-DD, YYYY-MM or YYYY)",
+                                                      value_column);
+            return ranged(op, first, last, QueryBranch::FIRST_DAY, QueryBranch::LAST_DAY,
+                          [](QueryBranch& b) -> std::pair<int64_t&, int64_t&> { return {b.first_day, b.last_day}; });
+        }
+        case Field::Start:
+        case Field::End: {
+            int64_t first = 0;
+            int64_t last = 0;
+            if (!parse_seconds(value, first, last)) fail("invalid time '" + value + "' (HH:MM:SS or HH:MM)",
+                                                         value_column);
+            if (field == Field::Start) {
+                return ranged(op, first, last, int64_t{0}, QueryBranch::DAY_END,
+                              [](QueryBranch& b) -> std::pair<int64_t&, int64_t&> {
+                                  return {b.first_start, b.last_start};
+                              });
+            }
+            return ranged(op, first, last, int64_t{0}, QueryBranch::DAY_END,
+                          [](QueryBranch& b) -> std::pair<int64_t&, int64_t&> { return {b.first_end, b.last_end}; });
+        }
+        case Field::Hours: {
+            double hours = 0.0;
+            if (!parse_hours(value, hours)) fail("invalid duration '" + value + "' (hours, or minutes as 90m)",
+                                                 value_column);
+            return ranged(op, hours, hours, -INF, INF,
+                          [](QueryBranch& b) -> std::pair<double&, double&> { return {b.min_hours, b.max_hours}; });
+        }
+        }
+        return Branches();
+    }
+
+    // "YYYY-MM-DD", or every day of "YYYY-MM" or "YYYY"
+    static bool parse_days(const std::string& value, int64_t& first, int64_t& last) {
+        if (value.size() == 10) {
+            if (!iso_time::parse_day(value, first)) return false;
+            last = first;
+            return true;
+        }
+        if (value.size() == 7) {
+            iso_time::CivilDate month{};
+            if (!iso_time::parse_date(value + "-01", month)) return false;
+            first = iso_time::days_from_civil(month.year, month.month, 1);
+            last = month.month == 12 ? iso_time::days_from_civil(month.year + 1, 1, 1) - 1
+                                     : iso_time::days_from_civil(month.year, month.month + 1, 1) - 1;
+            return true;
+        }
+        if (value.size() == 4) {
+            iso_time::CivilDate year{};
+            if (!iso_time::parse_date(value + "-01-01", year)) return false;
+            first = iso_time::days_from_civil(year.year, 1, 1);
+            last = iso_time::days_from_civil(year.year, 12, 31);
+            return true;
+        }
+        return false;
+    }
+
+    // "HH:MM:SS", or every second of "HH:MM"
+    static bool parse_seconds(const std::string& value, int64_t& first, int64_t& last) {
+        if (value.size() == 8) {
+            if (!iso_time::parse_clock(value, first)) return false;
+            last = first;
+            return true;
+        }
+        if (value.size() == 5) {
+            if (!iso_time::parse_clock(value + ":00", first)) return false;
+            last = first + 59;
+            return true;
+        }
+        return false;
+    }
+
+    // Hours, with an optional h suffix, or minutes with an m suffix
+    static bool parse_hours(const std::string& value, double& hours) {
+        std::string_view number = value;
+        double scale = 1.0;
+        if (!number.empty() && (number.back() == 'h' || number.back() == 'm')) {
+            if (number.back() == 'm') scale = 1.0 / 60.0;
+            number.remove_suffix(1);
+        }
+        auto parsed = std::from_chars(number.data(), number.data() + number.size(), hours);
+        if (parsed.ec != std::errc() || parsed.ptr != number.data() + number.size() || !std::isfinite(hours)) {
+            return false;
+        }
+        hours *= scale;
+        return true;
+    }
+
+    // The ranges of field (first..last is the value) the comparison keeps,
+    // one branch each; != keeps the two sides
+    template <typename T, typename Bounds>
+    static Branches ranged(Op op, T first, T last, T min, T max, Bounds bounds) {
+        std::vector<std::pair<T, T>> ranges;
+        switch (op) {
+        case Op::Equal: ranges.emplace_back(first, last); break;
+        case Op::NotEqual:
+            ranges.emplace_back(min, before(first));
+            ranges.emplace_back(after(last), max);
+            break;
+        case Op::Less: ranges.emplace_back(min, before(first)); break;
+        case Op::LessEqual: ranges.emplace_back(min, last); break;
+        case Op::Greater: ranges.emplace_back(after(last), max); break;
+        case Op::GreaterEqual: ranges.emplace_back(first, max); break;
+        case Op::Contains:
+        case Op::Lacks: break;
+        }
+        Branches branches;
+        for (const auto& range : ranges) {
+            QueryBranch branch;
+            auto field = bounds(branch);
+            field.first = std::max(range.first, min);
+            field.second = std::min(range.second, max);
+            if (field.first <= field.second) branches.push_back(std::move(branch));
+        }
+        return branches;
+    }
+
+    static Branches text_test(Field field, Op op, const std::string& value) {
+        QueryBranch branch;
+        QueryText& test = field == Field::Name ? branch.name : branch.description;
+        switch (op) {
+        case Op::Equal:
+            test.exact = true;
+            test.equal = value;
+            break;
+        case Op::NotEqual: test.unequal.push_back(value); break;
+        case Op::Contains:
+            if (!value.empty()) test.contains.push_back(QueryNeedle{lowercase(value)});
+            break;
+        case Op::Lacks:
+            if (value.empty()) return Branches(); // every text holds ""
+            test.lacks.push_back(QueryNeedle{lowercase(value)});
+            break;
+        default: break;
+        }
+        return Branches{branch};
+    }
+
+    std::string_view text_;
+    size_t pos_ = 0;
+    Token token_;
+};
+
+// The fields of one row that a kernel tests
+struct Fields {
+    int64_t day = 0;
+    int64_t start = 0;
+    int64_t end = 0;
+    double hours = 0.0;
+    std::string_view name;
+    std::string_view description;
+};
+
+bool read_hours(const CsvRecord& record, double& hours) {
+    std::string_view duration = record.fields[CSV_DURATION];
+    return std::from_chars(duration.data(), duration.data() + duration.size(), hours).ec == std::errc();
+}
+
+// Reads only what shape S tests; false if one of those fields is malformed
+template <unsigned S>
+bool read_fields(const CsvRecord& record, Fields& fields) {
+    if constexpr ((S & QueryBranch::HOURS) != 0) {
+        if (!read_hours(record, fields.hours)) return false;
+    }
+    if constexpr ((S & QueryBranch::CLOCK) != 0) {
+        if (!iso_time::parse_clock(record.fields[CSV_START_TIME], fields.start) ||
+            !iso_time::parse_clock(record.fields[CSV_END_TIME], fields.end)) {
+            return false;
+        }
+    }
+    if constexpr ((S & QueryBranch::NAME) != 0) fields.name = record.fields[CSV_NAME];
+    if constexpr ((S & QueryBranch::DESCRIPTION) != 0) fields.description = record.description();
+    return true;
+}
+
+template <unsigned S>
+bool satisfies(const QueryBranch& branch, const Fields& fields) {
+    if (fields.day < branch.first_day || fields.day > branch.last_day) return false;
+    if constexpr ((S & QueryBranch::HOURS) != 0) {
+        if (!(fields.hours >= branch.min_hours && fields.hours <= branch.max_hours)) return false;
+    }
+    if constexpr ((S & QueryBranch::CLOCK) != 0) {
+        if (fields.start < branch.first_start || fields.start > branch.last_start ||
+            fields.end < branch.first_end || fields.end > branch.last_end) {
+            return false;
+        }
+    }
+    if constexpr ((S & QueryBranch::NAME) != 0) {
+        if (!branch.name.passes(fields.name)) return false;
+    }
+    if constexpr ((S & QueryBranch::DESCRIPTION) != 0) {
+        if (!branch.description.passes(fields.description)) return false;
+    }
+    return true;
+}
+
+// Totals every match and keeps where the last limit of them are
+struct Matches {
+    size_t limit = 0;
+    uint64_t sessions = 0;
+    double hours = 0.0;
+    std::vector<std::pair<uint64_t, uint32_t>> latest; // logical offset and length; a ring once full
+    size_t next = 0;                                   // oldest entry of the full ring
+
+    void add(uint64_t offset, size_t length, double row_hours) {
+        ++sessions;
+        hours += row_hours;
+        if (limit == 0) return;
+        std::pair<uint64_t, uint32_t> entry(offset, static_cast<uint32_t>(length));
+        if (latest.size() < limit) {
+            latest.push_back(entry);
+            return;
+        }
+        latest[next] = entry;
+        next = next + 1 == limit ? 0 : next + 1;
+    }
+};
+
+// One branch, reading and testing a field at a time, cheapest first, so
+// most rows are turned away before their duration is parsed
+template <unsigned S>
+bool single_matches(const QueryBranch& branch, const CsvRecord& record, Fields& fields) {
+    if constexpr ((S & QueryBranch::NAME) != 0) {
+        if (!branch.name.passes(record.fields[CSV_NAME])) return false;
+    }
+    if constexpr ((S & QueryBranch::CLOCK) != 0) {
+        if (!read_fields<QueryBranch::CLOCK>(record, fields) || fields.start < branch.first_start ||
+            fields.start > branch.last_start || fields.end < branch.first_end || fields.end > branch.last_end) {
+            return false;
+        }
+    }
+    if constexpr ((S & QueryBranch::HOURS) != 0) {
+        if (!read_hours(record, fields.hours) ||
+            !(fields.hours >= branch.min_hours && fields.hours <= branch.max_hours)) {
+            return false;
+        }
+    }
+    if constexpr ((S & QueryBranch::DESCRIPTION) != 0) {
+        if (!branch.description.passes(record.description())) return false;
+    }
+    return true;
+}
+
+// The scan loop for rows in text from begin, instantiated per shape: one
+// branch is tested inline, otherwise each in turn until one passes
+template <unsigned S, bool SINGLE>
+void scan(const std::vector<QueryBranch>& branches, int64_t first_day, int64_t last_day,
+          std::string_view text, size_t begin, uint64_t shift, Matches& matches) {
+    CsvTokenizer rows(text, begin);
+    CsvRecord record;
+    Fields fields;
+    while (rows.next(record)) {
+        if (record.fields.size() < CSV_COLUMNS) continue;
+        std::string_view date = record.fields[CSV_DATE];
+        if (date.size() != 10 || !iso_time::parse_day(date, fields.day)) continue;
+        if (fields.day < first_day || fields.day > last_day) continue;
+
+        bool hit = false;
+        if constexpr (SINGLE) {
+            hit = single_matches<S>(branches.front(), record, fields);
+        } else if (read_fields<S>(record, fields)) {
+            for (const auto& branch : branches) {
+                if ((hit = satisfies<S>(branch, fields))) break;
+            }
+        }
+        if (!hit) continue;
+        if constexpr ((S & QueryBranch::HOURS) == 0) {
+            if (!read_hours(record, fields.hours)) continue;
+        }
+        matches.add(record.begin + shift, record.line.size(), fields.hours);
+    }
+}
+
+using Kernel = void (*)(const std::vector<QueryBranch>&, int64_t, int64_t, std::string_view, size_t, uint64_t,
+                        Matches&);
+
+// Indexed by shape, plus SHAPES for the single-branch kernels
+template <size_t... I>
+constexpr std::array<Kernel, sizeof...(I)> make_kernels(std::index_sequence<I...>) {
+    return {{&scan<I % QueryBranch::SHAPES, (I >= QueryBranch::SHAPES)>...}};
+}
+
+constexpr auto KERNELS = make_kernels(std::make_index_sequence<2 * QueryBranch::SHAPES>());
+
+std::string shape_text(unsigned shape) {
+    std::string text = "date";
+    if (shape & QueryBranch::CLOCK) text += "+clock";
+    if (shape & QueryBranch::HOURS) text += "+duration";
+    if (shape & QueryBranch::NAME) text += "+user";
+    if (shape & QueryBranch::DESCRIPTION) text += "+desc";
+    return text;
+}
+
+void describe_text(const char* field, const QueryText& test, std::vector<std::string>& parts) {
+    auto quoted = [](const std::string& value) { return "\"" + value + "\""; };
+    if (test.exact) parts.push_back(std::string(field) + " = " + quoted(test.equal));
+    for (const auto& value : test.unequal) parts.push_back(std::string(field) + " != " + quoted(value));
+    for (const auto& needle : test.contains) parts.push_back(std::string(field) + " ~ " + quoted(needle.lowered));
+    for (const auto& needle : test.lacks) parts.push_back(std::string(field) + " !~ " + quoted(needle.lowered));
+}
+
+// Bounds of an integer range, as = or >= and <=
+template <typename Format>
+void describe_range(const char* field, int64_t first, int64_t last, int64_t min, int64_t max, Format format,
+                    std::vector<std::string>& parts) {
+    if (first == last) {
+        parts.push_back(std::string(field) + " = " + format(first));
+        return;
+    }
+    if (first != min) parts.push_back(std::string(field) + " >= " + format(first));
+    if (last != max) parts.push_back(std::string(field) + " <= " + format(last));
+}
+
+// Hours bounds, shown strict when that reads shorter: "> 2", not ">= 2.0000000000000004"
+void describe_hours(double min, double max, std::vector<std::string>& parts) {
+    if (min == max) {
+        parts.push_back("duration = " + number_text(min));
+        return;
+    }
+    if (min != -INF) {
+        std::string inclusive = number_text(min);
+        std::string strict = number_text(before(min));
+        parts.push_back(strict.size() < inclusive.size() ? "duration > " + strict : "duration >= " + inclusive);
+    }
+    if (max != INF) {
+        std::string inclusive = number_text(max);
+        std::string strict = number_text(after(max));
+        parts.push_back(strict.size() < inclusive.size() ? "duration < " + strict : "duration <= " + inclusive);
+    }
+}
+
+} // namespace
+
+bool QueryNeedle::found_in(std::string_view text) const {
+    size_t size = lowered.size();
+    if (size > text.size()) return false;
+    unsigned char first = static_cast<unsigned char>(lowered[0]);
+    const char* needle = lowered.data();
+    for (size_t i = 0, last = text.size() - size; i <= last; ++i) {
+        if (fold(text[i]) != first) continue;
+        size_t j = 1;
+        while (j < size && fold(text[i + j]) == static_cast<unsigned char>(needle[j])) ++j;
+        if (j == size) return true;
+    }
+    return false;
+}
+
+bool QueryText::passes(std::string_view text) const {
+    if (exact && text != equal) return false;
+    for (const auto& value : unequal) {
+        if (text == value) return false;
+    }
+    for (const auto& needle : contains) {
+        if (!needle.found_in(text)) return false;
+    }
+    for (const auto& needle : lacks) {
+        if (needle.found_in(text)) return false;
+    }
+    return true;
+}
+
+bool QueryText::merge(const QueryText& other) {
+    if (other.exact) {
+        if (exact && equal != other.equal) return false;
+        exact = true;
+        equal = other.equal;
+    }
+    unequal.insert(unequal.end(), other.unequal.begin(), other.unequal.end());
+    contains.insert(contains.end(), other.contains.begin(), other.contains.end());
+    lacks.insert(lacks.end(), other.lacks.begin(), other.lacks.end());
+    if (!exact) return true;
+
+    // A fixed value decides the other tests now
+    if (!passes(equal)) return false;
+    unequal.clear();
+    contains.clear();
+    lacks.clear();
+    return true;
+}
+
+unsigned QueryBranch::shape() const {
+    unsigned shape = 0;
+    if (first_start > 0 || last_start < DAY_END || first_end > 0 || last_end < DAY_END) shape |= CLOCK;
+    if (min_hours != -INF || max_hours != INF) shape |= HOURS;
+    if (name.active()) shape |= NAME;
+    if (description.active()) shape |= DESCRIPTION;
+    return shape;
+}
+
+bool QueryBranch::intersect(const QueryBranch& other) {
+    first_day = std::max(first_day, other.first_day);
+    last_day = std::min(last_day, other.last_day);
+    first_start = std::max(first_start, other.first_start);
+    last_start = std::min(last_start, other.last_start);
+    first_end = std::max(first_end, other.first_end);
+    last_end = std::min(last_end, other.last_end);
+    min_hours = std::max(min_hours, other.min_hours);
+    max_hours = std::min(max_hours, other.max_hours);
+    if (first_day > last_day || first_start > last_start || first_end > last_end || !(min_hours <= max_hours)) {
+        return false;
+    }
+    return name.merge(other.name) && description.merge(other.description);
+}
+
+LogQuery::LogQuery(std::string_view expression) {
+    if (expression.find_first_not_of(" \t\r\n") == std::string_view::npos) {
+        throw std::runtime_error("Empty query");
+    }
+    branches_ = Parser(expression).parse();
+    for (const auto& branch : branches_) {
+        first_day_ = std::min(first_day_, branch.first_day);
+        last_day_ = std::max(last_day_, branch.last_day);
+        shape_ |= branch.shape();
+    }
+}
+
+QueryResult LogQuery::run(const fs::path& csv_file, const fs::path& index_file, const fs::path& segment_dir,
+                          size_t limit) const {
+    QueryResult result;
+    if (branches_.empty()) return result;
+
+    Matches matches;
+    matches.limit = limit;
+    Kernel kernel = KERNELS[shape_ + (branches_.size() == 1 ? unsigned{QueryBranch::SHAPES} : 0u)];
+
+    // Sealed rows come first; only segments whose dates can match are read
+    SegmentStore segments(csv_file, segment_dir);
+    for (const Segment& segment : segments.overlapping(first_day_, last_day_)) {
+        kernel(branches_, first_day_, last_day_, segments.read(segment), 0, segment.offset, matches);
+    }
+
+    // Then the head's rows the date index has in range
+    std::vector<DayRange> ranges = LogIndex(csv_file, index_file).find(date_text(first_day_), date_text(last_day_));
+    MappedFile csv(csv_file);
+    std::string_view text = csv.view();
+    uint64_t head_start = segments.head_start(text);
+    uint64_t shift = segments.logical_offset(text, head_start) - head_start;
+    for (const auto& range : ranges) {
+        if (range.end > text.size()) continue; // log changed under us
+        if (range.end <= head_start) continue; // sealed; a compaction was interrupted
+        kernel(branches_, first_day_, last_day_, text.substr(0, range.end),
+               static_cast<size_t>(std::max(range.begin, head_start)), shift, matches);
+    }
+
+    result.sessions = matches.sessions;
+    result.hours = matches.hours;
+    for (size_t i = 0; i < matches.latest.size(); ++i) {
+        const auto& entry = matches.latest[(matches.next + i) % matches.latest.size()];
+        result.rows.push_back(segments.logical_bytes(text, entry.first, entry.second));
+    }
+    return result;
+}
+
+std::string LogQuery::explain() const {
+    std::ostringstream text;
+    if (branches_.empty()) {
+        text << "Plan: no row can match\n";
+        return text.str();
+    }
+    text << "Plan: " << branches_.size() << (branches_.size() == 1 ? " branch" : " branches") << ", days "
+         << date_text(first_day_) << " to " << date_text(last_day_) << ", kernel " << shape_text(shape_) << "\n";
+    for (size_t i = 0; i < branches_.size(); ++i) {
+        const QueryBranch& branch = branches_[i];
+        std::vector<std::string> parts;
+        describe_range("date", branch.first_day, branch.last_day, QueryBranch::FIRST_DAY, QueryBranch::LAST_DAY,
+                       date_text, parts);
+        describe_range("start", branch.first_start, branch.last_start, 0, QueryBranch::DAY_END, clock_text, parts);
+        describe_range("end", branch.first_end, branch.last_end, 0, QueryBranch::DAY_END, clock_text, parts);
+        describe_hours(branch.min_hours, branch.max_hours, parts);
+        describe_text("user", branch.name, parts);
+        describe_text("desc", branch.description, parts);
+        text << "  " << i + 1 << ": ";
+        if (parts.empty()) text << "every row";
+        for (size_t p = 0; p < parts.size(); ++p) text << (p ? " AND " : "") << parts[p];
+        text << "\n";
+    }
+    return text.str();
+}
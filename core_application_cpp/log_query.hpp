@@ -0,0 +1,118 @@
+/*
+ * Time Tracker - query expressions over the log
+ *
+ * `query` selects sessions with an expression such as
+ *
+ *   user=alice AND date>=2025-10-01 AND duration>2 AND desc~review
+ *
+ * Comparisons are FIELD OP VALUE, joined by AND (or just a space), OR and
+ * NOT, with parentheses for grouping. Keywords and field names are case
+ * insensitive.
+ *
+ *   user, name         = != ~ !~         who logged the session
+ *   desc, description  = != ~ !~         its description
+ *   date               = != < <= > >=    YYYY-MM-DD, or YYYY-MM / YYYY for a
+ *                                        whole month / year
+ *   start, end         = != < <= > >=    HH:MM:SS, or HH:MM for a whole minute
+ *   duration, hours    = != < <= > >=    hours, or minutes with an m suffix
+ *
+ * = compares text exactly; ~ finds a substring, ignoring ASCII case.
+ * Values holding spaces, parentheses or operators go in double quotes.
+ *
+ * An expression is compiled once: NOT is pushed down to the comparisons,
+ * the result is expanded into an OR of AND-branches, and every branch is
+ * lowered to constant ranges (days, hours, clock seconds) and text tests.
+ * Contradictory branches are dropped and tests that a fixed value already
+ * decides are folded away. The scan runs a kernel instantiated for the
+ * fields the branches test, so a row costs a few compares and no dispatch,
+ * and only the days a branch can match are read: the date index and the
+ * segments' date ranges skip the rest of the log.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// A substring to find regardless of ASCII case
+struct QueryNeedle {
+    std::string lowered;
+
+    bool found_in(std::string_view text) const;
+};
+
+// The tests one text column must pass in a branch
+struct QueryText {
+    bool exact = false;
+    std::string equal;                // the whole value, when exact
+    std::vector<std::string> unequal; // values it must not be
+    std::vector<QueryNeedle> contains;
+    std::vector<QueryNeedle> lacks;
+
+    bool active() const { return exact || !unequal.empty() || !contains.empty() || !lacks.empty(); }
+    bool passes(std::string_view text) const;
+    // Adds other's tests; false if the two cannot both pass
+    bool merge(const QueryText& other);
+};
+
+// One AND-branch: inclusive ranges and text tests, all of which a row must pass
+struct QueryBranch {
+    static constexpr int64_t FIRST_DAY = -719162; // 0001-01-01
+    static constexpr int64_t LAST_DAY = 2932896;  // 9999-12-31
+    static constexpr int64_t DAY_END = 86400;     // 23:59:60, a leap second
+
+    int64_t first_day = FIRST_DAY;
+    int64_t last_day = LAST_DAY;
+    int64_t first_start = 0; // seconds since midnight
+    int64_t last_start = DAY_END;
+    int64_t first_end = 0;
+    int64_t last_end = DAY_END;
+    double min_hours = -std::numeric_limits<double>::infinity();
+    double max_hours = std::numeric_limits<double>::infinity();
+    QueryText name;
+    QueryText description;
+
+    // Which kernel it needs: a bit per field beyond the date
+    enum Shape : unsigned { CLOCK = 1, HOURS = 2, NAME = 4, DESCRIPTION = 8, SHAPES = 16 };
+    unsigned shape() const;
+    // Narrows this branch to rows other also matches; false if none can
+    bool intersect(const QueryBranch& other);
+};
+
+struct QueryResult {
+    uint64_t sessions = 0;
+    double hours = 0.0;
+    std::vector<std::string> rows; // the most recent matches, oldest first
+};
+
+class LogQuery {
+public:
+    static constexpr size_t MAX_BRANCHES = 256;
+
+    // Compiles expression. Throws std::runtime_error, naming the column,
+    // if it does not parse or expands to more than MAX_BRANCHES branches.
+    explicit LogQuery(std::string_view expression);
+
+    // Sessions in the log that match, sealed segments included. At most
+    // limit rows are returned, but sessions and hours count every match.
+    QueryResult run(const fs::path& csv_file, const fs::path& index_file, const fs::path& segment_dir,
+                    size_t limit) const;
+
+    // The compiled branches and the days read, one line each
+    std::string explain() const;
+
+    const std::vector<QueryBranch>& branches() const { return branches_; }
+
+private:
+    std::vector<QueryBranch> branches_; // none if nothing can match
+    int64_t first_day_ = QueryBranch::LAST_DAY; // days any branch can match
+    int64_t last_day_ = QueryBranch::FIRST_DAY;
+    unsigned shape_ = 0; // every branch's fields
+};
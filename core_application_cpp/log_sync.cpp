@@ -0,0 +1,302 @@
+#include "log_sync.hpp"
+
+#include "csv_tokenizer.hpp"
+#include "durable_log.hpp"
+#include "log_index.hpp"
+#include "mapped_file.hpp"
+#include "segment_store.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <fstream>
+#include <sstream>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#ifdef TIME_TRACKER_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+constexpr char DEFLATED = 'D';
+constexpr char RAW = 'R';
+constexpr char ESCAPE = '\x01';
+
+// Largest batch a deflated one may claim to inflate to: the most the
+// channel carries in one message, so a raw batch could be no larger
+constexpr uint64_t MAX_RAW_BYTES = 64u << 20;
+
+// The head CSV mapped in, with the segments sealed before it
+struct LogView {
+    MappedFile csv;
+    std::string_view head;
+    SegmentStore segments;
+    uint64_t end = 0; // logical size
+
+    LogView(const fs::path& csv_file, const fs::path& segment_dir) : segments(csv_file, segment_dir) {
+        if (!csv.open(csv_file)) return;
+        head = csv.view();
+        end = segments.logical_offset(head, head.size());
+    }
+
+    uint32_t tail_crc(uint64_t offset) const {
+        uint64_t length = std::min<uint64_t>(offset, LogSync::TAIL_BYTES);
+        std::string tail = segments.logical_bytes(head, offset - length, length);
+        return crc32(tail.data(), tail.size());
+    }
+};
+
+// Identifies a session however its row was quoted or its duration rounded
+uint64_t session_key(const LogRow& row) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (std::string_view field : {row.name, row.date, row.start_time, row.end_time, row.description}) {
+        for (char c : field) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ULL;
+        }
+        hash ^= 0x1f; // unit separator, so fields cannot run into each other
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+void add_keys(std::string_view text, size_t begin, std::unordered_set<uint64_t>& keys) {
+    CsvTokenizer rows(text, begin);
+    CsvRecord record;
+    LogRow row;
+    while (rows.next(record)) {
+        if (parse_log_row(record, row)) keys.insert(session_key(row));
+    }
+}
+
+} // namespace
+
+LogSync::LogSync(fs::path csv_file, fs::path journal_file, fs::path index_file, fs::path segment_dir)
+    : csv_file_(std::move(csv_file)), journal_file_(std::move(journal_file)),
+      index_file_(std::move(index_file)), segment_dir_(std::move(segment_dir)) {}
+
+SyncCursor LogSync::end() const {
+    LogView log(csv_file_, segment_dir_);
+    return SyncCursor{log.end, log.tail_crc(log.end)};
+}
+
+bool LogSync::matches(const SyncCursor& cursor) const {
+    LogView log(csv_file_, segment_dir_);
+    return cursor.offset <= log.end && log.tail_crc(cursor.offset) == cursor.tail_crc;
+}
+
+SyncBatch LogSync::read(uint64_t from, uint64_t until) const {
+    LogView log(csv_file_, segment_dir_);
+    SyncBatch batch;
+    batch.end = log.end;
+    from = std::max<uint64_t>(from, csv_next_record(log.head, 0, false));
+    uint64_t stop = until > from ? std::min(until, log.end) : log.end;
+    for (uint64_t length = BATCH_BYTES; from < stop; length *= 2) {
+        std::string bytes = log.segments.logical_bytes(log.head, from, std::min(length, stop - from));
+        size_t whole = 0;
+        {
+            CsvTokenizer rows(bytes);
+            CsvRecord record;
+            while (rows.next(record) && record.terminated) whole = record.end;
+        }
+        // A batch holding no whole row is read again longer, up to the stop
+        if (whole > 0 || from + bytes.size() >= stop) {
+            bytes.resize(whole);
+            batch.rows = std::move(bytes);
+            break;
+        }
+    }
+    batch.next.offset = std::min(from, log.end) + batch.rows.size();
+    batch.next.tail_crc = log.tail_crc(batch.next.offset);
+    return batch;
+}
+
+SyncApplied LogSync::apply(std::string_view rows) const {
+    struct Incoming {
+        std::string_view line;
+        uint64_t key;
+    };
+    std::vector<Incoming> incoming;
+    SyncApplied applied;
+    std::string first_date, last_date;
+    int64_t first_day = 0, last_day = 0;
+    {
+        CsvTokenizer tokens(rows);
+        CsvRecord record;
+        LogRow row;
+        while (tokens.next(record)) {
+            if (!parse_log_row(record, row) || row.date.size() != 10) {
+                ++applied.skipped;
+                continue;
+            }
+            if (incoming.empty() || row.date < first_date) {
+                first_date.assign(row.date);
+                first_day = row.day;
+            }
+            if (incoming.empty() || row.date > last_date) {
+                last_date.assign(row.date);
+                last_day = row.day;
+            }
+            incoming.push_back(Incoming{record.line, session_key(row)});
+        }
+    }
+
+    DurableAppender csv(csv_file_, journal_file_);
+    applied.head_offset = csv.append_bulk([&](const DurableAppender::BulkWriter& write) {
+        // The sessions already logged on the batch's days
+        LogView log(csv_file_, segment_dir_);
+        std::unordered_set<uint64_t> known;
+        if (!incoming.empty()) {
+            for (const Segment& segment : log.segments.overlapping(first_day, last_day)) {
+                add_keys(log.segments.read(segment), 0, known);
+            }
+            uint64_t head_start = log.segments.head_start(log.head);
+            for (const auto& range : LogIndex(csv_file_, index_file_).find(first_date, last_date)) {
+                if (range.end > log.head.size() || range.end <= head_start) continue;
+                add_keys(log.head.substr(0, range.end), static_cast<size_t>(std::max(range.begin, head_start)),
+                         known);
+            }
+        }
+
+        std::string block;
+        for (const auto& row : incoming) {
+            if (!known.insert(row.key).second) {
+                ++applied.duplicates;
+                continue;
+            }
+            block.append(row.line);
+            block += '\n';
+            ++applied.rows;
+        }
+
+        // Where the rows land: the appender puts a newline after a partial last line
+        applied.before = SyncCursor{log.end, log.tail_crc(log.end)};
+        uint64_t length = std::min<uint64_t>(log.end, TAIL_BYTES);
+        std::string tail = log.segments.logical_bytes(log.head, log.end - length, length);
+        if (!block.empty() && !log.head.empty() && log.head.back() != '\n') tail += '\n';
+        tail += block;
+        applied.after.offset = log.end - length + tail.size();
+        std::string_view last(tail);
+        last.remove_prefix(last.size() - std::min(last.size(), TAIL_BYTES));
+        applied.after.tail_crc = crc32(last.data(), last.size());
+        write(block);
+    });
+    return applied;
+}
+
+SyncPeers::SyncPeers(fs::path file) : file_(std::move(file)) {}
+
+std::map<std::string, SyncPeer> SyncPeers::load() const {
+    std::map<std::string, SyncPeer> peers;
+    std::ifstream in(file_, std::ios::binary);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string address;
+        SyncPeer peer;
+        if (std::getline(fields, address, '\t') && fields >> peer.pulled.offset >> peer.pulled.tail_crc >>
+                                                       peer.pushed.offset >> peer.pushed.tail_crc) {
+            peers[address] = peer;
+        }
+    }
+    return peers;
+}
+
+SyncPeer SyncPeers::find(const std::string& address) const {
+    std::map<std::string, SyncPeer> peers = load();
+    auto found = peers.find(address);
+    return found == peers.end() ? SyncPeer{} : found->second;
+}
+
+void SyncPeers::store(const std::string& address, const SyncPeer& peer) {
+    std::map<std::string, SyncPeer> peers = load();
+    peers[address] = peer;
+    std::ostringstream text;
+    for (const auto& entry : peers) {
+        const SyncPeer& p = entry.second;
+        text << entry.first << '\t' << p.pulled.offset << '\t' << p.pulled.tail_crc << '\t'
+             << p.pushed.offset << '\t' << p.pushed.tail_crc << '\n';
+    }
+    write_file_atomic(file_, text.str());
+}
+
+std::string encode_sync_batch(std::string_view rows, bool compress) {
+    std::string packed(1, RAW);
+#ifdef TIME_TRACKER_ZLIB
+    if (compress && !rows.empty() && rows.size() <= UINT_MAX) {
+        uLongf length = compressBound(static_cast<uLong>(rows.size()));
+        std::string deflated(9 + length, '\0');
+        deflated[0] = DEFLATED;
+        uint64_t raw_length = rows.size();
+        for (int i = 0; i < 8; ++i) deflated[1 + i] = static_cast<char>(raw_length >> (8 * i));
+        if (compress2(reinterpret_cast<Bytef*>(&deflated[9]), &length,
+                      reinterpret_cast<const Bytef*>(rows.data()), static_cast<uLong>(rows.size()),
+                      Z_DEFAULT_COMPRESSION) == Z_OK && length < rows.size()) {
+            deflated.resize(9 + length);
+            packed = std::move(deflated);
+        }
+    }
+#else
+    (void)compress;
+#endif
+    if (packed[0] == RAW) packed.append(rows);
+
+    // NUL -> ESCAPE 1, ESCAPE -> ESCAPE 2
+    std::string escaped;
+    escaped.reserve(packed.size() + packed.size() / 64);
+    for (char c : packed) {
+        if (c == '\0' || c == ESCAPE) {
+            escaped += ESCAPE;
+            escaped += c == '\0' ? '\x01' : '\x02';
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+bool decode_sync_batch(std::string_view escaped, std::string& rows) {
+    std::string packed;
+    packed.reserve(escaped.size());
+    for (size_t i = 0; i < escaped.size(); ++i) {
+        if (escaped[i] != ESCAPE) {
+            packed += escaped[i];
+            continue;
+        }
+        if (++i == escaped.size() || (escaped[i] != '\x01' && escaped[i] != '\x02')) return false;
+        packed += escaped[i] == '\x01' ? '\0' : ESCAPE;
+    }
+
+    if (packed.empty()) return false;
+    if (packed[0] == RAW) {
+        rows = packed.substr(1);
+        return true;
+    }
+    if (packed[0] != DEFLATED || packed.size() < 9) return false;
+#ifdef TIME_TRACKER_ZLIB
+    uint64_t raw_length = 0;
+    for (int i = 0; i < 8; ++i) raw_length |= uint64_t{static_cast<unsigned char>(packed[1 + i])} << (8 * i);
+    if (raw_length > MAX_RAW_BYTES || packed.size() - 9 > UINT_MAX) return false;
+    rows.assign(static_cast<size_t>(raw_length), '\0');
+    uLongf length = static_cast<uLongf>(raw_length);
+    return uncompress(reinterpret_cast<Bytef*>(rows.data()), &length,
+                      reinterpret_cast<const Bytef*>(packed.data() + 9), static_cast<uLong>(packed.size() - 9)) == Z_OK &&
+           length == raw_length;
+#else
+    return false;
+#endif
+}
+
+bool sync_batch_deflated(std::string_view packed) {
+    return !packed.empty() && packed[0] == DEFLATED;
+}
+
+bool sync_compression() {
+#ifdef TIME_TRACKER_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,126 @@
+/*
+ * Time Tracker - delta sync of the log between machines
+ *
+ * `sync HOST:PORT` merges this machine's time_logs.csv with the one a
+ * `sync-server` serves, so a session tracked on either ends up in both
+ * logs once. The client keeps two watermarks per server in sync.tsv:
+ *
+ *   pulled   how far it has read the server's log
+ *   pushed   how far it has sent its own
+ *
+ * Both are logical offsets (see segment_store.hpp), so a compaction on
+ * either side does not move them, and each carries the crc32 of the
+ * TAIL_BYTES before it. Only rows past a watermark travel; a watermark
+ * whose tail no longer matches means that log was rewritten, and the
+ * sync starts over from its first row.
+ *
+ * A log takes only sessions it does not hold yet: rows are compared by a
+ * hash of name, date, start, end and description against the log's rows
+ * on the days a batch covers, found through the date index and the
+ * segments' date ranges, so a small batch reads only a few days. Rows are
+ * not echoed back either: the client pushes first, and where the server
+ * appended what it took, the pull that follows skips over; the rows it
+ * then pulls land at the end of its own log, past its push watermark.
+ *
+ * Batches of whole rows are deflated when built with zlib and NUL-escaped,
+ * as the control channel ends each argument with a NUL:
+ *
+ *   'D' u64 raw length, deflate stream   or   'R' rows as they are
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <string_view>
+
+namespace fs = std::filesystem;
+
+// A logical offset into a log and the crc32 of the bytes just before it
+struct SyncCursor {
+    uint64_t offset = 0;
+    uint32_t tail_crc = 0;
+};
+
+struct SyncPeer {
+    SyncCursor pulled; // into the server's log
+    SyncCursor pushed; // into this log
+};
+
+// Whole rows read from a log
+struct SyncBatch {
+    std::string rows;
+    SyncCursor next; // just past the last row
+    uint64_t end = 0; // the log's logical size
+};
+
+struct SyncApplied {
+    uint64_t rows = 0;       // appended
+    uint64_t duplicates = 0; // already in the log
+    uint64_t skipped = 0;    // not valid rows
+    SyncCursor before;       // the log's end when the batch arrived
+    SyncCursor after;        // and once it was appended
+    uint64_t head_offset = 0; // CSV offset of the first appended row
+};
+
+class LogSync {
+public:
+    static constexpr size_t TAIL_BYTES = 64;
+    static constexpr size_t BATCH_BYTES = 4 << 20;
+
+    LogSync(fs::path csv_file, fs::path journal_file, fs::path index_file, fs::path segment_dir);
+
+    // The end of the log
+    SyncCursor end() const;
+
+    // True if the log reaches cursor and still holds the bytes it was taken after
+    bool matches(const SyncCursor& cursor) const;
+
+    // The whole rows from logical offset from (past the header), about
+    // BATCH_BYTES of them; more if a single row is longer. They stop at
+    // until (a row boundary) if it lies past from. A row still being
+    // written at the end of the log is left for the next read.
+    SyncBatch read(uint64_t from, uint64_t until = 0) const;
+
+    // Appends the rows of batch the log does not hold, in one durable
+    // append with writes from every process held off meanwhile
+    SyncApplied apply(std::string_view rows) const;
+
+private:
+    fs::path csv_file_;
+    fs::path journal_file_;
+    fs::path index_file_;
+    fs::path segment_dir_;
+};
+
+// sync.tsv: "address<TAB>pulled<TAB>crc<TAB>pushed<TAB>crc" per server
+class SyncPeers {
+public:
+    explicit SyncPeers(fs::path file);
+
+    // The watermarks for address; zero for a server never synced with
+    SyncPeer find(const std::string& address) const;
+
+    void store(const std::string& address, const SyncPeer& peer);
+
+private:
+    std::map<std::string, SyncPeer> load() const;
+
+    fs::path file_;
+};
+
+// Rows in the wire format above, deflated if compress and built with zlib
+std::string encode_sync_batch(std::string_view rows, bool compress);
+
+// False if packed is damaged, inflates to more than a message can carry,
+// or is deflated and this build has no zlib
+bool decode_sync_batch(std::string_view packed, std::string& rows);
+
+// True if packed holds a deflated batch
+bool sync_batch_deflated(std::string_view packed);
+
+// Whether this build can deflate batches
+bool sync_compression();
@@ -0,0 +1,44 @@
+/*
+ * Time Tracker - read-only memory-mapped file
+ * Maps a whole file into memory so the log can be scanned without copying
+ * it through std::ifstream buffers.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+namespace fs = std::filesystem;
+
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const fs::path& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // Maps the file, replacing any previous mapping.
+    // Returns false if the file is missing; an empty file maps to an empty view.
+    bool open(const fs::path& path);
+    void close();
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    std::string_view view() const { return std::string_view(data_, size_); }
+    bool is_open() const { return opened_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool opened_ = false;
+#ifdef _WIN32
+    void* file_handle_ = nullptr;
+    void* mapping_handle_ = nullptr;
+#endif
+};
@@ -0,0 +1,158 @@
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace metrics {
+
+namespace {
+
+// Four buckets per power of two: values below 4 have one each, then
+// [2^m, 2^(m+1)) is split on the two bits after the leading one
+size_t bucket_of(uint64_t ns) {
+    if (ns < 4) return static_cast<size_t>(ns);
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanReverse64(&index, ns);
+    unsigned msb = static_cast<unsigned>(index);
+#else
+    unsigned msb = 63 - static_cast<unsigned>(__builtin_clzll(ns));
+#endif
+    return 4 * (msb - 1) + ((ns >> (msb - 2)) & 3);
+}
+
+uint64_t bucket_upper(size_t bucket) {
+    if (bucket < 4) return bucket;
+    unsigned msb = static_cast<unsigned>(bucket / 4 + 1);
+    uint64_t lower = (4 + bucket % 4) << (msb - 2);
+    return lower + ((uint64_t(1) << (msb - 2)) - 1);
+}
+
+// Written only by its own thread; read by snapshot() from any thread
+struct Buffer {
+    struct Timing {
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> total_ns;
+        std::atomic<uint64_t> max_ns;
+        std::atomic<uint64_t> buckets[BUCKETS];
+    };
+    std::atomic<uint64_t> counters[COUNTER_COUNT];
+    Timing timers[TIMER_COUNT];
+
+    Buffer();
+    ~Buffer();
+};
+
+void bump(std::atomic<uint64_t>& value, uint64_t n) {
+    value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+void add_to(Snapshot& total, const Buffer& buffer) {
+    for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+        total.counters[i] += buffer.counters[i].load(std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < TIMER_COUNT; ++i) {
+        const Buffer::Timing& from = buffer.timers[i];
+        Histogram& to = total.timers[i];
+        to.count += from.count.load(std::memory_order_relaxed);
+        to.total_ns += from.total_ns.load(std::memory_order_relaxed);
+        to.max_ns = std::max(to.max_ns, from.max_ns.load(std::memory_order_relaxed));
+        for (size_t b = 0; b < BUCKETS; ++b) to.buckets[b] += from.buckets[b].load(std::memory_order_relaxed);
+    }
+}
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<const Buffer*> live;
+    Snapshot retired; // of threads that have exited
+};
+
+const auto process_start = std::chrono::steady_clock::now();
+
+// Never destroyed: threads may still exit while statics are torn down
+Registry& registry() {
+    static Registry* instance = new Registry;
+    return *instance;
+}
+
+// Zero-initialized like any thread_local before the constructor runs
+Buffer::Buffer() {
+    Registry& all = registry();
+    std::lock_guard<std::mutex> lock(all.mutex);
+    all.live.push_back(this);
+}
+
+Buffer::~Buffer() {
+    Registry& all = registry();
+    std::lock_guard<std::mutex> lock(all.mutex);
+    add_to(all.retired, *this);
+    all.live.erase(std::find(all.live.begin(), all.live.end(), this));
+}
+
+Buffer& local() {
+    thread_local Buffer buffer;
+    return buffer;
+}
+
+} // namespace
+
+uint64_t Histogram::percentile(double fraction) const {
+    if (count == 0) return 0;
+    // Nearest rank: the smallest sample with at least fraction of them at or below it
+    uint64_t rank = static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(count)));
+    rank = std::max<uint64_t>(rank, 1);
+    uint64_t seen = 0;
+    for (size_t b = 0; b < BUCKETS; ++b) {
+        seen += buckets[b];
+        if (seen >= rank) return std::min(bucket_upper(b), max_ns);
+    }
+    return max_ns;
+}
+
+void add(Counter counter, uint64_t n) {
+    bump(local().counters[counter], n);
+}
+
+void record(Timer timer, uint64_t ns) {
+    Buffer::Timing& timing = local().timers[timer];
+    bump(timing.count, 1);
+    bump(timing.total_ns, ns);
+    if (ns > timing.max_ns.load(std::memory_order_relaxed)) timing.max_ns.store(ns, std::memory_order_relaxed);
+    bump(timing.buckets[bucket_of(ns)], 1);
+}
+
+Snapshot snapshot() {
+    Registry& all = registry();
+    std::lock_guard<std::mutex> lock(all.mutex);
+    Snapshot total = all.retired;
+    for (const Buffer* buffer : all.live) add_to(total, *buffer);
+    return total;
+}
+
+double uptime_seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - process_start).count();
+}
+
+const char* name(Counter counter) {
+    static const char* const names[COUNTER_COUNT] = {
+        "bytes_read", "rows_parsed", "segment_bytes", "rollup_hits", "rollup_misses",
+        "search_hits", "search_misses", "notifications", "notifications_dropped",
+        "lock_waits", "slot_retries"};
+    return names[counter];
+}
+
+const char* name(Timer timer) {
+    static const char* const names[TIMER_COUNT] = {
+        "tokenize", "parse_row", "segment_read", "command", "report", "search",
+        "query", "notification", "notification_delivery", "lock_wait"};
+    return names[timer];
+}
+
+} // namespace metrics
@@ -0,0 +1,208 @@
+#include "notifier.hpp"
+#include "dbus_wire.hpp"
+#include "metrics.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <shellapi.h>
+#else
+#include <cerrno>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+namespace {
+
+void print_fallback(const std::string& title, const std::string& message) {
+    std::cout << "NOTIFICATION: " << title << " - " << message << std::endl;
+}
+
+#ifndef _WIN32
+// notify-send started directly, without a shell. Returns false if it could not run.
+bool spawn_notify_send(const std::string& title, const std::string& message) {
+    const char* argv[] = {"notify-send", "-i", "time-admin", "-u", "normal", "-t", "5000",
+                          title.c_str(), message.c_str(), nullptr};
+    pid_t pid;
+    if (posix_spawnp(&pid, "notify-send", nullptr, nullptr,
+                     const_cast<char* const*>(argv), environ) != 0) {
+        return false;
+    }
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+#endif
+
+} // namespace
+
+Notifier& Notifier::instance() {
+    static Notifier notifier;
+    return notifier;
+}
+
+Notifier::~Notifier() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (worker_.joinable()) worker_.join();
+#ifdef _WIN32
+    if (icon_added_) {
+        NOTIFYICONDATAW icon{};
+        icon.cbSize = sizeof(icon);
+        icon.hWnd = static_cast<HWND>(window_);
+        icon.uID = 1;
+        Shell_NotifyIconW(NIM_DELETE, &icon);
+    }
+    if (window_) DestroyWindow(static_cast<HWND>(window_));
+#else
+    if (bus_fd_ >= 0) close(bus_fd_);
+#endif
+}
+
+bool Notifier::post(const std::string& title, const std::string& message) {
+    bool dropped = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!worker_.joinable()) worker_ = std::thread(&Notifier::run, this);
+        if (queue_.size() >= QUEUE_CAPACITY) {
+            queue_.pop_front();
+            dropped = true;
+        }
+        queue_.push_back(Message{title, message, std::chrono::steady_clock::now()});
+    }
+    METRIC_ADD(NOTIFICATIONS, 1);
+    if (dropped) METRIC_ADD(NOTIFICATIONS_DROPPED, 1);
+    wake_.notify_one();
+    return !dropped;
+}
+
+void Notifier::flush(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!worker_.joinable()) return;
+    idle_.wait_for(lock, timeout, [this] { return queue_.empty() && !busy_; });
+}
+
+void Notifier::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        wake_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) return; // stopping with nothing left to send
+
+        Message message = std::move(queue_.front());
+        queue_.pop_front();
+        busy_ = true;
+        lock.unlock();
+        {
+            METRIC_TIMER(NOTIFICATION_DELIVERY);
+            deliver(message);
+        }
+        METRIC_RECORD(NOTIFICATION, metrics::elapsed_ns(message.queued));
+        lock.lock();
+        busy_ = false;
+        if (queue_.empty()) idle_.notify_all();
+    }
+}
+
+#ifdef _WIN32
+
+void Notifier::deliver(const Message& message) {
+    auto wide = [](const std::string& text) {
+        int size = MultiByteToWideChar(CP_UTF8, 0, text.c_str(), -1, NULL, 0);
+        std::wstring result(size > 0 ? size : 1, L'\0');
+        MultiByteToWideChar(CP_UTF8, 0, text.c_str(), -1, result.data(), size);
+        return result;
+    };
+
+    if (!window_) {
+        // Message-only window owning the tray icon; created on this thread
+        WNDCLASSW window_class{};
+        window_class.lpfnWndProc = DefWindowProcW;
+        window_class.hInstance = GetModuleHandleW(NULL);
+        window_class.lpszClassName = L"TimeTrackerNotifier";
+        RegisterClassW(&window_class);
+        window_ = CreateWindowExW(0, window_class.lpszClassName, L"", 0, 0, 0, 0, 0,
+                                  HWND_MESSAGE, NULL, window_class.hInstance, NULL);
+    }
+
+    NOTIFYICONDATAW icon{};
+    icon.cbSize = sizeof(icon);
+    icon.hWnd = static_cast<HWND>(window_);
+    icon.uID = 1;
+    icon.uFlags = NIF_ICON | NIF_TIP | NIF_INFO;
+    icon.hIcon = LoadIcon(NULL, IDI_INFORMATION);
+    icon.dwInfoFlags = NIIF_INFO;
+    wcsncpy_s(icon.szTip, L"Time Tracker", _TRUNCATE);
+    wcsncpy_s(icon.szInfoTitle, wide(message.title).c_str(), _TRUNCATE);
+    wcsncpy_s(icon.szInfo, wide(message.body).c_str(), _TRUNCATE);
+
+    bool shown = window_ && Shell_NotifyIconW(icon_added_ ? NIM_MODIFY : NIM_ADD, &icon);
+    if (shown) {
+        icon_added_ = true;
+    } else {
+        print_fallback(message.title, message.body);
+    }
+}
+
+#else
+
+bool Notifier::connect_bus() {
+    if (bus_fd_ >= 0) return true;
+    if (bus_failed_) return false;
+    bus_fd_ = dbus::connect(dbus::Bus::Session);
+    bus_serial_ = 1; // Hello
+    if (bus_fd_ < 0) {
+        bus_failed_ = true;
+        return false;
+    }
+    return true;
+}
+
+bool Notifier::notify_bus(const Message& message) {
+    // Notify(app_name, replaces_id, app_icon, summary, body, actions, hints, expire_timeout)
+    dbus::Writer body;
+    body.str("Time Tracker");
+    body.u32(0);
+    body.str("time-admin");
+    body.str(message.title);
+    body.str(message.body);
+    body.u32(0);   // actions: empty array of strings
+    body.u32(0);   // hints: empty a{sv} ...
+    body.align(8); // ... padded to its dict-entry alignment
+    body.u32(5000);
+
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (!connect_bus()) return false;
+        std::string call = dbus::method_call(++bus_serial_, dbus::NO_REPLY_EXPECTED,
+                                             "org.freedesktop.Notifications",
+                                             "/org/freedesktop/Notifications",
+                                             "org.freedesktop.Notifications", "Notify",
+                                             "susssasa{sv}i", body.data);
+        if (dbus::send_all(bus_fd_, call)) {
+            // Discard whatever the bus sent us (Hello reply, NameAcquired)
+            char discard[4096];
+            while (recv(bus_fd_, discard, sizeof(discard), MSG_DONTWAIT) > 0) {}
+            return true;
+        }
+        close(bus_fd_); // bus restarted: reconnect once
+        bus_fd_ = -1;
+    }
+    return false;
+}
+
+void Notifier::deliver(const Message& message) {
+    if (notify_bus(message)) return;
+    if (spawn_notify_send(message.title, message.body)) return;
+    print_fallback(message.title, message.body);
+}
+
+#endif
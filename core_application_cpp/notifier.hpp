@@ -0,0 +1,74 @@
+/*
+ * Time Tracker - asynchronous desktop notifications
+ *
+ * post() only queues the notification; a worker thread delivers it, so
+ * tracking commands never wait for a popup. Delivery is in-process:
+ *
+ *   Linux    org.freedesktop.Notifications.Notify sent directly over the
+ *            D-Bus session bus socket (no libdbus/libnotify needed). If no
+ *            bus is reachable, notify-send is spawned without a shell.
+ *   Windows  a tray balloon via Shell_NotifyIcon, shown as a toast on
+ *            Windows 10 and later.
+ *
+ * If neither works the notification is printed to stdout, as before.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class Notifier {
+public:
+    // Queued notifications beyond this are dropped, oldest first
+    static constexpr size_t QUEUE_CAPACITY = 32;
+
+    static Notifier& instance();
+
+    // Queues a notification and returns immediately.
+    // Returns false if the queue was full and the oldest entry was dropped.
+    bool post(const std::string& title, const std::string& message);
+
+    // Waits up to timeout for queued notifications to be handed off.
+    // Short-lived commands call this before exiting.
+    void flush(std::chrono::milliseconds timeout);
+
+    ~Notifier();
+    Notifier(const Notifier&) = delete;
+    Notifier& operator=(const Notifier&) = delete;
+
+private:
+    struct Message {
+        std::string title;
+        std::string body;
+        std::chrono::steady_clock::time_point queued;
+    };
+
+    Notifier() = default;
+    void run();
+    void deliver(const Message& message);
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::deque<Message> queue_;
+    bool busy_ = false;
+    bool stopping_ = false;
+    std::thread worker_;
+
+#ifdef _WIN32
+    void* window_ = nullptr;
+    bool icon_added_ = false;
+#else
+    int bus_fd_ = -1;
+    unsigned bus_serial_ = 0;
+    bool bus_failed_ = false;
+    bool connect_bus();
+    bool notify_bus(const Message& message);
+#endif
+};
@@ -0,0 +1,155 @@
+#include "range_report.hpp"
+#include "csv_tokenizer.hpp"
+#include "iso_time.hpp"
+#include "mapped_file.hpp"
+#include "string_pool.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+// Chunks smaller than this are not worth a thread of their own
+constexpr size_t MIN_CHUNK_BYTES = 4 << 20;
+
+struct Totals {
+    double hours = 0.0;
+    size_t entries = 0;
+};
+
+// Keys are views into the mapped log, so aggregation never copies strings
+using PartialMap = std::unordered_map<std::string_view, Totals>;
+
+struct Partial {
+    PartialMap totals;
+    StringPool unescaped; // stable storage for keys that are not in the log
+};
+
+void aggregate_chunk(std::string_view chunk, int64_t from_day, int64_t to_day,
+                     GroupBy group_by, Partial& partial) {
+    CsvTokenizer rows(chunk);
+    CsvRecord record;
+    LogRow row;
+    while (rows.next(record)) {
+        if (!parse_log_row(record, row) || row.day < from_day || row.day > to_day) continue;
+
+        std::string_view key;
+        switch (group_by) {
+        case GroupBy::Day:
+        case GroupBy::Week:        key = row.date; break; // weeks are folded at merge time
+        case GroupBy::Description: key = row.description; break;
+        case GroupBy::User:        key = row.name; break;
+        }
+        auto found = partial.totals.find(key);
+        if (found == partial.totals.end()) {
+            // Unescaped fields live in the record's scratch buffer; keep a copy
+            if (key.data() < chunk.data() || key.data() >= chunk.data() + chunk.size()) {
+                key = partial.unescaped.view(key);
+            }
+            found = partial.totals.emplace(key, Totals{}).first;
+        }
+        found->second.hours += row.hours;
+        ++found->second.entries;
+    }
+}
+
+std::string week_label(std::string_view date) {
+    int64_t day = 0;
+    iso_time::parse_day(date, day);
+    iso_time::IsoWeek week = iso_time::iso_week(day);
+    char label[16];
+    std::snprintf(label, sizeof(label), "%04d-W%02u", week.year, week.week);
+    return label;
+}
+
+} // namespace
+
+bool parse_group_by(std::string_view text, GroupBy& group_by) {
+    if (text == "day") group_by = GroupBy::Day;
+    else if (text == "week") group_by = GroupBy::Week;
+    else if (text == "description") group_by = GroupBy::Description;
+    else if (text == "user") group_by = GroupBy::User;
+    else return false;
+    return true;
+}
+
+std::vector<std::string_view> split_rows(std::string_view text, unsigned threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t max_chunks = std::max<size_t>(1, text.size() / MIN_CHUNK_BYTES);
+    size_t chunk_count = std::min<size_t>(threads, max_chunks);
+
+    // Quoted descriptions may contain newlines, so a cut is only a row
+    // boundary if an even number of quotes precedes it. Count the quotes
+    // of every slice in parallel, then move each cut forward to the next
+    // newline that lies outside quotes.
+    std::vector<size_t> cuts(chunk_count + 1, text.size());
+    for (size_t i = 0; i < chunk_count; ++i) cuts[i] = text.size() / chunk_count * i;
+    std::vector<size_t> quotes(chunk_count, 0);
+    auto count_slice = [&](size_t i) {
+        quotes[i] = csv_count_quotes(text.data() + cuts[i], cuts[i + 1] - cuts[i]);
+    };
+    if (chunk_count > 1) {
+        std::vector<std::thread> counters;
+        for (size_t i = 0; i + 1 < chunk_count; ++i) counters.emplace_back(count_slice, i);
+        for (auto& counter : counters) counter.join();
+    }
+
+    std::vector<std::string_view> chunks;
+    size_t begin = 0;
+    size_t quotes_before = 0;
+    for (size_t i = 1; i <= chunk_count && begin < text.size(); ++i) {
+        quotes_before += quotes[i - 1];
+        size_t end = text.size();
+        if (i < chunk_count) {
+            end = std::max(begin, csv_next_record(text, cuts[i], quotes_before % 2 == 1));
+        }
+        chunks.push_back(text.substr(begin, end - begin));
+        begin = end;
+    }
+    return chunks;
+}
+
+std::vector<GroupTotal> aggregate_range(const fs::path& csv_file, int64_t from_day, int64_t to_day,
+                                        GroupBy group_by, unsigned threads) {
+    MappedFile csv(csv_file);
+    std::string_view text = csv.view();
+
+    // Skip the column header row
+    text.remove_prefix(csv_next_record(text, 0, false));
+
+    std::vector<std::string_view> chunks = split_rows(text, threads);
+    std::vector<Partial> partials(chunks.size());
+    if (chunks.size() == 1) {
+        aggregate_chunk(chunks[0], from_day, to_day, group_by, partials[0]);
+    } else {
+        std::vector<std::thread> workers;
+        workers.reserve(chunks.size());
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            workers.emplace_back(aggregate_chunk, chunks[i], from_day, to_day, group_by,
+                                 std::ref(partials[i]));
+        }
+        for (auto& worker : workers) worker.join();
+    }
+
+    // Keys still view the log or the partials; only week labels are new
+    StringPool weeks;
+    std::unordered_map<std::string_view, Totals> merged;
+    for (const auto& partial : partials) {
+        for (const auto& [key, totals] : partial.totals) {
+            Totals& target = merged[group_by == GroupBy::Week ? weeks.view(week_label(key)) : key];
+            target.hours += totals.hours;
+            target.entries += totals.entries;
+        }
+    }
+
+    std::vector<GroupTotal> result;
+    result.reserve(merged.size());
+    for (auto& [key, totals] : merged) {
+        result.push_back(GroupTotal{std::string(key), totals.hours, totals.entries});
+    }
+    std::sort(result.begin(), result.end(),
+              [](const GroupTotal& a, const GroupTotal& b) { return a.key < b.key; });
+    return result;
+}
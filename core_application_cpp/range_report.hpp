@@ -0,0 +1,45 @@
+/*
+ * Time Tracker - multi-day report aggregation
+ *
+ * Aggregates every row of time_logs.csv whose date falls in [from, to] in a
+ * single pass. The memory-mapped log is split into row-aligned chunks,
+ * each chunk is aggregated on its own thread into a private hash map, and
+ * the per-thread maps are merged once at the end.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+enum class GroupBy {
+    Day,
+    Week,
+    Description,
+    User
+};
+
+// Parses "day", "week", "description" or "user"
+bool parse_group_by(std::string_view text, GroupBy& group_by);
+
+struct GroupTotal {
+    std::string key;
+    double hours = 0.0;
+    size_t entries = 0;
+};
+
+// Splits CSV rows into row-aligned chunks of at least a few MB, at most one
+// per thread, to be aggregated on a thread each. threads = 0 picks one per
+// hardware thread. Empty text gives no chunks.
+std::vector<std::string_view> split_rows(std::string_view text, unsigned threads = 0);
+
+// Totals per group for rows dated from_day..to_day (days since 1970-01-01),
+// sorted by key. threads = 0 picks one per hardware thread.
+std::vector<GroupTotal> aggregate_range(const fs::path& csv_file, int64_t from_day, int64_t to_day,
+                                        GroupBy group_by, unsigned threads = 0);
@@ -0,0 +1,80 @@
+#include "reminder_list.hpp"
+
+#include "durable_log.hpp"
+#include "iso_time.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <sstream>
+
+ReminderList::ReminderList(fs::path file) : file_(std::move(file)) {}
+
+std::vector<Alert> ReminderList::load() const {
+    std::vector<Alert> alerts;
+    std::ifstream in(file_, std::ios::binary);
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t first_tab = line.find('\t');
+        size_t second_tab = first_tab == std::string::npos ? first_tab : line.find('\t', first_tab + 1);
+        if (second_tab == std::string::npos) continue;
+        Alert alert;
+        auto parsed = std::from_chars(line.data(), line.data() + first_tab, alert.id);
+        if (parsed.ec != std::errc() || parsed.ptr != line.data() + first_tab || alert.id == 0) continue;
+        std::string_view due(line.data() + first_tab + 1, second_tab - first_tab - 1);
+        if (due.size() != iso_time::ISO_LENGTH || !iso_time::parse_iso(due, alert.due)) continue;
+        alert.message = line.substr(second_tab + 1);
+        alerts.push_back(std::move(alert));
+    }
+    return alerts;
+}
+
+Alert ReminderList::add(int64_t due, std::string message) {
+    std::vector<Alert> alerts = load();
+    Alert alert;
+    for (const auto& existing : alerts) alert.id = std::max(alert.id, existing.id);
+    ++alert.id;
+    alert.due = due;
+    std::replace_if(message.begin(), message.end(), [](char c) { return c == '\t' || c == '\n' || c == '\r'; },
+                    ' ');
+    alert.message = std::move(message);
+    alerts.push_back(alert);
+    save(alerts);
+    return alert;
+}
+
+size_t ReminderList::remove(const std::vector<uint64_t>& ids) {
+    std::vector<Alert> alerts = load();
+    auto listed = [&](const Alert& alert) { return std::find(ids.begin(), ids.end(), alert.id) != ids.end(); };
+    size_t before = alerts.size();
+    alerts.erase(std::remove_if(alerts.begin(), alerts.end(), listed), alerts.end());
+    size_t removed = before - alerts.size();
+    if (removed > 0) save(alerts);
+    return removed;
+}
+
+void ReminderList::save(const std::vector<Alert>& alerts) const {
+    std::ostringstream text;
+    for (const auto& alert : alerts) {
+        char due[iso_time::ISO_LENGTH];
+        iso_time::format_iso(alert.due, due);
+        text << alert.id << '\t' << std::string_view(due, sizeof(due)) << '\t' << alert.message << '\n';
+    }
+    write_file_atomic(file_, text.str());
+}
+
+bool parse_delay(std::string_view text, int64_t& seconds) {
+    seconds = 0;
+    if (text.empty()) return false;
+    while (!text.empty()) {
+        int64_t count = 0;
+        auto parsed = std::from_chars(text.data(), text.data() + text.size(), count);
+        if (parsed.ec != std::errc() || parsed.ptr == text.data() + text.size() || count < 0) return false;
+        char unit = *parsed.ptr;
+        int64_t scale = unit == 'h' ? 3600 : unit == 'm' ? 60 : unit == 's' ? 1 : 0;
+        if (scale == 0 || count > (int64_t{1} << 40)) return false;
+        seconds += count * scale;
+        text.remove_prefix(static_cast<size_t>(parsed.ptr - text.data()) + 1);
+    }
+    return seconds > 0;
+}
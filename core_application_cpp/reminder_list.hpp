@@ -0,0 +1,52 @@
+/*
+ * Time Tracker - one-shot reminders set with `remind`
+ *
+ * reminders.tsv holds one line per pending alert, in the order set:
+ *
+ *   id<TAB>due<TAB>message
+ *
+ * where due is a local "YYYY-MM-DDTHH:MM:SS", like the session start
+ * times. Commands add and cancel lines by rewriting the file; the daemon
+ * watches it, keeps every alert in its timer wheel and drops a line once
+ * the alert has been shown. An alert that fell due while no daemon ran is
+ * shown as soon as one starts.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct Alert {
+    uint64_t id = 0;
+    int64_t due = 0; // local seconds, see iso_time.hpp
+    std::string message;
+};
+
+class ReminderList {
+public:
+    explicit ReminderList(fs::path file);
+
+    // Every pending alert; none if the file is missing. Malformed lines are skipped.
+    std::vector<Alert> load() const;
+
+    // Appends an alert and returns it with its new id. Tabs and line
+    // breaks in message become spaces.
+    Alert add(int64_t due, std::string message);
+
+    // Drops the alerts with these ids; returns how many there were
+    size_t remove(const std::vector<uint64_t>& ids);
+
+private:
+    void save(const std::vector<Alert>& alerts) const;
+
+    fs::path file_;
+};
+
+// "90m", "2h", "1h30m" or "45s" -> seconds; false if malformed or zero
+bool parse_delay(std::string_view text, int64_t& seconds);
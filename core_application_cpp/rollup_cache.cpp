@@ -0,0 +1,458 @@
+#include "rollup_cache.hpp"
+#include "csv_tokenizer.hpp"
+#include "durable_log.hpp"
+#include "iso_time.hpp"
+#include "mapped_file.hpp"
+#include "metrics.hpp"
+#include "segment_store.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <utility>
+
+namespace {
+
+constexpr char ROLLUP_MAGIC[4] = {'T', 'T', 'R', 'U'};
+constexpr uint32_t ROLLUP_VERSION = 2;
+constexpr uint64_t TAIL_HASH_BYTES = 64;
+
+// Appended records may grow to twice the snapshot plus this before the
+// file is rewritten
+constexpr uint64_t COMPACT_SLACK_BYTES = 64 << 10;
+
+enum EntryKind : uint32_t {
+    DAY_TOTAL = 0,
+    DAY_DESCRIPTION = 1,
+    DAY_USER = 2,
+    KEY_NAME = 3, // the next key id's text follows, padded to 8 bytes
+    DAY_HOUR = 4  // key is the clock hour; entries is unused
+};
+
+// Sessions longer than this are spread over its last hours only
+constexpr int64_t MAX_SPREAD_SECONDS = 31 * 86400;
+
+struct Entry {
+    int64_t day;
+    uint32_t kind;
+    uint32_t key;     // key id; unused for DAY_TOTAL
+    double hours;
+    uint64_t entries; // byte length of the text for KEY_NAME
+};
+
+void append_entry(std::string& out, const Entry& entry) {
+    out.append(reinterpret_cast<const char*>(&entry), sizeof(entry));
+}
+
+void append_key(std::string& out, uint32_t id, std::string_view key) {
+    append_entry(out, Entry{0, KEY_NAME, id, 0.0, key.size()});
+    out += key;
+    out.append((8 - key.size() % 8) % 8, '\0');
+}
+
+// FNV-1a over the logical log's bytes just before the watermark
+uint64_t tail_hash(const SegmentStore& segments, std::string_view head, uint64_t end) {
+    uint64_t length = std::min(end, TAIL_HASH_BYTES);
+    uint64_t hash = 1469598103934665603ULL;
+    for (char c : segments.logical_bytes(head, end - length, length)) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+std::string day_label(int64_t day) {
+    iso_time::CivilDate date = iso_time::civil_from_days(day);
+    char label[32];
+    std::snprintf(label, sizeof(label), "%04d-%02u-%02u", date.year, date.month, date.day);
+    return label;
+}
+
+std::string week_label(int64_t day) {
+    iso_time::IsoWeek week = iso_time::iso_week(day);
+    char label[32];
+    std::snprintf(label, sizeof(label), "%04d-W%02u", week.year, week.week);
+    return label;
+}
+
+} // namespace
+
+RollupCache::RollupCache(fs::path csv_file, fs::path segment_dir, fs::path rollup_file)
+    : csv_file_(std::move(csv_file)), segment_dir_(std::move(segment_dir)), rollup_file_(std::move(rollup_file)) {}
+
+void RollupCache::sync() {
+    std::error_code ec;
+    uint64_t size = fs::file_size(csv_file_, ec);
+    if (ec) return;
+    int64_t mtime = static_cast<int64_t>(fs::last_write_time(csv_file_, ec).time_since_epoch().count());
+    if (ec) return;
+
+    if (loaded_ && size == csv_size_ && mtime == csv_mtime_) {
+        METRIC_ADD(ROLLUP_HITS, 1);
+        return;
+    }
+
+    // Other processes append to the file too: its size check, the records
+    // and the header must go in together
+    ProcessLock lock(derived_lock_file(csv_file_));
+    if (!loaded_) {
+        loaded_ = true;
+        if (!load()) clear();
+    }
+    if (size == csv_size_ && mtime == csv_mtime_) {
+        METRIC_ADD(ROLLUP_HITS, 1);
+        return;
+    }
+
+    MappedFile csv;
+    if (!csv.open(csv_file_)) return;
+    std::string_view text = csv.view();
+    if (text.size() < size) return; // truncated between stat and map
+    text = text.substr(0, static_cast<size_t>(size)); // ignore rows appended since the stat
+
+    // Appends only ever grow the log, so a same-size change is an edit.
+    // A compaction shrinks the CSV but leaves the logical log as it was.
+    SegmentStore segments(csv_file_, segment_dir_);
+    bool edited = segments.logical_offset(text, size) < watermark_ || size == csv_size_ ||
+                  tail_hash(segments, text, watermark_) != tail_hash_;
+    if (edited) {
+        clear();
+        METRIC_ADD(ROLLUP_MISSES, 1);
+    } else {
+        METRIC_ADD(ROLLUP_HITS, 1);
+    }
+    size_t first_new_key = keys_.size();
+    changes_.clear();
+    segments.visit(text, watermark_, [&](std::string_view rows, uint64_t from, uint64_t shift) {
+        scan(rows, from, shift, !edited);
+    });
+    tail_hash_ = tail_hash(segments, text, watermark_);
+    last_query_.valid = false;
+    csv_size_ = size;
+    csv_mtime_ = mtime;
+    if (edited) save_snapshot();
+    else save_changes(first_new_key);
+}
+
+std::vector<GroupTotal> RollupCache::totals(int64_t from_day, int64_t to_day, GroupBy group_by) {
+    sync();
+    if (last_query_.valid && last_query_.from_day == from_day && last_query_.to_day == to_day &&
+        last_query_.group_by == group_by) {
+        return last_query_.result;
+    }
+
+    last_query_ = Query{true, from_day, to_day, group_by, {}};
+    std::vector<GroupTotal>& result = last_query_.result;
+    auto first = days_.lower_bound(from_day);
+    auto last = days_.upper_bound(to_day);
+    if (group_by == GroupBy::Day || group_by == GroupBy::Week) {
+        // Days come out of the map in order, and so do their weeks
+        for (auto it = first; it != last; ++it) {
+            std::string key = group_by == GroupBy::Week ? week_label(it->first) : day_label(it->first);
+            if (result.empty() || result.back().key != key) result.push_back(GroupTotal{key, 0.0, 0});
+            result.back().hours += it->second.total.hours;
+            result.back().entries += it->second.total.entries;
+        }
+        return result;
+    }
+
+    std::unordered_map<uint32_t, Totals> merged;
+    for (auto it = first; it != last; ++it) {
+        const auto& by_key = group_by == GroupBy::User ? it->second.users : it->second.descriptions;
+        for (const auto& [key, totals] : by_key) {
+            Totals& target = merged[key];
+            target.hours += totals.hours;
+            target.entries += totals.entries;
+        }
+    }
+    result.reserve(merged.size());
+    for (const auto& [key, totals] : merged) {
+        result.push_back(GroupTotal{std::string(keys_.at(key)), totals.hours, totals.entries});
+    }
+    std::sort(result.begin(), result.end(),
+              [](const GroupTotal& a, const GroupTotal& b) { return a.key < b.key; });
+    return result;
+}
+
+std::vector<double> RollupCache::daily_hours(int64_t from_day, int64_t to_day) {
+    sync();
+    std::vector<double> hours(static_cast<size_t>(std::max<int64_t>(0, to_day - from_day + 1)), 0.0);
+    for (auto it = days_.lower_bound(from_day); it != days_.end() && it->first <= to_day; ++it) {
+        hours[static_cast<size_t>(it->first - from_day)] = it->second.total.hours;
+    }
+    return hours;
+}
+
+RollupCache::WeekHours RollupCache::weekly_hours(int64_t from_day, int64_t to_day) {
+    sync();
+    WeekHours week{};
+    for (auto it = hours_.lower_bound(from_day); it != hours_.end() && it->first <= to_day; ++it) {
+        std::array<double, 24>& target = week[iso_time::weekday(it->first)];
+        for (size_t hour = 0; hour < 24; ++hour) target[hour] += it->second[hour];
+    }
+    return week;
+}
+
+bool RollupCache::load() {
+    MappedFile file;
+    if (!file.open(rollup_file_)) return false;
+    std::string_view data = file.view();
+
+    Header header;
+    if (data.size() < sizeof(header)) return false;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, ROLLUP_MAGIC, sizeof(ROLLUP_MAGIC)) != 0 ||
+        header.version != ROLLUP_VERSION ||
+        data.size() - sizeof(header) < header.record_bytes) {
+        return false;
+    }
+
+    // Later records replace earlier values of the same total
+    clear();
+    size_t pos = sizeof(header);
+    size_t end = pos + static_cast<size_t>(header.record_bytes);
+    while (end - pos >= sizeof(Entry)) {
+        Entry entry;
+        std::memcpy(&entry, data.data() + pos, sizeof(entry));
+        pos += sizeof(entry);
+        if (entry.kind == KEY_NAME) {
+            size_t padded = (entry.entries + 7) & ~size_t{7};
+            if (entry.key != keys_.size() || end - pos < padded) return false;
+            keys_.intern(data.substr(pos, static_cast<size_t>(entry.entries)));
+            pos += padded;
+            continue;
+        }
+        if (entry.kind == DAY_HOUR) {
+            if (entry.key >= 24) return false;
+            hours_[entry.day][entry.key] = entry.hours;
+            continue;
+        }
+        if (entry.kind != DAY_TOTAL && entry.key >= keys_.size()) return false;
+        Day& day = days_[entry.day];
+        Totals& totals = entry.kind == DAY_TOTAL       ? day.total
+                         : entry.kind == DAY_USER      ? day.users[entry.key]
+                                                       : day.descriptions[entry.key];
+        totals.hours = entry.hours;
+        totals.entries = static_cast<size_t>(entry.entries);
+    }
+
+    watermark_ = header.watermark;
+    csv_size_ = header.csv_size;
+    csv_mtime_ = header.csv_mtime;
+    tail_hash_ = header.tail_hash;
+    record_bytes_ = header.record_bytes;
+    snapshot_bytes_ = header.snapshot_bytes;
+    return true;
+}
+
+void RollupCache::save_snapshot() {
+    std::string records;
+    for (size_t id = 0; id < keys_.size(); ++id) append_key(records, static_cast<uint32_t>(id), keys_.at(static_cast<uint32_t>(id)));
+    for (const auto& [day, totals] : days_) {
+        append_entry(records, Entry{day, DAY_TOTAL, 0, totals.total.hours, totals.total.entries});
+        for (const auto& [key, by_key] : totals.descriptions) {
+            append_entry(records, Entry{day, DAY_DESCRIPTION, key, by_key.hours, by_key.entries});
+        }
+        for (const auto& [key, by_key] : totals.users) {
+            append_entry(records, Entry{day, DAY_USER, key, by_key.hours, by_key.entries});
+        }
+    }
+    for (const auto& [day, hours] : hours_) {
+        for (uint32_t hour = 0; hour < 24; ++hour) {
+            if (hours[hour] != 0.0) append_entry(records, Entry{day, DAY_HOUR, hour, hours[hour], 0});
+        }
+    }
+    record_bytes_ = records.size();
+    snapshot_bytes_ = records.size();
+
+    std::ostringstream contents;
+    write_header(contents);
+    contents << records;
+
+    // The rollup can always be rebuilt from the CSV, so a failed save only
+    // costs a rescan next time
+    try {
+        write_file_atomic(rollup_file_, contents.str());
+    } catch (const std::exception&) {
+    }
+}
+
+void RollupCache::save_changes(size_t first_new_key) {
+    std::error_code ec;
+    if (fs::file_size(rollup_file_, ec) != sizeof(Header) + record_bytes_ || ec ||
+        record_bytes_ > 2 * snapshot_bytes_ + COMPACT_SLACK_BYTES) {
+        save_snapshot();
+        return;
+    }
+
+    std::string records;
+    for (size_t id = first_new_key; id < keys_.size(); ++id) {
+        append_key(records, static_cast<uint32_t>(id), keys_.at(static_cast<uint32_t>(id)));
+    }
+    auto order = [](const Change& a, const Change& b) {
+        return std::tie(a.day, a.kind, a.key) < std::tie(b.day, b.kind, b.key);
+    };
+    auto same = [](const Change& a, const Change& b) {
+        return a.day == b.day && a.kind == b.kind && a.key == b.key;
+    };
+    std::sort(changes_.begin(), changes_.end(), order);
+    changes_.erase(std::unique(changes_.begin(), changes_.end(), same), changes_.end());
+    for (const Change& change : changes_) {
+        if (change.kind == DAY_HOUR) {
+            append_entry(records, Entry{change.day, DAY_HOUR, change.key, hours_[change.day][change.key], 0});
+            continue;
+        }
+        const Day& day = days_[change.day];
+        const Totals& totals = change.kind == DAY_TOTAL  ? day.total
+                               : change.kind == DAY_USER ? day.users.at(change.key)
+                                                         : day.descriptions.at(change.key);
+        append_entry(records, Entry{change.day, change.kind, change.key, totals.hours, totals.entries});
+    }
+
+    // Records first, then the header that makes them visible
+    std::fstream out(rollup_file_, std::ios::binary | std::ios::in | std::ios::out);
+    out.seekp(static_cast<std::streamoff>(sizeof(Header) + record_bytes_));
+    out.write(records.data(), static_cast<std::streamsize>(records.size()));
+    out.flush();
+    if (!out) return;
+    record_bytes_ += records.size();
+    out.seekp(0);
+    write_header(out);
+}
+
+void RollupCache::write_header(std::ostream& out) const {
+    Header header{};
+    std::memcpy(header.magic, ROLLUP_MAGIC, sizeof(ROLLUP_MAGIC));
+    header.version = ROLLUP_VERSION;
+    header.watermark = watermark_;
+    header.csv_size = csv_size_;
+    header.csv_mtime = csv_mtime_;
+    header.tail_hash = tail_hash_;
+    header.record_bytes = record_bytes_;
+    header.snapshot_bytes = snapshot_bytes_;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+void RollupCache::clear() {
+    watermark_ = 0;
+    csv_size_ = 0;
+    csv_mtime_ = 0;
+    tail_hash_ = 0;
+    record_bytes_ = 0;
+    snapshot_bytes_ = 0;
+    keys_.clear();
+    days_.clear();
+    hours_.clear();
+    last_query_.valid = false;
+}
+
+void RollupCache::scan(std::string_view text, uint64_t from, uint64_t shift, bool track_changes) {
+    size_t begin = static_cast<size_t>(from);
+    if (from + shift == 0) {
+        // Skip the column header row
+        CsvTokenizer rows(text);
+        CsvRecord row;
+        if (!rows.next(row) || !row.terminated) return;
+        watermark_ = row.end;
+        begin = row.end;
+    }
+    std::string_view rows = text.substr(begin);
+
+    // Appended rows are few; only a rebuild is worth the threads
+    std::vector<std::string_view> chunks;
+    if (!track_changes) chunks = split_rows(rows);
+    if (chunks.size() <= 1) {
+        size_t end = add_rows(rows, keys_, days_, hours_, track_changes ? &changes_ : nullptr);
+        if (end > 0) watermark_ = begin + end + shift;
+        return;
+    }
+
+    struct Partial {
+        StringPool keys;
+        std::map<int64_t, Day> days;
+        std::map<int64_t, std::array<double, 24>> hours;
+        size_t end = 0;
+    };
+    std::vector<Partial> partials(chunks.size());
+    {
+        std::vector<std::thread> workers;
+        workers.reserve(chunks.size());
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            workers.emplace_back([&chunks, &partials, i] {
+                Partial& partial = partials[i];
+                partial.end = add_rows(chunks[i], partial.keys, partial.days, partial.hours, nullptr);
+            });
+        }
+        for (auto& worker : workers) worker.join();
+    }
+
+    // Merged in log order, so keys get the ids a single pass would give them
+    auto add = [](Totals& target, const Totals& totals) {
+        target.hours += totals.hours;
+        target.entries += totals.entries;
+    };
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        const Partial& partial = partials[i];
+        std::vector<uint32_t> ids(partial.keys.size());
+        for (uint32_t id = 0; id < ids.size(); ++id) ids[id] = keys_.intern(partial.keys.at(id));
+        for (const auto& [day, totals] : partial.days) {
+            Day& target = days_[day];
+            add(target.total, totals.total);
+            for (const auto& [key, description] : totals.descriptions) add(target.descriptions[ids[key]], description);
+            for (const auto& [key, user] : totals.users) add(target.users[ids[key]], user);
+        }
+        for (const auto& [day, hours] : partial.hours) {
+            std::array<double, 24>& target = hours_[day];
+            for (size_t hour = 0; hour < target.size(); ++hour) target[hour] += hours[hour];
+        }
+        if (partial.end > 0) watermark_ = static_cast<size_t>(chunks[i].data() - text.data()) + partial.end + shift;
+    }
+}
+
+size_t RollupCache::add_rows(std::string_view text, StringPool& keys, std::map<int64_t, Day>& days,
+                             std::map<int64_t, std::array<double, 24>>& hours, std::vector<Change>* changes) {
+    CsvTokenizer rows(text);
+    CsvRecord row;
+    LogRow logged;
+    size_t end = 0;
+    while (rows.next(row) && row.terminated) { // a partial row is still being written
+        end = row.end;
+        if (!parse_log_row(row, logged)) continue;
+
+        int64_t day = logged.day;
+        uint32_t description = keys.intern(logged.description);
+        uint32_t user = keys.intern(logged.name);
+        Day& totals = days[day];
+        for (Totals* target : {&totals.total, &totals.descriptions[description], &totals.users[user]}) {
+            target->hours += logged.hours;
+            ++target->entries;
+        }
+        // A rebuild is saved as a snapshot and needs no change list
+        if (changes) {
+            changes->push_back(Change{day, DAY_TOTAL, 0});
+            changes->push_back(Change{day, DAY_DESCRIPTION, description});
+            changes->push_back(Change{day, DAY_USER, user});
+        }
+
+        // Spread the duration over the clock hours before the end time
+        int64_t end_clock = 0;
+        if (logged.hours <= 0.0 || !iso_time::parse_clock(logged.end_time, end_clock)) continue;
+        int64_t until = day * 86400 + end_clock;
+        int64_t length = std::min(std::max<int64_t>(1, std::llround(logged.hours * 3600.0)), MAX_SPREAD_SECONDS);
+        for (int64_t begin = until - length; until > begin;) {
+            int64_t hour_start = std::max(begin, until - 1 - iso_time::seconds_of_day(until - 1) % 3600);
+            int64_t hour_day = iso_time::day_of(hour_start);
+            uint32_t hour = static_cast<uint32_t>(iso_time::seconds_of_day(hour_start) / 3600);
+            hours[hour_day][hour] += logged.hours * static_cast<double>(until - hour_start) / length;
+            if (changes) changes->push_back(Change{hour_day, DAY_HOUR, hour});
+            until = hour_start;
+        }
+    }
+    return end;
+}
@@ -0,0 +1,136 @@
+/*
+ * Time Tracker - materialized report totals
+ *
+ * time_logs.rollup holds the log's totals per day, per day and description
+ * and per day and user, so range reports add up a handful of precomputed
+ * numbers instead of rescanning the CSV. It also holds the hours worked in
+ * each clock hour of each day (a session is spread over the hours before
+ * its end time, so one past midnight counts on both days), from which the
+ * heatmap and the weekday-by-hour report are drawn. Like the date index
+ * it records how many bytes of the logical log (see segment_store.hpp) it
+ * covers (the watermark) and a hash of the bytes just before it; it also
+ * records the CSV's size and modification time at the last sync:
+ *
+ *   size and mtime unchanged          -> up to date, the CSV is not read
+ *   grown, bytes before watermark same -> only the appended rows are added
+ *   anything else (edited, truncated)  -> rebuilt from the whole log
+ *
+ * The file is a snapshot of every total followed by records appended on
+ * each sync, each carrying the new value of one total it changed, so a
+ * stop adds a few dozen bytes instead of rewriting the file. Once the
+ * appended records outgrow the snapshot the file is rewritten. Syncs that
+ * read or change the file hold the derived files' lock (see durable_log.hpp).
+ *
+ * A RollupCache keeps the totals in memory between syncs, and remembers
+ * the last report it answered, so a long-lived process (the daemon) answers
+ * a dashboard polling the same report with a single stat().
+ */
+
+#pragma once
+
+#include "range_report.hpp"
+#include "string_pool.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+class RollupCache {
+public:
+    // segment_dir holds the rows `compact` sealed out of csv_file
+    RollupCache(fs::path csv_file, fs::path segment_dir, fs::path rollup_file);
+
+    // Brings the totals up to date with the CSV and saves them if they changed
+    void sync();
+
+    // Totals per group for days from_day..to_day (days since 1970-01-01),
+    // sorted by key; the same result aggregate_range computes. Syncs first.
+    std::vector<GroupTotal> totals(int64_t from_day, int64_t to_day, GroupBy group_by);
+
+    // Hours for each day from_day..to_day, dated like totals(); 0 for a
+    // day with no entries. Syncs first.
+    std::vector<double> daily_hours(int64_t from_day, int64_t to_day);
+
+    // Hours worked in each clock hour of each weekday (0 = Monday) over
+    // the days from_day..to_day. Syncs first.
+    using WeekHours = std::array<std::array<double, 24>, 7>;
+    WeekHours weekly_hours(int64_t from_day, int64_t to_day);
+
+private:
+    struct Totals {
+        double hours = 0.0;
+        size_t entries = 0;
+    };
+
+    struct Day {
+        Totals total;
+        std::unordered_map<uint32_t, Totals> descriptions; // by key id
+        std::unordered_map<uint32_t, Totals> users;        // by key id
+    };
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t watermark;   // CSV bytes covered by the totals
+        uint64_t csv_size;    // CSV size and mtime when last synced
+        int64_t csv_mtime;
+        uint64_t tail_hash;   // hash of the last bytes before watermark
+        uint64_t record_bytes;   // valid record bytes after the header
+        uint64_t snapshot_bytes; // of which written by the last full save
+    };
+
+    // A total changed by the current sync: (day, record kind, key id)
+    struct Change {
+        int64_t day;
+        uint32_t kind;
+        uint32_t key;
+    };
+
+    // The last report answered; dropped whenever the totals change
+    struct Query {
+        bool valid = false;
+        int64_t from_day = 0;
+        int64_t to_day = 0;
+        GroupBy group_by = GroupBy::Day;
+        std::vector<GroupTotal> result;
+    };
+
+    bool load();
+    void save_snapshot();
+    void save_changes(size_t first_new_key);
+    void write_header(std::ostream& out) const;
+    void clear();
+    // Adds the rows of text from offset from; shift maps text offsets to
+    // logical ones. A rebuild (no changes tracked) adds up row-aligned
+    // chunks on a thread each, as aggregate_range does, and merges them.
+    void scan(std::string_view text, uint64_t from, uint64_t shift, bool track_changes);
+    // Adds the whole rows of text to keys, days and hours, noting the totals
+    // changed in changes if given. Returns where the last whole row ends.
+    static size_t add_rows(std::string_view text, StringPool& keys, std::map<int64_t, Day>& days,
+                           std::map<int64_t, std::array<double, 24>>& hours, std::vector<Change>* changes);
+
+    fs::path csv_file_;
+    fs::path segment_dir_;
+    fs::path rollup_file_;
+    bool loaded_ = false;
+    uint64_t watermark_ = 0;
+    uint64_t csv_size_ = 0;
+    int64_t csv_mtime_ = 0;
+    uint64_t tail_hash_ = 0;
+    uint64_t record_bytes_ = 0;
+    uint64_t snapshot_bytes_ = 0;
+    std::vector<Change> changes_;
+    StringPool keys_; // descriptions and user names
+    std::map<int64_t, Day> days_;
+    std::map<int64_t, std::array<double, 24>> hours_; // by the day they were worked on
+    Query last_query_;
+};
@@ -0,0 +1,496 @@
+#include "search_index.hpp"
+#include "csv_tokenizer.hpp"
+#include "durable_log.hpp"
+#include "mapped_file.hpp"
+#include "metrics.hpp"
+#include "segment_store.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <system_error>
+#include <utility>
+
+namespace {
+
+constexpr char SEARCH_MAGIC[4] = {'T', 'T', 'S', 'I'};
+constexpr uint32_t SEARCH_VERSION = 1;
+constexpr uint64_t TAIL_HASH_BYTES = 64;
+
+// Appended entries may grow to twice the snapshot plus this before the
+// file is rewritten
+constexpr uint64_t COMPACT_SLACK_BYTES = 64 << 10;
+
+// Record ids per postings block; each block starts with an absolute id
+constexpr uint32_t BLOCK_IDS = 128;
+
+void put_varint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+bool get_varint(std::string_view data, size_t& pos, uint64_t& value) {
+    // Gaps between a word's sessions mostly fit in one byte
+    if (pos < data.size() && static_cast<unsigned char>(data[pos]) < 0x80) {
+        value = static_cast<unsigned char>(data[pos++]);
+        return true;
+    }
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < data.size(); shift += 7) {
+        unsigned char byte = static_cast<unsigned char>(data[pos++]);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (byte < 0x80) return true;
+    }
+    return false;
+}
+
+bool get_text(std::string_view data, size_t& pos, std::string_view& text) {
+    uint64_t length = 0;
+    if (!get_varint(data, pos, length) || data.size() - pos < length) return false;
+    text = data.substr(pos, static_cast<size_t>(length));
+    pos += static_cast<size_t>(length);
+    return true;
+}
+
+// FNV-1a over the logical log's bytes just before the watermark
+uint64_t tail_hash(const SegmentStore& segments, std::string_view head, uint64_t end) {
+    uint64_t length = std::min(end, TAIL_HASH_BYTES);
+    uint64_t hash = 1469598103934665603ULL;
+    for (char c : segments.logical_bytes(head, end - length, length)) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+} // namespace
+
+SearchIndex::SearchIndex(fs::path csv_file, fs::path segment_dir, fs::path index_file)
+    : csv_file_(std::move(csv_file)), segment_dir_(std::move(segment_dir)), index_file_(std::move(index_file)) {}
+
+void SearchIndex::words_of(std::string_view text, std::string& lowered, std::vector<std::string_view>& words) {
+    lowered.assign(text);
+    size_t start = 0;
+    for (size_t i = 0; i <= lowered.size(); ++i) {
+        unsigned char byte = i < lowered.size() ? static_cast<unsigned char>(lowered[i]) : ' ';
+        if (byte >= 'A' && byte <= 'Z') {
+            lowered[i] = static_cast<char>(byte - 'A' + 'a');
+        } else if (!((byte >= '0' && byte <= '9') || (byte >= 'a' && byte <= 'z') || byte >= 0x80)) {
+            if (i > start) words.push_back(std::string_view(lowered).substr(start, i - start));
+            start = i + 1;
+        }
+    }
+}
+
+void SearchIndex::sync() {
+    ProcessLock lock(derived_lock_file(csv_file_));
+    update();
+}
+
+void SearchIndex::update() {
+    std::error_code ec;
+    uint64_t size = fs::file_size(csv_file_, ec);
+    if (ec) return;
+    int64_t mtime = static_cast<int64_t>(fs::last_write_time(csv_file_, ec).time_since_epoch().count());
+    if (ec) return;
+
+    // Another process may have appended to (or rewritten) the file
+    Header on_disk{};
+    bool valid = read_header(on_disk);
+    if (loaded_ && (!valid || std::memcmp(&on_disk, &header_, sizeof(Header)) != 0)) loaded_ = false;
+    if (!loaded_) header_ = valid ? on_disk : Header{};
+    if (valid && size == header_.csv_size && mtime == header_.csv_mtime) {
+        METRIC_ADD(SEARCH_HITS, 1);
+        return;
+    }
+
+    // Rewriting the file needs every postings list, so only then is it read
+    bool rewrite = valid && header_.data_bytes > 2 * header_.snapshot_bytes + COMPACT_SLACK_BYTES;
+    if (rewrite && !loaded_ && !load()) valid = false;
+
+    MappedFile csv;
+    if (!csv.open(csv_file_)) return;
+    std::string_view text = csv.view();
+    if (text.size() < size) return; // truncated between stat and map
+    text = text.substr(0, static_cast<size_t>(size)); // ignore rows appended since the stat
+
+    // Appends only ever grow the log, so a same-size change is an edit
+    SegmentStore segments(csv_file_, segment_dir_);
+    bool edited = !valid || segments.logical_offset(text, size) < header_.watermark ||
+                  size == header_.csv_size || tail_hash(segments, text, header_.watermark) != header_.tail_hash;
+    if (edited) {
+        clear();
+        loaded_ = true;
+        rewrite = true;
+        METRIC_ADD(SEARCH_MISSES, 1);
+    } else {
+        METRIC_ADD(SEARCH_HITS, 1);
+    }
+
+    std::string entries;
+    segments.visit(text, header_.watermark, [&](std::string_view rows, uint64_t from, uint64_t shift) {
+        scan(rows, from, shift, [&](const Record& record, const std::vector<std::string_view>& words) {
+            if (loaded_) add(record, words);
+            else ++header_.record_count;
+            if (rewrite) return;
+            entries.append(reinterpret_cast<const char*>(&record), sizeof(record));
+            put_varint(entries, words.size());
+            for (const auto& word : words) {
+                put_varint(entries, word.size());
+                entries += word;
+            }
+        });
+    });
+    header_.tail_hash = tail_hash(segments, text, header_.watermark);
+    header_.csv_size = size;
+    header_.csv_mtime = mtime;
+
+    if (rewrite || !append_entries(entries)) {
+        if (loaded_ || load()) {
+            save_snapshot();
+        } else {
+            // Neither readable nor appendable; the next sync rebuilds it
+            fs::remove(index_file_, ec);
+        }
+    }
+}
+
+SearchIndex::Result SearchIndex::search(const std::vector<std::string>& terms, size_t limit) {
+    {
+        // Held while the file is read in too, so no one appends meanwhile
+        ProcessLock lock(derived_lock_file(csv_file_));
+        update();
+        if (!loaded_ && !load()) {
+            // A damaged file is rebuilt from the log
+            std::error_code ec;
+            fs::remove(index_file_, ec);
+            update();
+        }
+    }
+
+    // Every term must match; a phrase like "auth-service" is two terms.
+    // Each term is the postings of its word, or of every word it prefixes.
+    std::vector<std::vector<const Postings*>> matched;
+    for (const auto& term : terms) {
+        bool prefix = !term.empty() && term.back() == '*';
+        std::string lowered;
+        std::vector<std::string_view> words;
+        words_of(std::string_view(term).substr(0, term.size() - (prefix ? 1 : 0)), lowered, words);
+        for (size_t i = 0; i < words.size(); ++i) {
+            matched.push_back(postings_for(words[i], prefix && i + 1 == words.size()));
+        }
+    }
+
+    Result result;
+    if (matched.empty()) return result;
+    auto sessions = [](const std::vector<const Postings*>& lists) {
+        size_t count = 0;
+        for (const Postings* postings : lists) count += postings->count;
+        return count;
+    };
+    std::sort(matched.begin(), matched.end(),
+              [&](const auto& a, const auto& b) { return sessions(a) < sessions(b); });
+
+    // One word: its totals are kept up to date, and the latest matches
+    // are in its last blocks
+    std::vector<uint32_t> ids;
+    if (matched.size() == 1 && matched[0].size() == 1) {
+        const Postings& postings = *matched[0][0];
+        result.sessions = postings.count;
+        result.hours = postings.hours;
+        if (limit == 0 || postings.count == 0) return result;
+        decode(postings, (postings.count - std::min<size_t>(limit, postings.count)) / BLOCK_IDS, ids);
+    } else {
+        // Start from the rarest term and narrow it down with the others
+        ids = decode_union(matched[0]);
+        for (size_t i = 1; i < matched.size() && !ids.empty(); ++i) {
+            if (matched[i].size() == 1) {
+                narrow(ids, *matched[i][0]);
+                continue;
+            }
+            std::vector<uint32_t> other = decode_union(matched[i]);
+            auto end = std::set_intersection(ids.begin(), ids.end(), other.begin(), other.end(), ids.begin());
+            ids.erase(end, ids.end());
+        }
+        result.sessions = ids.size();
+        for (uint32_t id : ids) result.hours += records_[id].hours;
+    }
+    if (ids.empty() || limit == 0) return result;
+
+    MappedFile csv;
+    if (!csv.open(csv_file_)) return result;
+    SegmentStore segments(csv_file_, segment_dir_);
+    for (size_t i = ids.size() - std::min(limit, ids.size()); i < ids.size(); ++i) {
+        const Record& record = records_[ids[i]];
+        result.rows.push_back(segments.logical_bytes(csv.view(), record.offset, record.length));
+    }
+    return result;
+}
+
+bool SearchIndex::read_header(Header& header) const {
+    std::ifstream in(index_file_, std::ios::binary);
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+    return std::memcmp(header.magic, SEARCH_MAGIC, sizeof(SEARCH_MAGIC)) == 0 && header.version == SEARCH_VERSION;
+}
+
+bool SearchIndex::load() {
+    MappedFile file;
+    if (!file.open(index_file_)) return false;
+    std::string_view data = file.view();
+
+    Header header;
+    if (data.size() < sizeof(header)) return false;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, SEARCH_MAGIC, sizeof(SEARCH_MAGIC)) != 0 || header.version != SEARCH_VERSION ||
+        data.size() - sizeof(header) < header.data_bytes || header.data_bytes < header.snapshot_bytes) {
+        return false;
+    }
+    data = data.substr(sizeof(header), static_cast<size_t>(header.data_bytes));
+
+    // Snapshot: the record table, then each word with its postings
+    clear();
+    std::string_view snapshot = data.substr(0, static_cast<size_t>(header.snapshot_bytes));
+    size_t pos = 0;
+    uint64_t count = 0;
+    if (!get_varint(snapshot, pos, count) || (snapshot.size() - pos) / sizeof(Record) < count) return false;
+    records_.resize(static_cast<size_t>(count));
+    std::memcpy(records_.data(), snapshot.data() + pos, records_.size() * sizeof(Record));
+    pos += records_.size() * sizeof(Record);
+    if (!get_varint(snapshot, pos, count)) return false;
+    for (uint64_t i = 0; i < count; ++i) {
+        std::string_view word;
+        std::string_view deltas;
+        uint64_t ids = 0;
+        uint64_t last = 0;
+        double hours = 0.0;
+        if (!get_text(snapshot, pos, word) || !get_varint(snapshot, pos, ids) || !get_varint(snapshot, pos, last) ||
+            last >= records_.size() || snapshot.size() - pos < sizeof(hours)) {
+            return false;
+        }
+        std::memcpy(&hours, snapshot.data() + pos, sizeof(hours));
+        pos += sizeof(hours);
+        if (!get_text(snapshot, pos, deltas)) return false;
+
+        Postings& postings = postings_[std::string(word)];
+        postings.deltas.assign(deltas);
+        postings.last = static_cast<uint32_t>(last);
+        postings.count = static_cast<uint32_t>(ids);
+        postings.hours = hours;
+
+        // Block offsets follow from the ids, so they are not stored
+        size_t at = 0;
+        uint64_t gap = 0;
+        for (uint32_t n = 0; n < postings.count; ++n) {
+            if (n % BLOCK_IDS == 0) postings.blocks.push_back(static_cast<uint32_t>(at));
+            if (!get_varint(deltas, at, gap)) return false;
+        }
+        if (at != deltas.size()) return false;
+    }
+
+    // Then one entry per session indexed since
+    pos = static_cast<size_t>(header.snapshot_bytes);
+    std::vector<std::string_view> words;
+    while (data.size() - pos >= sizeof(Record)) {
+        Record record;
+        std::memcpy(&record, data.data() + pos, sizeof(record));
+        pos += sizeof(record);
+        uint64_t word_count = 0;
+        if (!get_varint(data, pos, word_count)) return false;
+        words.clear();
+        for (uint64_t i = 0; i < word_count; ++i) {
+            std::string_view word;
+            if (!get_text(data, pos, word)) return false;
+            words.push_back(word);
+        }
+        add(record, words);
+    }
+    if (pos != data.size() || records_.size() != header.record_count) return false;
+
+    header_ = header;
+    loaded_ = true;
+    return true;
+}
+
+void SearchIndex::save_snapshot() {
+    std::string data;
+    put_varint(data, records_.size());
+    data.append(reinterpret_cast<const char*>(records_.data()), records_.size() * sizeof(Record));
+    put_varint(data, postings_.size());
+    for (const auto& [word, postings] : postings_) {
+        put_varint(data, word.size());
+        data += word;
+        put_varint(data, postings.count);
+        put_varint(data, postings.last);
+        data.append(reinterpret_cast<const char*>(&postings.hours), sizeof(postings.hours));
+        put_varint(data, postings.deltas.size());
+        data += postings.deltas;
+    }
+    header_.record_count = records_.size();
+    header_.data_bytes = data.size();
+    header_.snapshot_bytes = data.size();
+
+    std::ostringstream contents;
+    write_header(contents);
+    contents << data;
+
+    // The index can always be rebuilt from the log, so a failed save only
+    // costs a rescan next time
+    try {
+        write_file_atomic(index_file_, contents.str());
+    } catch (const std::exception&) {
+    }
+}
+
+bool SearchIndex::append_entries(const std::string& entries) {
+    std::error_code ec;
+    if (fs::file_size(index_file_, ec) != sizeof(Header) + header_.data_bytes || ec) return false;
+
+    // Entries first, then the header that makes them visible
+    std::fstream out(index_file_, std::ios::binary | std::ios::in | std::ios::out);
+    out.seekp(static_cast<std::streamoff>(sizeof(Header) + header_.data_bytes));
+    out.write(entries.data(), static_cast<std::streamsize>(entries.size()));
+    out.flush();
+    if (!out) return false;
+    header_.data_bytes += entries.size();
+    out.seekp(0);
+    write_header(out);
+    return static_cast<bool>(out.flush());
+}
+
+void SearchIndex::write_header(std::ostream& out) const {
+    Header header = header_;
+    std::memcpy(header.magic, SEARCH_MAGIC, sizeof(SEARCH_MAGIC));
+    header.version = SEARCH_VERSION;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+void SearchIndex::clear() {
+    header_ = Header{};
+    records_.clear();
+    postings_.clear();
+}
+
+void SearchIndex::add(const Record& record, const std::vector<std::string_view>& words) {
+    uint32_t id = static_cast<uint32_t>(records_.size());
+    records_.push_back(record);
+    header_.record_count = records_.size();
+    for (const auto& word : words) {
+        auto found = postings_.find(word);
+        if (found == postings_.end()) found = postings_.emplace(word, Postings{}).first;
+        Postings& postings = found->second;
+        if (postings.count > 0 && postings.last == id) continue; // repeated word
+        if (postings.count % BLOCK_IDS == 0) {
+            postings.blocks.push_back(static_cast<uint32_t>(postings.deltas.size()));
+            put_varint(postings.deltas, id);
+        } else {
+            put_varint(postings.deltas, id - postings.last);
+        }
+        postings.last = id;
+        ++postings.count;
+        postings.hours += record.hours;
+    }
+}
+
+void SearchIndex::scan(std::string_view text, uint64_t from, uint64_t shift,
+                       const std::function<void(const Record&, const std::vector<std::string_view>&)>& found) {
+    CsvTokenizer rows(text, static_cast<size_t>(from));
+    CsvRecord row;
+    LogRow logged;
+    if (from + shift == 0) {
+        // Skip the column header row
+        if (!rows.next(row) || !row.terminated) return;
+        header_.watermark = row.end;
+    }
+
+    // Reused from row to row, so scanning allocates nothing per row
+    std::string lowered;
+    std::vector<std::string_view> words;
+    while (rows.next(row) && row.terminated) { // a partial row is still being written
+        header_.watermark = row.end + shift;
+        if (!parse_log_row(row, logged)) continue; // reports skip it too
+
+        words.clear();
+        words_of(logged.description, lowered, words);
+        std::sort(words.begin(), words.end());
+        words.erase(std::unique(words.begin(), words.end()), words.end());
+        found(Record{row.begin + shift, static_cast<uint32_t>(row.line.size()), 0, logged.hours}, words);
+    }
+}
+
+std::vector<const SearchIndex::Postings*> SearchIndex::postings_for(std::string_view word, bool prefix) const {
+    std::vector<const Postings*> lists;
+    if (!prefix) {
+        auto found = postings_.find(word);
+        if (found != postings_.end()) lists.push_back(&found->second);
+        return lists;
+    }
+    // Words sharing the prefix sit next to each other in the map
+    for (auto it = postings_.lower_bound(word);
+         it != postings_.end() && it->first.compare(0, word.size(), word) == 0; ++it) {
+        lists.push_back(&it->second);
+    }
+    return lists;
+}
+
+void SearchIndex::decode(const Postings& postings, size_t first_block, std::vector<uint32_t>& ids) {
+    std::string_view deltas = postings.deltas;
+    ids.reserve(ids.size() + postings.count - std::min<size_t>(postings.count, first_block * BLOCK_IDS));
+    for (size_t block = first_block; block < postings.blocks.size(); ++block) {
+        size_t pos = postings.blocks[block];
+        size_t end = block + 1 < postings.blocks.size() ? postings.blocks[block + 1] : deltas.size();
+        uint64_t id = 0;
+        uint64_t gap = 0;
+        get_varint(deltas, pos, id);
+        ids.push_back(static_cast<uint32_t>(id));
+        while (pos < end && get_varint(deltas, pos, gap)) {
+            id += gap;
+            ids.push_back(static_cast<uint32_t>(id));
+        }
+    }
+}
+
+void SearchIndex::narrow(std::vector<uint32_t>& ids, const Postings& postings) {
+    std::string_view deltas = postings.deltas;
+    size_t keep = 0;
+    size_t next = 0;
+    uint64_t next_first = 0;
+    size_t next_pos = 0;
+    if (!postings.blocks.empty()) {
+        next_pos = postings.blocks[0];
+        get_varint(deltas, next_pos, next_first);
+    }
+    for (size_t block = 0; block < postings.blocks.size() && next < ids.size(); ++block) {
+        uint64_t id = next_first;
+        size_t pos = next_pos;
+        size_t end = deltas.size();
+        if (block + 1 < postings.blocks.size()) {
+            end = postings.blocks[block + 1];
+            next_pos = end;
+            get_varint(deltas, next_pos, next_first);
+            // The whole block lies below the next id wanted
+            if (next_first <= ids[next]) continue;
+        }
+        uint64_t gap = 0;
+        while (true) {
+            while (next < ids.size() && ids[next] < id) ++next;
+            if (next < ids.size() && ids[next] == id) ids[keep++] = ids[next++];
+            if (next == ids.size() || pos >= end || !get_varint(deltas, pos, gap)) break;
+            id += gap;
+        }
+    }
+    ids.resize(keep);
+}
+
+std::vector<uint32_t> SearchIndex::decode_union(const std::vector<const Postings*>& lists) {
+    std::vector<uint32_t> ids;
+    for (const Postings* postings : lists) decode(*postings, 0, ids);
+    if (lists.size() > 1) {
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    }
+    return ids;
+}
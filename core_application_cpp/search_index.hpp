@@ -0,0 +1,113 @@
+/*
+ * Time Tracker - full-text index of session descriptions
+ *
+ * time_logs.search maps every word of every description to the sessions
+ * that use it, so `search auth` finds them without reading the log. Each
+ * session gets a record id in log order, and a word's postings list is
+ * its record ids as varint deltas, a byte or two per session.
+ *
+ * The file is a snapshot (the record table and every postings list)
+ * followed by one entry per session logged since: its record and its
+ * words. A stop appends an entry without reading the rest of the file;
+ * once the entries outgrow the snapshot the file is rewritten. Like the
+ * rollup cache it tracks the logical log (see segment_store.hpp) by
+ * watermark and tail hash, and is rebuilt if the log was edited. Every
+ * process appends to the file in place, so syncs and searches hold the
+ * derived files' lock (see durable_log.hpp).
+ *
+ * Words are runs of letters, digits and non-ASCII bytes, lowercased.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+class SearchIndex {
+public:
+    struct Result {
+        size_t sessions = 0;
+        double hours = 0.0;
+        std::vector<std::string> rows; // the most recent matches, oldest first
+    };
+
+    // segment_dir holds the rows `compact` sealed out of csv_file
+    SearchIndex(fs::path csv_file, fs::path segment_dir, fs::path index_file);
+
+    // Indexes sessions logged since the last sync, or rebuilds the index if
+    // the log no longer matches it
+    void sync();
+
+    // Sessions whose description holds every term; a term ending in '*'
+    // matches any word it is a prefix of. Syncs first. At most limit rows
+    // are returned, but sessions and hours count every match.
+    Result search(const std::vector<std::string>& terms, size_t limit);
+
+    // Lowercases text into lowered and appends views of its words to words
+    static void words_of(std::string_view text, std::string& lowered, std::vector<std::string_view>& words);
+
+private:
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t watermark;   // logical log bytes covered by the index
+        uint64_t csv_size;    // CSV size and mtime when last synced
+        int64_t csv_mtime;
+        uint64_t tail_hash;   // hash of the last bytes before watermark
+        uint64_t record_count;
+        uint64_t data_bytes;     // valid bytes after the header
+        uint64_t snapshot_bytes; // of which written by the last full save
+    };
+
+    struct Record {
+        uint64_t offset;  // logical offset of the row
+        uint32_t length;  // row length without its line terminator
+        uint32_t reserved;
+        double hours;
+    };
+
+    // A word's record ids, ascending, in blocks: each block is the varint
+    // of its first id, then of the gaps to the next ones
+    struct Postings {
+        std::string deltas;
+        std::vector<uint32_t> blocks; // offset in deltas of each block
+        uint32_t last = 0;            // last record id added
+        uint32_t count = 0;
+        double hours = 0.0;           // total over its sessions
+    };
+
+    // sync() for a caller holding the lock
+    void update();
+    bool read_header(Header& header) const;
+    bool load();
+    void save_snapshot();
+    bool append_entries(const std::string& entries);
+    void write_header(std::ostream& out) const;
+    void clear();
+    void add(const Record& record, const std::vector<std::string_view>& words);
+    void scan(std::string_view text, uint64_t from, uint64_t shift,
+              const std::function<void(const Record&, const std::vector<std::string_view>&)>& found);
+    // The postings of word, or of every word it is a prefix of
+    std::vector<const Postings*> postings_for(std::string_view word, bool prefix) const;
+    static std::vector<uint32_t> decode_union(const std::vector<const Postings*>& lists);
+    // Appends the ids from block first_block on
+    static void decode(const Postings& postings, size_t first_block, std::vector<uint32_t>& ids);
+    // Keeps the ids that postings also holds, skipping blocks that cannot match
+    static void narrow(std::vector<uint32_t>& ids, const Postings& postings);
+
+    fs::path csv_file_;
+    fs::path segment_dir_;
+    fs::path index_file_;
+    bool loaded_ = false; // postings are in memory; otherwise only the header is known
+    Header header_{};
+    std::vector<Record> records_;
+    std::map<std::string, Postings, std::less<>> postings_;
+};
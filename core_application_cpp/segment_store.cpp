@@ -0,0 +1,343 @@
+#include "segment_store.hpp"
+#include "csv_tokenizer.hpp"
+#include "durable_log.hpp"
+#include "iso_time.hpp"
+#include "mapped_file.hpp"
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#ifdef TIME_TRACKER_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+constexpr const char* MANIFEST_NAME = "manifest.tsv";
+constexpr const char* MANIFEST_TITLE = "# time_tracker segments 1";
+
+#ifdef TIME_TRACKER_ZLIB
+constexpr const char* SEGMENT_SUFFIX = ".csv.gz";
+
+// gzip rather than a raw zlib stream, so `zcat` reads a segment directly
+std::string compress(std::string_view raw) {
+    if (raw.size() > UINT_MAX) throw std::runtime_error("segment too large to compress");
+    z_stream stream{};
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw std::runtime_error("Could not start compression");
+    }
+    std::string out(deflateBound(&stream, static_cast<uLong>(raw.size())) + 32, '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(raw.data()));
+    stream.avail_in = static_cast<uInt>(raw.size());
+    stream.next_out = reinterpret_cast<Bytef*>(out.data());
+    stream.avail_out = static_cast<uInt>(out.size());
+    int status = deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    if (status != Z_STREAM_END) throw std::runtime_error("Could not compress segment");
+    return out;
+}
+
+bool decompress(std::string_view stored, std::string& raw) {
+    if (stored.size() > UINT_MAX || raw.size() > UINT_MAX) return false;
+    z_stream stream{};
+    if (inflateInit2(&stream, 15 + 16) != Z_OK) return false;
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(stored.data()));
+    stream.avail_in = static_cast<uInt>(stored.size());
+    stream.next_out = reinterpret_cast<Bytef*>(raw.data());
+    stream.avail_out = static_cast<uInt>(raw.size());
+    int status = inflate(&stream, Z_FINISH);
+    bool ok = status == Z_STREAM_END && stream.total_out == raw.size();
+    inflateEnd(&stream);
+    return ok;
+}
+#else
+constexpr const char* SEGMENT_SUFFIX = ".csv";
+#endif
+
+bool ends_with(const std::string& text, std::string_view suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::string date_text(int64_t day) {
+    iso_time::CivilDate date = iso_time::civil_from_days(day);
+    char text[32];
+    std::snprintf(text, sizeof(text), "%04d-%02u-%02u", date.year, date.month, date.day);
+    return text;
+}
+
+// "2025-09" or "2025"
+std::string period_of(int64_t day, bool by_year) {
+    iso_time::CivilDate date = iso_time::civil_from_days(day);
+    char text[32];
+    if (by_year) std::snprintf(text, sizeof(text), "%04d", date.year);
+    else std::snprintf(text, sizeof(text), "%04d-%02u", date.year, date.month);
+    return text;
+}
+
+size_t header_length(std::string_view head) {
+    return csv_next_record(head, 0, false);
+}
+
+} // namespace
+
+SegmentStore::SegmentStore(fs::path csv_file, fs::path segment_dir)
+    : csv_file_(std::move(csv_file)), segment_dir_(std::move(segment_dir)) {
+    load();
+}
+
+const char* SegmentStore::compression() {
+#ifdef TIME_TRACKER_ZLIB
+    return "gzip";
+#else
+    return "none";
+#endif
+}
+
+std::vector<Segment> SegmentStore::overlapping(int64_t from_day, int64_t to_day) const {
+    std::vector<Segment> found;
+    for (const auto& segment : segments_) {
+        if (segment.last_day >= from_day && segment.first_day <= to_day) found.push_back(segment);
+    }
+    return found;
+}
+
+std::string SegmentStore::read(const Segment& segment) const {
+    METRIC_TIMER(SEGMENT_READ);
+    METRIC_ADD(SEGMENT_BYTES, segment.stored_bytes);
+    fs::path path = segment_dir_ / segment.file;
+    MappedFile stored;
+    if (!stored.open(path)) throw std::runtime_error("Missing log segment " + path.string());
+
+    std::string raw;
+    if (ends_with(segment.file, ".gz")) {
+#ifdef TIME_TRACKER_ZLIB
+        raw.resize(static_cast<size_t>(segment.raw_bytes));
+        if (!decompress(stored.view(), raw)) {
+            throw std::runtime_error("Damaged log segment " + path.string());
+        }
+#else
+        throw std::runtime_error("Built without zlib; cannot read " + path.string());
+#endif
+    } else {
+        raw.assign(stored.view());
+    }
+    if (raw.size() != segment.raw_bytes || crc32(raw.data(), raw.size()) != segment.crc) {
+        throw std::runtime_error("Damaged log segment " + path.string());
+    }
+    return raw;
+}
+
+uint64_t SegmentStore::head_start(std::string_view head) const {
+    uint64_t header = header_length(head);
+    if (trim_bytes_ > 0 && head.size() - header >= trim_bytes_ &&
+        crc32(head.data() + header, static_cast<size_t>(trim_bytes_)) == trim_crc_) {
+        return header + trim_bytes_;
+    }
+    return header;
+}
+
+uint64_t SegmentStore::logical_offset(std::string_view head, uint64_t head_pos) const {
+    if (segments_.empty()) return head_pos;
+    const Segment& last = segments_.back();
+    return head_pos - head_start(head) + last.offset + last.raw_bytes;
+}
+
+std::string SegmentStore::logical_bytes(std::string_view head, uint64_t offset, uint64_t length) const {
+    std::string bytes;
+    uint64_t header = header_length(head);
+    uint64_t sealed_end = segments_.empty() ? header : segments_.back().offset + segments_.back().raw_bytes;
+    uint64_t start = head_start(head);
+    while (length > 0) {
+        std::string_view piece;
+        if (offset < header) {
+            piece = head.substr(static_cast<size_t>(offset), static_cast<size_t>(header - offset));
+        } else if (offset < sealed_end) {
+            auto it = std::upper_bound(segments_.begin(), segments_.end(), offset,
+                                       [](uint64_t value, const Segment& s) { return value < s.offset; });
+            size_t index = static_cast<size_t>(it - segments_.begin()) - 1;
+            if (index != cached_segment_) {
+                cached_text_ = read(segments_[index]);
+                cached_segment_ = index;
+            }
+            piece = std::string_view(cached_text_).substr(static_cast<size_t>(offset - segments_[index].offset));
+        } else {
+            uint64_t head_pos = offset - sealed_end + start;
+            if (head_pos >= head.size()) break;
+            piece = head.substr(static_cast<size_t>(head_pos));
+        }
+        piece = piece.substr(0, static_cast<size_t>(std::min<uint64_t>(length, piece.size())));
+        if (piece.empty()) break;
+        bytes.append(piece);
+        offset += piece.size();
+        length -= piece.size();
+    }
+    return bytes;
+}
+
+void SegmentStore::visit(std::string_view head, uint64_t from,
+                         const std::function<void(std::string_view, uint64_t, uint64_t)>& visit) const {
+    for (const Segment& segment : segments_) {
+        if (segment.offset + segment.raw_bytes <= from) continue;
+        std::string rows = read(segment);
+        visit(rows, std::max(from, segment.offset) - segment.offset, segment.offset);
+    }
+    uint64_t start = head_start(head);
+    uint64_t sealed_end = logical_offset(head, start);
+    visit(head, std::max(from, sealed_end) - sealed_end + start, sealed_end - start);
+}
+
+SegmentStore::CompactStats SegmentStore::compact(const fs::path& journal_file, int64_t before_day, bool by_year) {
+    CompactStats stats;
+    fs::create_directories(segment_dir_);
+
+    DurableAppender csv(csv_file_, journal_file);
+    csv.rewrite([&](std::string_view head, std::string& replacement) {
+        load(); // another compaction may have run since the constructor
+        uint64_t header = header_length(head);
+        if (header == 0 || header > head.size()) return false;
+        if (header_bytes_ == 0) header_bytes_ = header;
+        uint64_t start = head_start(head);
+
+        // Cut the sealable prefix into runs of rows from the same period;
+        // undated rows go with their neighbours
+        struct Run {
+            std::string period;
+            size_t begin;
+            size_t end;
+            int64_t first_day;
+            int64_t last_day;
+            uint64_t rows;
+        };
+        std::vector<Run> runs;
+        CsvTokenizer rows(head, static_cast<size_t>(start));
+        CsvRecord row;
+        while (rows.next(row) && row.terminated) {
+            int64_t day = 0;
+            bool dated = row.fields.size() > CSV_DATE && row.fields[CSV_DATE].size() == 10 &&
+                         iso_time::parse_day(row.fields[CSV_DATE], day);
+            if (dated && day >= before_day) break;
+
+            std::string period = dated ? period_of(day, by_year) : std::string();
+            if (runs.empty() || (dated && !runs.back().period.empty() && runs.back().period != period)) {
+                runs.push_back(Run{period, row.begin, row.end, day, day, 0});
+            }
+            Run& run = runs.back();
+            if (dated) {
+                if (run.period.empty()) {
+                    run.period = period;
+                    run.first_day = run.last_day = day;
+                }
+                run.first_day = std::min(run.first_day, day);
+                run.last_day = std::max(run.last_day, day);
+            }
+            run.end = row.end;
+            ++run.rows;
+        }
+        // A run of only undated rows waits for a dated neighbour
+        if (!runs.empty() && runs.back().period.empty()) runs.pop_back();
+        if (runs.empty() && start == header) return false;
+
+        uint64_t offset = segments_.empty() ? header : segments_.back().offset + segments_.back().raw_bytes;
+        for (const Run& run : runs) {
+            std::string_view raw = head.substr(run.begin, run.end - run.begin);
+            Segment segment;
+            segment.file = run.period + SEGMENT_SUFFIX;
+            for (int copy = 1; fs::exists(segment_dir_ / segment.file); ++copy) {
+                segment.file = run.period + "." + std::to_string(copy) + SEGMENT_SUFFIX;
+            }
+#ifdef TIME_TRACKER_ZLIB
+            std::string stored = compress(raw);
+#else
+            std::string_view stored = raw;
+#endif
+            write_file_atomic(segment_dir_ / segment.file, stored);
+
+            segment.first_day = run.first_day;
+            segment.last_day = run.last_day;
+            segment.offset = offset;
+            segment.raw_bytes = raw.size();
+            segment.stored_bytes = stored.size();
+            segment.rows = run.rows;
+            segment.crc = crc32(raw.data(), raw.size());
+            segments_.push_back(segment);
+            offset += raw.size();
+
+            ++stats.segments;
+            stats.rows += run.rows;
+            stats.raw_bytes += raw.size();
+            stats.stored_bytes += stored.size();
+        }
+
+        // Record what is about to leave the head before it goes
+        size_t cut = runs.empty() ? static_cast<size_t>(start) : runs.back().end;
+        trim_bytes_ = cut - header;
+        trim_crc_ = crc32(head.data() + header, static_cast<size_t>(trim_bytes_));
+        save();
+
+        replacement.assign(head.substr(0, static_cast<size_t>(header)));
+        replacement.append(head.substr(cut));
+        return true;
+    });
+
+    if (trim_bytes_ > 0) {
+        trim_bytes_ = 0;
+        trim_crc_ = 0;
+        save();
+    }
+    cached_segment_ = static_cast<size_t>(-1);
+    return stats;
+}
+
+void SegmentStore::load() {
+    segments_.clear();
+    header_bytes_ = 0;
+    trim_bytes_ = 0;
+    trim_crc_ = 0;
+    cached_segment_ = static_cast<size_t>(-1);
+
+    std::ifstream in(segment_dir_ / MANIFEST_NAME);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string kind;
+        fields >> kind;
+        if (kind == "header") {
+            fields >> header_bytes_;
+        } else if (kind == "trim") {
+            fields >> trim_bytes_ >> std::hex >> trim_crc_;
+        } else if (kind == "segment") {
+            Segment segment;
+            std::string first, last;
+            fields >> segment.file >> first >> last >> segment.offset >> segment.raw_bytes >>
+                segment.stored_bytes >> segment.rows >> std::hex >> segment.crc;
+            if (!fields || !iso_time::parse_day(first, segment.first_day) ||
+                !iso_time::parse_day(last, segment.last_day)) {
+                throw std::runtime_error("Damaged segment manifest: " + (segment_dir_ / MANIFEST_NAME).string());
+            }
+            segments_.push_back(segment);
+        }
+    }
+}
+
+void SegmentStore::save() const {
+    std::ostringstream out;
+    out << MANIFEST_TITLE << "\n";
+    out << "# segment file first_day last_day offset raw_bytes stored_bytes rows crc32\n";
+    out << "header\t" << header_bytes_ << "\n";
+    if (trim_bytes_ > 0) out << "trim\t" << trim_bytes_ << "\t" << std::hex << trim_crc_ << std::dec << "\n";
+    for (const auto& segment : segments_) {
+        out << "segment\t" << segment.file << "\t" << date_text(segment.first_day) << "\t"
+            << date_text(segment.last_day) << "\t" << segment.offset << "\t" << segment.raw_bytes << "\t"
+            << segment.stored_bytes << "\t" << segment.rows << "\t" << std::hex << segment.crc << std::dec
+            << "\n";
+    }
+    write_file_atomic(segment_dir_ / MANIFEST_NAME, out.str());
+}
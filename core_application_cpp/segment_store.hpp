@@ -0,0 +1,107 @@
+/*
+ * Time Tracker - sealed log segments
+ *
+ * `compact` moves the leading rows of time_logs.csv that are dated before
+ * the current month into sealed, compressed segment files, one per month
+ * (or year), leaving the header and the recent rows in the CSV as the
+ * active head:
+ *
+ *   segments/manifest.tsv      one line per segment: file, date range,
+ *                              offset, sizes, row count and crc32
+ *   segments/2025-09.csv.gz    the month's rows, gzip (plain .csv when
+ *                              built without zlib)
+ *
+ * Only a prefix is ever sealed, so the header, every segment in order and
+ * then the head's rows are byte for byte the log as it was before any
+ * compaction. Offsets into that "logical log" never change, which lets
+ * the rollup cache and team push cursors carry on across a compaction;
+ * reports read only the segments whose date range can match.
+ *
+ * The manifest is written before the head is trimmed and records the
+ * bytes being trimmed; if a crash leaves them in the head, readers skip
+ * them and the next compaction finishes the trim.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct Segment {
+    std::string file;      // name inside the segment directory
+    int64_t first_day = 0; // date range of its rows, in days since 1970-01-01
+    int64_t last_day = 0;
+    uint64_t offset = 0;   // logical offset of its first row
+    uint64_t raw_bytes = 0;
+    uint64_t stored_bytes = 0;
+    uint64_t rows = 0;
+    uint32_t crc = 0;      // crc32 of the raw rows
+};
+
+class SegmentStore {
+public:
+    struct CompactStats {
+        size_t segments = 0;
+        uint64_t rows = 0;
+        uint64_t raw_bytes = 0;
+        uint64_t stored_bytes = 0;
+    };
+
+    // Loads the manifest; a missing manifest means nothing is sealed yet
+    SegmentStore(fs::path csv_file, fs::path segment_dir);
+
+    const std::vector<Segment>& segments() const { return segments_; }
+
+    // Segments whose date range overlaps from_day..to_day
+    std::vector<Segment> overlapping(int64_t from_day, int64_t to_day) const;
+
+    // A segment's rows, decompressed and checked against the manifest.
+    // Throws std::runtime_error if the file is missing or damaged.
+    std::string read(const Segment& segment) const;
+
+    // Offset in the head CSV of its first row that is not sealed
+    uint64_t head_start(std::string_view head) const;
+
+    // Logical offset of head CSV offset head_pos (at or after head_start)
+    uint64_t logical_offset(std::string_view head, uint64_t head_pos) const;
+
+    // length bytes of the logical log from offset, given the head's text;
+    // fewer at the end of the log
+    std::string logical_bytes(std::string_view head, uint64_t offset, uint64_t length) const;
+
+    // Calls visit(text, from, shift) with each segment that extends past
+    // logical offset `from` and then with the head, where text + from is
+    // where to start reading and shift maps offsets in text to logical ones
+    void visit(std::string_view head, uint64_t from,
+               const std::function<void(std::string_view text, uint64_t from, uint64_t shift)>& visit) const;
+
+    // Seals the head's leading rows dated before before_day into one
+    // segment per month (or year) and trims them from the head. Appends
+    // from every process wait on the journal lock meanwhile.
+    CompactStats compact(const fs::path& journal_file, int64_t before_day, bool by_year);
+
+    // "gzip" or "none"
+    static const char* compression();
+
+private:
+    void load();
+    void save() const;
+
+    fs::path csv_file_;
+    fs::path segment_dir_;
+    std::vector<Segment> segments_;
+    uint64_t header_bytes_ = 0; // length of the CSV header row
+    uint64_t trim_bytes_ = 0;   // sealed head bytes a crash may have left behind
+    uint32_t trim_crc_ = 0;
+
+    // The last segment read, since logical reads tend to stay in one
+    mutable size_t cached_segment_ = static_cast<size_t>(-1);
+    mutable std::string cached_text_;
+};
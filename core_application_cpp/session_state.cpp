@@ -0,0 +1,248 @@
+#include "session_state.hpp"
+
+#include <cstdint>
+#include <cstdio>
+
+namespace {
+
+void append_utf8(uint32_t code, std::string& out) {
+    if (code < 0x80) {
+        out += static_cast<char>(code);
+    } else if (code < 0x800) {
+        out += static_cast<char>(0xc0 | (code >> 6));
+        out += static_cast<char>(0x80 | (code & 0x3f));
+    } else if (code < 0x10000) {
+        out += static_cast<char>(0xe0 | (code >> 12));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (code & 0x3f));
+    } else {
+        out += static_cast<char>(0xf0 | (code >> 18));
+        out += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (code & 0x3f));
+    }
+}
+
+// Cursor over the document; every method advances past what it consumed
+class Parser {
+public:
+    explicit Parser(std::string_view text) : p_(text.data()), end_(text.data() + text.size()) {}
+
+    bool consume(char expected) {
+        skip_space();
+        if (p_ == end_ || *p_ != expected) return false;
+        ++p_;
+        return true;
+    }
+
+    // Raw key text; keys needing unescaping never match a known member
+    bool key(std::string_view& raw) {
+        if (!consume('"')) return false;
+        const char* start = p_;
+        while (p_ < end_ && *p_ != '"') p_ += (*p_ == '\\' && end_ - p_ > 1) ? 2 : 1;
+        if (p_ >= end_) return false;
+        raw = std::string_view(start, static_cast<size_t>(p_ - start));
+        ++p_;
+        return true;
+    }
+
+    // String value decoded into target; target == nullptr skips it
+    bool string(std::string* target) {
+        if (!consume('"')) return false;
+        if (target) target->clear();
+        const char* run = p_;
+        while (p_ < end_) {
+            char c = *p_;
+            if (c == '"') {
+                if (target) target->append(run, static_cast<size_t>(p_ - run));
+                ++p_;
+                return true;
+            }
+            if (c != '\\') {
+                ++p_;
+                continue;
+            }
+            if (target) target->append(run, static_cast<size_t>(p_ - run));
+            if (++p_ == end_) return false;
+            char escape = *p_++;
+            char plain = 0;
+            switch (escape) {
+            case '"':  plain = '"'; break;
+            case '\\': plain = '\\'; break;
+            case '/':  plain = '/'; break;
+            case 'b':  plain = '\b'; break;
+            case 'f':  plain = '\f'; break;
+            case 'n':  plain = '\n'; break;
+            case 'r':  plain = '\r'; break;
+            case 't':  plain = '\t'; break;
+            case 'u': {
+                uint32_t code = 0;
+                if (!hex4(code)) return false;
+                // A high surrogate followed by \uDC00-\uDFFF is one code point
+                if (code >= 0xd800 && code < 0xdc00 && end_ - p_ >= 6 && p_[0] == '\\' && p_[1] == 'u') {
+                    const char* save = p_;
+                    p_ += 2;
+                    uint32_t low = 0;
+                    if (hex4(low) && low >= 0xdc00 && low < 0xe000) {
+                        code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                    } else {
+                        p_ = save;
+                    }
+                }
+                if (target) append_utf8(code, *target);
+                break;
+            }
+            default:
+                return false;
+            }
+            if (plain && target) *target += plain;
+            run = p_;
+        }
+        return false;
+    }
+
+    // Numbers, literals, arrays and objects are stepped over without decoding
+    bool skip_value() {
+        skip_space();
+        if (p_ == end_) return false;
+        if (*p_ == '"') return string(nullptr);
+        if (*p_ != '{' && *p_ != '[') {
+            const char* start = p_;
+            while (p_ < end_ && *p_ != ',' && *p_ != '}' && *p_ != ']' &&
+                   *p_ != ' ' && *p_ != '\n' && *p_ != '\r' && *p_ != '\t') {
+                ++p_;
+            }
+            return p_ > start;
+        }
+        int depth = 0;
+        while (p_ < end_) {
+            char c = *p_;
+            if (c == '"') {
+                if (!string(nullptr)) return false;
+                continue;
+            }
+            ++p_;
+            if (c == '{' || c == '[') ++depth;
+            else if ((c == '}' || c == ']') && --depth == 0) return true;
+        }
+        return false;
+    }
+
+    bool at_end() {
+        skip_space();
+        return p_ == end_;
+    }
+
+private:
+    void skip_space() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) ++p_;
+    }
+
+    bool hex4(uint32_t& value) {
+        if (end_ - p_ < 4) return false;
+        for (int i = 0; i < 4; ++i) {
+            char c = *p_++;
+            uint32_t digit;
+            if (c >= '0' && c <= '9') digit = static_cast<uint32_t>(c - '0');
+            else if (c >= 'a' && c <= 'f') digit = static_cast<uint32_t>(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') digit = static_cast<uint32_t>(c - 'A' + 10);
+            else return false;
+            value = value << 4 | digit;
+        }
+        return true;
+    }
+
+    const char* p_;
+    const char* end_;
+};
+
+bool parse_members(Parser& parser, SessionData& session) {
+    if (!parser.consume('{')) return false;
+    if (parser.consume('}')) return parser.at_end();
+    do {
+        std::string_view key;
+        if (!parser.key(key) || !parser.consume(':')) return false;
+        std::string* target = nullptr;
+        if (key == "name") target = &session.name;
+        else if (key == "start_time") target = &session.start_time;
+        else if (key == "description") target = &session.description;
+        else if (key == "last_notification") target = &session.last_notification;
+        else if (key == "session") target = &session.session;
+        if (!(target ? parser.string(target) : parser.skip_value())) return false;
+    } while (parser.consume(','));
+    return parser.consume('}') && parser.at_end();
+}
+
+} // namespace
+
+void encode_json_string(std::string_view text, std::string& out) {
+    out += '"';
+    for (char c : text) {
+        unsigned char u = static_cast<unsigned char>(c);
+        switch (c) {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (u < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", u);
+                out += escaped;
+            } else {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+}
+
+void encode_session(const SessionData& session, std::string& out) {
+    out += "{\n  \"name\": ";
+    encode_json_string(session.name, out);
+    out += ",\n  \"start_time\": ";
+    encode_json_string(session.start_time, out);
+    out += ",\n  \"description\": ";
+    encode_json_string(session.description, out);
+    out += ",\n  \"last_notification\": ";
+    encode_json_string(session.last_notification, out);
+    out += ",\n  \"session\": ";
+    encode_json_string(session.session, out);
+    out += "\n}\n";
+}
+
+bool decode_session(std::string_view json, SessionData& session) {
+    session.name.clear();
+    session.start_time.clear();
+    session.description.clear();
+    session.last_notification.clear();
+    session.session.clear();
+
+    Parser parser(json);
+    bool complete = parse_members(parser, session);
+    session.valid = !session.start_time.empty() && !session.description.empty();
+    return complete;
+}
+
+bool load_session(const fs::path& state_file, SessionData& session) {
+    std::string text;
+#ifdef _WIN32
+    std::FILE* file = _wfopen(state_file.c_str(), L"rb");
+#else
+    std::FILE* file = std::fopen(state_file.c_str(), "rb");
+#endif
+    if (!file) {
+        decode_session({}, session);
+        return false;
+    }
+    char buffer[4096];
+    size_t n;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) text.append(buffer, n);
+    std::fclose(file);
+    if (text.empty()) {
+        decode_session({}, session);
+        return false;
+    }
+    return decode_session(text, session);
+}
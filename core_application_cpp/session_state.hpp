@@ -0,0 +1,49 @@
+/*
+ * Time Tracker - session state codec
+ *
+ * current_session.json is real JSON with escaped strings:
+ *
+ *   {
+ *     "name": "time_tracker",
+ *     "start_time": "2025-10-03T14:30:00",
+ *     "description": "Working on \"time tracker\"",
+ *     "last_notification": "2025-10-03T14:30:00",
+ *     "session": "default"
+ *   }
+ *
+ * decode_session reads it in one pass straight into a SessionData, reusing
+ * the strings' storage; unknown members are skipped. Every command and the
+ * daemon go through this one codec.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+namespace fs = std::filesystem;
+
+// Holds the active session's metadata
+struct SessionData {
+    std::string name;              // Username who started the session
+    std::string start_time;        // ISO-8601 timestamp when tracking began
+    std::string description;       // User's task description
+    std::string last_notification; // ISO-8601 timestamp of the last reminder
+    std::string session;           // Session name; several may run at once
+    bool valid = false;            // True if both start_time and description were parsed
+};
+
+// Appends text as a quoted JSON string, escaping what JSON requires
+void encode_json_string(std::string_view text, std::string& out);
+
+// Appends the session as pretty-printed JSON
+void encode_session(const SessionData& session, std::string& out);
+
+// Parses a session document. Returns false if it is not well-formed JSON;
+// members read before the error are kept, so session.valid still tells
+// whether a usable session was found.
+bool decode_session(std::string_view json, SessionData& session);
+
+// Reads and decodes a state file; session.valid is false if it is missing
+bool load_session(const fs::path& state_file, SessionData& session);
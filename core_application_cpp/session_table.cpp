@@ -0,0 +1,448 @@
+#include "session_table.hpp"
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "the session table needs address-free 64-bit atomics");
+
+namespace {
+
+constexpr char TABLE_MAGIC[4] = {'T', 'T', 'S', 'T'};
+constexpr uint32_t TABLE_VERSION = 1;
+
+struct TableHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_bytes;
+    std::atomic<uint64_t> next_ticket; // orders competing starts of one name
+    char reserved[40];
+};
+static_assert(sizeof(TableHeader) == 64, "table header must stay 64 bytes");
+
+constexpr size_t TABLE_BYTES = sizeof(TableHeader) + SessionTable::SLOT_COUNT * SessionTable::SLOT_BYTES;
+
+enum Status : uint64_t {
+    FREE = 0,
+    CLAIMING = 1,  // owner is filling the slot in
+    PUBLISHED = 2, // filled in, checking for a duplicate name
+    ACTIVE = 3,
+    STOPPING = 4,  // a stopper owns it and is about to free it
+    REJECTED = 5   // lost a name race; its owner frees it
+};
+
+// State word: status (8 bits) | time of the transition (32 bits) | generation (24 bits).
+// The time travels with the status, so an abandoned slot is recognisable
+// from the word alone.
+uint64_t status_of(uint64_t word) { return word & 0xff; }
+uint32_t time_of(uint64_t word) { return static_cast<uint32_t>(word >> 8); }
+
+uint64_t transition(uint64_t word, uint64_t status, std::time_t now) {
+    uint64_t generation = ((word >> 40) + 1) & 0xffffff;
+    return generation << 40 | static_cast<uint64_t>(static_cast<uint32_t>(now)) << 8 | status;
+}
+
+uint64_t process_id() {
+#ifdef _WIN32
+    return GetCurrentProcessId();
+#else
+    return static_cast<uint64_t>(getpid());
+#endif
+}
+
+// False once process pid has exited; 0 (a table written before owners
+// were recorded) counts as exited
+bool process_alive(uint64_t pid) {
+    if (pid == 0) return false;
+#ifdef _WIN32
+    HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, static_cast<DWORD>(pid));
+    if (!process) return GetLastError() == ERROR_ACCESS_DENIED;
+    DWORD code = 0;
+    bool alive = GetExitCodeProcess(process, &code) && code == STILL_ACTIVE;
+    CloseHandle(process);
+    return alive;
+#else
+    return kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM;
+#endif
+}
+
+void copy_field(char* target, size_t capacity, const std::string& value) {
+    size_t size = std::min(value.size(), capacity - 1);
+    // Never cut a UTF-8 sequence in half
+    if (size < value.size()) {
+        while (size > 0 && (static_cast<unsigned char>(value[size]) & 0xc0) == 0x80) --size;
+    }
+    std::memcpy(target, value.data(), size);
+    std::memset(target + size, 0, capacity - size);
+}
+
+std::string read_field(const char* field, size_t capacity) {
+    const void* end = std::memchr(field, '\0', capacity);
+    return std::string(field, end ? static_cast<const char*>(end) - field : capacity);
+}
+
+} // namespace
+
+struct SessionTable::Slot {
+    std::atomic<uint64_t> state;
+    uint64_t ticket;
+    std::atomic<uint64_t> owner; // pid of the process moving it through a transition
+    uint64_t reserved;
+    char session[SESSION_NAME_BYTES];
+    char user[64];
+    char start_time[32];
+    char last_notification[32];
+    char description[SLOT_BYTES - 32 - SESSION_NAME_BYTES - 64 - 32 - 32];
+};
+static_assert(sizeof(SessionTable::Slot) == SessionTable::SLOT_BYTES, "slot must stay SLOT_BYTES");
+
+namespace {
+
+// A slot mid-transition is abandoned once its owner has exited, so a stop
+// waiting behind a long import or compaction keeps its slot. Past
+// LIVE_OWNER_SECONDS the owner is taken to be a reused pid.
+constexpr int64_t LIVE_OWNER_SECONDS = 3600;
+
+bool abandoned(const SessionTable::Slot& slot, uint64_t word, std::time_t now) {
+    uint64_t status = status_of(word);
+    if (status == FREE || status == ACTIVE) return false;
+    int32_t age = static_cast<int32_t>(static_cast<uint32_t>(now) - time_of(word));
+    if (age <= SessionTable::ABANDON_SECONDS) return false;
+    return age > LIVE_OWNER_SECONDS || !process_alive(slot.owner.load(std::memory_order_relaxed));
+}
+
+// Copies a slot's fields and returns the state word they belong to.
+// Retries while an owner changes the slot underneath (a seqlock read).
+template <typename Copy>
+uint64_t read_consistent(const SessionTable::Slot& slot, Copy&& copy) {
+    for (;;) {
+        uint64_t before = slot.state.load();
+        copy(slot);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.state.load(std::memory_order_relaxed) == before) return before;
+    }
+}
+
+SessionData to_session(const SessionTable::Slot& slot) {
+    SessionData session;
+    session.session = read_field(slot.session, sizeof(slot.session));
+    session.name = read_field(slot.user, sizeof(slot.user));
+    session.start_time = read_field(slot.start_time, sizeof(slot.start_time));
+    session.last_notification = read_field(slot.last_notification, sizeof(slot.last_notification));
+    session.description = read_field(slot.description, sizeof(slot.description));
+    session.valid = true;
+    return session;
+}
+
+} // namespace
+
+SessionTable::SessionTable(const fs::path& table_file, Mode mode) {
+    bool writable = mode == Mode::ReadWrite;
+#ifdef _WIN32
+    HANDLE file = CreateFileW(table_file.wstring().c_str(),
+                              writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              NULL, writable ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        if (!writable) return;
+        throw std::runtime_error("Could not open " + table_file.string());
+    }
+    LARGE_INTEGER size{};
+    if (!writable && (!GetFileSizeEx(file, &size) || static_cast<size_t>(size.QuadPart) < TABLE_BYTES)) {
+        CloseHandle(file);
+        return;
+    }
+    // Grows a new or short file to the table size; new bytes are zero (all slots FREE)
+    HANDLE mapping = CreateFileMappingW(file, NULL, writable ? PAGE_READWRITE : PAGE_READONLY,
+                                        0, static_cast<DWORD>(TABLE_BYTES), NULL);
+    void* view = mapping ? MapViewOfFile(mapping, writable ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ,
+                                         0, 0, TABLE_BYTES) : NULL;
+    if (!view) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        throw std::runtime_error("Could not map " + table_file.string());
+    }
+    file_handle_ = file;
+    mapping_handle_ = mapping;
+    data_ = static_cast<char*>(view);
+#else
+    fd_ = writable ? ::open(table_file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600)
+                   : ::open(table_file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0) {
+        if (!writable) return;
+        throw std::runtime_error("Could not open " + table_file.string());
+    }
+    struct stat st;
+    bool sized = fstat(fd_, &st) == 0;
+    if (sized && static_cast<size_t>(st.st_size) < TABLE_BYTES) {
+        // Growing is idempotent, so concurrent first users need no coordination
+        sized = writable && ftruncate(fd_, TABLE_BYTES) == 0;
+    }
+    if (!sized) {
+        close();
+        if (!writable) return;
+        throw std::runtime_error("Could not size " + table_file.string());
+    }
+    void* view = mmap(nullptr, TABLE_BYTES, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                      MAP_SHARED, fd_, 0);
+    if (view == MAP_FAILED) {
+        close();
+        throw std::runtime_error("Could not map " + table_file.string());
+    }
+    data_ = static_cast<char*>(view);
+#endif
+    writable_ = writable;
+
+    // A zero-filled table is valid; stamping the header is idempotent too
+    TableHeader* header = reinterpret_cast<TableHeader*>(data_);
+    static const char zero[4] = {};
+    if (writable && std::memcmp(header->magic, zero, sizeof(zero)) == 0) {
+        header->version = TABLE_VERSION;
+        header->slot_count = SLOT_COUNT;
+        header->slot_bytes = SLOT_BYTES;
+        std::memcpy(header->magic, TABLE_MAGIC, sizeof(TABLE_MAGIC));
+    }
+    if (!writable && std::memcmp(header->magic, zero, sizeof(zero)) == 0) {
+        close(); // created but never used
+        return;
+    }
+    if (std::memcmp(header->magic, TABLE_MAGIC, sizeof(TABLE_MAGIC)) != 0 ||
+        header->version != TABLE_VERSION || header->slot_count != SLOT_COUNT ||
+        header->slot_bytes != SLOT_BYTES) {
+        close();
+        throw std::runtime_error(table_file.string() + " is not a session table this version can read");
+    }
+}
+
+SessionTable::~SessionTable() {
+    close();
+}
+
+void SessionTable::close() {
+#ifdef _WIN32
+    if (data_) {
+        FlushViewOfFile(data_, 0); // also lets directory watchers see the write
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_handle_) CloseHandle(static_cast<HANDLE>(mapping_handle_));
+    if (file_handle_) CloseHandle(static_cast<HANDLE>(file_handle_));
+    mapping_handle_ = file_handle_ = nullptr;
+#else
+    if (data_) munmap(data_, TABLE_BYTES);
+    // Closing a descriptor opened for writing is what wakes inotify watchers
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+#endif
+    data_ = nullptr;
+}
+
+SessionTable::Slot* SessionTable::slot(size_t index) const {
+    return reinterpret_cast<Slot*>(data_ + sizeof(TableHeader) + index * SLOT_BYTES);
+}
+
+bool SessionTable::valid_name(const std::string& session_name) {
+    if (session_name.empty() || session_name.size() >= SESSION_NAME_BYTES) return false;
+    for (char c : session_name) {
+        if (static_cast<unsigned char>(c) < 0x20) return false;
+    }
+    return true;
+}
+
+size_t SessionTable::max_description() {
+    return sizeof(Slot::description) - 1;
+}
+
+SessionTable::StartResult SessionTable::start(const SessionData& session) {
+    if (!writable_) throw std::logic_error("session table opened read-only");
+    if (!valid_name(session.session)) {
+        throw std::invalid_argument("session names must be 1 to " +
+                                    std::to_string(SESSION_NAME_BYTES - 1) + " bytes");
+    }
+    TableHeader* header = reinterpret_cast<TableHeader*>(data_);
+    for (;;) {
+        if (SessionData existing; find(session.session, existing)) return StartResult::AlreadyRunning;
+
+        // Claim a free (or abandoned) slot
+        std::time_t now = std::time(nullptr);
+        Slot* mine = nullptr;
+        uint64_t claimed = 0;
+        for (size_t i = 0; i < SLOT_COUNT && !mine; ++i) {
+            uint64_t word = slot(i)->state.load();
+            if (status_of(word) != FREE && !abandoned(*slot(i), word, now)) continue;
+            claimed = transition(word, CLAIMING, now);
+            if (slot(i)->state.compare_exchange_strong(word, claimed)) mine = slot(i);
+        }
+        if (!mine) return StartResult::Full;
+
+        mine->owner.store(process_id(), std::memory_order_relaxed);
+        mine->ticket = header->next_ticket.fetch_add(1);
+        copy_field(mine->session, sizeof(mine->session), session.session);
+        copy_field(mine->user, sizeof(mine->user), session.name);
+        copy_field(mine->start_time, sizeof(mine->start_time), session.start_time);
+        copy_field(mine->last_notification, sizeof(mine->last_notification), session.last_notification);
+        copy_field(mine->description, sizeof(mine->description), session.description);
+
+        uint64_t published = transition(claimed, PUBLISHED, std::time(nullptr));
+        if (!mine->state.compare_exchange_strong(claimed, published)) { // reclaimed: start over
+            METRIC_ADD(SLOT_RETRIES, 1);
+            continue;
+        }
+
+        // Look for a competing slot with the same name
+        bool lost = false;
+        for (size_t i = 0; i < SLOT_COUNT && !lost; ++i) {
+            Slot* other = slot(i);
+            if (other == mine) continue;
+            for (;;) {
+                char name[SESSION_NAME_BYTES];
+                uint64_t ticket = 0;
+                uint64_t word = read_consistent(*other, [&](const Slot& s) {
+                    std::memcpy(name, s.session, sizeof(name));
+                    ticket = s.ticket;
+                });
+                uint64_t status = status_of(word);
+                if ((status != PUBLISHED && status != ACTIVE && status != STOPPING) ||
+                    abandoned(*other, word, std::time(nullptr)) || std::strncmp(name, mine->session, sizeof(name)) != 0) {
+                    break;
+                }
+                // A session being stopped or split still counts as running
+                if (status != PUBLISHED || ticket < mine->ticket) {
+                    lost = true;
+                    break;
+                }
+                // A later competitor: make sure it can never become ACTIVE
+                if (other->state.compare_exchange_strong(word, transition(word, REJECTED, std::time(nullptr)))) break;
+                METRIC_ADD(SLOT_RETRIES, 1);
+            }
+        }
+
+        uint64_t word = published;
+        if (!lost && mine->state.compare_exchange_strong(word, transition(published, ACTIVE, std::time(nullptr)))) {
+            return StartResult::Started;
+        }
+        // Lost the race (or was rejected): give the slot back
+        word = mine->state.load();
+        mine->state.compare_exchange_strong(word, transition(word, FREE, std::time(nullptr)));
+        return StartResult::AlreadyRunning;
+    }
+}
+
+SessionTable::Slot* SessionTable::hold(const std::string& session_name, SessionData& session,
+                                       uint64_t& held) {
+    if (!writable_) throw std::logic_error("session table opened read-only");
+    for (;;) {
+        bool contended = false;
+        for (size_t i = 0; i < SLOT_COUNT; ++i) {
+            Slot* current = slot(i);
+            SessionData copy;
+            uint64_t word = read_consistent(*current, [&](const Slot& s) { copy = to_session(s); });
+            if (status_of(word) != ACTIVE || copy.session != session_name) continue;
+
+            uint64_t stopping = transition(word, STOPPING, std::time(nullptr));
+            if (!current->state.compare_exchange_strong(word, stopping)) {
+                contended = true; // changed since it was read: look again
+                METRIC_ADD(SLOT_RETRIES, 1);
+                break;
+            }
+            // The swap proves the copy was taken from this very session
+            current->owner.store(process_id(), std::memory_order_relaxed);
+            session = std::move(copy);
+            held = stopping;
+            return current;
+        }
+        if (!contended) return nullptr;
+    }
+}
+
+bool SessionTable::stop(const std::string& session_name, SessionData& session,
+                        const std::function<void(const SessionData&)>& commit) {
+    SessionData copy;
+    uint64_t stopping = 0;
+    Slot* current = hold(session_name, copy, stopping);
+    if (!current) return false;
+    try {
+        commit(copy);
+    } catch (...) {
+        current->state.compare_exchange_strong(stopping, transition(stopping, ACTIVE, std::time(nullptr)));
+        throw;
+    }
+    current->state.compare_exchange_strong(stopping, transition(stopping, FREE, std::time(nullptr)));
+    session = std::move(copy);
+    return true;
+}
+
+bool SessionTable::split(const std::string& session_name, const std::string& start_time,
+                         const std::function<void(const SessionData&)>& commit) {
+    SessionData copy;
+    uint64_t stopping = 0;
+    Slot* current = hold(session_name, copy, stopping);
+    if (!current) return false;
+    try {
+        commit(copy);
+    } catch (...) {
+        current->state.compare_exchange_strong(stopping, transition(stopping, ACTIVE, std::time(nullptr)));
+        throw;
+    }
+    // Readers ignore a STOPPING slot, so its fields can change in place
+    copy_field(current->start_time, sizeof(current->start_time), start_time);
+    copy_field(current->last_notification, sizeof(current->last_notification), start_time);
+    current->state.compare_exchange_strong(stopping, transition(stopping, ACTIVE, std::time(nullptr)));
+    return true;
+}
+
+std::vector<SessionData> SessionTable::list() const {
+    std::vector<std::pair<uint64_t, SessionData>> active;
+    if (!data_) return {};
+    for (size_t i = 0; i < SLOT_COUNT; ++i) {
+        SessionData copy;
+        uint64_t ticket = 0;
+        uint64_t word = read_consistent(*slot(i), [&](const Slot& s) {
+            if (status_of(s.state.load(std::memory_order_relaxed)) != ACTIVE) return;
+            copy = to_session(s);
+            ticket = s.ticket;
+        });
+        if (status_of(word) == ACTIVE) active.emplace_back(ticket, std::move(copy));
+    }
+    std::sort(active.begin(), active.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    std::vector<SessionData> sessions;
+    sessions.reserve(active.size());
+    for (auto& entry : active) sessions.push_back(std::move(entry.second));
+    return sessions;
+}
+
+bool SessionTable::find(const std::string& session_name, SessionData& session) const {
+    if (!data_ || session_name.size() >= SESSION_NAME_BYTES) {
+        session = SessionData();
+        return false;
+    }
+    for (size_t i = 0; i < SLOT_COUNT; ++i) {
+        const Slot& current = *slot(i);
+        bool match = false;
+        uint64_t word = read_consistent(current, [&](const Slot& s) {
+            match = std::strncmp(s.session, session_name.c_str(), sizeof(s.session)) == 0;
+            if (match) session = to_session(s);
+        });
+        if (match && status_of(word) == ACTIVE) return true;
+    }
+    session = SessionData();
+    return false;
+}
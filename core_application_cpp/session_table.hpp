@@ -0,0 +1,111 @@
+/*
+ * Time Tracker - concurrent named sessions
+ *
+ * Active sessions live in sessions.tbl, a fixed table of slots that every
+ * process maps shared and updates only with atomic compare-and-swap, so
+ * parallel start/stop calls never take a lock and never lose an update.
+ *
+ * Each slot's state word holds a status and a generation counter:
+ *
+ *   FREE -> CLAIMING -> PUBLISHED -> ACTIVE <-> STOPPING -> FREE
+ *                           \-> REJECTED -> FREE
+ *
+ * A starter claims a free slot, fills it in, publishes it and then looks
+ * for another slot with the same session name. An ACTIVE one, or a
+ * PUBLISHED one with an earlier ticket, wins; a PUBLISHED one with a
+ * later ticket is rejected. Only a starter whose own slot is still
+ * PUBLISHED can make it ACTIVE, so at most one slot per name is ever
+ * ACTIVE. A stopper owns a session once its ACTIVE -> STOPPING swap
+ * succeeds and frees the slot once the session has been logged; a split
+ * (see split) makes it ACTIVE again instead. To a starter a STOPPING slot
+ * still holds its name. Readers
+ * copy a slot and retry if its state word changed meanwhile. A slot records
+ * the process moving it through a transition; one left mid-transition is
+ * reclaimed after ABANDON_SECONDS once that process has exited.
+ */
+
+#pragma once
+
+#include "session_state.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+class SessionTable {
+public:
+    static constexpr size_t SLOT_COUNT = 64;
+    static constexpr size_t SLOT_BYTES = 1024;
+    static constexpr size_t SESSION_NAME_BYTES = 64; // including the terminating NUL
+    static constexpr int64_t ABANDON_SECONDS = 30;
+
+    enum class Mode {
+        ReadWrite, // creates the table if needed
+        ReadOnly   // never writes; a missing table reads as empty
+    };
+
+    enum class StartResult {
+        Started,
+        AlreadyRunning, // a session with this name is active
+        Full            // every slot is in use
+    };
+
+    // Maps the table. Throws std::runtime_error if a ReadWrite table
+    // cannot be opened or the file is not a session table.
+    explicit SessionTable(const fs::path& table_file, Mode mode = Mode::ReadWrite);
+    ~SessionTable();
+
+    SessionTable(const SessionTable&) = delete;
+    SessionTable& operator=(const SessionTable&) = delete;
+
+    // session.session names the slot (std::invalid_argument unless
+    // valid_name). Over-long descriptions are truncated.
+    StartResult start(const SessionData& session);
+
+    // Takes the named session out of the table and hands it to commit
+    // (which logs it) before freeing the slot. If commit throws, the session
+    // is put back and the exception propagates. False if it is not running.
+    bool stop(const std::string& session_name, SessionData& session,
+              const std::function<void(const SessionData&)>& commit);
+
+    // Hands the named session to commit (which logs its time so far), then
+    // restarts it at start_time. The slot is held throughout, so nothing
+    // can stop, split or restart the session meanwhile. If commit throws,
+    // the session is left as it was. False if it is not running.
+    bool split(const std::string& session_name, const std::string& start_time,
+               const std::function<void(const SessionData&)>& commit);
+
+    // Snapshot of the active sessions, oldest first
+    std::vector<SessionData> list() const;
+
+    bool find(const std::string& session_name, SessionData& session) const;
+
+    // 1 to SESSION_NAME_BYTES - 1 bytes, no control characters
+    static bool valid_name(const std::string& session_name);
+
+    // Longest description a slot can hold, in bytes
+    static size_t max_description();
+
+    // One slot of the mapped table; its layout is defined in session_table.cpp
+    struct Slot;
+
+private:
+    Slot* slot(size_t index) const;
+    // Moves the named ACTIVE session to STOPPING; held gets the new state word
+    Slot* hold(const std::string& session_name, SessionData& session, uint64_t& held);
+    void close();
+
+    char* data_ = nullptr;
+    bool writable_ = false;
+#ifdef _WIN32
+    void* file_handle_ = nullptr;
+    void* mapping_handle_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
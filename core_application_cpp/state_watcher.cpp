@@ -0,0 +1,108 @@
+#include "state_watcher.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Milliseconds until deadline, clamped to what the wait APIs accept
+long long millis_until(std::chrono::steady_clock::time_point deadline) {
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now()).count();
+    return std::clamp<long long>(remaining, 0, 24LL * 60 * 60 * 1000);
+}
+
+} // namespace
+
+StateWatcher::StateWatcher(const fs::path& state_file)
+    : state_file_(state_file), file_names_{state_file.filename().string()} {
+#ifdef _WIN32
+    HANDLE handle = FindFirstChangeNotificationW(
+        state_file_.parent_path().wstring().c_str(), FALSE,
+        FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE);
+    if (handle == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Could not watch " + state_file_.parent_path().string());
+    }
+    change_handle_ = handle;
+#elif defined(__linux__)
+    inotify_fd_ = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (inotify_fd_ < 0) {
+        throw std::runtime_error(std::string("inotify_init1 failed: ") + std::strerror(errno));
+    }
+    // Watch the directory: the state file is created, replaced and deleted
+    if (inotify_add_watch(inotify_fd_, state_file_.parent_path().c_str(),
+                          IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE) < 0) {
+        close(inotify_fd_);
+        throw std::runtime_error("Could not watch " + state_file_.parent_path().string());
+    }
+#endif
+}
+
+StateWatcher::~StateWatcher() {
+#ifdef _WIN32
+    if (change_handle_) FindCloseChangeNotification(change_handle_);
+#elif defined(__linux__)
+    if (inotify_fd_ >= 0) close(inotify_fd_);
+#endif
+}
+
+void StateWatcher::watch(const fs::path& file) {
+    file_names_.push_back(file.filename().string());
+}
+
+StateWatcher::Wake StateWatcher::wait_until(std::chrono::steady_clock::time_point deadline) {
+#ifdef _WIN32
+    // The directory handle also fires for the CSV and other files; callers
+    // re-read the state, which is cheap compared to waking on a timer.
+    for (;;) {
+        DWORD result = WaitForSingleObject(change_handle_, static_cast<DWORD>(millis_until(deadline)));
+        if (result == WAIT_TIMEOUT) {
+            if (std::chrono::steady_clock::now() >= deadline) return Wake::Deadline;
+            continue;
+        }
+        FindNextChangeNotification(change_handle_);
+        return Wake::Changed;
+    }
+#elif defined(__linux__)
+    alignas(struct inotify_event) char buffer[4096];
+    for (;;) {
+        struct pollfd pfd = {inotify_fd_, POLLIN, 0};
+        int ready = poll(&pfd, 1, static_cast<int>(millis_until(deadline)));
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready <= 0) {
+            if (std::chrono::steady_clock::now() >= deadline) return Wake::Deadline;
+            continue;
+        }
+
+        // Only events for the watched files themselves count as a change
+        bool changed = false;
+        ssize_t length;
+        while ((length = read(inotify_fd_, buffer, sizeof(buffer))) > 0) {
+            for (char* p = buffer; p < buffer + length;) {
+                auto* event = reinterpret_cast<struct inotify_event*>(p);
+                if (event->len > 0 && std::find(file_names_.begin(), file_names_.end(), event->name) !=
+                                          file_names_.end()) {
+                    changed = true;
+                }
+                p += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        if (changed) return Wake::Changed;
+    }
+#else
+    auto bounded = std::min(deadline, std::chrono::steady_clock::now() + std::chrono::seconds(30));
+    std::this_thread::sleep_until(bounded);
+    return bounded >= deadline ? Wake::Deadline : Wake::Changed;
+#endif
+}
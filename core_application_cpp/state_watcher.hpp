@@ -0,0 +1,47 @@
+/*
+ * Time Tracker - session state change notifications
+ *
+ * Lets the notification daemon sleep until either its next reminder is due
+ * or sessions.tbl (or another watched file, such as reminders.tsv)
+ * changes, instead of waking up periodically to poll the files. Linux uses inotify on the config directory, Windows a
+ * directory change notification handle. Other platforms fall back to a
+ * bounded sleep and report a change so the caller re-reads the state.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+class StateWatcher {
+public:
+    enum class Wake {
+        Deadline, // the deadline passed with no change to the state file
+        Changed   // a watched file was written, replaced or removed
+    };
+
+    explicit StateWatcher(const fs::path& state_file);
+    ~StateWatcher();
+
+    StateWatcher(const StateWatcher&) = delete;
+    StateWatcher& operator=(const StateWatcher&) = delete;
+
+    // Also reports changes to file, which must be in the same directory
+    void watch(const fs::path& file);
+
+    // Blocks until a watched file changes or deadline is reached
+    Wake wait_until(std::chrono::steady_clock::time_point deadline);
+
+private:
+    fs::path state_file_;
+    std::vector<std::string> file_names_;
+#ifdef _WIN32
+    void* change_handle_ = nullptr;
+#elif defined(__linux__)
+    int inotify_fd_ = -1;
+#endif
+};
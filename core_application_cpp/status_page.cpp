@@ -0,0 +1,258 @@
+#include "status_page.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "the status page needs address-free 64-bit atomics");
+
+namespace {
+
+constexpr char PAGE_MAGIC[4] = {'T', 'T', 'S', 'P'};
+constexpr uint32_t PAGE_VERSION = 1;
+
+// Copies that keep seeing a write in progress give up after this many tries
+constexpr int READ_ATTEMPTS = 64;
+
+struct PageHeader {
+    char magic[4];
+    uint32_t version;
+    std::atomic<uint64_t> sequence; // odd while the daemon writes the record
+};
+
+struct PageSession {
+    int64_t start; // UTC seconds
+    char name[StatusPage::NAME_BYTES];
+    char description[StatusPage::DESCRIPTION_BYTES];
+};
+
+// Copied as a whole, so it holds only plain bytes
+struct PageRecord {
+    int64_t daemon_pid; // 0 once retired
+    int64_t published;
+    int64_t idle_since;
+    uint32_t active;
+    uint32_t listed;
+    PageSession sessions[StatusPage::MAX_SESSIONS];
+};
+static_assert(sizeof(PageHeader) + sizeof(PageRecord) <= StatusPage::PAGE_BYTES,
+              "status record must fit in the page");
+
+PageHeader* header_of(char* data) { return reinterpret_cast<PageHeader*>(data); }
+char* record_of(char* data) { return data + sizeof(PageHeader); }
+
+void copy_field(char* target, size_t capacity, const std::string& value) {
+    size_t size = std::min(value.size(), capacity - 1);
+    // Never cut a UTF-8 sequence in half
+    if (size < value.size()) {
+        while (size > 0 && (static_cast<unsigned char>(value[size]) & 0xc0) == 0x80) --size;
+    }
+    std::memcpy(target, value.data(), size);
+    std::memset(target + size, 0, capacity - size);
+}
+
+std::string read_field(const char* field, size_t capacity) {
+    const void* end = std::memchr(field, '\0', capacity);
+    return std::string(field, end ? static_cast<const char*>(end) - field : capacity);
+}
+
+int64_t current_pid() {
+#ifdef _WIN32
+    return static_cast<int64_t>(GetCurrentProcessId());
+#else
+    return static_cast<int64_t>(getpid());
+#endif
+}
+
+bool process_alive(int64_t pid) {
+    if (pid <= 0) return false;
+#ifdef _WIN32
+    HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, static_cast<DWORD>(pid));
+    if (!process) return false;
+    bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+    CloseHandle(process);
+    return alive;
+#else
+    return kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM;
+#endif
+}
+
+} // namespace
+
+StatusPage::StatusPage(const fs::path& page_file, Mode mode) {
+    bool writable = mode == Mode::Publish;
+#ifdef _WIN32
+    HANDLE file = CreateFileW(page_file.wstring().c_str(),
+                              writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              NULL, writable ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        if (!writable) return;
+        throw std::runtime_error("Could not open " + page_file.string());
+    }
+    LARGE_INTEGER size{};
+    if (!writable && (!GetFileSizeEx(file, &size) || static_cast<size_t>(size.QuadPart) < PAGE_BYTES)) {
+        CloseHandle(file);
+        return;
+    }
+    HANDLE mapping = CreateFileMappingW(file, NULL, writable ? PAGE_READWRITE : PAGE_READONLY,
+                                        0, static_cast<DWORD>(PAGE_BYTES), NULL);
+    void* view = mapping ? MapViewOfFile(mapping, writable ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ,
+                                         0, 0, PAGE_BYTES) : NULL;
+    if (!view) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        if (!writable) return;
+        throw std::runtime_error("Could not map " + page_file.string());
+    }
+    file_handle_ = file;
+    mapping_handle_ = mapping;
+    data_ = static_cast<char*>(view);
+#else
+    fd_ = writable ? ::open(page_file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600)
+                   : ::open(page_file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0) {
+        if (!writable) return;
+        throw std::runtime_error("Could not open " + page_file.string());
+    }
+    struct stat st;
+    bool sized = fstat(fd_, &st) == 0;
+    if (sized && static_cast<size_t>(st.st_size) < PAGE_BYTES) {
+        sized = writable && ftruncate(fd_, PAGE_BYTES) == 0;
+    }
+    if (!sized) {
+        close();
+        if (!writable) return;
+        throw std::runtime_error("Could not size " + page_file.string());
+    }
+    void* view = mmap(nullptr, PAGE_BYTES, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                      MAP_SHARED, fd_, 0);
+    if (view == MAP_FAILED) {
+        close();
+        if (!writable) return;
+        throw std::runtime_error("Could not map " + page_file.string());
+    }
+    data_ = static_cast<char*>(view);
+#endif
+    writable_ = writable;
+
+    // One daemon per page, so the publisher may stamp it unconditionally
+    if (writable) {
+        PageHeader* header = header_of(data_);
+        if (std::memcmp(header->magic, PAGE_MAGIC, sizeof(PAGE_MAGIC)) != 0 ||
+            header->version != PAGE_VERSION) {
+            std::memset(record_of(data_), 0, sizeof(PageRecord));
+            header->version = PAGE_VERSION;
+            std::memcpy(header->magic, PAGE_MAGIC, sizeof(PAGE_MAGIC));
+        }
+    }
+}
+
+StatusPage::~StatusPage() {
+    close();
+}
+
+void StatusPage::close() {
+#ifdef _WIN32
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_handle_) CloseHandle(static_cast<HANDLE>(mapping_handle_));
+    if (file_handle_) CloseHandle(static_cast<HANDLE>(file_handle_));
+    mapping_handle_ = file_handle_ = nullptr;
+#else
+    if (data_) munmap(data_, PAGE_BYTES);
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+#endif
+    data_ = nullptr;
+}
+
+namespace {
+
+// The seqlock write: readers that overlap it see an odd or changed sequence
+void write_record(char* data, const PageRecord& record) {
+    PageHeader* header = header_of(data);
+    uint64_t sequence = header->sequence.load(std::memory_order_relaxed);
+    header->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(record_of(data), &record, sizeof(record));
+    header->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+} // namespace
+
+void StatusPage::publish(const Status& status) {
+    if (!writable_) return;
+    PageRecord record{};
+    record.daemon_pid = current_pid();
+    record.idle_since = static_cast<int64_t>(status.idle_since);
+    record.active = status.active;
+    record.listed = static_cast<uint32_t>(std::min(status.sessions.size(), MAX_SESSIONS));
+    for (uint32_t i = 0; i < record.listed; ++i) {
+        const Session& session = status.sessions[i];
+        record.sessions[i].start = static_cast<int64_t>(session.start);
+        copy_field(record.sessions[i].name, NAME_BYTES, session.name);
+        copy_field(record.sessions[i].description, DESCRIPTION_BYTES, session.description);
+    }
+
+    // Only this process writes the page, so reading it back needs no seqlock
+    PageRecord current;
+    std::memcpy(&current, record_of(data_), sizeof(current));
+    record.published = current.published;
+    if (std::memcmp(&record, &current, sizeof(record)) == 0) return;
+    record.published = static_cast<int64_t>(status.published ? status.published : std::time(nullptr));
+    write_record(data_, record);
+}
+
+void StatusPage::retire() {
+    if (!writable_) return;
+    PageRecord record{};
+    write_record(data_, record);
+}
+
+bool StatusPage::read(Status& status) const {
+    if (!data_) return false;
+    const PageHeader* header = header_of(data_);
+    if (std::memcmp(header->magic, PAGE_MAGIC, sizeof(PAGE_MAGIC)) != 0 || header->version != PAGE_VERSION) {
+        return false;
+    }
+
+    PageRecord record;
+    bool consistent = false;
+    for (int attempt = 0; attempt < READ_ATTEMPTS && !consistent; ++attempt) {
+        uint64_t before = header->sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+        std::memcpy(&record, record_of(data_), sizeof(record));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        consistent = header->sequence.load(std::memory_order_relaxed) == before;
+    }
+    if (!consistent || !process_alive(record.daemon_pid)) return false;
+
+    status.active = record.active;
+    status.idle_since = static_cast<std::time_t>(record.idle_since);
+    status.published = static_cast<std::time_t>(record.published);
+    status.sessions.clear();
+    for (uint32_t i = 0; i < std::min<uint32_t>(record.listed, MAX_SESSIONS); ++i) {
+        const PageSession& session = record.sessions[i];
+        status.sessions.push_back(Session{read_field(session.name, NAME_BYTES),
+                                          read_field(session.description, DESCRIPTION_BYTES),
+                                          static_cast<std::time_t>(session.start)});
+    }
+    return true;
+}
@@ -0,0 +1,78 @@
+/*
+ * Time Tracker - shared-memory status page for prompts and status bars
+ *
+ * The daemon keeps status.page, one fixed-layout page mapped shared, in
+ * step with the session table and its idle state. Readers map it
+ * read-only and copy it under a seqlock: the sequence word is odd while
+ * the daemon writes, and a copy is kept only if the word was even and
+ * unchanged across it. Reading needs no lock, no parsing and no request
+ * to the daemon, so polling it many times a second costs next to nothing.
+ *
+ * The daemon is the only writer. It clears the page when it exits; a
+ * page left by a daemon that died is recognised by its process ID.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+class StatusPage {
+public:
+    static constexpr size_t PAGE_BYTES = 4096;
+    static constexpr size_t MAX_SESSIONS = 8;      // further sessions are only counted
+    static constexpr size_t NAME_BYTES = 64;        // including the terminating NUL
+    static constexpr size_t DESCRIPTION_BYTES = 128;
+
+    struct Session {
+        std::string name;
+        std::string description; // truncated to DESCRIPTION_BYTES - 1
+        std::time_t start = 0;
+    };
+
+    struct Status {
+        uint32_t active = 0;        // running sessions, possibly more than listed
+        std::time_t idle_since = 0; // last input before the user went away; 0 while active
+        std::time_t published = 0;
+        std::vector<Session> sessions; // oldest first, at most MAX_SESSIONS
+    };
+
+    enum class Mode {
+        Publish, // the daemon: creates the page and writes it
+        Read     // never writes; a missing page reads as unpublished
+    };
+
+    // Throws std::runtime_error if a Publish page cannot be mapped
+    StatusPage(const fs::path& page_file, Mode mode);
+    ~StatusPage();
+
+    StatusPage(const StatusPage&) = delete;
+    StatusPage& operator=(const StatusPage&) = delete;
+
+    // Replaces the page; a status equal to the last one is not rewritten
+    void publish(const Status& status);
+
+    // Marks the page as no longer maintained (the daemon is exiting)
+    void retire();
+
+    // False unless a running daemon has published the page
+    bool read(Status& status) const;
+
+private:
+    void close();
+
+    char* data_ = nullptr;
+    bool writable_ = false;
+#ifdef _WIN32
+    void* file_handle_ = nullptr;
+    void* mapping_handle_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
@@ -0,0 +1,351 @@
+/*
+ * Time Tracker - concurrency stress run
+ *
+ * Runs thousands of start, stop, status, report and search commands at
+ * once against one scratch HOME: worker threads run them in this process
+ * (as the in-process fallback does) while an in-process daemon serves the
+ * same commands to other workers over its control channel, with its
+ * notification loop watching the session table. Half the sessions are a
+ * worker's own and half are shared, so starts and stops race for names.
+ *
+ * Once the workers are done it checks what the log must look like:
+ *
+ *   - every row parses, and there is one per successful stop
+ *   - the sessions still running are the starts that were never stopped,
+ *     with no name running twice
+ *   - the date index points at each day's rows exactly once
+ *   - the rollup cache and the search index on disk agree with a scan
+ *
+ * Results are JSON lines like the benchmark's: latency and throughput per
+ * command, then the contention the metrics saw (file-lock waits and lost
+ * session-table swaps). The exit status is 1 if a check failed.
+ *
+ * `make stress` builds it with ThreadSanitizer and runs it, so a data race
+ * fails the run too (STRESS_THREADS and STRESS_OPERATIONS size it).
+ *
+ * ./time_tracker_stress.exe [--threads N] [--operations N] [--output results.jsonl]
+ */
+
+#define TIME_TRACKER_NO_MAIN
+#include "time_tracker.cpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+
+namespace {
+
+// Swallows command output
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+};
+
+enum Operation { START, STOP, STATUS, REPORT, SEARCH, OPERATION_COUNT };
+const char* const OPERATION_NAMES[OPERATION_COUNT] = {"start", "stop", "status", "report", "search"};
+constexpr size_t SHARED_SESSIONS = 4;
+
+struct Options {
+    unsigned threads = 8;
+    size_t operations = 500; // per thread
+    std::string output;
+};
+
+struct Worker {
+    std::vector<double> samples[OPERATION_COUNT]; // microseconds
+    uint64_t starts = 0; // successful
+    uint64_t stops = 0;
+    uint64_t errors = 0; // commands that threw or could not reach the daemon
+};
+
+void set_env(const char* name, const std::string& value) {
+#ifdef _WIN32
+    _putenv_s(name, value.c_str());
+#else
+    setenv(name, value.c_str(), 1);
+#endif
+}
+
+class Results {
+public:
+    explicit Results(const std::string& path) {
+        if (!path.empty()) {
+            file_.open(path, std::ios::app);
+            if (!file_) throw std::runtime_error("Could not open " + path);
+        }
+    }
+
+    void print(const std::string& line) {
+        std::fputs(line.c_str(), stdout);
+        std::fflush(stdout);
+        if (file_.is_open()) file_ << line << std::flush;
+    }
+
+    // samples in microseconds, taken over seconds of wall time on every thread
+    void record(const char* name, unsigned threads, std::vector<double> samples, double seconds) {
+        if (samples.empty()) return;
+        std::sort(samples.begin(), samples.end());
+        auto percentile = [&samples](double p) {
+            return samples[std::min(samples.size() - 1, static_cast<size_t>(p * samples.size()))];
+        };
+        char line[512];
+        std::snprintf(line, sizeof(line),
+                      "{\"stress\":\"%s\",\"threads\":%u,\"operations\":%zu,\"p50_us\":%.2f,"
+                      "\"p99_us\":%.2f,\"max_us\":%.2f,\"throughput\":%.2f,\"unit\":\"ops/s\"}\n",
+                      name, threads, samples.size(), percentile(0.50), percentile(0.99), samples.back(),
+                      seconds > 0.0 ? samples.size() / seconds : 0.0);
+        print(line);
+    }
+
+private:
+    std::ofstream file_;
+};
+
+// Runs one command in this process, or through the daemon when remote
+int run(TimeTracker& tracker, const std::string& endpoint, bool remote, const std::vector<std::string>& args,
+        Worker& worker) {
+    try {
+        if (!remote) return run_command(tracker, args);
+        std::string response;
+        int exit_code = 1;
+        if (control_call(endpoint, args, response, exit_code)) return exit_code;
+    } catch (const std::exception&) {
+    }
+    ++worker.errors;
+    return -1;
+}
+
+void work(unsigned id, const Options& options, const std::string& endpoint, const std::string& today,
+          Worker& worker) {
+    NullBuffer discarded;
+    std::ostream output(&discarded);
+    TimeTracker tracker;
+    tracker.set_output(output);
+    bool remote = id % 2 == 1;
+
+    std::mt19937 random(id + 1);
+    std::string own = "worker" + std::to_string(id);
+    for (size_t i = 0; i < options.operations; ++i) {
+        // Starts and stops twice as often as the rest, on a shared name half the time
+        unsigned pick = random() % 7;
+        Operation operation = pick < 2 ? START : pick < 4 ? STOP : static_cast<Operation>(pick - 2);
+        std::string name = random() % 2 ? own : "shared" + std::to_string(random() % SHARED_SESSIONS);
+        std::vector<std::string> args;
+        switch (operation) {
+        case START:  args = {"start", "--session", name, "stress", own, "step", std::to_string(i)}; break;
+        case STOP:   args = {"stop", name}; break;
+        case STATUS: args = {"status"}; break;
+        case REPORT:
+            // Daily reports read through the date index the stops are appending to
+            if (i % 2) args = {"report", today};
+            else args = {"report", "--from", today, "--to", today};
+            break;
+        case SEARCH: args = {"search", "stress"}; break;
+        default:     break;
+        }
+        auto begin = std::chrono::steady_clock::now();
+        int exit_code = run(tracker, endpoint, remote, args, worker);
+        worker.samples[operation].push_back(
+            std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count());
+        if (exit_code == 0 && operation == START) ++worker.starts;
+        if (exit_code == 0 && operation == STOP) ++worker.stops;
+    }
+}
+
+// Checks the log and its caches once every worker is done; prints what is wrong
+bool check(const fs::path& config_dir, uint64_t starts, uint64_t stops, int64_t today) {
+    bool ok = true;
+    auto fail = [&ok](const std::string& message) {
+        std::fprintf(stderr, "FAIL: %s\n", message.c_str());
+        ok = false;
+    };
+
+    fs::path csv_file = config_dir / "time_logs.csv";
+    uint64_t rows = 0;
+    std::map<std::string, std::vector<size_t>> rows_by_date; // offsets of each day's rows
+    {
+        MappedFile csv(csv_file);
+        CsvTokenizer tokens(csv.view(), csv_next_record(csv.view(), 0, false));
+        CsvRecord record;
+        LogRow row;
+        while (tokens.next(record)) {
+            if (!record.terminated || !parse_log_row(record, row)) {
+                fail("bad row at offset " + std::to_string(record.begin) + ": " + std::string(record.line));
+            }
+            rows_by_date[std::string(row.date)].push_back(record.begin);
+            ++rows;
+        }
+    }
+    if (rows != stops) fail(std::to_string(rows) + " rows logged for " + std::to_string(stops) + " stops");
+
+    // The index the stops and reports kept in sync must hold each row once
+    for (const auto& day : rows_by_date) {
+        std::vector<size_t> indexed;
+        MappedFile csv(csv_file);
+        for (const auto& range : LogIndex(csv_file, config_dir / "time_logs.idx").find(day.first)) {
+            std::string_view text = csv.view().substr(0, range.end);
+            CsvTokenizer tokens(text, range.begin);
+            CsvRecord record;
+            while (tokens.next(record)) indexed.push_back(record.begin);
+        }
+        std::sort(indexed.begin(), indexed.end());
+        if (indexed != day.second) {
+            fail("date index holds " + std::to_string(indexed.size()) + " rows for " + day.first + " of " +
+                 std::to_string(day.second.size()));
+        }
+    }
+
+    std::vector<SessionData> running = SessionTable(config_dir / "sessions.tbl", SessionTable::Mode::ReadOnly).list();
+    if (running.size() != starts - stops) {
+        fail(std::to_string(running.size()) + " sessions running after " + std::to_string(starts) +
+             " starts and " + std::to_string(stops) + " stops");
+    }
+    std::set<std::string> names;
+    for (const auto& session : running) {
+        if (!names.insert(session.session).second) fail("session '" + session.session + "' is running twice");
+    }
+
+    // Loaded from the files the workers left, then synced with any rows they missed
+    std::vector<GroupTotal> scanned = aggregate_range(csv_file, today - 1, today, GroupBy::Day);
+    std::vector<GroupTotal> cached =
+        RollupCache(csv_file, config_dir / "segments", config_dir / "time_logs.rollup").totals(today - 1, today, GroupBy::Day);
+    size_t scanned_entries = 0, cached_entries = 0;
+    for (const auto& group : scanned) scanned_entries += group.entries;
+    for (const auto& group : cached) cached_entries += group.entries;
+    if (scanned_entries != rows || cached_entries != rows) {
+        fail("rollup counts " + std::to_string(cached_entries) + " entries and a scan " +
+             std::to_string(scanned_entries) + " for " + std::to_string(rows) + " rows");
+    }
+    SearchIndex::Result found =
+        SearchIndex(csv_file, config_dir / "segments", config_dir / "time_logs.search").search({"stress"}, 0);
+    if (found.sessions != rows) {
+        fail("search finds " + std::to_string(found.sessions) + " of " + std::to_string(rows) + " rows");
+    }
+    return ok;
+}
+
+int run_stress(const Options& options) {
+    fs::path home = fs::temp_directory_path() / "time_tracker_stress";
+    fs::remove_all(home);
+    fs::create_directories(home / ".time_tracker");
+    set_env("HOME", home.string());
+    set_env("USERPROFILE", home.string());
+    fs::path config_dir = home / ".time_tracker";
+    std::string endpoint = control_endpoint(config_dir);
+
+    // The daemon serves the remote workers; the notification loop it starts
+    // is detached, so the daemon's tracker lives until the process exits
+    TimeTracker* daemon = new TimeTracker;
+    NullBuffer discarded;
+    std::ostream daemon_output(&discarded);
+    daemon->set_output(daemon_output);
+    daemon->setup_directories();
+    std::thread daemon_thread([daemon] { daemon->run_daemon(); });
+    std::string response;
+    int exit_code = 0;
+    for (int attempt = 0; !control_call(endpoint, {"ping"}, response, exit_code); ++attempt) {
+        if (attempt == 500) throw std::runtime_error("The in-process daemon did not come up");
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    std::string today = TimeTracker().get_current_date();
+    std::vector<Worker> workers(options.threads);
+    std::vector<std::thread> threads;
+    auto begin = std::chrono::steady_clock::now();
+    for (unsigned id = 0; id < options.threads; ++id) {
+        threads.emplace_back(work, id, std::cref(options), std::cref(endpoint), std::cref(today),
+                             std::ref(workers[id]));
+    }
+    for (auto& thread : threads) thread.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    control_call(endpoint, {"shutdown"}, response, exit_code);
+    daemon_thread.join();
+
+    Results results(options.output);
+    std::vector<double> all;
+    uint64_t starts = 0, stops = 0, errors = 0;
+    for (unsigned operation = 0; operation < OPERATION_COUNT; ++operation) {
+        std::vector<double> samples;
+        for (const auto& worker : workers) {
+            samples.insert(samples.end(), worker.samples[operation].begin(), worker.samples[operation].end());
+        }
+        all.insert(all.end(), samples.begin(), samples.end());
+        results.record(OPERATION_NAMES[operation], options.threads, std::move(samples), seconds);
+    }
+    results.record("all", options.threads, std::move(all), seconds);
+    for (const auto& worker : workers) {
+        starts += worker.starts;
+        stops += worker.stops;
+        errors += worker.errors;
+    }
+
+    metrics::Snapshot seen = metrics::snapshot();
+    const metrics::Histogram& lock_wait = seen.timers[metrics::LOCK_WAIT];
+    char line[512];
+    std::snprintf(line, sizeof(line),
+                  "{\"stress\":\"contention\",\"threads\":%u,\"starts\":%llu,\"stops\":%llu,\"errors\":%llu,"
+                  "\"lock_waits\":%llu,\"lock_wait_p99_us\":%.2f,\"lock_wait_max_us\":%.2f,"
+                  "\"slot_retries\":%llu,\"metrics\":%s}\n",
+                  options.threads, static_cast<unsigned long long>(starts), static_cast<unsigned long long>(stops),
+                  static_cast<unsigned long long>(errors),
+                  static_cast<unsigned long long>(seen.counters[metrics::LOCK_WAITS]),
+                  lock_wait.percentile(0.99) / 1e3, lock_wait.max_ns / 1e3,
+                  static_cast<unsigned long long>(seen.counters[metrics::SLOT_RETRIES]),
+                  metrics::ENABLED ? "true" : "false");
+    results.print(line);
+
+    int64_t today_day = 0;
+    iso_time::parse_day(today, today_day);
+    bool ok = check(config_dir, starts, stops, today_day);
+    if (errors > 0) {
+        std::fprintf(stderr, "FAIL: %llu commands failed\n", static_cast<unsigned long long>(errors));
+        ok = false;
+    }
+    if (ok) fs::remove_all(home);
+    else std::fprintf(stderr, "The log and its caches are left in %s\n", home.string().c_str());
+    return ok ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--threads" && i + 1 < argc) {
+                options.threads = std::max(1u, static_cast<unsigned>(std::stoul(argv[++i])));
+            } else if (arg == "--operations" && i + 1 < argc) {
+                options.operations = std::max(1ul, std::stoul(argv[++i]));
+            } else if (arg == "--output" && i + 1 < argc) {
+                options.output = argv[++i];
+            } else {
+                std::cerr << "Usage: " << argv[0] << " [--threads N] [--operations N] [--output results.jsonl]\n";
+                return 1;
+            }
+        }
+
+        // Workers run commands here unless they mean to reach the daemon,
+        // and nothing reaches the desktop
+        set_env("TIME_TRACKER_NO_DAEMON", "1");
+        set_env("DBUS_SESSION_BUS_ADDRESS", "unix:path=/nonexistent");
+        set_env("PATH", "");
+#ifndef _WIN32
+        // With TZ unset glibc replaces its copy of the zone name on every
+        // mktime, under a lock ThreadSanitizer cannot see
+        if (!getenv("TZ")) set_env("TZ", ":/etc/localtime");
+#endif
+
+        // Notifications with no desktop to show them print here
+        NullBuffer discarded;
+        std::streambuf* console = std::cout.rdbuf(&discarded);
+        int exit_code = run_stress(options);
+        std::cout.rdbuf(console);
+        return exit_code;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
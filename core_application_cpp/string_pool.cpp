@@ -0,0 +1,57 @@
+#include "string_pool.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Strings are packed into blocks of this size; longer ones get their own
+constexpr size_t BLOCK_BYTES = 64 << 10;
+
+} // namespace
+
+uint32_t StringPool::intern(std::string_view text) {
+    auto found = ids_.find(text);
+    if (found != ids_.end()) return found->second;
+    uint32_t id = static_cast<uint32_t>(strings_.size());
+    strings_.push_back(copy(text));
+    ids_.emplace(strings_.back(), id);
+    return id;
+}
+
+bool StringPool::find(std::string_view text, uint32_t& id) const {
+    auto found = ids_.find(text);
+    if (found == ids_.end()) return false;
+    id = found->second;
+    return true;
+}
+
+void StringPool::clear() {
+    blocks_.clear();
+    block_used_ = 0;
+    block_size_ = 0;
+    strings_.clear();
+    ids_.clear();
+}
+
+std::string_view StringPool::copy(std::string_view text) {
+    if (text.empty()) return std::string_view();
+    if (block_size_ - block_used_ < text.size()) {
+        // A long string gets a block of its own, behind the current one
+        size_t size = std::max(BLOCK_BYTES, text.size());
+        auto block = std::make_unique<char[]>(size);
+        if (size > BLOCK_BYTES) {
+            std::memcpy(block.get(), text.data(), text.size());
+            std::string_view stored(block.get(), text.size());
+            blocks_.insert(blocks_.end() - (blocks_.empty() ? 0 : 1), std::move(block));
+            return stored;
+        }
+        blocks_.push_back(std::move(block));
+        block_used_ = 0;
+        block_size_ = size;
+    }
+    char* target = blocks_.back().get() + block_used_;
+    std::memcpy(target, text.data(), text.size());
+    block_used_ += text.size();
+    return std::string_view(target, text.size());
+}
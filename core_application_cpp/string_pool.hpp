@@ -0,0 +1,52 @@
+/*
+ * Time Tracker - interned strings in an arena
+ *
+ * The report paths see the same few descriptions and user names on
+ * millions of rows. A StringPool keeps one copy of each distinct string,
+ * packed into large blocks rather than one heap allocation per string,
+ * and hands out small ids and string_views that stay valid as long as
+ * the pool. Looking up a string that is already interned allocates
+ * nothing.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class StringPool {
+public:
+    StringPool() = default;
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+    StringPool(StringPool&&) = default;
+    StringPool& operator=(StringPool&&) = default;
+
+    // Id of text, copying it into the pool the first time it is seen.
+    // Ids are handed out in order from 0.
+    uint32_t intern(std::string_view text);
+
+    // Id of text if it is interned
+    bool find(std::string_view text, uint32_t& id) const;
+
+    // The interned copy of text
+    std::string_view view(std::string_view text) { return strings_[intern(text)]; }
+
+    std::string_view at(uint32_t id) const { return strings_[id]; }
+    size_t size() const { return strings_.size(); }
+
+    void clear();
+
+private:
+    std::string_view copy(std::string_view text);
+
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    size_t block_used_ = 0;
+    size_t block_size_ = 0;
+    std::vector<std::string_view> strings_;
+    std::unordered_map<std::string_view, uint32_t> ids_;
+};
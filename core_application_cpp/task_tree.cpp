@@ -0,0 +1,171 @@
+#include "task_tree.hpp"
+
+#include <algorithm>
+
+namespace {
+
+constexpr size_t INITIAL_SLOTS = 64;
+constexpr std::string_view UNTITLED = "(no description)";
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t';
+}
+
+// Tags run over letters, digits, "-_./" and any non-ASCII byte
+bool is_tag_char(char c) {
+    unsigned char u = static_cast<unsigned char>(c);
+    return u >= 0x80 || (u >= '0' && u <= '9') || ((u | 0x20) >= 'a' && (u | 0x20) <= 'z') ||
+           c == '-' || c == '_' || c == '.' || c == '/';
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && is_space(text.front())) text.remove_prefix(1);
+    while (!text.empty() && is_space(text.back())) text.remove_suffix(1);
+    return text;
+}
+
+// FNV-1a over the label, seeded with the parent, then mixed so the low
+// bits (the slot) and high bits (the check) are independent
+uint64_t edge_hash(uint32_t parent, std::string_view label) {
+    uint64_t hash = 1469598103934665603ULL ^ parent;
+    for (char c : label) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+} // namespace
+
+void parse_task_path(std::string_view description, TaskPath& path) {
+    path.segments.clear();
+    path.tags.clear();
+    path.text.clear();
+    path.text.reserve(description.size()); // segments view it, so it must not move
+
+    // Copy the description without "#tag" words
+    if (description.find('#') == std::string_view::npos) path.text.assign(description);
+    for (size_t i = path.text.size(); i < description.size();) {
+        bool word_start = i == 0 || is_space(description[i - 1]);
+        if (word_start && description[i] == '#' && i + 1 < description.size() && is_tag_char(description[i + 1])) {
+            size_t end = i + 1;
+            while (end < description.size() && is_tag_char(description[end])) ++end;
+            path.tags.push_back(description.substr(i + 1, end - i - 1));
+            i = end;
+            while (i < description.size() && is_space(description[i])) ++i;
+            continue;
+        }
+        path.text += description[i++];
+    }
+
+    // Then split it at every ':' that a space or the end follows
+    std::string_view text = path.text;
+    size_t begin = 0;
+    for (size_t i = 0; i <= text.size(); ++i) {
+        bool separator = i < text.size() && text[i] == ':' && (i + 1 == text.size() || is_space(text[i + 1]));
+        if (i < text.size() && !separator) continue;
+        std::string_view segment = trim(text.substr(begin, i - begin));
+        if (!segment.empty()) path.segments.push_back(segment);
+        begin = i + 1;
+    }
+    if (path.segments.empty()) path.segments.push_back(UNTITLED);
+}
+
+TaskTree::TaskTree() : nodes_(1), slots_(INITIAL_SLOTS, Slot{0, 0}) {}
+
+void TaskTree::add(std::string_view description, double hours, uint64_t entries) {
+    parse_task_path(description, path_);
+    nodes_[ROOT].hours += hours;
+    nodes_[ROOT].entries += entries;
+    uint32_t parent = ROOT;
+    for (std::string_view segment : path_.segments) {
+        parent = child(parent, segment);
+        nodes_[parent].hours += hours;
+        nodes_[parent].entries += entries;
+    }
+
+    for (std::string_view tag : path_.tags) {
+        uint32_t id = tag_names_.intern(tag);
+        if (id == tag_totals_.size()) tag_totals_.push_back(GroupTotal{std::string(tag), 0.0, 0});
+        tag_totals_[id].hours += hours;
+        tag_totals_[id].entries += entries;
+    }
+}
+
+uint32_t TaskTree::child(uint32_t parent, std::string_view label) {
+    if (nodes_.size() * 2 >= slots_.size()) grow();
+    uint64_t hash = edge_hash(parent, label);
+    uint32_t check = static_cast<uint32_t>(hash >> 32);
+    size_t mask = slots_.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        Slot& slot = slots_[i];
+        if (slot.node == 0) {
+            uint32_t id = static_cast<uint32_t>(nodes_.size());
+            Node node;
+            node.parent = parent;
+            node.depth = nodes_[parent].depth + 1;
+            node.label = labels_.view(label);
+            nodes_.push_back(node);
+            slot = Slot{id, check};
+            return id;
+        }
+        if (slot.check == check) {
+            const Node& node = nodes_[slot.node];
+            if (node.parent == parent && node.label == label) return slot.node;
+        }
+    }
+}
+
+void TaskTree::grow() {
+    std::vector<Slot> slots(slots_.size() * 2, Slot{0, 0});
+    size_t mask = slots.size() - 1;
+    for (uint32_t id = 1; id < nodes_.size(); ++id) {
+        uint64_t hash = edge_hash(nodes_[id].parent, nodes_[id].label);
+        size_t i = hash & mask;
+        while (slots[i].node != 0) i = (i + 1) & mask;
+        slots[i] = Slot{id, static_cast<uint32_t>(hash >> 32)};
+    }
+    slots_.swap(slots);
+}
+
+std::vector<uint32_t> TaskTree::preorder() const {
+    // Group the children by parent (a counting sort), then order each group
+    size_t count = nodes_.size();
+    std::vector<uint32_t> first(count + 1, 0);
+    for (uint32_t id = 1; id < count; ++id) ++first[nodes_[id].parent + 1];
+    for (size_t i = 0; i < count; ++i) first[i + 1] += first[i];
+    std::vector<uint32_t> children(count - 1);
+    std::vector<uint32_t> fill(first.begin(), first.end() - 1);
+    for (uint32_t id = 1; id < count; ++id) children[fill[nodes_[id].parent]++] = id;
+
+    auto before = [&](uint32_t a, uint32_t b) {
+        if (nodes_[a].hours != nodes_[b].hours) return nodes_[a].hours > nodes_[b].hours;
+        return nodes_[a].label < nodes_[b].label;
+    };
+    for (size_t parent = 0; parent < count; ++parent) {
+        std::sort(children.begin() + first[parent], children.begin() + first[parent + 1], before);
+    }
+
+    std::vector<uint32_t> order;
+    order.reserve(count - 1);
+    std::vector<uint32_t> pending(children.rend() - first[1], children.rend());
+    while (!pending.empty()) {
+        uint32_t id = pending.back();
+        pending.pop_back();
+        order.push_back(id);
+        for (uint32_t i = first[id + 1]; i > first[id]; --i) pending.push_back(children[i - 1]);
+    }
+    return order;
+}
+
+std::vector<GroupTotal> TaskTree::tags() const {
+    std::vector<GroupTotal> tags = tag_totals_;
+    std::sort(tags.begin(), tags.end(), [](const GroupTotal& a, const GroupTotal& b) {
+        if (a.hours != b.hours) return a.hours > b.hours;
+        return a.key < b.key;
+    });
+    return tags;
+}
@@ -0,0 +1,84 @@
+/*
+ * Time Tracker - project/task hierarchy of descriptions
+ *
+ * A description written "project: task", or deeper as "client: project:
+ * task", is read as a path. A colon only separates when a space (or the
+ * end) follows it, so "1:1 with manager" and "10:30 sync" stay whole.
+ * Words starting with '#' are tags: they are taken out of the path and
+ * totalled on their own, so "api: fix login #bug" counts towards
+ * api > fix login and towards #bug.
+ *
+ * A TaskTree adds hours up along every path in one pass. Its nodes live
+ * in one flat array and its edges in one open-addressing table keyed by
+ * (parent, label), so adding a row costs a few probes of contiguous
+ * memory per level rather than a walk through nested maps, however many
+ * distinct tasks there are.
+ */
+
+#pragma once
+
+#include "range_report.hpp"
+#include "string_pool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct TaskPath {
+    std::vector<std::string_view> segments; // project first; views into text
+    std::vector<std::string_view> tags;     // without the '#'; views into the description
+    std::string text;                       // the description without its tags
+};
+
+// Splits description into its path and tags
+void parse_task_path(std::string_view description, TaskPath& path);
+
+class TaskTree {
+public:
+    static constexpr uint32_t ROOT = 0;
+
+    struct Node {
+        uint32_t parent = ROOT;
+        uint32_t depth = 0;     // 1 for projects
+        std::string_view label; // interned in the tree
+        double hours = 0.0;     // the node's own rows and its descendants'
+        uint64_t entries = 0;
+    };
+
+    TaskTree();
+    TaskTree(const TaskTree&) = delete;
+    TaskTree& operator=(const TaskTree&) = delete;
+
+    // Counts hours and entries towards every node on the description's
+    // path, the root included, and towards its tags
+    void add(std::string_view description, double hours, uint64_t entries = 1);
+
+    const Node& node(uint32_t id) const { return nodes_[id]; }
+    const Node& root() const { return nodes_[ROOT]; }
+    size_t size() const { return nodes_.size() - 1; } // without the root
+
+    // Every node but the root, depth first; siblings by hours, most first,
+    // then by label
+    std::vector<uint32_t> preorder() const;
+
+    // Totals per tag, keyed without the '#', sorted like siblings
+    std::vector<GroupTotal> tags() const;
+
+private:
+    struct Slot {
+        uint32_t node; // 0 (the root, never a child) while empty
+        uint32_t check; // high hash bits, to skip most label compares
+    };
+
+    uint32_t child(uint32_t parent, std::string_view label);
+    void grow();
+
+    std::vector<Node> nodes_;
+    std::vector<Slot> slots_; // a power of two, at most half full
+    StringPool labels_;
+    StringPool tag_names_;
+    std::vector<GroupTotal> tag_totals_; // by tag id in tag_names_
+    TaskPath path_;                      // scratch for add()
+};
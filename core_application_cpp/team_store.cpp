@@ -0,0 +1,142 @@
+#include "team_store.hpp"
+#include "csv_tokenizer.hpp"
+#include "iso_time.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+namespace {
+
+std::string day_label(int64_t day) {
+    iso_time::CivilDate date = iso_time::civil_from_days(day);
+    char label[32];
+    std::snprintf(label, sizeof(label), "%04d-%02u-%02u", date.year, date.month, date.day);
+    return label;
+}
+
+std::string week_label(int64_t day) {
+    iso_time::IsoWeek week = iso_time::iso_week(day);
+    char label[32];
+    std::snprintf(label, sizeof(label), "%04d-W%02u", week.year, week.week);
+    return label;
+}
+
+} // namespace
+
+TeamStore::PushResult TeamStore::push(const std::string& client, uint64_t from, std::string_view tail,
+                                      std::string_view csv, size_t& rows) {
+    rows = 0;
+    Client& state = clients_[client];
+    if (from != state.cursor) return PushResult::WrongOffset;
+    if (tail != state.tail) return PushResult::Diverged;
+
+    CsvTokenizer tokenizer(csv);
+    CsvRecord row;
+    LogRow logged;
+    size_t consumed = 0;
+    std::string_view user_name; // interned
+    uint32_t user = 0;
+    bool have_user = false;
+    while (tokenizer.next(row) && row.terminated) {
+        consumed = row.end;
+        // The column header opens every log
+        if (from == 0 && row.begin == 0) continue;
+        ++rows;
+        if (!parse_log_row(row, logged)) continue;
+
+        // A client's rows are nearly always its own user's
+        if (!have_user || logged.name != user_name) {
+            user = users_.intern(logged.name);
+            user_name = users_.at(user);
+            have_user = true;
+        }
+        add(logged.day, user, logged.hours, 1);
+        Totals& added = state.added[{logged.day, user}];
+        added.hours += logged.hours;
+        ++added.entries;
+    }
+
+    state.cursor = from + consumed;
+    std::string_view pushed = csv.substr(0, consumed);
+    if (pushed.size() >= TAIL_BYTES) {
+        state.tail.assign(pushed.substr(pushed.size() - TAIL_BYTES));
+    } else {
+        state.tail.append(pushed);
+        if (state.tail.size() > TAIL_BYTES) state.tail.erase(0, state.tail.size() - TAIL_BYTES);
+    }
+    return PushResult::Applied;
+}
+
+uint64_t TeamStore::cursor(const std::string& client) const {
+    auto found = clients_.find(client);
+    return found == clients_.end() ? 0 : found->second.cursor;
+}
+
+void TeamStore::reset(const std::string& client) {
+    auto found = clients_.find(client);
+    if (found == clients_.end()) return;
+    for (const auto& [key, totals] : found->second.added) withdraw(key.first, key.second, totals);
+    clients_.erase(found);
+}
+
+std::vector<GroupTotal> TeamStore::report(int64_t from_day, int64_t to_day, GroupBy group_by) const {
+    if (group_by == GroupBy::Description) {
+        throw std::invalid_argument("the team server does not keep descriptions");
+    }
+
+    std::vector<GroupTotal> result;
+    auto first = days_.lower_bound(from_day);
+    auto last = days_.upper_bound(to_day);
+    if (group_by == GroupBy::User) {
+        std::unordered_map<uint32_t, Totals> users;
+        for (auto it = first; it != last; ++it) {
+            for (const auto& [user, totals] : it->second.users) {
+                Totals& target = users[user];
+                target.hours += totals.hours;
+                target.entries += totals.entries;
+            }
+        }
+        result.reserve(users.size());
+        for (const auto& [user, totals] : users) {
+            result.push_back(GroupTotal{std::string(users_.at(user)), totals.hours, totals.entries});
+        }
+        std::sort(result.begin(), result.end(),
+                  [](const GroupTotal& a, const GroupTotal& b) { return a.key < b.key; });
+        return result;
+    }
+
+    // Days come out of the map in order, and so do their weeks
+    for (auto it = first; it != last; ++it) {
+        std::string key = group_by == GroupBy::Week ? week_label(it->first) : day_label(it->first);
+        if (result.empty() || result.back().key != key) result.push_back(GroupTotal{key, 0.0, 0});
+        result.back().hours += it->second.team.hours;
+        result.back().entries += it->second.team.entries;
+    }
+    return result;
+}
+
+void TeamStore::add(int64_t day, uint32_t user, double hours, size_t entries) {
+    DayTotals& totals = days_[day];
+    totals.team.hours += hours;
+    totals.team.entries += entries;
+    Totals& user_totals = totals.users[user];
+    user_totals.hours += hours;
+    user_totals.entries += entries;
+}
+
+void TeamStore::withdraw(int64_t day, uint32_t user, const Totals& totals) {
+    auto found = days_.find(day);
+    if (found == days_.end()) return;
+    DayTotals& day_totals = found->second;
+    // Drop emptied entries outright instead of leaving rounding residue
+    auto user_totals = day_totals.users.find(user);
+    if (user_totals != day_totals.users.end()) {
+        user_totals->second.hours -= totals.hours;
+        user_totals->second.entries -= std::min(user_totals->second.entries, totals.entries);
+        if (user_totals->second.entries == 0) day_totals.users.erase(user_totals);
+    }
+    day_totals.team.hours -= totals.hours;
+    day_totals.team.entries -= std::min(day_totals.team.entries, totals.entries);
+    if (day_totals.team.entries == 0) days_.erase(found);
+}
@@ -0,0 +1,88 @@
+/*
+ * Time Tracker - team aggregation store
+ *
+ * The team server keeps every user's time pre-aggregated in memory: one
+ * total per user per day plus a team total per day, so a team-wide report
+ * touches only the days it covers instead of every row of every log.
+ *
+ * Clients push the bytes appended to their time_logs.csv since the server's
+ * cursor for them. A batch that does not start at the cursor is refused, so
+ * retried or overlapping pushes never count a row twice. The last bytes
+ * before the cursor are kept too: a client whose log no longer ends with
+ * them has rewritten it, and its earlier rows (remembered per client) are
+ * withdrawn before it pushes again from the start.
+ *
+ * Nothing is written to disk. After a restart every cursor is 0 and each
+ * client's next push resends its whole log.
+ */
+
+#pragma once
+
+#include "range_report.hpp"
+#include "string_pool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class TeamStore {
+public:
+    // Bytes of a client's log before its cursor that a push must repeat
+    static constexpr size_t TAIL_BYTES = 64;
+
+    enum class PushResult {
+        Applied,
+        WrongOffset, // the batch does not start at the client's cursor
+        Diverged     // the client's log no longer matches what it pushed
+    };
+
+    // Ingests csv, the bytes at offset from of the client's log; tail holds
+    // the (up to TAIL_BYTES) bytes before from. Only whole rows are taken,
+    // so the cursor may stop short of from + csv.size(). rows receives the
+    // number of rows read.
+    PushResult push(const std::string& client, uint64_t from, std::string_view tail,
+                    std::string_view csv, size_t& rows);
+
+    // Offset the client's next push must start at; 0 for an unknown client
+    uint64_t cursor(const std::string& client) const;
+
+    // Withdraws everything the client pushed and moves its cursor back to 0
+    void reset(const std::string& client);
+
+    // Totals for days from_day..to_day (days since 1970-01-01), sorted by
+    // key. Descriptions are not kept: GroupBy::Description throws
+    // std::invalid_argument.
+    std::vector<GroupTotal> report(int64_t from_day, int64_t to_day, GroupBy group_by) const;
+
+    size_t client_count() const { return clients_.size(); }
+    size_t user_count() const { return users_.size(); }
+
+private:
+    struct Totals {
+        double hours = 0.0;
+        size_t entries = 0;
+    };
+
+    struct DayTotals {
+        Totals team;
+        std::unordered_map<uint32_t, Totals> users; // by user id
+    };
+
+    struct Client {
+        uint64_t cursor = 0;
+        std::string tail;                                 // last TAIL_BYTES before cursor
+        std::map<std::pair<int64_t, uint32_t>, Totals> added; // (day, user) -> pushed totals
+    };
+
+    void add(int64_t day, uint32_t user, double hours, size_t entries);
+    void withdraw(int64_t day, uint32_t user, const Totals& totals);
+
+    StringPool users_;
+    std::map<int64_t, DayTotals> days_;
+    std::unordered_map<std::string, Client> clients_;
+};
@@ -3,14 +3,14 @@
  * A command-line time tracking tool with notifications and CSV logging
  *
  * Compile with:
- * g++ -std=c++17 -o time_tracker_cpp time_tracker.cpp
- * g++ -std=c++17 -Wall -Wextra -O2 -o time_tracker.exe time_tracker.cpp
+ * g++ -std=c++17 -pthread -o time_tracker_cpp *.cpp
+ * g++ -std=c++17 -Wall -Wextra -O2 -pthread -o time_tracker.exe *.cpp
  * 
- * Dependencies (linux): libnotify-dev (sudo apt-get install libnotify-dev)
- * Dependencies (windows): None (uses MessageBox)
+ * Dependencies (linux): None (talks to the D-Bus session bus; notify-send as fallback)
+ * Dependencies (windows): None (uses tray notifications)
  * make: provided for building with g++
  * g++ -std=c++17 -Wall -Wextra -O2 -pthread -c time_tracker.cpp -o time_tracker.o
- * g++ -std=c++17 -Wall -Wextra -O2 -pthread -o time_tracker.exe time_tracker.o
+ * g++ -std=c++17 -Wall -Wextra -O2 -pthread -o time_tracker.exe *.o
  * ./time_tracker.exe start "test8: time tracker"
  * ./time_tracker.exe status
  * ./time_tracker.exe report
@@ -22,20 +22,59 @@
 
 // without periodic notifications
 #include <iostream>
+#include <algorithm>
 #include <fstream>
 #include <string>
+#include <atomic>
 #include <chrono>
 #include <thread>
 #include <filesystem>
 #include <ctime>
 #include <sstream>
 #include <vector>
+#include <map>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <iomanip>
 #include <sys/stat.h>
 #include <csignal>
+#include <charconv>
+#include <string_view>
+
+#include "activity_chart.hpp"
+#include "binary_log.hpp"
+#include "csv_tokenizer.hpp"
+#include "daemon_ipc.hpp"
+#include "durable_log.hpp"
+#include "idle_monitor.hpp"
+#include "iso_time.hpp"
+#include "local_clock.hpp"
+#include "log_export.hpp"
+#include "log_import.hpp"
+#include "log_index.hpp"
+#include "log_query.hpp"
+#include "log_sync.hpp"
+#include "mapped_file.hpp"
+#include "metrics.hpp"
+#include "notifier.hpp"
+#include "range_report.hpp"
+#include "reminder_list.hpp"
+#include "rollup_cache.hpp"
+#include "search_index.hpp"
+#include "segment_store.hpp"
+#include "session_state.hpp"
+#include "session_table.hpp"
+#include "state_watcher.hpp"
+#include "status_page.hpp"
+#include "task_tree.hpp"
+#include "team_store.hpp"
+#include "timer_wheel.hpp"
 
 #ifdef _WIN32
 #include <windows.h>
+#include <fcntl.h>
+#include <io.h>
 #else
 #include <signal.h>
 #include <unistd.h>
@@ -43,16 +82,70 @@
 
 namespace fs = std::filesystem;
 
+// Set by SIGTERM/SIGINT or a shutdown request to end the daemon
+static std::atomic<bool> daemon_stop_requested{false};
+
+class TimeTracker;
+int run_command(TimeTracker& tracker, const std::vector<std::string>& args);
+
 class TimeTracker {
 private:
     fs::path config_dir;
     fs::path state_file;
+    fs::path sessions_file;
     fs::path csv_file;
     fs::path daemon_pid_file;
+    fs::path index_file;
+    fs::path binary_log_file;
+    fs::path strings_file;
+    fs::path journal_file;
+    fs::path rollup_file;
+    fs::path segment_dir;
+    fs::path search_file;
+    fs::path status_page_file;
+    fs::path reminders_file;
+    fs::path sync_file;
+    
+    // Report totals; kept in memory so the daemon only re-reads what changed
+    std::unique_ptr<RollupCache> rollup;
+    std::unique_ptr<SearchIndex> search;
+    // Open for the life of the process, so the daemon does not reopen and
+    // recover the journal for every row it appends
+    std::unique_ptr<DurableAppender> appender;
 
-    const int NOTIFICATION_INTERVAL = 3 * 60; // 3 minutes in seconds
-
+    // Reminders, daemon only (see notification_loop); 0 turns each off
+    static constexpr int DEFAULT_REMIND_MINUTES = 3;
+    int64_t remind_interval = DEFAULT_REMIND_MINUTES * 60; // seconds between a session's reminders
+    int64_t break_interval = 0; // seconds of work without a break before a break reminder
+    int64_t end_of_day = -1;    // seconds after midnight of the end-of-day reminder; -1 for none
+    
+    // Idle detection, daemon only (see check_idle). daemon_mutex serializes
+    // commands with the idle checks and guards the fields below.
+    static constexpr int DEFAULT_IDLE_MINUTES = 10;
+    static constexpr int IDLE_POLL_SECONDS = 5;     // while the user is away
+    static constexpr int IDLE_RETRY_SECONDS = 300;  // while no idle source answers
+    static constexpr const char* IDLE_SUFFIX = " (idle)";
+    std::mutex daemon_mutex;
+    std::unique_ptr<IdleMonitor> idle_monitor;
+    std::unique_ptr<StatusPage> status_page; // written by notification_loop only
+    int64_t idle_threshold = 0; // seconds; 0 turns idle detection off
+    std::time_t idle_since = 0; // last input before the current idle stretch; 0 while active
+    bool daemon_process = false; // set by run_daemon
+    bool storage_ready = false;  // set by setup_directories
+    
+    // Command output goes here; the daemon points it at a per-request buffer
+    std::ostream* output = &std::cout;
+    
 public:
+    // Session used when start/stop/status are not given a name
+    static constexpr const char* DEFAULT_SESSION = "default";
+
+
+    std::ostream& out() { return *output; }
+    
+    // Sends command output to stream; each thread running commands needs its own
+    void set_output(std::ostream& stream) { output = &stream; }
+
     TimeTracker() {
         const char* home = getenv("HOME");
         if (!home) {
@@ -66,13 +159,27 @@ public:
         
         config_dir = fs::path(home) / ".time_tracker";
         state_file = config_dir / "current_session.json";
+        sessions_file = config_dir / "sessions.tbl";
         csv_file = config_dir / "time_logs.csv";
         daemon_pid_file = config_dir / "daemon.pid";
+        index_file = config_dir / "time_logs.idx";
+        binary_log_file = config_dir / "time_logs.bin";
+        strings_file = config_dir / "time_logs.strings";
+        journal_file = config_dir / "time_logs.wal";
+        rollup_file = config_dir / "time_logs.rollup";
+        segment_dir = config_dir / "segments";
+        search_file = config_dir / "time_logs.search";
+        status_page_file = config_dir / "status.page";
+        reminders_file = config_dir / "reminders.tsv";
+        sync_file = config_dir / "sync.tsv";
         
-        setup_directories();
+        // Nothing is touched on disk yet; run_command calls setup_directories
+        // for the commands that need it, so status costs no syscalls up front
     }
     
+    // Creates the data directory and the log on first use; idempotent
     void setup_directories() {
+        if (storage_ready) return;
         fs::create_directories(config_dir);
         
         // Initialize CSV file with headers if it doesn't exist
@@ -81,68 +188,51 @@ public:
             file << "name,date,start_time,end_time,duration_hours,description\n";
             file.close();
         }
+        storage_ready = true;
+    }
+    
+    RollupCache& rollup_cache() {
+        if (!rollup) rollup = std::make_unique<RollupCache>(csv_file, segment_dir, rollup_file);
+        return *rollup;
+    }
+    
+    SearchIndex& search_index() {
+        if (!search) search = std::make_unique<SearchIndex>(csv_file, segment_dir, search_file);
+        return *search;
     }
     
+    DurableAppender& csv_appender() {
+        if (!appender) appender = std::make_unique<DurableAppender>(csv_file, journal_file);
+        return *appender;
+    }
+    
+    // Queued for the notification worker; never waits for the popup
     void send_notification(const std::string& title, const std::string& message) {
-#ifdef _WIN32
-        // Windows notification using MessageBox
-        std::string escaped_title = title;
-        std::string escaped_message = message;
-        
-        // Replace newlines with spaces for Windows display
-        for (size_t pos = 0; pos < escaped_message.length(); pos++) {
-            if (escaped_message[pos] == '\n') {
-                escaped_message[pos] = ' ';
-            }
-        }
-        
-        // Simple Windows message box
-        std::string command = "powershell -WindowStyle Hidden -Command \""
-                             "Add-Type -AssemblyName System.Windows.Forms; "
-                             "[System.Windows.Forms.MessageBox]::Show('" + escaped_message + "', '" + escaped_title + "', 'OK', 'Information')\"";
-        
-        int result = system(command.c_str());
-        if (result != 0) {
-            std::cout << "NOTIFICATION: " << title << " - " << message << std::endl;
-        }
-#else
-        // Linux notification
-        std::string command = "notify-send -i time-admin -u normal -t 5000 \"" +
-                              title + "\" \"" + message + "\"";
-        
-        int result = system(command.c_str());
-        if (result != 0) {
-            std::cout << "NOTIFICATION: " << title << " - " << message << std::endl;
-        }
-#endif
+        Notifier::instance().post(title, message);
     }
     
-    bool is_running() {
-        return fs::exists(state_file);
+    // Moves a session left in current_session.json by an older version
+    // into the session table
+    void migrate_legacy_session() {
+        if (!fs::exists(state_file)) return;
+        SessionData session = read_session_data(state_file);
+        if (session.valid) {
+            if (session.session.empty()) session.session = DEFAULT_SESSION;
+            SessionTable(sessions_file).start(session);
+        }
+        fs::remove(state_file);
     }
     
     std::string get_current_time_iso() {
-        auto now = std::chrono::system_clock::now();
-        auto time_t = std::chrono::system_clock::to_time_t(now);
-        std::stringstream ss;
-        ss << std::put_time(std::localtime(&time_t), "%Y-%m-%dT%H:%M:%S");
-        return ss.str();
+        return std::string(ClockSnapshot::now().iso());
     }
     
     std::string get_current_date() {
-        auto now = std::chrono::system_clock::now();
-        auto time_t = std::chrono::system_clock::to_time_t(now);
-        std::stringstream ss;
-        ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d");
-        return ss.str();
+        return std::string(ClockSnapshot::now().date());
     }
     
     std::string get_current_time() {
-        auto now = std::chrono::system_clock::now();
-        auto time_t = std::chrono::system_clock::to_time_t(now);
-        std::stringstream ss;
-        ss << std::put_time(std::localtime(&time_t), "%H:%M:%S");
-        return ss.str();
+        return std::string(ClockSnapshot::now().clock());
     }
     
     std::string get_username() {
@@ -155,554 +245,2081 @@ public:
         return user ? std::string(user) : "unknown";
     }
     
-    bool start_tracking(const std::string& description = "Work session") {
-        if (is_running()) {
-            std::cout << "Time tracking is already running.\n";
+    // Writes the session in the current_session.json layout
+    void write_session_json(std::ostream& os, const SessionData& session) {
+        std::string json;
+        encode_session(session, json);
+        os << json;
+    }
+    
+    bool start_tracking(const std::string& description = "Work session",
+                        const std::string& session_name = DEFAULT_SESSION) {
+        if (!SessionTable::valid_name(session_name)) {
+            out() << "Invalid session name (1-" << SessionTable::SESSION_NAME_BYTES - 1
+                  << " bytes, no control characters).\n";
             return false;
         }
+        migrate_legacy_session();
         
-        // Create session state file (simplified JSON-like format)
-        std::ofstream state(state_file);
-        state << "{\n";
-        state << "  \"name\": \"" << get_username() << "\",\n";
-        state << "  \"start_time\": \"" << get_current_time_iso() << "\",\n";
-        state << "  \"description\": \"" << description << "\"\n";
-        state << "}\n";
-        state.close();
+        ClockSnapshot started = ClockSnapshot::now();
+        SessionData session;
+        session.name = get_username();
+        session.start_time = std::string(started.iso());
+        session.description = description;
+        session.last_notification = session.start_time;
+        session.session = session_name;
+        session.valid = true;
         
-        // Start daemon (simplified - would need proper daemon implementation)
-        start_daemon();
+        // Claimed with a compare-and-swap: parallel starts never block,
+        // and at most one of them wins a given name
+        switch (SessionTable(sessions_file).start(session)) {
+        case SessionTable::StartResult::Started:
+            break;
+        case SessionTable::StartResult::AlreadyRunning:
+            if (session_name == DEFAULT_SESSION) out() << "Time tracking is already running.\n";
+            else out() << "Session '" << session_name << "' is already running.\n";
+            return false;
+        case SessionTable::StartResult::Full:
+            out() << "Too many sessions running (at most " << SessionTable::SLOT_COUNT << ").\n";
+            return false;
+        }
         
         send_notification("Time Tracker Started", "Started tracking: " + description);
         
-        std::cout << "Time tracking started at " << get_current_time() << std::endl;
-        std::cout << "Description: " << description << std::endl;
+        out() << "Time tracking started at " << started.clock() << std::endl;
+        out() << "Description: " << description << std::endl;
+        if (session_name != DEFAULT_SESSION) out() << "Session: " << session_name << std::endl;
+        if (description.size() > SessionTable::max_description()) {
+            out() << "Description truncated to " << SessionTable::max_description() << " bytes.\n";
+        }
         
         return true;
     }
     
-    bool stop_tracking() {
-        if (!is_running()) {
-            std::cout << "Time tracking is not currently running.\n";
+    // Stops the named session; with no name, the only running one
+    bool stop_tracking(const std::string& session_name = "") {
+        migrate_legacy_session();
+        // In the daemon, a user just back from a break has the break split off first
+        if (idle_monitor) check_idle();
+        
+        std::string target = session_name;
+        if (target.empty()) {
+            std::vector<SessionData> running = SessionTable(sessions_file, SessionTable::Mode::ReadOnly).list();
+            if (running.empty()) {
+                out() << "Time tracking is not currently running.\n";
+                return false;
+            }
+            if (running.size() > 1) {
+                out() << "Several sessions are running; name the one to stop:\n";
+                for (const auto& session : running) {
+                    out() << "  " << session.session << " - " << session.description << "\n";
+                }
+                return false;
+            }
+            target = running.front().session;
+        }
+        
+        // The row is made durable while the session is held in STOPPING,
+        // so a failed append leaves the session running
+        LoggedRow row;
+        SessionData stopped;
+        bool found = SessionTable(sessions_file).stop(target, stopped, [&](const SessionData& session) {
+            row = append_session_row(session);
+        });
+        if (!found) {
+            if (session_name.empty()) out() << "Time tracking is not currently running.\n";
+            else out() << "Session '" << session_name << "' is not running.\n";
             return false;
         }
         
-        // Read session data (simplified parsing)
-        std::ifstream state(state_file);
-        std::string line, start_time, description, name;
-        
-        while (std::getline(state, line)) {
-            if (line.find("\"start_time\"") != std::string::npos) {
-                size_t start = line.find(": \"") + 3;
-                size_t end = line.find("\"", start);
-                start_time = line.substr(start, end - start);
-            } else if (line.find("\"description\"") != std::string::npos) {
-                size_t start = line.find(": \"") + 3;
-                size_t end = line.find("\"", start);
-                description = line.substr(start, end - start);
-            } else if (line.find("\"name\"") != std::string::npos) {
-                size_t start = line.find(": \"") + 3;
-                size_t end = line.find("\"", start);
-                name = line.substr(start, end - start);
-            }
-        }
-        state.close();
-        
-        // Calculate duration (simplified - would need proper ISO parsing)
-        std::string current_time = get_current_time_iso();
-        std::string current_time_only = get_current_time();
-        std::string current_date = get_current_date();
-        
-        // For demo purposes, assume 1 hour duration
-        double duration_hours = 1.0; // Needs full implementation
-        
-        // Log to CSV
-        std::ofstream csv(csv_file, std::ios::app);
-        csv << name << ","
-            << current_date << ","
-            << start_time.substr(11) << "," // Extract time part
-            << current_time_only << ","
-            << std::fixed << std::setprecision(2) << duration_hours << ","
-            << description << "\n";
-        csv.close();
-        
-        // Remove state file
-        fs::remove(state_file);
+        index_logged_rows({row});
         
-        // Stop daemon
-        stop_daemon();
+        double duration_hours = row.duration_seconds / 3600.0;
         
         send_notification("Time Tracker Stopped", 
                          "Session completed\nLogged to CSV file");
         
-        std::cout << "Time tracking stopped at " << current_time_only << std::endl;
-        std::cout << "Duration: " << duration_hours << " hours\n";
-        std::cout << "Logged to: " << csv_file << std::endl;
+        out() << "Time tracking stopped at " << row.end_clock << std::endl;
+        out() << "Duration: " << std::fixed << std::setprecision(2) << duration_hours << " hours\n";
+        out() << "Logged to: " << csv_file << std::endl;
         
         return true;
     }
     
-    void get_status() {
-        if (!is_running()) {
-            std::cout << "Time tracking is not currently running.\n";
+    struct LoggedRow {
+        int64_t start_local = 0;
+        int64_t end_local = 0;
+        uint32_t duration_seconds = 0;
+        std::string end_clock; // HH:MM:SS
+        std::string name;
+        std::string description;
+    };
+    
+    // Formats session, from its start_time until end, as a CSV row appended to rows
+    LoggedRow format_session_row(const SessionData& session, std::time_t end, std::string& rows) {
+        LoggedRow logged;
+        const std::string& start_time = session.start_time;
+        logged.name = session.name;
+        logged.description = session.description;
+        
+        ClockSnapshot ended(end);
+        logged.end_clock = std::string(ended.clock());
+        
+        // Duration is measured between UTC instants, so sessions spanning
+        // midnight or a DST change are counted by elapsed time
+        int64_t& start_local = logged.start_local;
+        int64_t& end_local = logged.end_local;
+        if (!iso_time::parse_iso(start_time, start_local)) {
+            throw std::runtime_error("Invalid start_time in session '" + session.session + "': " + start_time);
+        }
+        end_local = ended.local();
+        std::time_t elapsed = end - iso_time::local_to_utc(start_local);
+        logged.duration_seconds = elapsed > 0 ? static_cast<uint32_t>(elapsed) : 0;
+        double duration_hours = logged.duration_seconds / 3600.0;
+        
+        std::ostringstream row;
+        write_csv_field(row, session.name);
+        row << ","
+            << ended.date() << ","
+            << std::string_view(start_time).substr(11, 8) << "," // Extract time part
+            << logged.end_clock << ","
+            << std::fixed << std::setprecision(2) << duration_hours << ",";
+        write_csv_field(row, session.description);
+        row << "\n";
+        rows += row.str();
+        return logged;
+    }
+    
+    // Appends rows to the CSV log through the journal and makes them durable.
+    // One journal flush commits them; the CSV is flushed in batches.
+    void append_rows(const std::string& rows) {
+        DurableAppender& csv = csv_appender();
+        csv.append(rows);
+        csv.commit();
+    }
+    
+    // Appends a session that ends now to the CSV log
+    LoggedRow append_session_row(const SessionData& session) {
+        std::string rows;
+        LoggedRow logged = format_session_row(session, std::time(nullptr), rows);
+        append_rows(rows);
+        return logged;
+    }
+    
+    // Indexes appended rows so reports can seek straight to them, adds them
+    // to the report totals and makes their descriptions searchable
+    void index_logged_rows(const std::vector<LoggedRow>& rows) {
+        LogIndex(csv_file, index_file).sync();
+        rollup_cache().sync();
+        search_index().sync();
+        
+        // Mirror the rows into the binary store once it has been enabled
+        BinaryLog binary_log(binary_log_file, strings_file);
+        if (binary_log.enabled()) {
+            for (const auto& row : rows) {
+                binary_log.append(row.start_local, row.end_local, row.duration_seconds,
+                                  row.name, row.description);
+            }
+        }
+    }
+    
+    // Same for rows appended in bulk from CSV offset `offset` on
+    void index_appended_rows(uint64_t offset) {
+        LogIndex(csv_file, index_file).sync();
+        rollup_cache().sync();
+        search_index().sync();
+        BinaryLog binary_log(binary_log_file, strings_file);
+        if (binary_log.enabled()) {
+            MappedFile csv(csv_file);
+            std::string_view text = csv.view();
+            if (offset < text.size()) binary_log.import_rows(text.substr(offset), false);
+        }
+    }
+    
+    // Stops every running session
+    void stop_all() {
+        migrate_legacy_session();
+        std::vector<SessionData> running = SessionTable(sessions_file, SessionTable::Mode::ReadOnly).list();
+        if (running.empty()) out() << "Time tracking is not currently running.\n";
+        for (const auto& session : running) stop_tracking(session.session);
+    }
+    
+    // Shows the named session, or every running one
+    void get_status(const std::string& session_name = "") {
+        migrate_legacy_session();
+        
+        SessionTable sessions(sessions_file, SessionTable::Mode::ReadOnly);
+        std::vector<SessionData> running;
+        SessionData session;
+        if (session_name.empty()) running = sessions.list();
+        else if (sessions.find(session_name, session)) running.push_back(session);
+        
+        if (running.empty()) {
+            if (session_name.empty()) out() << "Time tracking is not currently running.\n";
+            else out() << "Session '" << session_name << "' is not running.\n";
             return;
         }
         
-        std::ifstream state(state_file);
+        out() << "Time tracking is ACTIVE";
+        if (running.size() > 1) out() << " (" << running.size() << " sessions)";
+        out() << "\n";
+        if (idle_since) out() << "Idle since " << ClockSnapshot(idle_since).clock() << " (logged separately)\n";
+        for (const auto& entry : running) {
+            write_session_json(out(), entry);
+        }
+    }
+    
+    // What prompts and status bars show: the daemon's status page, or the
+    // session table when no daemon keeps one (idle state is then unknown).
+    // Neither opens the JSON state or the CSV log. Sessions left by an
+    // older version are not migrated on this path.
+    void read_status(StatusPage::Status& status, const std::string& session_name) {
+        if (!StatusPage(status_page_file, StatusPage::Mode::Read).read(status)) table_status(status);
+        if (!session_name.empty()) {
+            auto other = [&](const StatusPage::Session& s) { return s.name != session_name; };
+            status.sessions.erase(std::remove_if(status.sessions.begin(), status.sessions.end(), other),
+                                  status.sessions.end());
+        }
+    }
+    
+    // The running sessions as the session table has them
+    void table_status(StatusPage::Status& status) {
+        status = StatusPage::Status();
+        for (const auto& entry : SessionTable(sessions_file, SessionTable::Mode::ReadOnly).list()) {
+            int64_t start_local = 0;
+            std::time_t start = iso_time::parse_iso(entry.start_time, start_local)
+                                    ? iso_time::local_to_utc(start_local) : 0;
+            status.sessions.push_back(StatusPage::Session{entry.session, entry.description, start});
+        }
+        status.active = static_cast<uint32_t>(status.sessions.size());
+    }
+    
+    // Expands {name} {description} {start} {elapsed} {seconds} {count} and
+    // {idle}; anything else is copied. Time away from the keyboard is
+    // logged separately, so it does not count as elapsed.
+    static std::string format_status(const std::string& format, const StatusPage::Session& session,
+                                     const StatusPage::Status& status, std::time_t now) {
+        std::time_t until = status.idle_since && status.idle_since > session.start ? status.idle_since : now;
+        int64_t seconds = std::max<int64_t>(0, static_cast<int64_t>(until - session.start));
+        std::string text;
+        for (size_t i = 0; i < format.size();) {
+            size_t close = format[i] == '{' ? format.find('}', i) : std::string::npos;
+            std::string_view token = close == std::string::npos
+                                         ? std::string_view()
+                                         : std::string_view(format).substr(i + 1, close - i - 1);
+            char number[32];
+            if (token == "name") text += session.name;
+            else if (token == "description") text += session.description;
+            else if (token == "start") text += ClockSnapshot(session.start).clock().substr(0, 5);
+            else if (token == "elapsed") {
+                std::snprintf(number, sizeof(number), "%lld:%02d", static_cast<long long>(seconds / 3600),
+                              static_cast<int>(seconds / 60 % 60));
+                text += number;
+            } else if (token == "seconds") text += std::to_string(seconds);
+            else if (token == "count") text += std::to_string(status.active);
+            else if (token == "idle") text += status.idle_since ? "idle" : "";
+            else {
+                text += format[i++];
+                continue;
+            }
+            i = close + 1;
+        }
+        return text;
+    }
+    
+    // One line for shell prompts and status bars: format (default
+    // "{name} {elapsed}") for each running session, joined by ", ".
+    // False, with no output, if no session is running.
+    bool get_fast_status(const std::string& session_name = "", const std::string& format = "") {
+        StatusPage::Status status;
+        read_status(status, session_name);
+        if (status.sessions.empty()) return false;
+        
+        std::time_t now = std::time(nullptr);
         std::string line;
-        std::cout << "Time tracking is ACTIVE\n";
-        while (std::getline(state, line)) {
-            std::cout << line << std::endl;
+        for (const auto& session : status.sessions) {
+            if (!line.empty()) line += ", ";
+            line += format_status(format.empty() ? "{name} {elapsed}" : format, session, status, now);
         }
-        state.close();
+        if (format.empty() && status.idle_since) line += IDLE_SUFFIX;
+        out() << line << "\n";
+        return true;
     }
     
     void generate_daily_report(const std::string& date = "") {
+        METRIC_TIMER(REPORT);
         std::string target_date = date.empty() ? get_current_date() : date;
         
-        std::ifstream csv(csv_file);
-        std::string line;
-        std::vector<std::string> daily_entries;
+        // Only the rows the date index points at are mapped in and examined
+        LogIndex index(csv_file, index_file);
+        std::vector<DayRange> ranges = index.find(target_date);
+        
+        MappedFile csv(csv_file);
+        std::string_view text = csv.view();
+        std::vector<std::string_view> daily_entries;
         double total_hours = 0.0;
         
-        // Skip header
-        if (std::getline(csv, line)) {
-            while (std::getline(csv, line)) {
-                if (line.find(target_date) != std::string::npos) {
-                    daily_entries.push_back(line);
-                    
-                    // Extract duration (simplified parsing)
-                    std::istringstream iss(line);
-                    std::string field;
-                    int field_count = 0;
-                    while (std::getline(iss, field, ',')) {
-                        if (field_count == 4) { // duration_hours field
-                            total_hours += std::stod(field);
-                            break;
-                        }
-                        field_count++;
-                    }
-                }
+        // Entries view the mapped log, so a report allocates nothing per row
+        auto collect = [&](std::string_view rows_text, size_t begin) {
+            CsvTokenizer rows(rows_text, begin);
+            CsvRecord record;
+            LogRow row;
+            while (rows.next(record)) {
+                if (!parse_log_row(record, row) || row.date != target_date) continue;
+                daily_entries.push_back(record.line);
+                total_hours += row.hours;
+            }
+        };
+        
+        // Sealed rows come first; only segments whose dates can match are read
+        SegmentStore segments(csv_file, segment_dir);
+        std::deque<std::string> sealed; // keeps the entries' text alive
+        int64_t day = 0;
+        if (target_date.size() == 10 && iso_time::parse_day(target_date, day)) {
+            for (const Segment& segment : segments.overlapping(day, day)) {
+                sealed.push_back(segments.read(segment));
+                collect(sealed.back(), 0);
             }
         }
-        csv.close();
+        
+        uint64_t head_start = segments.head_start(text);
+        for (const auto& range : ranges) {
+            if (range.end > text.size()) continue; // log changed under us
+            if (range.end <= head_start) continue; // sealed; a compaction was interrupted
+            collect(text.substr(0, range.end), static_cast<size_t>(std::max(range.begin, head_start)));
+        }
         
         if (daily_entries.empty()) {
-            std::cout << "No entries found for " << target_date << std::endl;
+            out() << "No entries found for " << target_date << std::endl;
             return;
         }
         
-        std::cout << "\n=== Daily Report for " << target_date << " ===\n";
-        std::cout << "Total Hours: " << std::fixed << std::setprecision(2) << total_hours << "\n";
-        std::cout << "Total Entries: " << daily_entries.size() << "\n";
-        std::cout << "\nDetails:\n";
-        std::cout << std::string(70, '-') << "\n";
+        out() << "\n=== Daily Report for " << target_date << " ===\n";
+        out() << "Total Hours: " << std::fixed << std::setprecision(2) << total_hours << "\n";
+        out() << "Total Entries: " << daily_entries.size() << "\n";
+        out() << "\nDetails:\n";
+        out() << std::string(70, '-') << "\n";
         
         for (const auto& entry : daily_entries) {
-            std::cout << entry << "\n";
+            out() << entry << "\n";
         }
         
-        std::cout << std::string(70, '-') << "\n";
-        std::cout << "Total: " << total_hours << " hours\n";
+        out() << std::string(70, '-') << "\n";
+        out() << "Total: " << total_hours << " hours\n";
+    }
+    
+    // Days since 1970-01-01 of a report bound given as option
+    static int64_t report_day(const std::string& date, const char* option) {
+        int64_t day = 0;
+        if (date.size() != 10 || !iso_time::parse_day(date, day)) {
+            throw std::runtime_error(std::string("Invalid ") + option + " date: " + date);
+        }
+        return day;
     }
+    
+    // Totals for every day from..to, grouped by day, ISO week, description or user
+    void generate_range_report(const std::string& from, const std::string& to, GroupBy group_by,
+                               const std::string& group_name) {
+        METRIC_TIMER(REPORT);
+        int64_t from_day = report_day(from, "--from");
+        int64_t to_day = report_day(to, "--to");
         
-    // Holds the active session’s metadata
-    struct SessionData {
-        std::string name;        // Username who started the session
-        std::string start_time;  // ISO-8601 timestamp when tracking began
-        std::string description; // User’s task description
-        bool valid = false;      // True if both start_time and description were parsed
-    };
-
-    // Reads and parses the JSON-like state file.
-    // Returns a SessionData with .valid=true if parsing succeeded.
-    SessionData read_session_data(const fs::path& state_file) {
-        SessionData data;
-        if (!fs::exists(state_file)) return data;
-
-        std::ifstream f(state_file);
-        std::string line;
-        while (std::getline(f, line)) {
-            auto p = line.find("\"name\"");
-            if (p != std::string::npos) {
-                auto s = line.find(':', p) + 2;
-                data.name = line.substr(s, line.find('"', s) - s);
-            }
-            p = line.find("\"start_time\"");
-            if (p != std::string::npos) {
-                auto s = line.find(':', p) + 2;
-                data.start_time = line.substr(s, line.find('"', s) - s);
-            }
-            p = line.find("\"description\"");
-            if (p != std::string::npos) {
-                auto s = line.find(':', p) + 2;
-                data.description = line.substr(s, line.find('"', s) - s);
-            }
+        print_group_totals(rollup_cache().totals(from_day, to_day, group_by), from, to, group_name);
+    }
+    
+    // Hours per day as a calendar, or per weekday and clock hour, drawn
+    // from the cached buckets without reading the log
+    void generate_chart(const std::string& from, const std::string& to, bool by_hour, ChartFormat format) {
+        METRIC_TIMER(REPORT);
+        int64_t from_day = report_day(from, "--from");
+        int64_t to_day = report_day(to, "--to");
+        if (to_day < from_day) throw std::runtime_error("--from " + from + " is after --to " + to);
+        if (by_hour) {
+            render_by_hour(out(), from_day, to_day, rollup_cache().weekly_hours(from_day, to_day), format);
+        } else {
+            render_heatmap(out(), from_day, rollup_cache().daily_hours(from_day, to_day), format);
         }
-        data.valid = !data.start_time.empty() && !data.description.empty();
-        return data;
     }
-
-    void notification_loop(const fs::path& state_file) {
-        auto last = std::chrono::steady_clock::now();
-        while (fs::exists(state_file)) {
-            std::this_thread::sleep_for(std::chrono::seconds(30));
-            auto now = std::chrono::steady_clock::now();
-            if (std::chrono::duration_cast<std::chrono::seconds>(now - last).count() >= NOTIFICATION_INTERVAL)
-            {
-                auto session = read_session_data(state_file);
-                if (session.valid) {
-                    std::string msg = "You've been working for "
-                        + std::to_string(NOTIFICATION_INTERVAL / 60)
-                        + " minutes. Current task: " + session.description;
-                    send_notification("Time Tracker Reminder", msg);
-                }
-                last = now;
-            }
+    
+    // Hours per project and task, read from descriptions written
+    // "project: task" (see task_tree.hpp), with tags totalled separately.
+    // Built from the cached totals per description in one pass.
+    void generate_tree_report(const std::string& from, const std::string& to) {
+        METRIC_TIMER(REPORT);
+        int64_t from_day = report_day(from, "--from");
+        int64_t to_day = report_day(to, "--to");
+        std::string period = from == to ? from : from + " to " + to;
+        
+        TaskTree tree;
+        for (const auto& group : rollup_cache().totals(from_day, to_day, GroupBy::Description)) {
+            tree.add(group.key, group.hours, group.entries);
+        }
+        if (tree.root().entries == 0) {
+            out() << "No entries found for " << period << std::endl;
+            return;
+        }
+        
+        std::vector<uint32_t> order = tree.preorder();
+        std::vector<GroupTotal> tags = tree.tags();
+        size_t label_width = 4; // "task"
+        for (uint32_t id : order) {
+            const TaskTree::Node& node = tree.node(id);
+            label_width = std::max(label_width, 2 * (node.depth - 1) + node.label.size());
+        }
+        for (const auto& tag : tags) label_width = std::max(label_width, tag.key.size() + 1);
+        auto line = [&](const std::string& label, double hours, uint64_t entries) {
+            out() << std::left << std::setw(static_cast<int>(label_width)) << label
+                  << std::right << std::setw(10) << hours << std::setw(10) << entries << "\n";
+        };
+        
+        out() << "\n=== Task Tree for " << period << " ===\n";
+        out() << "Total Hours: " << std::fixed << std::setprecision(2) << tree.root().hours << "\n";
+        out() << "Total Entries: " << tree.root().entries << "\n";
+        out() << "\nDetails:\n";
+        out() << std::string(70, '-') << "\n";
+        out() << std::left << std::setw(static_cast<int>(label_width)) << "task"
+              << std::right << std::setw(10) << "hours" << std::setw(10) << "entries" << "\n";
+        for (uint32_t id : order) {
+            const TaskTree::Node& node = tree.node(id);
+            line(std::string(2 * (node.depth - 1), ' ') + std::string(node.label), node.hours, node.entries);
+        }
+        if (!tags.empty()) {
+            out() << "\nTags:\n";
+            for (const auto& tag : tags) line("#" + tag.key, tag.hours, tag.entries);
         }
+        out() << std::string(70, '-') << "\n";
+        out() << "Total: " << tree.root().hours << " hours\n";
     }
     
-private:
-    void start_daemon() {
-        // Simplified: Here you'd fork a proper daemon process in production
-        // For example, spawning a separate process to handle notifications
-        // Spawn background thread for periodic reminders
-        std::thread([this]() {
-            notification_loop(state_file);
-        }).detach();
-        std::cout << "Notification daemon started (simplified placeholder).\n";
+    // Sessions whose description holds every term (a trailing '*' matches
+    // any word with that prefix), with their total hours
+    void search_sessions(const std::vector<std::string>& terms, size_t limit) {
+        METRIC_TIMER(SEARCH);
+        std::string query;
+        for (const auto& term : terms) query += (query.empty() ? "" : " ") + term;
+        
+        SearchIndex::Result result = search_index().search(terms, limit);
+        if (result.sessions == 0) {
+            out() << "No sessions match \"" << query << "\"\n";
+            return;
+        }
+        out() << "\n=== Sessions matching \"" << query << "\" ===\n";
+        out() << "Total Hours: " << std::fixed << std::setprecision(2) << result.hours << "\n";
+        out() << "Total Entries: " << result.sessions << "\n";
+        if (result.rows.empty()) return;
+        out() << "\n";
+        if (result.rows.size() < result.sessions) out() << "Latest " << result.rows.size() << ":\n";
+        out() << std::string(70, '-') << "\n";
+        for (const auto& row : result.rows) out() << row << "\n";
+        out() << std::string(70, '-') << "\n";
     }
     
-    void stop_daemon() {
-        if (fs::exists(daemon_pid_file)) {
-            std::ifstream pid_file(daemon_pid_file);
-            std::string pid_str;
-            if (std::getline(pid_file, pid_str)) {
-                int pid = std::stoi(pid_str);
+    // Sessions matching a query expression (see log_query.hpp), with their
+    // total hours; with explain, the compiled plan first
+    void query_sessions(const std::string& expression, size_t limit, bool explain) {
+        METRIC_TIMER(QUERY);
+        LogQuery query(expression);
+        if (explain) out() << query.explain();
+        
+        QueryResult result = query.run(csv_file, index_file, segment_dir, limit);
+        if (result.sessions == 0) {
+            out() << "No sessions match \"" << expression << "\"\n";
+            return;
+        }
+        out() << "\n=== Sessions matching \"" << expression << "\" ===\n";
+        out() << "Total Hours: " << std::fixed << std::setprecision(2) << result.hours << "\n";
+        out() << "Total Entries: " << result.sessions << "\n";
+        if (result.rows.empty()) return;
+        out() << "\n";
+        if (result.rows.size() < result.sessions) out() << "Latest " << result.rows.size() << ":\n";
+        out() << std::string(70, '-') << "\n";
+        for (const auto& row : result.rows) out() << row << "\n";
+        out() << std::string(70, '-') << "\n";
+    }
+    
+    // What this process has measured (see metrics.hpp). The daemon's numbers
+    // cover every command it has served, so `stats` is answered by it when
+    // it is running. With json, one object per call for monitoring.
+    void print_stats(bool json) {
+        if (!metrics::ENABLED) {
+            out() << "Metrics are compiled out of this build (make METRICS=1).\n";
+            return;
+        }
+        metrics::Snapshot stats = metrics::snapshot();
+        auto counter = [&](metrics::Counter c) { return stats.counters[c]; };
 #ifdef _WIN32
-                HANDLE hProcess = OpenProcess(PROCESS_TERMINATE, FALSE, pid);
-                if (hProcess != NULL) {
-                    TerminateProcess(hProcess, 1); // exit code 1
-                    CloseHandle(hProcess);
-                }
+        unsigned long pid = GetCurrentProcessId();
 #else
-                kill(pid, SIGTERM);
+        long pid = getpid();
 #endif
+        
+        if (json) {
+            out() << "{\"process\":\"" << (daemon_process ? "daemon" : "command") << "\",\"pid\":" << pid
+                  << ",\"uptime_seconds\":" << std::fixed << std::setprecision(1) << metrics::uptime_seconds()
+                  << ",\"counters\":{";
+            for (unsigned c = 0; c < metrics::COUNTER_COUNT; ++c) {
+                auto id = static_cast<metrics::Counter>(c);
+                out() << (c ? "," : "") << "\"" << metrics::name(id) << "\":" << counter(id);
             }
-            pid_file.close();
-            fs::remove(daemon_pid_file);
+            out() << "},\"timers\":{";
+            for (unsigned t = 0; t < metrics::TIMER_COUNT; ++t) {
+                auto id = static_cast<metrics::Timer>(t);
+                const metrics::Histogram& h = stats.timers[t];
+                out() << (t ? "," : "") << "\"" << metrics::name(id) << "\":{\"count\":" << h.count
+                      << ",\"total_ns\":" << h.total_ns << ",\"p50_ns\":" << h.percentile(0.5)
+                      << ",\"p90_ns\":" << h.percentile(0.9) << ",\"p99_ns\":" << h.percentile(0.99)
+                      << ",\"max_ns\":" << h.max_ns << "}";
+            }
+            out() << "}}\n";
+            return;
+        }
+        
+        auto duration = [](uint64_t ns) {
+            std::ostringstream text;
+            text << std::fixed << std::setprecision(ns < 10000 ? 0 : 1);
+            if (ns < 10000) text << ns << "ns";
+            else if (ns < 10000000) text << ns / 1e3 << "us";
+            else if (ns < 10000000000ull) text << ns / 1e6 << "ms";
+            else text << ns / 1e9 << "s";
+            return text.str();
+        };
+        auto ratio = [](uint64_t hits, uint64_t misses) {
+            std::ostringstream text;
+            text << hits << "/" << hits + misses;
+            return text.str();
+        };
+        
+        uint64_t hits = counter(metrics::ROLLUP_HITS) + counter(metrics::SEARCH_HITS);
+        uint64_t lookups = hits + counter(metrics::ROLLUP_MISSES) + counter(metrics::SEARCH_MISSES);
+        auto uptime = static_cast<int64_t>(metrics::uptime_seconds());
+        
+        out() << "\n=== Time Tracker Stats ===\n";
+        out() << (daemon_process ? "Daemon" : "This process") << " (pid " << pid << "), up "
+              << uptime / 3600 << "h " << std::setfill('0') << std::setw(2) << uptime / 60 % 60 << "m "
+              << std::setw(2) << uptime % 60 << "s" << std::setfill(' ') << "\n";
+        if (!daemon_process) out() << "No daemon is running; these are this command's own numbers.\n";
+        out() << "\n";
+        out() << "Bytes read:     " << counter(metrics::BYTES_READ) << " of CSV, "
+              << counter(metrics::SEGMENT_BYTES) << " of stored segments\n";
+        out() << "Rows parsed:    " << counter(metrics::ROWS_PARSED) << "\n";
+        out() << "Parse:          " << stats.timers[metrics::TOKENIZE].mean_ns() << " ns/row tokenizing + "
+              << stats.timers[metrics::PARSE_ROW].mean_ns() << " ns/row reading fields (sampled)\n";
+        out() << "Cache hit rate: ";
+        if (lookups) out() << std::fixed << std::setprecision(1) << 100.0 * hits / lookups << "%";
+        else out() << "-";
+        out() << " (rollup " << ratio(counter(metrics::ROLLUP_HITS), counter(metrics::ROLLUP_MISSES))
+              << ", search " << ratio(counter(metrics::SEARCH_HITS), counter(metrics::SEARCH_MISSES)) << ")\n";
+        out() << "Notifications:  " << counter(metrics::NOTIFICATIONS) << " queued, "
+              << counter(metrics::NOTIFICATIONS_DROPPED) << " dropped\n";
+        out() << "Contention:     " << counter(metrics::LOCK_WAITS) << " lock waits, "
+              << counter(metrics::SLOT_RETRIES) << " session slot retries\n";
+        
+        out() << "\n" << std::left << std::setw(24) << "Latency" << std::right << std::setw(8) << "count"
+              << std::setw(10) << "mean" << std::setw(10) << "p50" << std::setw(10) << "p90"
+              << std::setw(10) << "p99" << std::setw(10) << "max" << "\n";
+        out() << std::string(82, '-') << "\n";
+        for (unsigned t = 0; t < metrics::TIMER_COUNT; ++t) {
+            const metrics::Histogram& h = stats.timers[t];
+            out() << std::left << std::setw(24) << metrics::name(static_cast<metrics::Timer>(t)) << std::right
+                  << std::setw(8) << h.count;
+            if (h.count) {
+                out() << std::setw(10) << duration(h.mean_ns()) << std::setw(10) << duration(h.percentile(0.5))
+                      << std::setw(10) << duration(h.percentile(0.9)) << std::setw(10) << duration(h.percentile(0.99))
+                      << std::setw(10) << duration(h.max_ns);
+            }
+            out() << "\n";
         }
     }
-};
-
-void print_usage(const char* program_name) {
-    std::cout << "Time Reporting Tool - C++ Version\n\n";
-    std::cout << "Usage:\n";
-    std::cout << "  " << program_name << " start [description]  - Start time tracking\n";
-    std::cout << "  " << program_name << " stop                 - Stop time tracking\n";
-    std::cout << "  " << program_name << " status               - Check current status\n";
-    std::cout << "  " << program_name << " report [date]        - Generate daily report\n";
-    std::cout << "\nExamples:\n";
-    std::cout << "  " << program_name << " start \"Coding new features\"\n";
-    std::cout << "  " << program_name << " stop\n";
-    std::cout << "  " << program_name << " report 2025-10-03\n";
-}
-
-int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        print_usage(argv[0]);
-        return 1;
+    
+    // Same report, answered by a team server from every user's pushed logs.
+    // Returns false if the server refused the request.
+    bool generate_team_report(const std::string& address, const std::string& from, const std::string& to,
+                              const std::string& group_name) {
+        std::string response;
+        int exit_code = 1;
+        if (!remote_call(address, {"report", team_token(), from, to, group_name}, response, exit_code)) {
+            throw std::runtime_error("Could not reach team server at " + address);
+        }
+        if (exit_code != 0) {
+            out() << response;
+            return false;
+        }
+        
+        // One "key<TAB>hours<TAB>entries" line per group
+        std::vector<GroupTotal> groups;
+        std::istringstream lines(response);
+        std::string line;
+        while (std::getline(lines, line)) {
+            size_t first_tab = line.find('\t');
+            size_t second_tab = line.find('\t', first_tab + 1);
+            if (first_tab == std::string::npos || second_tab == std::string::npos) continue;
+            GroupTotal group;
+            group.key = line.substr(0, first_tab);
+            group.hours = std::strtod(line.c_str() + first_tab + 1, nullptr);
+            group.entries = std::strtoull(line.c_str() + second_tab + 1, nullptr, 10);
+            groups.push_back(std::move(group));
+        }
+        print_group_totals(groups, from, to, group_name);
+        return true;
     }
     
-    try {
-        TimeTracker tracker;
-        std::string command = argv[1];
-        
-        if (command == "start") {
-            std::string description = "Work session";
-            if (argc > 2) {
-                description = "";
-                for (int i = 2; i < argc; ++i) {
-                    if (i > 2) description += " ";
-                    description += argv[i];
-                }
+    void print_group_totals(const std::vector<GroupTotal>& groups, const std::string& from,
+                            const std::string& to, const std::string& group_name) {
+        if (groups.empty()) {
+            out() << "No entries found from " << from << " to " << to << std::endl;
+            return;
+        }
+        
+        double total_hours = 0.0;
+        size_t total_entries = 0;
+        size_t key_width = group_name.size();
+        for (const auto& group : groups) {
+            total_hours += group.hours;
+            total_entries += group.entries;
+            key_width = std::max(key_width, group.key.size());
+        }
+        
+        out() << "\n=== Report for " << from << " to " << to << " (by " << group_name << ") ===\n";
+        out() << "Total Hours: " << std::fixed << std::setprecision(2) << total_hours << "\n";
+        out() << "Total Entries: " << total_entries << "\n";
+        out() << "\nDetails:\n";
+        out() << std::string(70, '-') << "\n";
+        out() << std::left << std::setw(static_cast<int>(key_width)) << group_name
+                  << std::right << std::setw(10) << "hours" << std::setw(10) << "entries" << "\n";
+        for (const auto& group : groups) {
+            out() << std::left << std::setw(static_cast<int>(key_width)) << group.key
+                      << std::right << std::setw(10) << group.hours
+                      << std::setw(10) << group.entries << "\n";
+        }
+        out() << std::string(70, '-') << "\n";
+        out() << "Total: " << total_hours << " hours\n";
+    }
+    
+    // Loads a CSV in the time_logs.csv schema into the binary store.
+    // Without a path the store is rebuilt from time_logs.csv, which also
+    // enables mirroring of future sessions into it.
+    void import_csv(const std::string& path = "") {
+        BinaryLog binary_log(binary_log_file, strings_file);
+        if (path.empty()) {
+            binary_log.reset();
+        }
+        fs::path source = path.empty() ? csv_file : fs::path(path);
+        size_t imported = 0;
+        if (path.empty()) {
+            // The whole log: sealed segments, then the rows left in the CSV
+            SegmentStore segments(csv_file, segment_dir);
+            for (const Segment& segment : segments.segments()) {
+                imported += binary_log.import_rows(segments.read(segment), false);
             }
-            tracker.start_tracking(description);
-            
-        } else if (command == "stop") {
-            tracker.stop_tracking();
-            
-        } else if (command == "status") {
-            tracker.get_status();
-            
-        } else if (command == "report") {
-            std::string date = (argc > 2) ? argv[2] : "";
-            tracker.generate_daily_report(date);
-            
+            MappedFile csv(csv_file);
+            std::string_view text = csv.view();
+            imported += binary_log.import_rows(text.substr(segments.head_start(text)), false);
         } else {
-            std::cout << "Unknown command: " << command << "\n";
-            print_usage(argv[0]);
-            return 1;
+            imported = binary_log.import_csv(source);
+        }
+        out() << "Imported " << imported << " sessions from " << source << "\n";
+        out() << "Binary log: " << binary_log_file << std::endl;
+    }
+    
+    // Appends historical sessions from path (stdin if empty or "-") in one
+    // batch, then brings the indexes, report totals and binary mirror up
+    // to date with a single pass over the new rows each
+    bool import_sessions(const std::string& path, const std::string& name) {
+        bool from_stdin = path.empty() || path == "-";
+        std::FILE* input = from_stdin ? stdin : std::fopen(path.c_str(), "rb");
+        if (!input) {
+            out() << "Could not open " << path << "\n";
+            return false;
+        }
+        auto started = std::chrono::steady_clock::now();
+        ImportResult result;
+        try {
+            result = LogImporter(csv_file, journal_file, name.empty() ? get_username() : name).run(input);
+        } catch (...) {
+            if (!from_stdin) std::fclose(input);
+            throw;
         }
+        if (!from_stdin) std::fclose(input);
         
-    } catch (const std::exception& e) {
-        std::cerr << "Error: " << e.what() << std::endl;
-        return 1;
+        for (const auto& error : result.errors) out() << "Skipped " << error << "\n";
+        if (result.skipped > result.errors.size()) {
+            out() << "... and " << result.skipped - result.errors.size() << " more\n";
+        }
+        if (result.rows > 0) index_appended_rows(result.offset);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        out() << "Imported " << result.rows << (result.rows == 1 ? " session" : " sessions")
+              << " (" << result.skipped << " skipped) in " << std::fixed << std::setprecision(2)
+              << seconds << " s\n";
+        out().unsetf(std::ios::floatfield);
+        out() << "Logged to: " << csv_file << std::endl;
+        return result.skipped == 0;
     }
     
-    return 0;
-}
-
-#if 0
-// with daemon, but not recording data after start
-// status does not work
-
-#include <iostream>
-#include <fstream>
-#include <string>
-#include <chrono>
-#include <thread>
-#include <filesystem>
-#include <ctime>
-#include <sstream>
-#include <vector>
-#include <iomanip>
-#include <csignal>
-#include <iomanip>
-
+    // Writes the rows dated from..to as format to path, or to stdout. With
+    // stdout the data is the only output; notes go to stderr.
+    bool export_range(ExportFormat format, const std::string& from, const std::string& to,
+                      const std::string& path) {
+        bool to_stdout = path.empty() || path == "-";
+        std::FILE* output = stdout;
+        if (to_stdout) {
+            out().flush();
 #ifdef _WIN32
-#include <windows.h>
-#else
-#include <unistd.h>
+            _setmode(_fileno(stdout), _O_BINARY);
 #endif
-
-namespace fs = std::filesystem;
-
-// Notification interval in seconds (3 minutes)
-static constexpr int NOTIFICATION_INTERVAL = 3 * 60;
-
-struct SessionData {
-    std::string name;
-    std::string start_time;
-    std::string description;
-    bool valid = false;
-};
-
-void send_notification(const std::string& title, const std::string& message) {
-#ifdef _WIN32
-    std::string escaped_title = title;
-    std::string escaped_message = message;
-    // Replace newlines and quotes
-    for (auto& c : escaped_message) if (c=='\n') c=' ';
-    for (auto& c : escaped_title) if (c=='"') c='\'';
-    for (auto& c : escaped_message) if (c=='"') c='\'';
-    std::string cmd = "powershell -WindowStyle Hidden -Command \""
-        "Add-Type -AssemblyName System.Windows.Forms;"
-        "[System.Windows.Forms.MessageBox]::Show('" + escaped_message + "','" + escaped_title + "','OK','Information')\"";
-    if (system(cmd.c_str()) != 0) {
-        std::cout << "NOTIFICATION: " << title << " - " << message << std::endl;
+        } else if (!(output = std::fopen(path.c_str(), "wb"))) {
+            out() << "Could not open " << path << "\n";
+            return false;
+        }
+        ExportResult result;
+        try {
+            result = LogExporter(csv_file, index_file, segment_dir).run(format, from, to, output);
+        } catch (...) {
+            if (!to_stdout) {
+                std::fclose(output);
+                std::error_code ignored;
+                fs::remove(path, ignored);
+            }
+            throw;
+        }
+        if (!to_stdout && std::fclose(output) != 0) {
+            throw std::runtime_error("Could not write " + path);
+        }
+        
+        std::ostream& notes = to_stdout ? std::cerr : out();
+        if (result.skipped > 0) {
+            notes << "Skipped " << result.skipped << (result.skipped == 1 ? " row" : " rows")
+                  << " with unreadable start or end times\n";
+        }
+        if (!to_stdout) {
+            notes << "Exported " << result.rows << (result.rows == 1 ? " session" : " sessions") << " ("
+                  << result.bytes << " bytes) to " << path << std::endl;
+        }
+        return true;
     }
-#else
-    std::string cmd = "notify-send -i time-admin -u normal -t 5000 \""
-        + title + "\" \"" + message + "\"";
-    if (system(cmd.c_str()) != 0) {
-        std::cout << "NOTIFICATION: " << title << " - " << message << std::endl;
+    
+    // Sets a one-shot alert at local time due, shown by the daemon
+    void add_reminder(int64_t due, const std::string& message) {
+        Alert alert = ReminderList(reminders_file).add(due, message);
+        char text[iso_time::ISO_LENGTH];
+        iso_time::format_iso(alert.due, text);
+        std::string_view when(text, sizeof(text));
+        out() << "Reminder " << alert.id << " set for " << when.substr(0, 10) << " " << when.substr(11) << "\n";
+        if (!daemon_process) out() << "No daemon is running; it is shown once one starts.\n";
     }
-#endif
-}
-
-SessionData read_session_data(const fs::path& state_file) {
-    SessionData data;
-    if (!fs::exists(state_file)) return data;
-    std::ifstream f(state_file);
-    std::string line;
-    while (std::getline(f,line)) {
-        auto p = line.find("\"name\"");
-        if (p!=std::string::npos) {
-            auto s = line.find(':',p)+2;
-            data.name = line.substr(s, line.find('"',s)-s);
-        }
-        p = line.find("\"start_time\"");
-        if (p!=std::string::npos) {
-            auto s = line.find(':',p)+2;
-            data.start_time = line.substr(s, line.find('"',s)-s);
-        }
-        p = line.find("\"description\"");
-        if (p!=std::string::npos) {
-            auto s = line.find(':',p)+2;
-            data.description = line.substr(s, line.find('"',s)-s);
-        }
-    }
-    data.valid = !data.start_time.empty() && !data.description.empty();
-    return data;
-}
-
-void notification_loop(const fs::path& state_file) {
-    auto last = std::chrono::steady_clock::now();
-    while (fs::exists(state_file)) {
-        std::this_thread::sleep_for(std::chrono::seconds(30));
-        auto now = std::chrono::steady_clock::now();
-        if (std::chrono::duration_cast<std::chrono::seconds>(now-last).count() >= NOTIFICATION_INTERVAL) {
-            auto session = read_session_data(state_file);
-            if (session.valid) {
-                std::string msg = "You've been working for "
-                    + std::to_string(NOTIFICATION_INTERVAL/60)
-                    + " minutes. Current task: " + session.description;
-                send_notification("Time Tracker Reminder", msg);
-            }
-            last = now;
+    
+    void list_reminders() {
+        std::vector<Alert> alerts = ReminderList(reminders_file).load();
+        if (alerts.empty()) {
+            out() << "No reminders set.\n";
+            return;
         }
+        std::sort(alerts.begin(), alerts.end(), [](const Alert& a, const Alert& b) {
+            return a.due != b.due ? a.due < b.due : a.id < b.id;
+        });
+        out() << std::left << std::setw(6) << "id" << std::setw(21) << "due" << "message\n";
+        for (const auto& alert : alerts) {
+            char text[iso_time::ISO_LENGTH];
+            iso_time::format_iso(alert.due, text);
+            std::string when(text, sizeof(text));
+            when[10] = ' ';
+            out() << std::left << std::setw(6) << alert.id << std::setw(21) << when << alert.message << "\n";
+        }
+        out() << std::right;
+    }
+    
+    bool cancel_reminder(uint64_t id) {
+        if (ReminderList(reminders_file).remove({id}) == 0) {
+            out() << "No reminder " << id << ".\n";
+            return false;
+        }
+        out() << "Reminder " << id << " cancelled.\n";
+        return true;
+    }
+    
+    // Seals rows dated before `before` (default: the start of the current
+    // month or year) into compressed segment files
+    void compact_log(const std::string& before, bool by_year) {
+        std::string cutoff = before;
+        if (cutoff.empty()) {
+            cutoff = get_current_date();
+            cutoff.replace(by_year ? 5 : 8, std::string::npos, by_year ? "01-01" : "01");
+        }
+        int64_t before_day = 0;
+        if (cutoff.size() != 10 || !iso_time::parse_day(cutoff, before_day)) {
+            throw std::runtime_error("Invalid --before date: " + cutoff);
+        }
+        
+        SegmentStore segments(csv_file, segment_dir);
+        SegmentStore::CompactStats stats = segments.compact(journal_file, before_day, by_year);
+        rollup_cache().sync();
+        search_index().sync();
+        if (stats.segments == 0) {
+            out() << "Nothing to compact before " << cutoff << ".\n";
+            return;
+        }
+        out() << "Sealed " << stats.rows << " rows dated before " << cutoff << " into " << stats.segments
+              << (stats.segments == 1 ? " segment" : " segments") << " (" << SegmentStore::compression()
+              << "): " << stats.raw_bytes << " -> " << stats.stored_bytes << " bytes\n";
+        out() << "Segments: " << segment_dir << std::endl;
+    }
+    
+    // Writes the binary store as CSV to path, or to stdout
+    void export_csv(const std::string& path = "") {
+        BinaryLog binary_log(binary_log_file, strings_file);
+        if (!binary_log.enabled()) {
+            out() << "Binary log is not enabled. Run import-csv first.\n";
+            return;
+        }
+        if (path.empty()) {
+            binary_log.export_csv(out());
+            return;
+        }
+        std::ofstream file(path);
+        if (!file) {
+            throw std::runtime_error("Could not open " + path);
+        }
+        binary_log.export_csv(file);
+        out() << "Exported binary log to " << path << std::endl;
+    }
+        
+    // Reads and decodes the session state file.
+    // Returns a SessionData with .valid=true if parsing succeeded.
+    SessionData read_session_data(const fs::path& state_file) {
+        SessionData data;
+        load_session(state_file, data);
+        return data;
     }
-}
-
-void print_usage(const char* prog) {
-    std::cout<<"Usage:\n"
-        << prog << " start [description]\n"
-        << prog << " stop\n"
-        << prog << " status\n"
-        << prog << " report [YYYY-MM-DD]\n";
-}
-
-void print_status(const fs::path& state_file) {
-    if (!fs::exists(state_file)) {
-        std::cout << "Time tracking is not currently running.\n";
-        return;
-    }
-    SessionData session = read_session_data(state_file);
-    if (!session.valid) {
-        std::cout << "Error reading session data.\n";
-        return;
-    }
-    std::cout << "Time tracking is ACTIVE\n";
-    std::cout << "Started: " << session.start_time << "\n";
-    std::cout << "Description: " << session.description << "\n";
-    std::cout << "User: " << session.name << "\n";
-}
-
-void print_report(const fs::path& csv_file, const std::string& date="") {
-    std::ifstream f(csv_file);
-    if (!f) {
-        std::cout << "Could not open CSV file: " << csv_file << "\n";
-        return;
-    }
-    std::string target;
-    if (date.empty()) {
-        std::ostringstream oss;
-        std::time_t t = std::time(nullptr);
-        oss << std::put_time(std::localtime(&t), "%Y-%m-%d");
-        target = oss.str();
-    } else {
-        target = date;
-    }
-    std::string line;
-    // Skip header
-    if (!std::getline(f, line)) {
-        std::cout << "CSV is empty.\n";
-        return;
-    }
-    std::vector<std::string> entries;
-    double total = 0.0;
-    while (std::getline(f, line)) {
-        if (line.find(target) != std::string::npos) {
-            entries.push_back(line);
-            // Parse duration (5th field)
-            std::istringstream ss(line);
-            std::string field;
-            for (int i=0; i<=4; ++i) {
-                std::getline(ss, field, ',');
-            }
-            total += std::stod(field);
-        }
-    }
-    if (entries.empty()) {
-        std::cout << "No entries for " << target << "\n";
-        return;
-    }
-    std::cout << "=== Report for " << target << " ===\n"
-              << "Total Entries: " << entries.size() << "\n"
-              << "Total Hours: " << std::fixed << std::setprecision(2) << total << "\n\n"
-              << "Details:\n";
-    for (auto &e : entries) {
-        std::cout << e << "\n";
-    }
-}
-
-// Helper to get config directory
-fs::path get_config_dir() {
-    const char* home = getenv("HOME");
-#ifdef _WIN32
-    if (!home) home = getenv("USERPROFILE");
-#endif
-    if (!home) throw std::runtime_error("HOME/USERPROFILE not set");
-    return fs::path(home) / ".time_tracker";
-}
 
-int main(int argc,char** argv) {
-    if (argc<2) { print_usage(argv[0]); return 1; }
-    fs::path config = get_config_dir();
-    fs::path state = config/"current_session.json";
-    fs::path pidf  = config/"daemon.pid";
-    fs::path csv   = config/"time_logs.csv";
-    std::string cmd=argv[1];
-    if (cmd=="daemon") {
-        notification_loop(state);
-        return 0;
+    // Logs the time every running session spent before idle_start and the
+    // idle stretch up to resumed as separate rows, then restarts the
+    // sessions at resumed. Sessions started while the user was away are left alone.
+    void split_idle_sessions(std::time_t idle_start, std::time_t resumed) {
+        std::string resumed_time(ClockSnapshot(resumed).iso());
+        std::vector<LoggedRow> logged;
+        SessionTable sessions(sessions_file);
+        for (const auto& running : sessions.list()) {
+            int64_t start_local = 0;
+            if (!iso_time::parse_iso(running.start_time, start_local) ||
+                iso_time::local_to_utc(start_local) > idle_start) {
+                continue;
+            }
+            sessions.split(running.session, resumed_time, [&](const SessionData& session) {
+                std::string rows;
+                std::vector<LoggedRow> split;
+                SessionData idle = session;
+                if (iso_time::local_to_utc(start_local) < idle_start) {
+                    split.push_back(format_session_row(session, idle_start, rows));
+                }
+                idle.start_time = std::string(ClockSnapshot(idle_start).iso());
+                idle.description += IDLE_SUFFIX;
+                split.push_back(format_session_row(idle, resumed, rows));
+                append_rows(rows);
+                logged.insert(logged.end(), split.begin(), split.end());
+            });
+        }
+        if (!logged.empty()) index_logged_rows(logged);
     }
-    // other commands: start/stop/status/report
-    // start: write state_file, write pid, spawn daemon
-    if (cmd=="start") {
-        fs::create_directories(config);
-        std::ofstream s(state);
-        s<<"{\n"
-         <<" \"name\": \""<<getenv("USER")<<"\",\n"
-         <<" \"start_time\": \"";
-        {
-            auto now = std::chrono::system_clock::now();
-            auto t = std::chrono::system_clock::to_time_t(now);
-            std::ostringstream oss;
-            oss << std::put_time(std::localtime(&t), "%Y-%m-%dT%H:%M:%S");
-            s << oss.str();
-        }
-        s << "\",\n"
-         <<" \"description\": \""<<(argc>2?argv[2]:"Work session")<<"\"\n}";
-        s.close();
-        std::ofstream p(pidf); p<<getpid(); p.close();
+    
+    // Looks at how long the user has been idle. Past idle_threshold the
+    // user counts as away from their last input; once input arrives again
+    // the away time is split off the running sessions. Returns how long
+    // until the answer can next change: while the user is active, nothing
+    // can happen before the threshold is reached, so a busy user costs one
+    // query per threshold. Caller holds daemon_mutex.
+    std::chrono::seconds check_idle() {
+        int64_t idle = 0;
+        if (idle_threshold <= 0 || !idle_monitor->idle_seconds(idle)) {
+            return std::chrono::seconds(IDLE_RETRY_SECONDS);
+        }
+        std::time_t now = std::time(nullptr);
+        if (idle_since) {
+            // Counters only have whole seconds: allow one of jitter
+            if (now - idle <= idle_since + 1) return std::chrono::seconds(IDLE_POLL_SECONDS);
+            split_idle_sessions(idle_since, now - idle);
+            idle_since = 0;
+        }
+        if (idle >= idle_threshold) {
+            idle_since = now - idle;
+            return std::chrono::seconds(IDLE_POLL_SECONDS);
+        }
+        return std::chrono::seconds(idle_threshold - idle);
+    }
+    
+    // Rewrites the status page from the session table and the idle state.
+    // daemon_mutex keeps it from racing retire() at shutdown.
+    void publish_status() {
+        StatusPage::Status status;
+        table_status(status);
+        std::lock_guard<std::mutex> lock(daemon_mutex);
+        if (daemon_stop_requested) return;
+        status.idle_since = idle_since;
+        status_page->publish(status);
+    }
+    
+    // Every reminder is a timer in one wheel (timer_wheel.hpp), ticking in
+    // Unix seconds: one per running session, the break and end-of-day
+    // reminders, the idle checks and each alert in reminders.tsv. The loop
+    // sleeps until the earliest is due or the session table or the
+    // reminder list changes, so it wakes once per reminder, never to
+    // poll, and not at all while nothing is scheduled. The status page is
+    // republished whenever the sessions or the idle state change.
+    void notification_loop() {
+        enum class Kind { Session, Break, EndOfDay, Alert, IdleCheck };
+        struct Timer {
+            Kind kind = Kind::Session;
+            std::string session; // for Session
+            uint64_t alert = 0;  // for Alert
+        };
+        using Timers = TimerWheel<Timer>;
+        struct Tracked {
+            std::string start_time;
+            std::string description;
+            Timers::Id reminder = 0;
+        };
+        struct Pending {
+            Alert alert;
+            Timers::Id timer = 0;
+        };
+        
+        Timers timers(static_cast<uint64_t>(std::time(nullptr)));
+        std::map<std::string, Tracked> sessions; // by session name
+        std::map<uint64_t, Pending> alerts;      // by alert id
+        Timers::Id idle_check = 0;
+        Timers::Id break_reminder = 0;
+        Timers::Id end_of_day_reminder = 0;
+        bool away = false;
+        std::pair<fs::file_time_type, uintmax_t> alerts_stamp{};
+        std::vector<uint64_t> shown; // alerts to drop from the list
+        
+        StateWatcher watcher(sessions_file);
+        watcher.watch(reminders_file);
+        auto now = [] { return static_cast<uint64_t>(std::time(nullptr)); };
+        auto cancel = [&](Timers::Id& id) {
+            if (id) timers.cancel(id);
+            id = 0;
+        };
+        // The next time the clock reads end_of_day, in Unix seconds
+        auto next_end_of_day = [&] {
+            int64_t local = ClockSnapshot::now().local();
+            int64_t target = iso_time::day_of(local) * 86400 + end_of_day;
+            if (target <= local) target += 86400;
+            return static_cast<uint64_t>(iso_time::local_to_utc(target));
+        };
+        
+        auto refresh_sessions = [&] {
+            std::map<std::string, Tracked> updated;
+            for (auto& session : SessionTable(sessions_file, SessionTable::Mode::ReadOnly).list()) {
+                Tracked tracked{session.start_time, session.description, 0};
+                auto known = sessions.find(session.session);
+                // A new (or restarted) session begins a fresh reminder cycle
+                if (known != sessions.end() && known->second.start_time == session.start_time) {
+                    std::swap(tracked.reminder, known->second.reminder);
+                } else if (remind_interval > 0) {
+                    tracked.reminder = timers.schedule(now() + remind_interval, Timer{Kind::Session, session.session, 0});
+                }
+                updated[session.session] = std::move(tracked);
+            }
+            for (auto& entry : sessions) cancel(entry.second.reminder);
+            sessions.swap(updated);
+            
+            // Idle time, breaks and the end of the day only matter while
+            // something is being tracked
+            if (sessions.empty()) {
+                cancel(idle_check);
+                cancel(break_reminder);
+                cancel(end_of_day_reminder);
+            } else {
+                if (!idle_check) idle_check = timers.schedule(now(), Timer{Kind::IdleCheck, {}, 0});
+                if (break_interval > 0 && !break_reminder && !away) {
+                    break_reminder = timers.schedule(now() + break_interval, Timer{Kind::Break, {}, 0});
+                }
+                if (end_of_day >= 0 && !end_of_day_reminder) {
+                    end_of_day_reminder = timers.schedule(next_end_of_day(), Timer{Kind::EndOfDay, {}, 0});
+                }
+            }
+            publish_status();
+        };
+        
+        // Reschedules only the alerts that were added, changed or cancelled
+        auto refresh_alerts = [&] {
+            std::error_code error;
+            std::pair<fs::file_time_type, uintmax_t> stamp{fs::last_write_time(reminders_file, error), 0};
+            if (!error) stamp.second = fs::file_size(reminders_file, error);
+            if (error) stamp = {};
+            if (stamp == alerts_stamp) return;
+            alerts_stamp = stamp;
+            
+            std::map<uint64_t, Pending> updated;
+            for (auto& alert : ReminderList(reminders_file).load()) {
+                Pending pending{alert, 0};
+                auto known = alerts.find(alert.id);
+                if (known != alerts.end() && known->second.alert.due == alert.due) {
+                    std::swap(pending.timer, known->second.timer);
+                } else {
+                    uint64_t due = static_cast<uint64_t>(iso_time::local_to_utc(alert.due));
+                    pending.timer = timers.schedule(due, Timer{Kind::Alert, "", alert.id});
+                }
+                updated[alert.id] = std::move(pending);
+            }
+            for (auto& entry : alerts) cancel(entry.second.timer);
+            alerts.swap(updated);
+        };
+        
+        auto fire = [&](Timer timer) {
+            uint64_t tick = timers.now();
+            switch (timer.kind) {
+            case Kind::Session: {
+                auto tracked = sessions.find(timer.session);
+                if (tracked == sessions.end()) return;
+                // No one to remind while the user is away
+                if (!away) {
+                    const std::string& name = timer.session;
+                    std::string task = name == DEFAULT_SESSION ? "Current task: " : "Current task (" + name + "): ";
+                    send_notification("Time Tracker Reminder", "You've been working for "
+                                      + std::to_string(remind_interval / 60) + " minutes. " + task
+                                      + tracked->second.description);
+                }
+                tracked->second.reminder = timers.schedule(tick + remind_interval, timer);
+                return;
+            }
+            case Kind::Break:
+                // A break under way ends the stretch; the return starts the next one
+                break_reminder = 0;
+                if (away) return;
+                send_notification("Time Tracker Break", "You've been working for "
+                                  + std::to_string(break_interval / 60) + " minutes without a break.");
+                break_reminder = timers.schedule(tick + break_interval, timer);
+                return;
+            case Kind::EndOfDay: {
+                end_of_day_reminder = timers.schedule(next_end_of_day(), timer);
+                if (away) return;
+                std::string names;
+                for (const auto& entry : sessions) names += (names.empty() ? "" : ", ") + entry.first;
+                send_notification("Time Tracker", "It's " + std::string(ClockSnapshot::now().clock().substr(0, 5))
+                                  + " and still tracking: " + names);
+                return;
+            }
+            case Kind::Alert: {
+                auto pending = alerts.find(timer.alert);
+                if (pending == alerts.end()) return;
+                send_notification("Time Tracker Reminder", pending->second.alert.message);
+                shown.push_back(timer.alert);
+                alerts.erase(pending);
+                return;
+            }
+            case Kind::IdleCheck: {
+                bool was_away = away;
+                std::chrono::seconds delay;
+                {
+                    std::lock_guard<std::mutex> lock(daemon_mutex);
+                    delay = check_idle();
+                    away = idle_since != 0;
+                }
+                idle_check = timers.schedule(tick + static_cast<uint64_t>(delay.count()), timer);
+                if (away == was_away) return;
+                publish_status();
+                if (away) cancel(break_reminder);
+                else if (break_interval > 0 && !break_reminder) {
+                    break_reminder = timers.schedule(now() + break_interval, Timer{Kind::Break, {}, 0});
+                }
+                return;
+            }
+            }
+        };
+        
+        refresh_sessions();
+        refresh_alerts();
+        while (!daemon_stop_requested) {
+            uint64_t due = timers.next_due();
+            uint64_t current = now();
+            std::chrono::seconds wait = std::chrono::hours(24);
+            if (due != Timers::NEVER) wait = std::min(wait, std::chrono::seconds(due > current ? due - current : 0));
+            if (watcher.wait_until(std::chrono::steady_clock::now() + wait) == StateWatcher::Wake::Changed) {
+                refresh_sessions();
+                refresh_alerts();
+                continue;
+            }
+            timers.advance(now(), fire);
+            if (!shown.empty()) {
+                std::lock_guard<std::mutex> lock(daemon_mutex);
+                ReminderList(reminders_file).remove(shown);
+                shown.clear();
+            }
+        }
+    }
+    
+    // Runs this process as the daemon: serves commands over the control
+    // channel and sends reminders.
+    int run_daemon() {
+        ControlServer server(control_endpoint(config_dir));
+        
+        std::ofstream pid_file(daemon_pid_file);
 #ifdef _WIN32
-        std::string cmd = "start /B \"\" \"" + std::string(argv[0]) + "\" daemon";
-        system(cmd.c_str());
+        pid_file << GetCurrentProcessId() << "\n";
 #else
-        if (fork()==0) { execlp(argv[0],argv[0],"daemon",nullptr); exit(1);} 
+        pid_file << getpid() << "\n";
 #endif
-        send_notification("Time Tracker Started", "Started tracking");
+        pid_file.close();
+        
+        daemon_process = true;
+        idle_monitor = std::make_unique<IdleMonitor>();
+        idle_threshold = DEFAULT_IDLE_MINUTES * 60;
+        status_page = std::make_unique<StatusPage>(status_page_file, StatusPage::Mode::Publish);
+        if (const char* minutes = getenv("TIME_TRACKER_IDLE_MINUTES")) idle_threshold = std::atoll(minutes) * 60;
+        if (const char* minutes = getenv("TIME_TRACKER_REMIND_MINUTES")) remind_interval = std::atoll(minutes) * 60;
+        if (const char* minutes = getenv("TIME_TRACKER_BREAK_MINUTES")) break_interval = std::atoll(minutes) * 60;
+        int64_t end_of_day_seconds = 0;
+        const char* end_of_day_time = getenv("TIME_TRACKER_END_OF_DAY");
+        if (end_of_day_time && iso_time::parse_clock(std::string(end_of_day_time) + ":00", end_of_day_seconds)) {
+            end_of_day = end_of_day_seconds;
+        }
+        
+        install_stop_handlers();
+        std::thread([this]() {
+            notification_loop();
+        }).detach();
+        
+        server.serve([this](const std::vector<std::string>& args, std::string& response) {
+            if (args.empty()) return 1;
+            if (args[0] == "ping") return 0;
+            if (args[0] == "shutdown") {
+                daemon_stop_requested = true;
+                response = "Daemon stopped.\n";
+                return 0;
+            }
+            std::lock_guard<std::mutex> lock(daemon_mutex);
+            std::ostringstream captured;
+            output = &captured;
+            int code = 1;
+            try {
+                code = run_command(*this, args);
+            } catch (...) {
+                output = &std::cout;
+                throw;
+            }
+            output = &std::cout;
+            response = captured.str();
+            return code;
+        }, daemon_stop_requested);
+        
+        {
+            std::lock_guard<std::mutex> lock(daemon_mutex);
+            status_page->retire();
+        }
+        fs::remove(daemon_pid_file);
         return 0;
     }
-    if(cmd=="stop"){
-        if (fs::exists(pidf)){
-            int pid; std::ifstream p(pidf); p>>pid; p.close();
+    
+    // True when TIME_TRACKER_NO_DAEMON asks for every command to run locally
+    static bool daemon_disabled() {
+        const char* disabled = getenv("TIME_TRACKER_NO_DAEMON");
+        return disabled && *disabled && std::string(disabled) != "0";
+    }
+    
+    // Forwards a command to the daemon. With spawn, a daemon is started first
+    // if none is running. Returns false if the command must run locally.
+    bool call_daemon(const std::vector<std::string>& args, std::string& response, int& exit_code,
+                     bool spawn) {
+        if (daemon_disabled()) return false;
+        
+        std::string endpoint = control_endpoint(config_dir);
+        if (control_call(endpoint, args, response, exit_code)) return true;
+        if (!spawn || !start_daemon()) return false;
+        return control_call(endpoint, args, response, exit_code);
+    }
+    
+private:
+    // Starts a daemon for this config directory unless one is already serving it
+    bool start_daemon() {
+        std::string endpoint = control_endpoint(config_dir);
+        std::string response;
+        int exit_code = 0;
+        if (control_call(endpoint, {"ping"}, response, exit_code)) return true;
+        return spawn_daemon_process(endpoint);
+    }
+    
+    static void install_stop_handlers() {
+#ifndef _WIN32
+        // No SA_RESTART, so a blocked accept() returns and sees the flag
+        struct sigaction action {};
+        action.sa_handler = [](int) { daemon_stop_requested = true; };
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGTERM, &action, nullptr);
+        sigaction(SIGINT, &action, nullptr);
+        signal(SIGHUP, SIG_IGN);
+#endif
+    }
+    
+public:
+    void stop_daemon() {
+        std::string response;
+        int exit_code = 0;
+        if (control_call(control_endpoint(config_dir), {"shutdown"}, response, exit_code)) {
+            out() << response;
+            return;
+        }
+        
+        // No control channel: fall back to signalling the recorded PID
+        if (fs::exists(daemon_pid_file)) {
+            std::ifstream pid_file(daemon_pid_file);
+            std::string pid_str;
+            if (std::getline(pid_file, pid_str)) {
+                int pid = std::stoi(pid_str);
 #ifdef _WIN32
-            TerminateProcess(OpenProcess(PROCESS_TERMINATE,FALSE,pid),1);
+                HANDLE hProcess = OpenProcess(PROCESS_TERMINATE, FALSE, pid);
+                if (hProcess != NULL) {
+                    TerminateProcess(hProcess, 1); // exit code 1
+                    CloseHandle(hProcess);
+                }
 #else
-            kill(pid,SIGTERM);
+                kill(pid, SIGTERM);
 #endif
-            fs::remove(pidf);
+            }
+            pid_file.close();
+            fs::remove(daemon_pid_file);
+            out() << "Daemon stopped.\n";
+        } else {
+            out() << "Daemon is not running.\n";
         }
-        if (fs::exists(state)) fs::remove(state);
-        send_notification("Time Tracker Stopped","Session completed and logged");
-        return 0;
     }
-    if(cmd=="status"){
-        //if(fs::exists(state)) std::cout<<"Tracking active\n";
-        //else std::cout<<"Not running\n";
-        print_status(state);
+    
+    // Runs this process as a team server: clients push their logs with
+    // "push" and team-wide reports are answered from the in-memory store.
+    int run_team_server(const std::string& address) {
+        const std::string token = team_token();
+        if (!may_serve(address, token, "TIME_TRACKER_TEAM_TOKEN")) return 1;
+        ControlServer server(address, ControlServer::Transport::Tcp);
+        install_stop_handlers();
+        out() << "Team server listening on " << address << std::endl;
+        
+        TeamStore store;
+        server.serve([&](const std::vector<std::string>& args, std::string& response) {
+            return serve_team_request(store, token, args, response);
+        }, daemon_stop_requested);
+        out() << "Team server stopped (" << store.user_count() << " users from "
+              << store.client_count() << " clients).\n";
         return 0;
     }
-    if(cmd=="report"){
-        // report logic omitted for brevity
-        std::string date = (argc>2 ? argv[2] : "");
-        print_report(csv, date);
+    
+    // Sends the rows appended to the log since the last push, in batches
+    bool push_to_server(const std::string& address) {
+        MappedFile csv;
+        if (!csv.open(csv_file)) {
+            out() << "No time log to push.\n";
+            return true;
+        }
+        // Offsets are into the logical log, so a compaction does not disturb the cursor
+        std::string_view head = csv.view();
+        SegmentStore segments(csv_file, segment_dir);
+        const uint64_t log_size = segments.logical_offset(head, head.size());
+        const std::string token = team_token();
+        const std::string client = get_username() + "@" + host_name();
+        
+        std::string response;
+        int exit_code = 1;
+        auto call = [&](std::vector<std::string> args) {
+            if (!remote_call(address, args, response, exit_code)) {
+                throw std::runtime_error("Could not reach team server at " + address);
+            }
+            return exit_code;
+        };
+        auto reset = [&]() {
+            if (call({"reset", token, client}) != 0) throw std::runtime_error(response);
+            out() << "Time log was rewritten; pushing it again from the start.\n";
+            return uint64_t{0};
+        };
+        
+        if (call({"cursor", token, client}) != 0) {
+            out() << response;
+            return false;
+        }
+        uint64_t cursor = std::strtoull(response.c_str(), nullptr, 10);
+        if (cursor > log_size) cursor = reset();
+        
+        // The server takes only whole rows; a batch holding none (a huge
+        // row, or the unfinished last line) is retried larger or ends the push
+        size_t batch_bytes = PUSH_BATCH_BYTES;
+        size_t rows = 0;
+        bool was_reset = false;
+        while (cursor < log_size) {
+            uint64_t from = cursor;
+            uint64_t length = std::min<uint64_t>(batch_bytes, log_size - from);
+            uint64_t tail_length = std::min<uint64_t>(from, TeamStore::TAIL_BYTES);
+            std::string tail = segments.logical_bytes(head, from - tail_length, tail_length);
+            int code = call({"push", token, client, std::to_string(from), tail,
+                             segments.logical_bytes(head, from, length)});
+            if (code == 3 && !was_reset) {
+                cursor = reset();
+                was_reset = true;
+                continue;
+            }
+            if (code != 0 && code != 2) {
+                out() << response;
+                return false;
+            }
+            // 2: another push got there first; continue from its cursor
+            char* rest = nullptr;
+            uint64_t next = std::strtoull(response.c_str(), &rest, 10);
+            if (code == 0) rows += std::strtoull(rest, nullptr, 10);
+            if (next > log_size) {
+                cursor = reset();
+                continue;
+            }
+            if (next == cursor) {
+                if (from + length == log_size) break;
+                batch_bytes *= 2;
+                continue;
+            }
+            cursor = next;
+            batch_bytes = PUSH_BATCH_BYTES;
+        }
+        
+        if (rows == 0) {
+            out() << "Team server is up to date.\n";
+        } else {
+            out() << "Pushed " << rows << " rows to " << address << "\n";
+        }
+        return true;
+    }
+    
+    // Serves this machine's log to `sync` clients on other machines
+    int run_sync_server(const std::string& address) {
+        const std::string token = sync_token();
+        if (!may_serve(address, token, "TIME_TRACKER_SYNC_TOKEN")) return 1;
+        ControlServer server(address, ControlServer::Transport::Tcp);
+        install_stop_handlers();
+        out() << "Sync server listening on " << address << std::endl;
+        
+        server.serve([&](const std::vector<std::string>& args, std::string& response) {
+            return serve_sync_request(token, args, response);
+        }, daemon_stop_requested);
+        out() << "Sync server stopped.\n";
         return 0;
     }
-    print_usage(argv[0]);
-    return 1;
+    
+    // Merges the log with a sync server's: pushes the rows it has not seen,
+    // then pulls the ones this log has not seen, in batches
+    bool sync_with_server(const std::string& address) {
+        auto started = std::chrono::steady_clock::now();
+        LogSync log(csv_file, journal_file, index_file, segment_dir);
+        SyncPeers peers(sync_file);
+        SyncPeer peer = peers.find(address);
+        const std::string token = sync_token();
+        
+        std::string response;
+        int exit_code = 1;
+        uint64_t sent = 0;
+        uint64_t received = 0;
+        auto call = [&](std::vector<std::string> args) {
+            for (const auto& arg : args) sent += arg.size() + 1;
+            if (!remote_call(address, args, response, exit_code)) {
+                throw std::runtime_error("Could not reach sync server at " + address);
+            }
+            received += response.size();
+            return exit_code;
+        };
+        
+        // Push first, so the server's watermark can move past what it takes.
+        // From the top if this log was rewritten since the last sync.
+        SyncApplied pushed;
+        std::vector<std::pair<SyncCursor, SyncCursor>> taken; // where the server appended them
+        bool compress = sync_compression();
+        if (!log.matches(peer.pushed)) peer.pushed = SyncCursor{};
+        while (true) {
+            SyncBatch batch = log.read(peer.pushed.offset);
+            if (batch.rows.empty()) break;
+            int code = call({"push", token, encode_sync_batch(batch.rows, compress)});
+            // 4: a server built without zlib
+            if (code == 4 && compress) {
+                compress = false;
+                continue;
+            }
+            // "<rows> <duplicates> <before> <crc> <after> <crc>"
+            std::istringstream fields(response);
+            SyncApplied applied;
+            if (code != 0 || !(fields >> applied.rows >> applied.duplicates >> applied.before.offset >>
+                               applied.before.tail_crc >> applied.after.offset >> applied.after.tail_crc)) {
+                out() << response;
+                return false;
+            }
+            // Rows the server just took need not come back
+            if (applied.rows > 0) taken.emplace_back(applied.before, applied.after);
+            peer.pushed = batch.next;
+            pushed.rows += applied.rows;
+            pushed.duplicates += applied.duplicates;
+            if (batch.next.offset >= batch.end) break;
+        }
+        peers.store(address, peer);
+        
+        // Then pull. 3: the server's log no longer ends where it did
+        SyncApplied pulled;
+        bool restarted = false;
+        while (true) {
+            while (!taken.empty() && taken.front().first.offset <= peer.pulled.offset) {
+                if (taken.front().first.offset == peer.pulled.offset &&
+                    taken.front().first.tail_crc == peer.pulled.tail_crc) {
+                    peer.pulled = taken.front().second;
+                }
+                taken.erase(taken.begin());
+            }
+            uint64_t until = taken.empty() ? 0 : taken.front().first.offset;
+            int code = call({"pull", token, std::to_string(peer.pulled.offset), std::to_string(peer.pulled.tail_crc),
+                             std::to_string(until), compress ? "deflate" : "none"});
+            if (code == 3 && !restarted) {
+                out() << "The log on " << address << " was rewritten; reading it again from the start.\n";
+                peer.pulled = SyncCursor{};
+                restarted = true;
+                continue;
+            }
+            // "<next> <crc> <end>\n" and the batch
+            std::istringstream header(response);
+            SyncCursor next;
+            uint64_t end = 0;
+            if (code != 0 || !(header >> next.offset >> next.tail_crc >> end)) {
+                out() << response;
+                return false;
+            }
+            std::string rows;
+            size_t newline = response.find('\n');
+            if (newline == std::string::npos || !decode_sync_batch(std::string_view(response).substr(newline + 1), rows)) {
+                throw std::runtime_error("Damaged sync batch from " + address);
+            }
+            if (!rows.empty()) {
+                SyncApplied applied = log.apply(rows);
+                if (applied.rows > 0) index_appended_rows(applied.head_offset);
+                if (applied.before.offset == peer.pushed.offset &&
+                    applied.before.tail_crc == peer.pushed.tail_crc) {
+                    peer.pushed = applied.after;
+                }
+                pulled.rows += applied.rows;
+                pulled.duplicates += applied.duplicates;
+            }
+            peer.pulled = next;
+            if (next.offset >= end || (rows.empty() && next.offset != until)) break;
+        }
+        peers.store(address, peer);
+        
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+        if (pulled.rows == 0 && pushed.rows == 0) {
+            out() << "Already in sync with " << address << ".\n";
+        } else {
+            out() << "Pulled " << pulled.rows << (pulled.rows == 1 ? " session" : " sessions") << ", pushed "
+                  << pushed.rows << (pushed.rows == 1 ? " session" : " sessions") << ".\n";
+        }
+        uint64_t duplicates = pulled.duplicates + pushed.duplicates;
+        if (duplicates > 0) out() << "Skipped " << duplicates << " already in both logs.\n";
+        out() << std::fixed << std::setprecision(1) << (sent + received) / 1024.0 << " KB exchanged in " << ms
+              << " ms\n";
+        out().unsetf(std::ios::floatfield);
+        return true;
+    }
+    
+private:
+    // Rows are sent to the team server in batches of about this size
+    static constexpr size_t PUSH_BATCH_BYTES = 1 << 20;
+    
+    // Shared secret for the team server; empty when unset
+    static std::string team_token() {
+        const char* token = getenv("TIME_TRACKER_TEAM_TOKEN");
+        return token ? std::string(token) : std::string();
+    }
+    
+    // Shared secret for the sync server; empty when unset
+    static std::string sync_token() {
+        const char* token = getenv("TIME_TRACKER_SYNC_TOKEN");
+        return token ? std::string(token) : std::string();
+    }
+    
+    // Without a token anyone who can reach the server may use it, so an
+    // address other machines can reach needs one
+    bool may_serve(const std::string& address, const std::string& token, const char* variable) {
+        if (!token.empty() || loopback_address(address)) return true;
+        out() << "Error: set " << variable << " to serve on " << address
+              << "; without it only loopback addresses such as 127.0.0.1 are allowed.\n";
+        return false;
+    }
+    
+    static std::string host_name() {
+#ifdef _WIN32
+        const char* name = getenv("COMPUTERNAME");
+        return name ? std::string(name) : "localhost";
+#else
+        char name[256] = {};
+        if (gethostname(name, sizeof(name) - 1) != 0) return "localhost";
+        return name;
+#endif
+    }
+    
+    // Team protocol: args are the command, the token, then its arguments
+    //   cursor CLIENT                  -> "<cursor>"
+    //   push CLIENT FROM TAIL ROWS     -> "<cursor> <rows>"; exit 2 if FROM is
+    //                                     not the cursor, 3 if TAIL differs
+    //   reset CLIENT
+    //   report FROM TO GROUP           -> "key<TAB>hours<TAB>entries" lines
+    static int serve_team_request(TeamStore& store, const std::string& token,
+                                  const std::vector<std::string>& args, std::string& response) {
+        if (args.size() < 2) return 1;
+        const std::string& command = args[0];
+        if (!token.empty() && !tokens_match(args[1], token)) {
+            response = "Error: team server token rejected\n";
+            return 1;
+        }
+        
+        if (command == "cursor" && args.size() == 3) {
+            response = std::to_string(store.cursor(args[2]));
+            return 0;
+        }
+        if (command == "push" && args.size() == 6) {
+            size_t rows = 0;
+            TeamStore::PushResult result =
+                store.push(args[2], std::strtoull(args[3].c_str(), nullptr, 10), args[4], args[5], rows);
+            response = std::to_string(store.cursor(args[2])) + " " + std::to_string(rows);
+            switch (result) {
+            case TeamStore::PushResult::Applied:     return 0;
+            case TeamStore::PushResult::WrongOffset: return 2;
+            case TeamStore::PushResult::Diverged:    return 3;
+            }
+        }
+        if (command == "reset" && args.size() == 3) {
+            store.reset(args[2]);
+            return 0;
+        }
+        if (command == "report" && args.size() == 5) {
+            int64_t from_day = 0;
+            int64_t to_day = 0;
+            GroupBy group_by;
+            if (args[2].size() != 10 || !iso_time::parse_day(args[2], from_day) ||
+                args[3].size() != 10 || !iso_time::parse_day(args[3], to_day) ||
+                !parse_group_by(args[4], group_by)) {
+                response = "Error: invalid report request\n";
+                return 1;
+            }
+            std::vector<GroupTotal> groups;
+            try {
+                groups = store.report(from_day, to_day, group_by);
+            } catch (const std::invalid_argument& e) {
+                response = std::string("Error: ") + e.what() + "\n";
+                return 1;
+            }
+            char hours[32];
+            for (const auto& group : groups) {
+                std::string key = group.key;
+                std::replace(key.begin(), key.end(), '\t', ' ');
+                std::replace(key.begin(), key.end(), '\n', ' ');
+                std::snprintf(hours, sizeof(hours), "%.6f", group.hours);
+                response += key + "\t" + hours + "\t" + std::to_string(group.entries) + "\n";
+            }
+            return 0;
+        }
+        response = "Error: unknown team request: " + command + "\n";
+        return 1;
+    }
+    
+
+    // Sync protocol: args are the command, the token, then its arguments
+    //   push BATCH            -> "<rows> <duplicates> <before> <crc> <after> <crc>";
+    //                            exit 4 if BATCH is deflated and this build has no zlib
+    //   pull FROM CRC UNTIL ACCEPT
+    //                         -> "<next> <crc> <end>\n" and the batch from FROM
+    //                            to UNTIL (0: the end), deflated if ACCEPT is
+    //                            "deflate"; exit 3 if the log no longer holds
+    //                            FROM with CRC before it
+    int serve_sync_request(const std::string& token, const std::vector<std::string>& args,
+                           std::string& response) {
+        if (args.size() < 2) return 1;
+        const std::string& command = args[0];
+        if (!token.empty() && !tokens_match(args[1], token)) {
+            response = "Error: sync server token rejected\n";
+            return 1;
+        }
+        
+        LogSync log(csv_file, journal_file, index_file, segment_dir);
+        if (command == "pull" && args.size() == 6) {
+            SyncCursor from;
+            from.offset = std::strtoull(args[2].c_str(), nullptr, 10);
+            from.tail_crc = static_cast<uint32_t>(std::strtoul(args[3].c_str(), nullptr, 10));
+            if (!log.matches(from)) return 3;
+            SyncBatch batch = log.read(from.offset, std::strtoull(args[4].c_str(), nullptr, 10));
+            response = std::to_string(batch.next.offset) + " " + std::to_string(batch.next.tail_crc) + " " +
+                       std::to_string(batch.end) + "\n" + encode_sync_batch(batch.rows, args[5] == "deflate");
+            return 0;
+        }
+        if (command == "push" && args.size() == 3) {
+            std::string rows;
+            if (!decode_sync_batch(args[2], rows)) {
+                bool deflated = !sync_compression() && sync_batch_deflated(args[2]);
+                response = deflated ? "Error: sync server built without zlib\n" : "Error: damaged sync batch\n";
+                return deflated ? 4 : 1;
+            }
+            SyncApplied applied = log.apply(rows);
+            if (applied.rows > 0) index_appended_rows(applied.head_offset);
+            response = std::to_string(applied.rows) + " " + std::to_string(applied.duplicates) + " " +
+                       std::to_string(applied.before.offset) + " " + std::to_string(applied.before.tail_crc) + " " +
+                       std::to_string(applied.after.offset) + " " + std::to_string(applied.after.tail_crc);
+            return 0;
+        }
+        response = "Error: unknown sync request: " + command + "\n";
+        return 1;
+    }
+};
+
+// Team server port when team-server is given no address
+static constexpr int TEAM_PORT = 7464;
+// And the sync server's
+static constexpr int SYNC_PORT = 7465;
+// Both then listen on loopback only
+static constexpr const char* LOOPBACK_HOST = "127.0.0.1";
+
+void print_usage(const std::string& program_name, std::ostream& os = std::cout) {
+    os << "Time Reporting Tool - C++ Version\n\n";
+    os << "Usage:\n";
+    os << "  " << program_name << " start [-s name] [description]\n";
+    os << "                                    - Start time tracking (session \"default\")\n";
+    os << "  " << program_name << " stop [name|--all]    - Stop a session (the only one if unnamed)\n";
+    os << "  " << program_name << " status [name]        - Check current status\n";
+    os << "  " << program_name << " status --fast [name] - One line for shell prompts; exit 1 if none runs\n";
+    os << "  " << program_name << " status --format FORMAT [name]\n";
+    os << "                                    - The same with {name} {description} {start} {elapsed}\n";
+    os << "                                      {seconds} {count} {idle}\n";
+    os << "  " << program_name << " report [date]        - Generate daily report\n";
+    os << "  " << program_name << " report --from D1 --to D2 [--group-by day|week|description|user]\n";
+    os << "                                    - Totals for a range of days\n";
+    os << "  " << program_name << " report --tree [date | --from D1 --to D2]\n";
+    os << "                                    - Hours per project and task (\"project: task\" descriptions)\n";
+    os << "  " << program_name << " report --heatmap|--by-hour [--from D1] [--to D2] [--format text|csv|svg]\n";
+    os << "                                    - Hours per day as a calendar (the last year by default),\n";
+    os << "                                      or per weekday and hour of the day\n";
+    os << "  " << program_name << " search [--limit N] TERM...\n";
+    os << "                                    - Sessions whose description has every term (auth*: prefix)\n";
+    os << "  " << program_name << " query [--limit N] [--explain] EXPRESSION\n";
+    os << "                                    - Sessions matching e.g. user=alice AND duration>2 AND desc~review\n";
+    os << "  " << program_name << " remind in DELAY|at TIME MESSAGE...\n";
+    os << "                                    - Alert at a time (HH:MM or YYYY-MM-DDTHH:MM) or after 25m, 2h...\n";
+    os << "  " << program_name << " remind list | cancel ID\n";
+    os << "                                    - Pending alerts\n";
+    os << "  " << program_name << " stats [--json]       - Counters and latencies measured by the daemon\n";
+    os << "  " << program_name << " import [--name USER] [file|-]\n";
+    os << "                                    - Append historical sessions (stdin by default)\n";
+    os << "  " << program_name << " import-csv [file]    - Load CSV rows into the binary log\n";
+    os << "  " << program_name << " export-csv [file]    - Write the binary log as CSV\n";
+    os << "  " << program_name << " export --format json|arrow|parquet|ics [--from D1] [--to D2] [--output FILE]\n";
+    os << "                                    - Sessions for BI tools and calendars (stdout by default)\n";
+    os << "  " << program_name << " compact [--by month|year] [--before DATE]\n";
+    os << "                                    - Seal old rows into compressed segments\n";
+    os << "  " << program_name << " daemon [stop]        - Run (or stop) the background daemon\n";
+    os << "  " << program_name << " team-server [HOST:PORT]\n";
+    os << "                                    - Aggregate the team's logs (default " << LOOPBACK_HOST << ":"
+       << TEAM_PORT << ")\n";
+    os << "  " << program_name << " push HOST:PORT       - Send new log rows to a team server\n";
+    os << "  " << program_name << " report --server HOST:PORT --from D1 --to D2 [--group-by day|week|user]\n";
+    os << "                                    - Team-wide totals from a team server\n";
+    os << "  " << program_name << " sync-server [HOST:PORT]\n";
+    os << "                                    - Serve this log to sync (default " << LOOPBACK_HOST << ":"
+       << SYNC_PORT << ")\n";
+    os << "  " << program_name << " sync HOST:PORT       - Exchange new sessions with a sync server\n";
+    os << "\nstart/stop/status/report/search/stats/remind are answered by the daemon when it is running;\n";
+    os << "set TIME_TRACKER_NO_DAEMON=1 to always run them in this process.\n";
+    os << "The daemon logs time away from the keyboard as separate \"(idle)\" rows after\n";
+    os << "TIME_TRACKER_IDLE_MINUTES (default 10; 0 turns this off).\n";
+    os << "It reminds every TIME_TRACKER_REMIND_MINUTES (default 3) per session, after\n";
+    os << "TIME_TRACKER_BREAK_MINUTES of work without a break and, with TIME_TRACKER_END_OF_DAY\n";
+    os << "(HH:MM), when sessions are still running at the end of the day; 0 turns one off.\n";
+    os << "team-server and sync-server listen beyond loopback only when TIME_TRACKER_TEAM_TOKEN\n";
+    os << "or TIME_TRACKER_SYNC_TOKEN, respectively, is set.\n";
+    os << "\nExamples:\n";
+    os << "  " << program_name << " start \"Coding new features\"\n";
+    os << "  " << program_name << " start -s TICKET-42 \"Fix login bug\"\n";
+    os << "  " << program_name << " stop TICKET-42\n";
+    os << "  " << program_name << " report 2025-10-03\n";
+    os << "  " << program_name << " report --from 2025-10-01 --to 2025-10-31 --group-by week\n";
+    os << "  " << program_name << " report --tree --from 2025-10-01 --to 2025-10-31\n";
+    os << "  " << program_name << " search auth*\n";
+    os << "  " << program_name << " remind at 16:45 Submit the timesheet\n";
+    os << "  " << program_name << " query 'date>=2025-10-01 AND (desc~review OR desc~\"code review\") AND NOT user=bob'\n";
+    os << "  " << program_name << " report --server lead-box:" << TEAM_PORT << " --from 2025-10-01 --to 2025-10-07 --group-by user\n";
+    os << "  " << program_name << " sync desktop:" << SYNC_PORT << "\n";
 }
-#endif
\ No newline at end of file
+
+// Name used in usage messages; set from argv[0]
+static std::string program_name = "time_tracker.exe";
+
+// Runs one command in this process. args[0] is the command name.
+// Also used by the daemon to serve requests from the control channel.
+int run_command(TimeTracker& tracker, const std::vector<std::string>& args) {
+    METRIC_TIMER(COMMAND);
+    std::ostream& out = tracker.out();
+    const std::string& command = args[0];
+    size_t argc = args.size();
+    
+    // Lazy per-command init: only status, stats and daemon stop work
+    // without the data directory, and they must not create it
+    bool read_only = command == "status" || command == "stats" ||
+                     (command == "daemon" && argc > 1 && args[1] == "stop");
+    if (!read_only) tracker.setup_directories();
+    
+    if (command == "start") {
+        std::string session_name = TimeTracker::DEFAULT_SESSION;
+        size_t first = 1;
+        if (argc > 2 && (args[1] == "--session" || args[1] == "-s")) {
+            session_name = args[2];
+            first = 3;
+        }
+        std::string description = "Work session";
+        if (argc > first) {
+            description = "";
+            for (size_t i = first; i < argc; ++i) {
+                if (i > first) description += " ";
+                description += args[i];
+            }
+        }
+        if (!tracker.start_tracking(description, session_name)) return 1;
+        
+    } else if (command == "stop") {
+        if (argc > 1 && args[1] == "--all") {
+            tracker.stop_all();
+        } else if (!tracker.stop_tracking(argc > 1 ? args[1] : "")) {
+            return 1;
+        }
+        
+    } else if (command == "status") {
+        if (argc > 1 && args[1] == "--fast") {
+            if (!tracker.get_fast_status(argc > 2 ? args[2] : "")) return 1;
+        } else if (argc > 1 && args[1] == "--format") {
+            if (argc < 3) {
+                out << "Usage: " << program_name << " status --format FORMAT [name]\n";
+                return 1;
+            }
+            if (!tracker.get_fast_status(argc > 3 ? args[3] : "", args[2])) return 1;
+        } else {
+            tracker.get_status(argc > 1 ? args[1] : "");
+        }
+        
+    } else if (command == "report") {
+        if (argc > 1 && args[1].rfind("--", 0) == 0) {
+            std::string from, to, server, group_name, format_name;
+            bool tree = false;
+            bool heatmap = false;
+            bool by_hour = false;
+            for (size_t i = 1; i < argc; ++i) {
+                const std::string& option = args[i];
+                if (option == "--tree") {
+                    tree = true;
+                    continue;
+                }
+                if (option == "--heatmap" || option == "--by-hour") {
+                    (option == "--heatmap" ? heatmap : by_hour) = true;
+                    continue;
+                }
+                if (tree && option.rfind("--", 0) != 0 && from.empty() && to.empty()) {
+                    from = to = option; // report --tree DATE
+                    continue;
+                }
+                if (i + 1 >= argc) {
+                    out << "Missing value for " << option << "\n";
+                    return 1;
+                }
+                if (option == "--from") from = args[++i];
+                else if (option == "--to") to = args[++i];
+                else if (option == "--group-by") group_name = args[++i];
+                else if (option == "--server") server = args[++i];
+                else if (option == "--format") format_name = args[++i];
+                else {
+                    out << "Unknown report option: " << option << "\n";
+                    print_usage(program_name, out);
+                    return 1;
+                }
+            }
+            bool chart = heatmap || by_hour;
+            if (tree + heatmap + by_hour > 1) {
+                out << "Pick one of --tree, --heatmap and --by-hour\n";
+                return 1;
+            }
+            if ((tree || chart) && (!server.empty() || !group_name.empty())) {
+                out << (tree ? "--tree" : heatmap ? "--heatmap" : "--by-hour")
+                    << " cannot be combined with --server or --group-by\n";
+                return 1;
+            }
+            ChartFormat format = ChartFormat::Text;
+            if (!format_name.empty() && !chart) {
+                out << "--format needs --heatmap or --by-hour\n";
+                return 1;
+            }
+            if (!format_name.empty() && !parse_chart_format(format_name, format)) {
+                out << "Unknown --format value: " << format_name << "\n";
+                return 1;
+            }
+            // Charts cover the year to date: the 52 weeks before this one, and this one
+            if (chart && from.empty() && to.empty()) {
+                to = tracker.get_current_date();
+                int64_t today = 0;
+                iso_time::parse_day(to, today);
+                char first[iso_time::ISO_LENGTH];
+                iso_time::format_iso((today - iso_time::weekday(today) - 52 * 7) * 86400, first);
+                from.assign(first, 10);
+            }
+            if (group_name.empty()) group_name = "day";
+            GroupBy group_by;
+            if (!parse_group_by(group_name, group_by)) {
+                out << "Unknown --group-by value: " << group_name << "\n";
+                return 1;
+            }
+            // A missing bound defaults to today / the other bound
+            if (to.empty()) to = from.empty() ? tracker.get_current_date() : from;
+            if (from.empty()) from = to;
+            if (tree) {
+                tracker.generate_tree_report(from, to);
+            } else if (chart) {
+                tracker.generate_chart(from, to, by_hour, format);
+            } else if (!server.empty()) {
+                if (!tracker.generate_team_report(server, from, to, group_name)) return 1;
+            } else {
+                tracker.generate_range_report(from, to, group_by, group_name);
+            }
+        } else {
+            std::string date = (argc > 1) ? args[1] : "";
+            tracker.generate_daily_report(date);
+        }
+        
+    } else if (command == "search") {
+        size_t limit = 20;
+        size_t first = 1;
+        if (argc > 2 && args[1] == "--limit") {
+            auto parsed = std::from_chars(args[2].data(), args[2].data() + args[2].size(), limit);
+            if (parsed.ec != std::errc() || parsed.ptr != args[2].data() + args[2].size()) {
+                out << "Invalid --limit value: " << args[2] << "\n";
+                return 1;
+            }
+            first = 3;
+        }
+        if (argc <= first) {
+            out << "Usage: " << program_name << " search [--limit N] TERM...\n";
+            return 1;
+        }
+        tracker.search_sessions(std::vector<std::string>(args.begin() + first, args.end()), limit);
+        
+    } else if (command == "query") {
+        size_t limit = 20;
+        bool explain = false;
+        size_t first = 1;
+        for (; first < argc; ++first) {
+            if (args[first] == "--explain") {
+                explain = true;
+            } else if (args[first] == "--limit" && first + 1 < argc) {
+                const std::string& value = args[++first];
+                auto parsed = std::from_chars(value.data(), value.data() + value.size(), limit);
+                if (parsed.ec != std::errc() || parsed.ptr != value.data() + value.size()) {
+                    out << "Invalid --limit value: " << value << "\n";
+                    return 1;
+                }
+            } else {
+                break;
+            }
+        }
+        if (argc <= first) {
+            out << "Usage: " << program_name << " query [--limit N] [--explain] EXPRESSION\n";
+            return 1;
+        }
+        std::string expression;
+        for (size_t i = first; i < argc; ++i) expression += (i > first ? " " : "") + args[i];
+        tracker.query_sessions(expression, limit, explain);
+        
+    } else if (command == "remind") {
+        const char* usage = " remind in DELAY|at TIME MESSAGE... | list | cancel ID\n";
+        std::string action = argc > 1 ? args[1] : "";
+        if (action == "list" && argc == 2) {
+            tracker.list_reminders();
+        } else if (action == "cancel" && argc == 3) {
+            uint64_t id = 0;
+            auto parsed = std::from_chars(args[2].data(), args[2].data() + args[2].size(), id);
+            if (parsed.ec != std::errc() || parsed.ptr != args[2].data() + args[2].size()) {
+                out << "Invalid reminder id: " << args[2] << "\n";
+                return 1;
+            }
+            return tracker.cancel_reminder(id) ? 0 : 1;
+        } else if ((action == "in" || action == "at") && argc > 3) {
+            int64_t due = 0;
+            if (action == "in") {
+                int64_t delay = 0;
+                if (!parse_delay(args[2], delay)) {
+                    out << "Invalid delay: " << args[2] << " (e.g. 25m, 2h, 1h30m)\n";
+                    return 1;
+                }
+                due = ClockSnapshot(std::time(nullptr) + delay).local();
+            } else {
+                // HH:MM[:SS] is the next such time; a date makes it exact
+                std::string when = args[2];
+                if (when.size() == 5 || when.size() == 16) when += ":00";
+                int64_t seconds = 0;
+                if (when.size() == 8 && iso_time::parse_clock(when, seconds)) {
+                    int64_t local = ClockSnapshot::now().local();
+                    due = iso_time::day_of(local) * 86400 + seconds;
+                    if (due <= local) due += 86400;
+                } else if (when.size() != iso_time::ISO_LENGTH || !iso_time::parse_iso(when, due)) {
+                    out << "Invalid time: " << args[2] << " (HH:MM, or YYYY-MM-DDTHH:MM)\n";
+                    return 1;
+                }
+            }
+            std::string message;
+            for (size_t i = 3; i < argc; ++i) message += (i > 3 ? " " : "") + args[i];
+            tracker.add_reminder(due, message);
+        } else {
+            out << "Usage: " << program_name << usage;
+            return 1;
+        }
+        
+    } else if (command == "stats") {
+        bool json = argc > 1 && args[1] == "--json";
+        if (argc > 2 || (argc == 2 && !json)) {
+            out << "Usage: " << program_name << " stats [--json]\n";
+            return 1;
+        }
+        tracker.print_stats(json);
+        
+    } else if (command == "import-csv") {
+        tracker.import_csv(argc > 1 ? args[1] : "");
+        
+    } else if (command == "import") {
+        std::string name, path;
+        for (size_t i = 1; i < argc; ++i) {
+            if (args[i] == "--name" && i + 1 < argc) name = args[++i];
+            else if (path.empty()) path = args[i];
+            else {
+                out << "Usage: " << program_name << " import [--name USER] [file|-]\n";
+                return 1;
+            }
+        }
+        if (!tracker.import_sessions(path, name)) return 1;
+        
+    } else if (command == "export") {
+        std::string format_name = "json", from, to, path;
+        for (size_t i = 1; i < argc; ++i) {
+            const std::string& option = args[i];
+            if (i + 1 >= argc) {
+                out << "Missing value for " << option << "\n";
+                return 1;
+            }
+            if (option == "--format") format_name = args[++i];
+            else if (option == "--from") from = args[++i];
+            else if (option == "--to") to = args[++i];
+            else if (option == "--output") path = args[++i];
+            else {
+                out << "Unknown export option: " << option << "\n";
+                return 1;
+            }
+        }
+        ExportFormat format;
+        if (!parse_export_format(format_name, format)) {
+            out << "Unknown --format value: " << format_name << "\n";
+            return 1;
+        }
+        // A missing bound defaults to today / the other bound, as for report
+        if (to.empty()) to = from.empty() ? tracker.get_current_date() : from;
+        if (from.empty()) from = to;
+        if (!tracker.export_range(format, from, to, path)) return 1;
+        
+    } else if (command == "export-csv") {
+        tracker.export_csv(argc > 1 ? args[1] : "");
+        
+    } else if (command == "compact") {
+        std::string before, period = "month";
+        for (size_t i = 1; i < argc; ++i) {
+            const std::string& option = args[i];
+            if (i + 1 >= argc) {
+                out << "Missing value for " << option << "\n";
+                return 1;
+            }
+            if (option == "--before") before = args[++i];
+            else if (option == "--by") period = args[++i];
+            else {
+                out << "Unknown compact option: " << option << "\n";
+                return 1;
+            }
+        }
+        if (period != "month" && period != "year") {
+            out << "Unknown --by value: " << period << "\n";
+            return 1;
+        }
+        tracker.compact_log(before, period == "year");
+        
+    } else if (command == "team-server") {
+        return tracker.run_team_server(argc > 1 ? args[1] : LOOPBACK_HOST + (":" + std::to_string(TEAM_PORT)));
+        
+    } else if (command == "push") {
+        if (argc < 2) {
+            out << "Usage: " << program_name << " push HOST:PORT\n";
+            return 1;
+        }
+        if (!tracker.push_to_server(args[1])) return 1;
+        
+    } else if (command == "sync-server") {
+        return tracker.run_sync_server(argc > 1 ? args[1] : LOOPBACK_HOST + (":" + std::to_string(SYNC_PORT)));
+        
+    } else if (command == "sync") {
+        if (argc < 2) {
+            out << "Usage: " << program_name << " sync HOST:PORT\n";
+            return 1;
+        }
+        if (!tracker.sync_with_server(args[1])) return 1;
+        
+    } else if (command == "daemon") {
+        if (argc > 1 && args[1] == "stop") {
+            tracker.stop_daemon();
+        } else {
+            return tracker.run_daemon();
+        }
+        
+    } else {
+        out << "Unknown command: " << command << "\n";
+        print_usage(program_name, out);
+        return 1;
+    }
+    
+    return 0;
+}
+
+// bench.cpp includes this file and brings its own main
+#ifndef TIME_TRACKER_NO_MAIN
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    program_name = argv[0];
+    
+    try {
+        TimeTracker tracker;
+        std::vector<std::string> args(argv + 1, argv + argc);
+        const std::string& command = args[0];
+        
+        // Session commands go to the daemon; start brings one up if needed.
+        // Prompt-style status reads the daemon's status page instead.
+        // Setting a reminder also needs a daemon to show it.
+        bool page_status = command == "status" && args.size() > 1 &&
+                           (args[1] == "--fast" || args[1] == "--format");
+        bool set_reminder = command == "remind" && args.size() > 1 && (args[1] == "in" || args[1] == "at");
+        if ((command == "start" || command == "stop" || command == "status" || command == "report" ||
+             command == "search" || command == "stats" || command == "remind") && !page_status) {
+            std::string response;
+            int exit_code = 0;
+            if (tracker.call_daemon(args, response, exit_code, command == "start" || set_reminder)) {
+                std::cout << response << std::flush;
+                return exit_code;
+            }
+            // Only news when the daemon was wanted but could not be started
+            if (command == "start" && !TimeTracker::daemon_disabled()) {
+                std::cerr << "Notification daemon unavailable; no reminders will be sent.\n";
+            }
+        }
+        
+        int exit_code = run_command(tracker, args);
+        
+        // Give queued notifications a moment to be handed to the desktop
+        Notifier::instance().flush(std::chrono::seconds(1));
+        return exit_code;
+        
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+#endif
@@ -0,0 +1,247 @@
+/*
+ * Time Tracker - hierarchical timer wheel
+ *
+ * Holds the daemon's reminders, however many there are. Time is counted
+ * in ticks (the daemon uses Unix seconds). Level 0 has a slot per tick
+ * for the current 64-tick window, level 1 a slot per 64 ticks for the
+ * current 4096-tick window, and so on over four levels (2^24 ticks, about
+ * 194 days at one tick a second); later timers wait in an overflow list.
+ * A timer goes in the level of the highest bit its due time differs from
+ * now in, so every level's occupied slots lie ahead of its current one,
+ * and a level's timers are all due before the next level's.
+ *
+ * Scheduling and cancelling are O(1): slots are intrusive doubly linked
+ * lists over one node array, and a timer id names its node and the
+ * node's generation, so an id outlives its timer harmlessly. A timer is
+ * moved down a level at most three times before it fires. Each level
+ * keeps a bitmap of occupied slots, so next_due() finds the earliest
+ * timer without walking empty slots, and advance() jumps straight over
+ * them; the caller can sleep until exactly the next due time.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+template <typename T>
+class TimerWheel {
+public:
+    using Id = uint64_t; // never 0
+
+    static constexpr unsigned LEVEL_BITS = 6;
+    static constexpr unsigned LEVELS = 4;
+    static constexpr uint64_t NEVER = std::numeric_limits<uint64_t>::max();
+
+    explicit TimerWheel(uint64_t now) : now_(now) { heads_.fill(NIL); tails_.fill(NIL); }
+
+    uint64_t now() const { return now_; }
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+
+    // Adds a timer due at tick due; one already due fires on the next advance()
+    Id schedule(uint64_t due, T value) {
+        uint32_t index;
+        if (free_ != NIL) {
+            index = free_;
+            free_ = nodes_[index].next;
+        } else {
+            index = static_cast<uint32_t>(nodes_.size());
+            nodes_.emplace_back();
+        }
+        Node& node = nodes_[index];
+        node.due = due;
+        node.value = std::move(value);
+        place(index);
+        ++count_;
+        return static_cast<Id>(node.generation) << 32 | index;
+    }
+
+    // Removes a pending timer; false if it already fired or was cancelled
+    bool cancel(Id id) {
+        uint32_t index = static_cast<uint32_t>(id);
+        if (index >= nodes_.size() || nodes_[index].generation != static_cast<uint32_t>(id >> 32) ||
+            nodes_[index].list == FREE) {
+            return false;
+        }
+        unlink(index);
+        release(index);
+        return true;
+    }
+
+    bool pending(Id id) const {
+        uint32_t index = static_cast<uint32_t>(id);
+        return index < nodes_.size() && nodes_[index].generation == static_cast<uint32_t>(id >> 32) &&
+               nodes_[index].list != FREE;
+    }
+
+    // The earliest due tick of any timer (now() if one is overdue), or NEVER
+    uint64_t next_due() const {
+        if (heads_[DUE] != NIL) return now_;
+        for (unsigned level = 0; level < LEVELS; ++level) {
+            uint64_t ahead = occupied_ahead(level);
+            if (ahead == 0) continue;
+            unsigned slot = ctz(ahead);
+            // Level 0 slots are one tick wide; above, the slot holds a range
+            if (level == 0) return slot_start(0, slot);
+            return earliest(static_cast<uint16_t>(level * SLOTS + slot));
+        }
+        return heads_[OVERFLOW] != NIL ? earliest(OVERFLOW) : NEVER;
+    }
+
+    // Moves time forward to now (never back), calling fire(value) for
+    // every timer due by then in order of due tick. fire may schedule and
+    // cancel; a timer it schedules already due fires at the next tick
+    // with timers, or on the next call.
+    template <typename Fire>
+    size_t advance(uint64_t now, Fire&& fire) {
+        size_t fired = drain(DUE, fire);
+        if (now < now_) return fired;
+        for (uint64_t tick; (tick = next_event()) <= now;) {
+            now_ = tick;
+            // Highest level first, so its timers can land in the slots below
+            if (heads_[OVERFLOW] != NIL && (now_ & window_mask(LEVELS - 1)) == 0) cascade(OVERFLOW);
+            for (unsigned level = LEVELS - 1; level > 0; --level) {
+                if ((now_ & slot_mask(level)) != 0) continue;
+                cascade(static_cast<uint16_t>(level * SLOTS + slot_of(now_, level)));
+            }
+            fired += drain(static_cast<uint16_t>(slot_of(now_, 0)), fire);
+            fired += drain(DUE, fire); // moved down onto this very tick
+        }
+        now_ = now;
+        return fired;
+    }
+
+private:
+    static constexpr unsigned SLOTS = 1u << LEVEL_BITS;
+    static constexpr uint32_t NIL = std::numeric_limits<uint32_t>::max();
+    // Lists: level * SLOTS + slot, then these
+    static constexpr uint16_t DUE = LEVELS * SLOTS;
+    static constexpr uint16_t OVERFLOW = DUE + 1;
+    static constexpr uint16_t FREE = DUE + 2;
+
+    struct Node {
+        uint64_t due = 0;
+        uint32_t prev = NIL;
+        uint32_t next = NIL; // also links the free list
+        uint32_t generation = 1;
+        uint16_t list = FREE;
+        T value{};
+    };
+
+    static unsigned ctz(uint64_t bits) { return static_cast<unsigned>(__builtin_ctzll(bits)); }
+    static unsigned clz(uint64_t bits) { return static_cast<unsigned>(__builtin_clzll(bits)); }
+    // Ticks below a slot / a window of the given level
+    static uint64_t slot_mask(unsigned level) { return (uint64_t{1} << (level * LEVEL_BITS)) - 1; }
+    static uint64_t window_mask(unsigned level) { return (uint64_t{1} << ((level + 1) * LEVEL_BITS)) - 1; }
+    static unsigned slot_of(uint64_t tick, unsigned level) {
+        return static_cast<unsigned>(tick >> (level * LEVEL_BITS)) & (SLOTS - 1);
+    }
+
+    uint64_t slot_start(unsigned level, unsigned slot) const {
+        return (now_ & ~window_mask(level)) + (static_cast<uint64_t>(slot) << (level * LEVEL_BITS));
+    }
+
+    // Occupied slots of level after its current one
+    uint64_t occupied_ahead(unsigned level) const {
+        unsigned current = slot_of(now_, level);
+        return current + 1 == SLOTS ? 0 : occupied_[level] & (~uint64_t{0} << (current + 1));
+    }
+
+    // The next tick at which a slot's timers fire or move down a level
+    uint64_t next_event() const {
+        for (unsigned level = 0; level < LEVELS; ++level) {
+            uint64_t ahead = occupied_ahead(level);
+            if (ahead != 0) return slot_start(level, ctz(ahead));
+        }
+        if (heads_[OVERFLOW] == NIL) return NEVER;
+        return (now_ | window_mask(LEVELS - 1)) + 1;
+    }
+
+    uint64_t earliest(uint16_t list) const {
+        uint64_t due = NEVER;
+        for (uint32_t i = heads_[list]; i != NIL; i = nodes_[i].next) due = std::min(due, nodes_[i].due);
+        return due;
+    }
+
+    void place(uint32_t index) {
+        uint64_t due = nodes_[index].due;
+        uint16_t list = DUE;
+        if (due > now_) {
+            unsigned level = (63 - clz(due ^ now_)) / LEVEL_BITS;
+            list = level >= LEVELS ? OVERFLOW : static_cast<uint16_t>(level * SLOTS + slot_of(due, level));
+        }
+        Node& node = nodes_[index];
+        node.list = list;
+        node.next = NIL;
+        node.prev = tails_[list];
+        if (node.prev != NIL) nodes_[node.prev].next = index;
+        else heads_[list] = index;
+        tails_[list] = index;
+        if (list < DUE) occupied_[list / SLOTS] |= uint64_t{1} << (list % SLOTS);
+    }
+
+    void unlink(uint32_t index) {
+        Node& node = nodes_[index];
+        uint16_t list = node.list;
+        if (node.prev != NIL) nodes_[node.prev].next = node.next;
+        else heads_[list] = node.next;
+        if (node.next != NIL) nodes_[node.next].prev = node.prev;
+        else tails_[list] = node.prev;
+        if (list < DUE && heads_[list] == NIL) occupied_[list / SLOTS] &= ~(uint64_t{1} << (list % SLOTS));
+    }
+
+    void release(uint32_t index) {
+        Node& node = nodes_[index];
+        node.list = FREE;
+        node.value = T{};
+        ++node.generation;
+        node.next = free_;
+        free_ = index;
+        --count_;
+    }
+
+    // Takes a list's timers out and places them again for the current tick
+    void cascade(uint16_t list) {
+        uint32_t i = heads_[list];
+        heads_[list] = tails_[list] = NIL;
+        if (list < DUE) occupied_[list / SLOTS] &= ~(uint64_t{1} << (list % SLOTS));
+        while (i != NIL) {
+            uint32_t next = nodes_[i].next;
+            place(i);
+            i = next;
+        }
+    }
+
+    // Fires the timers a list holds when called, one at a time, so fire
+    // may cancel the rest or schedule more
+    template <typename Fire>
+    size_t drain(uint16_t list, Fire& fire) {
+        if (heads_[list] == NIL) return 0;
+        uint32_t last = tails_[list];
+        Id last_id = static_cast<Id>(nodes_[last].generation) << 32 | last;
+        size_t fired = 0;
+        while (pending(last_id)) {
+            uint32_t i = heads_[list];
+            unlink(i);
+            T value = std::move(nodes_[i].value);
+            release(i);
+            fire(std::move(value));
+            ++fired;
+        }
+        return fired;
+    }
+
+    uint64_t now_;
+    size_t count_ = 0;
+    std::vector<Node> nodes_;
+    uint32_t free_ = NIL;
+    std::array<uint32_t, LEVELS * SLOTS + 2> heads_;
+    std::array<uint32_t, LEVELS * SLOTS + 2> tails_;
+    std::array<uint64_t, LEVELS> occupied_{};
+};